@@ -0,0 +1,30 @@
+/**
+ * @file random_game.h
+ * @brief Contains the generator of random games the benchmarks take their positions and moves from.
+ */
+#pragma once
+
+#include "checkers_engine.h"
+
+#include <random>
+
+/**
+ * @brief Plays a game of random legal moves from the initial position.
+ * Benchmarks that need the positions replay the moves through their own engine.
+ * @param random The random number generator.
+ * @param max_plies The length limit of the game.
+ * @return The moves of the game, ending early if the side to move has none.
+ */
+inline MoveList random_game(std::mt19937& random, size_t max_plies) {
+  checkers_engine engine;
+  engine.reset();
+  MoveList moves;
+  while (moves.size() < max_plies) {
+    const MoveList legal = engine.valid_moves();
+    if (legal.empty()) break;
+    const Move move = legal[random() % legal.size()];
+    engine.make_move(move);
+    moves.push_back(move);
+  }
+  return moves;
+}
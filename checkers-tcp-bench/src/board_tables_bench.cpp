@@ -0,0 +1,157 @@
+/**
+ * @file board_tables_bench.cpp
+ * @brief Compares the per-spot tables of board.h with bitboard shifts, operation by operation.
+ *
+ * Each operation is implemented both ways on the same positions. The checksums of both ways
+ * must agree, the times decide which one checkers_engine uses.
+ */
+
+#include "board.h"
+#include "checkers_engine.h"
+#include "random_game.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief A position with a piece and a jump to query.
+ */
+struct Query {
+  Bitboard own;
+  Bitboard opponent;
+  Bitboard empty;
+  SpotIndex spot;
+  Move capture;
+};
+
+Bitboard steps_by_shift(Bitboard piece, Bitboard empty) {
+  return (shift(piece & NE_MOVES_MASK, NORTH_EAST) & empty) | (shift(piece & NW_MOVES_MASK, NORTH_WEST) & empty) |
+         (shift(piece & SE_MOVES_MASK, SOUTH_EAST) & empty) | (shift(piece & SW_MOVES_MASK, SOUTH_WEST) & empty);
+}
+
+Bitboard steps_by_table(SpotIndex spot, Bitboard empty) { return SPOT_TABLES[spot].king_steps & empty; }
+
+Bitboard captures_by_shift(Bitboard piece, Bitboard opponent, Bitboard empty) {
+  return (shift(shift(piece & NE_ATTACKS_MASK, NORTH_EAST) & opponent, NORTH_EAST) & empty) |
+         (shift(shift(piece & NW_ATTACKS_MASK, NORTH_WEST) & opponent, NORTH_WEST) & empty) |
+         (shift(shift(piece & SE_ATTACKS_MASK, SOUTH_EAST) & opponent, SOUTH_EAST) & empty) |
+         (shift(shift(piece & SW_ATTACKS_MASK, SOUTH_WEST) & opponent, SOUTH_WEST) & empty);
+}
+
+Bitboard captures_by_table(SpotIndex spot, Bitboard opponent, Bitboard empty) {
+  const SpotTable& table = SPOT_TABLES[spot];
+  Bitboard captures = 0;
+  for (int direction = 0; direction < DIRECTIONS_NUMBER; ++direction) {
+    captures |= table.jump[direction] & (Bitboard(0) - Bitboard((table.jumped[direction] & opponent) != 0));
+  }
+  return captures & empty;
+}
+
+SpotIndex captured_by_shift(const Move& move) {
+  const auto from_bit = spot_index_to_bit[move.from];
+  const auto to_bit = spot_index_to_bit[move.to];
+  if (shift(shift(from_bit, NORTH_WEST), NORTH_WEST) & to_bit) return bit_to_spot_index(shift(from_bit, NORTH_WEST));
+  if (shift(shift(from_bit, NORTH_EAST), NORTH_EAST) & to_bit) return bit_to_spot_index(shift(from_bit, NORTH_EAST));
+  if (shift(shift(from_bit, SOUTH_WEST), SOUTH_WEST) & to_bit) return bit_to_spot_index(shift(from_bit, SOUTH_WEST));
+  if (shift(shift(from_bit, SOUTH_EAST), SOUTH_EAST) & to_bit) return bit_to_spot_index(shift(from_bit, SOUTH_EAST));
+  return SPOTS_NUMBER;
+}
+
+SpotIndex captured_by_table(const Move& move) {
+  return SPOT_TABLES[move.from].jumped_spot_by_landing[move.to];
+}
+
+Bitboard all_captures_by_table(Bitboard own, Bitboard opponent, Bitboard empty) {
+  Bitboard captures = 0;
+  for (const SpotIndex spot : SpotsBitIterator(own)) captures |= captures_by_table(spot, opponent, empty);
+  return captures;
+}
+
+/**
+ * @brief Collects queries from games of random legal moves.
+ */
+std::vector<Query> random_queries(std::mt19937& random, size_t game_count) {
+  std::vector<Query> queries;
+  for (size_t game = 0; game < game_count; ++game) {
+    checkers_engine engine;
+    engine.reset();
+    for (const Move& move : random_game(random, 200)) {
+      Query query;
+      query.own = engine.pieces_bitboard(engine.turn);
+      query.opponent = engine.pieces_bitboard(~engine.turn);
+      query.empty = ~(query.own | query.opponent);
+      query.spot = move.from;
+      // Every spot pair with a jump between them, whether or not it is legal here.
+      const SpotTable& table = SPOT_TABLES[move.from];
+      const int direction = int(random() % DIRECTIONS_NUMBER);
+      query.capture = Move(move.from, table.jump[direction] ? table.jump_spot[direction] : move.to, MoveType::CAPTURE);
+      queries.push_back(query);
+      engine.make_move(move);
+    }
+  }
+  return queries;
+}
+
+/**
+ * @brief Times an operation over all queries.
+ * @return The operations per second and the checksum.
+ */
+template <typename Operation>
+std::pair<double, uint64_t> measure(const std::vector<Query>& queries, size_t rounds, Operation operation) {
+  uint64_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round) {
+    for (const Query& query : queries) checksum += operation(query);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return {double(rounds * queries.size()) / elapsed.count(), checksum};
+}
+
+}
+
+int main(int argc, char** argv) {
+  const size_t rounds = argc > 1 ? std::stoul(argv[1]) : 50;
+  std::mt19937 random(42);
+  const std::vector<Query> queries = random_queries(random, 1000);
+
+  struct Row {
+    const char* name;
+    std::pair<double, uint64_t> by_shift;
+    std::pair<double, uint64_t> by_table;
+  };
+  const Row rows[] = {
+    {"single-piece steps",
+     measure(queries, rounds, [](const Query& q) { return steps_by_shift(spot_index_to_bit[q.spot], q.empty); }),
+     measure(queries, rounds, [](const Query& q) { return steps_by_table(q.spot, q.empty); })},
+    {"single-piece captures",
+     measure(queries, rounds, [](const Query& q) { return captures_by_shift(spot_index_to_bit[q.spot], q.opponent, q.empty); }),
+     measure(queries, rounds, [](const Query& q) { return captures_by_table(q.spot, q.opponent, q.empty); })},
+    {"captured index",
+     measure(queries, rounds, [](const Query& q) { return captured_by_shift(q.capture); }),
+     measure(queries, rounds, [](const Query& q) { return captured_by_table(q.capture); })},
+    {"all-pieces captures",
+     measure(queries, rounds, [](const Query& q) { return captures_by_shift(q.own, q.opponent, q.empty); }),
+     measure(queries, rounds, [](const Query& q) { return all_captures_by_table(q.own, q.opponent, q.empty); })},
+  };
+
+  fmt::print("queries: {}, rounds: {}\n", queries.size(), rounds);
+  fmt::print("{:<24}{:>16}{:>16}  faster\n", "operation", "shift ops/s", "table ops/s");
+  int exit_code = 0;
+  for (const Row& row : rows) {
+    if (row.by_shift.second != row.by_table.second) {
+      fmt::print(stderr, "{}: checksums differ, {} by shift and {} by table\n", row.name, row.by_shift.second,
+                 row.by_table.second);
+      exit_code = 1;
+    }
+    fmt::print("{:<24}{:>16.0f}{:>16.0f}  {}\n", row.name, row.by_shift.first, row.by_table.first,
+               row.by_table.first > row.by_shift.first ? "table" : "shift");
+  }
+  return exit_code;
+}
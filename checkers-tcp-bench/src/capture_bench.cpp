@@ -0,0 +1,112 @@
+/**
+ * @file capture_bench.cpp
+ * @brief Measures make_move() on single jumps while checking that every jump removes the piece it jumps over.
+ *
+ * For every spot and direction with a landing square, a lone king jumps a lone man. The man must
+ * be gone, the king must stand on the landing square, the turn must pass and the incremental hash
+ * must equal the hash of the resulting position set up from scratch. Jumps across the wrap of the
+ * rotated bitboard, such as spot 9 to spot 0, are the ones a shift-based removal gets wrong.
+ */
+
+#include "board.h"
+#include "checkers_engine.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A lone king of the side to move next to a lone man it can jump.
+ */
+struct Jump {
+  Position position;
+  Move move;
+  SpotIndex jumped;
+};
+
+/**
+ * @brief Sets up every single jump of the board, both colors jumping.
+ * @return The jumps.
+ */
+static std::vector<Jump> all_jumps() {
+  std::vector<Jump> jumps;
+  for (const Color color : {WHITE, BLACK}) {
+    for (SpotIndex from = 0; from < SPOTS_NUMBER; ++from) {
+      const SpotTable& table = SPOT_TABLES[from];
+      for (int direction = 0; direction < DIRECTIONS_NUMBER; ++direction) {
+        if (!table.jump[direction]) continue;
+        const Bitboard king = spot_index_to_bit[from];
+        const Bitboard man = table.jumped[direction];
+        const Bitboard white = color == WHITE ? king : man;
+        const Bitboard black = color == WHITE ? man : king;
+        jumps.push_back({Position(white, black, king, color), Move(from, table.jump_spot[direction], MoveType::CAPTURE),
+                         table.jumped_spot[direction]});
+      }
+    }
+  }
+  return jumps;
+}
+
+/**
+ * @brief Makes a jump and checks the resulting position.
+ * @param jump The jump.
+ * @return True if only the jumping king is left on the landing square with the turn passed and a
+ * matching hash, false otherwise.
+ */
+static bool check_jump(const Jump& jump) {
+  const Color color = jump.position.side_to_move();
+  checkers_engine engine(jump.position);
+  if (!engine.is_valid(jump.move) || engine.get_captured_index(jump.move) != jump.jumped) {
+    fmt::print(stderr, "{}: {}x{} isn't a capture of spot {}\n", jump.position.to_fen(), jump.move.from + 1,
+               jump.move.to + 1, jump.jumped + 1);
+    return false;
+  }
+  engine.make_move(jump.move);
+  const Position expected(color == WHITE ? spot_index_to_bit[jump.move.to] : 0,
+                          color == BLACK ? spot_index_to_bit[jump.move.to] : 0, spot_index_to_bit[jump.move.to],
+                          color == WHITE ? BLACK : WHITE);
+  if (engine.position() != expected || engine.hash() != checkers_engine(expected).hash()) {
+    fmt::print(stderr, "{}: {}x{} left {} instead of {}\n", jump.position.to_fen(), jump.move.from + 1,
+               jump.move.to + 1, engine.position().to_fen(), expected.to_fen());
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const size_t rounds = argc > 1 ? std::stoul(argv[1]) : 100000;
+  const std::vector<Jump> jumps = all_jumps();
+  size_t wrapping = 0;
+  for (const Jump& jump : jumps) {
+    if (!check_jump(jump)) {
+      return 1;
+    }
+    wrapping += jump.move.from == 9 && jump.move.to == 0;
+  }
+  if (wrapping == 0) {
+    fmt::print(stderr, "The jump from spot 9 to spot 0 wasn't checked\n");
+    return 1;
+  }
+
+  std::vector<checkers_engine> engines;
+  for (const Jump& jump : jumps) {
+    engines.emplace_back(jump.position);
+  }
+  uint64_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round) {
+    for (size_t i = 0; i < jumps.size(); ++i) {
+      checkers_engine engine = engines[i];
+      engine.make_move(jumps[i].move);
+      checksum += engine.hash();
+    }
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+  fmt::print("jumps: {}, rounds: {} (checksum {:016x})\n", jumps.size(), rounds, checksum);
+  fmt::print("copy + make_move: {:6.1f} ns/jump\n", elapsed.count() / double(rounds * jumps.size()));
+  return 0;
+}
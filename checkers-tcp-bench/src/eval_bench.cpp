@@ -0,0 +1,76 @@
+/**
+ * @file eval_bench.cpp
+ * @brief Measures the incremental evaluation against computing every term from scratch.
+ */
+
+#include "checkers_engine.h"
+#include "evaluation.h"
+#include "random_game.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Collects the positions of games of random legal moves.
+ * @param random The random number generator.
+ * @param game_count The number of games.
+ * @return The positions.
+ */
+static std::vector<checkers_engine> random_positions(std::mt19937& random, size_t game_count) {
+  std::vector<checkers_engine> positions;
+  for (size_t game = 0; game < game_count; ++game) {
+    checkers_engine engine;
+    engine.reset();
+    for (const Move& move : random_game(random, 200)) {
+      engine.make_move(move);
+      positions.push_back(engine);
+    }
+  }
+  return positions;
+}
+
+int main(int argc, char** argv) {
+  const size_t rounds = argc > 1 ? std::stoul(argv[1]) : 20;
+
+  std::mt19937 random(42);
+  const std::vector<checkers_engine> positions = random_positions(random, 1000);
+
+  for (size_t i = 0; i < positions.size(); ++i) {
+    const checkers_engine& engine = positions[i];
+    const int from_scratch = evaluation_terms(engine).total();
+    const int incremental = engine.turn == BLACK ? -evaluate(engine) : evaluate(engine);
+    if (from_scratch != incremental) {
+      fmt::print(stderr, "Evaluation mismatch at position {}: {} incremental, {} from scratch\n", i, incremental,
+                 from_scratch);
+      return 1;
+    }
+  }
+
+  long long checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round) {
+    for (const checkers_engine& engine : positions) {
+      checksum += evaluate(engine);
+    }
+  }
+  const std::chrono::duration<double> incremental_time = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round) {
+    for (const checkers_engine& engine : positions) {
+      checksum -= evaluation_terms(engine).total() * (engine.turn == BLACK ? -1 : 1);
+    }
+  }
+  const std::chrono::duration<double> scratch_time = std::chrono::steady_clock::now() - start;
+
+  const double evals = double(rounds * positions.size());
+  fmt::print("positions: {}, rounds: {}, checksum: {}\n", positions.size(), rounds, checksum);
+  fmt::print("incremental:  {:12.0f} evals/s\n", evals / incremental_time.count());
+  fmt::print("from scratch: {:12.0f} evals/s\n", evals / scratch_time.count());
+  return checksum == 0 ? 0 : 1;
+}
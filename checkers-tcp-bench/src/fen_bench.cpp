@@ -0,0 +1,128 @@
+/**
+ * @file fen_bench.cpp
+ * @brief Measures formatting positions as FEN and parsing them back.
+ *
+ * Every position of a set of random games must parse back to itself, and the side to move must
+ * survive the packing into the kings bitboard. A few hand-written texts check ranges, kings and
+ * the rejection of malformed FEN.
+ */
+
+#include "checkers_engine.h"
+#include "position.h"
+#include "random_game.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief A FEN text and the canonical form it must parse to, nothing if it must be rejected.
+ */
+struct FenCase {
+  std::string_view text;
+  std::optional<std::string_view> canonical;
+};
+
+/**
+ * @brief Hand-written texts: ranges, kings, both color orders and malformed FEN.
+ */
+static constexpr FenCase FEN_CASES[] = {
+  {"B:W21-32:B1-12", "B:W21,22,23,24,25,26,27,28,29,30,31,32:B1,2,3,4,5,6,7,8,9,10,11,12"},
+  {"W:W21,K30:B1-3,12", "W:W21,K30:B1,2,3,12"},
+  {"W:BK1:W2", "W:W2:BK1"},
+  {"", std::nullopt},
+  {"X:W1:B2", std::nullopt},
+  {"B:W1:B1", std::nullopt},
+  {"B:W33:B1", std::nullopt},
+  {"B:W1-:B2", std::nullopt},
+  {"B:WK:B1", std::nullopt},
+  {"B:W3-1:B5", std::nullopt},
+};
+
+/**
+ * @brief Collects the positions of games of random legal moves.
+ * @param random The random number generator.
+ * @param game_count The number of games.
+ * @return The positions, both sides to move.
+ */
+static std::vector<Position> random_positions(std::mt19937& random, size_t game_count) {
+  std::vector<Position> positions;
+  for (size_t game = 0; game < game_count; ++game) {
+    checkers_engine engine;
+    engine.reset();
+    positions.push_back(engine.position());
+    for (const Move& move : random_game(random, 200)) {
+      engine.make_move(move);
+      positions.push_back(engine.position());
+    }
+  }
+  return positions;
+}
+
+/**
+ * @brief Parses the hand-written texts.
+ * @return True if every text parsed to its canonical form or was rejected as expected, false otherwise.
+ */
+static bool check_fen_cases() {
+  for (const FenCase& fen_case : FEN_CASES) {
+    const auto position = Position::from_fen(fen_case.text);
+    const std::string parsed = position ? position->to_fen() : "nothing";
+    if (position.has_value() != fen_case.canonical.has_value() || (position && parsed != *fen_case.canonical)) {
+      fmt::print(stderr, "'{}' parsed to {}\n", fen_case.text, parsed);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const size_t rounds = argc > 1 ? std::stoul(argv[1]) : 20;
+  if (!check_fen_cases()) {
+    return 1;
+  }
+
+  std::mt19937 random(42);
+  const std::vector<Position> positions = random_positions(random, 1000);
+  std::vector<std::string> texts(positions.size());
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round) {
+    for (size_t i = 0; i < positions.size(); ++i) {
+      texts[i] = positions[i].to_fen();
+    }
+  }
+  const std::chrono::duration<double> format_time = std::chrono::steady_clock::now() - start;
+
+  size_t checksum = 0;
+  start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round) {
+    for (size_t i = 0; i < positions.size(); ++i) {
+      const auto parsed = Position::from_fen(texts[i]);
+      if (!parsed || *parsed != positions[i]) {
+        fmt::print(stderr, "'{}' doesn't parse back to the position it was formatted from\n", texts[i]);
+        return 1;
+      }
+      checksum += parsed->side_to_move();
+    }
+  }
+  const std::chrono::duration<double> parse_time = std::chrono::steady_clock::now() - start;
+
+  for (const Position& position : positions) {
+    if (checkers_engine(position).position() != position) {
+      fmt::print(stderr, "'{}' changes when loaded into the engine\n", position.to_fen());
+      return 1;
+    }
+  }
+
+  const double conversions = double(rounds * positions.size());
+  fmt::print("positions: {}, rounds: {} (checksum {})\n", positions.size(), rounds, checksum);
+  fmt::print("to_fen:   {:12.0f} positions/s\n", conversions / format_time.count());
+  fmt::print("from_fen: {:12.0f} positions/s\n", conversions / parse_time.count());
+  return 0;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file frame_decoder_bench.cpp
+ * @brief Measures splitting a received byte stream into frames with FrameDecoder.
+ *
+ * A stream of v1 frames followed by v2 frames is fed in chunks of every size from one byte up.
+ * The frames taken out must match the frames written, whatever the chunk size, and missing()
+ * must never ask for bytes past the end of the frame being completed. A malformed header after
+ * the last frame must be reported once the frames before it are taken out.
+ */
+
+#include "frame.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A frame of the stream.
+ */
+struct StreamFrame {
+  uint8_t version;
+  MessageType message_type;
+  std::vector<uint8_t> payload;
+};
+
+/**
+ * @brief Number of v1 frames at the start of the stream, as before a HELLO switches the connection to v2.
+ */
+static constexpr size_t V1_FRAMES = 4;
+
+/**
+ * @brief Writes random frames, mostly short ones, with a few at the payload limit.
+ * @param random The random number generator.
+ * @param frame_count The number of frames.
+ * @return The frames.
+ */
+static std::vector<StreamFrame> random_frames(std::mt19937& random, size_t frame_count) {
+  std::vector<StreamFrame> frames;
+  for (size_t i = 0; i < frame_count; ++i) {
+    StreamFrame& frame = frames.emplace_back();
+    frame.version = i < V1_FRAMES ? PROTOCOL_V1 : PROTOCOL_V2;
+    frame.message_type = MessageType(random() % (MessageType::PONG + 1));
+    size_t length = random() % 16;
+    if (frame.version == PROTOCOL_V2 && i % 16 == 0) {
+      length = i % 64 == 0 ? MAX_FRAME_PAYLOAD : 0x80 + random() % 0x200;
+    }
+    frame.payload.resize(length);
+    for (uint8_t& byte : frame.payload) {
+      byte = uint8_t(random());
+    }
+  }
+  return frames;
+}
+
+/**
+ * @brief Concatenates the frames into the byte stream a peer would send.
+ * @param frames The frames.
+ * @param frame_ends The stream offset after each frame.
+ * @return The stream.
+ */
+static std::vector<uint8_t> write_stream(const std::vector<StreamFrame>& frames, std::vector<size_t>& frame_ends) {
+  std::vector<uint8_t> stream;
+  uint8_t header[MAX_FRAME_HEADER];
+  for (const StreamFrame& frame : frames) {
+    const size_t header_len = encode_frame_header(frame.message_type, frame.payload.size(), frame.version, header);
+    stream.insert(stream.end(), header, header + header_len);
+    stream.insert(stream.end(), frame.payload.begin(), frame.payload.end());
+    frame_ends.push_back(stream.size());
+  }
+  return stream;
+}
+
+/**
+ * @brief Feeds the stream to a decoder in chunks of one size.
+ * @param stream The stream, possibly followed by a malformed header.
+ * @param frames The frames written to the stream.
+ * @param frame_ends The stream offset after each frame.
+ * @param chunk_size The size of every chunk but the last.
+ * @param malformed True if the stream ends in a malformed header.
+ * @return True if every frame was taken out unchanged, missing() never reached past a frame and
+ * the stream ended as expected, false otherwise.
+ */
+static bool check_chunks(const std::vector<uint8_t>& stream, const std::vector<StreamFrame>& frames,
+                         const std::vector<size_t>& frame_ends, size_t chunk_size, bool malformed) {
+  FrameDecoder decoder;
+  size_t taken = 0;
+  size_t received = 0;
+  bool rejected = false;
+  while (received < stream.size() && !rejected) {
+    const size_t chunk = std::min(chunk_size, stream.size() - received);
+    decoder.append({stream.data() + received, chunk});
+    received += chunk;
+    for (;;) {
+      const uint8_t version = taken < frames.size() ? frames[taken].version : PROTOCOL_V2;
+      // The buffered bytes start at the frame being completed, so they end at received.
+      const size_t missing = decoder.missing(version);
+      if (taken < frames.size() && (received < frame_ends[taken] ? missing == 0 || received + missing > frame_ends[taken]
+                                                                 : missing != 0)) {
+        fmt::print(stderr, "Chunks of {}: frame {} asks for {} bytes with {} of its {} received\n", chunk_size, taken,
+                   missing, received, frame_ends[taken]);
+        return false;
+      }
+      FrameHeader header;
+      std::span<const uint8_t> payload;
+      const FrameDecoder::Status status = decoder.next(version, header, payload);
+      if (status == FrameDecoder::NEED_MORE) break;
+      if (status == FrameDecoder::MALFORMED) {
+        rejected = true;
+        break;
+      }
+      if (taken == frames.size() || header.message_type != frames[taken].message_type ||
+          !std::equal(payload.begin(), payload.end(), frames[taken].payload.begin(), frames[taken].payload.end())) {
+        fmt::print(stderr, "Chunks of {}: frame {} doesn't match the frame written\n", chunk_size, taken);
+        return false;
+      }
+      ++taken;
+    }
+  }
+  if (taken != frames.size() || rejected != malformed || (!malformed && decoder.buffered() != 0)) {
+    fmt::print(stderr, "Chunks of {}: took {} of {} frames, {} buffered, malformed {}\n", chunk_size, taken,
+               frames.size(), decoder.buffered(), rejected);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const size_t rounds = argc > 1 ? std::stoul(argv[1]) : 200;
+  std::mt19937 random(42);
+  const std::vector<StreamFrame> frames = random_frames(random, 256);
+  std::vector<size_t> frame_ends;
+  std::vector<uint8_t> stream = write_stream(frames, frame_ends);
+
+  const size_t max_chunk = MAX_FRAME_PAYLOAD + 2 * MAX_FRAME_HEADER;
+  for (size_t chunk_size = 1; chunk_size <= max_chunk; chunk_size += chunk_size < 64 ? 1 : 61) {
+    if (!check_chunks(stream, frames, frame_ends, chunk_size, false)) {
+      return 1;
+    }
+  }
+  // A length past the limit after the last frame.
+  std::vector<uint8_t> malformed_stream = stream;
+  malformed_stream.insert(malformed_stream.end(), {MessageType::MOVE, 0x81, 0x80, 0x01});
+  for (const size_t chunk_size : {size_t(1), size_t(7), size_t(1500), malformed_stream.size()}) {
+    if (!check_chunks(malformed_stream, frames, frame_ends, chunk_size, true)) {
+      return 1;
+    }
+  }
+
+  // Chunks of a typical segment size.
+  constexpr size_t SEGMENT = 1448;
+  FrameDecoder decoder;
+  size_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round) {
+    size_t taken = 0;
+    for (size_t received = 0; received < stream.size(); received += SEGMENT) {
+      decoder.append({stream.data() + received, std::min(SEGMENT, stream.size() - received)});
+      FrameHeader header;
+      std::span<const uint8_t> payload;
+      while (decoder.next(taken < V1_FRAMES ? PROTOCOL_V1 : PROTOCOL_V2, header, payload) == FrameDecoder::FRAME) {
+        checksum += payload.size();
+        ++taken;
+      }
+    }
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+  fmt::print("frames: {}, stream: {} bytes, rounds: {} (checksum {})\n", frames.size(), stream.size(), rounds,
+             checksum);
+  fmt::print("append + next: {:8.1f} ns/frame, {:6.2f} ns/byte\n", elapsed.count() / double(rounds * frames.size()),
+             elapsed.count() / double(rounds * stream.size()));
+  return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file frame_header_bench.cpp
+ * @brief Measures encoding and decoding frame headers of both protocol versions.
+ *
+ * Every payload length up to MAX_FRAME_PAYLOAD must decode back from its v2 header, which has
+ * the expected length and is the v1 header below 128. Every prefix of a header must ask for more
+ * bytes, and lengths above the limit or varints longer than three bytes must be rejected.
+ */
+
+#include "frame.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A v2 header the decoder must reject.
+ */
+struct MalformedHeader {
+  const char* what;
+  std::vector<uint8_t> bytes;
+};
+
+/**
+ * @brief Gets the expected v2 header length of a payload length.
+ * @param payload_len The payload length.
+ * @return The type byte and one varint byte per 7 bits.
+ */
+static size_t expected_header_len(size_t payload_len) {
+  return payload_len < 0x80 ? 2 : payload_len < 0x4000 ? 3 : 4;
+}
+
+/**
+ * @brief Encodes and decodes every payload length of both versions, and every prefix of the headers.
+ * @return True if every header decodes back to its length and every prefix asks for more bytes, false otherwise.
+ */
+static bool check_round_trip() {
+  uint8_t bytes[MAX_FRAME_HEADER];
+  for (size_t payload_len = 0; payload_len <= MAX_FRAME_PAYLOAD; ++payload_len) {
+    for (const uint8_t version : {PROTOCOL_V1, PROTOCOL_V2}) {
+      if (version == PROTOCOL_V1 && payload_len > 0xff) continue;
+      const size_t header_len = encode_frame_header(MessageType::MOVE_BATCH, payload_len, version, bytes);
+      const size_t expected_len = version == PROTOCOL_V1 ? 2 : expected_header_len(payload_len);
+      FrameHeader header;
+      const int decoded = decode_frame_header({bytes, header_len}, version, header);
+      if (header_len != expected_len || decoded != int(header_len) || header.payload_len != payload_len ||
+          header.message_type != MessageType::MOVE_BATCH) {
+        fmt::print(stderr, "v{} length {}: {}-byte header decoded as {} bytes, length {}\n", version, payload_len,
+                   header_len, decoded, header.payload_len);
+        return false;
+      }
+      for (size_t prefix = 0; prefix < header_len; ++prefix) {
+        if (decode_frame_header({bytes, prefix}, version, header) != 0) {
+          fmt::print(stderr, "v{} length {}: the first {} header bytes don't ask for more\n", version, payload_len,
+                     prefix);
+          return false;
+        }
+      }
+    }
+    if (payload_len < 0x80) {
+      uint8_t v1_bytes[MAX_FRAME_HEADER];
+      encode_frame_header(MessageType::MOVE_BATCH, payload_len, PROTOCOL_V1, v1_bytes);
+      if (v1_bytes[1] != bytes[1]) {
+        fmt::print(stderr, "Length {} encodes differently in v1 and v2\n", payload_len);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Decodes headers past the limits.
+ * @return True if every one is rejected, false otherwise.
+ */
+static bool check_malformed() {
+  const MalformedHeader malformed[] = {
+    {"one past MAX_FRAME_PAYLOAD", {MessageType::MOVE, 0x81, 0x80, 0x01}},
+    {"the largest three-byte varint", {MessageType::MOVE, 0xff, 0xff, 0x7f}},
+    {"a four-byte varint of zero", {MessageType::MOVE, 0x80, 0x80, 0x80, 0x00}},
+    {"a varint that never ends", {MessageType::MOVE, 0xff, 0xff, 0xff, 0xff, 0xff}},
+  };
+  for (const MalformedHeader& header_case : malformed) {
+    FrameHeader header;
+    if (const int decoded = decode_frame_header(header_case.bytes, PROTOCOL_V2, header); decoded != -1) {
+      fmt::print(stderr, "{} decoded as {} bytes, length {}\n", header_case.what, decoded, header.payload_len);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 10000000;
+  if (!check_round_trip() || !check_malformed()) {
+    return 1;
+  }
+
+  // Mostly short frames, as on a live connection, with a tail of long ones.
+  std::mt19937 random(42);
+  std::vector<size_t> lengths(4096);
+  for (size_t& length : lengths) {
+    length = random() % 8 == 0 ? random() % (MAX_FRAME_PAYLOAD + 1) : random() % 0x80;
+  }
+
+  uint8_t bytes[MAX_FRAME_HEADER];
+  size_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    const size_t header_len = encode_frame_header(MessageType::MOVE, lengths[i % lengths.size()], PROTOCOL_V2, bytes);
+    FrameHeader header;
+    checksum += size_t(decode_frame_header({bytes, header_len}, PROTOCOL_V2, header)) + header.payload_len;
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+  fmt::print("headers: {} (checksum {})\n", iterations, checksum);
+  fmt::print("v2 encode + decode: {:6.1f} ns/header\n", elapsed.count() / double(iterations));
+  return 0;
+}
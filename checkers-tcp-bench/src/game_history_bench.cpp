@@ -0,0 +1,195 @@
+/**
+ * @file game_history_bench.cpp
+ * @brief Measures recording positions in GameHistory and asking it for draws, as a session does after each move.
+ *
+ * Two scripted king endings check the draw rules: shuffling back and forth draws by repetition
+ * on the third occurrence, and a walk that never repeats draws by the move limit on the 80th
+ * reversible ply unless a man move resets it first.
+ */
+
+#include "checkers_engine.h"
+#include "game_history.h"
+#include "position.h"
+#include "random_game.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief A king ending far from any capture, engine WHITE to move.
+ */
+constexpr std::string_view KINGS_ENDING = "B:WK29,K30:BK3,K4";
+
+/**
+ * @brief The same ending with a white man that can still move.
+ */
+constexpr std::string_view KINGS_AND_MAN_ENDING = "B:WK29,K30:BK3,K4,9";
+
+/**
+ * @brief Checks whether the side to move has a capture.
+ */
+bool has_capture(const checkers_engine& engine) {
+  const MoveList moves = engine.valid_moves();
+  return std::any_of(moves.begin(), moves.end(), [](const Move& move) { return move.type & MoveType::CAPTURE; });
+}
+
+/**
+ * @brief Plays a king step that gives no capture away and doesn't reach a position seen twice.
+ * @return True if such a step was played, false if there is none.
+ */
+bool play_king_walk(checkers_engine& engine, GameHistory& history, std::unordered_map<uint64_t, int>& seen,
+                    std::mt19937& random) {
+  std::vector<checkers_engine> candidates;
+  for (const Move& move : engine.valid_moves()) {
+    if (move.type != MoveType::NORMAL || !(engine.position().kings() & spot_index_to_bit[move.from])) continue;
+    checkers_engine next = engine;
+    next.make_move(move);
+    if (!has_capture(next) && seen[next.hash()] < 2) candidates.push_back(next);
+  }
+  if (candidates.empty()) return false;
+  engine = candidates[random() % candidates.size()];
+  ++seen[engine.hash()];
+  history.push(engine);
+  return true;
+}
+
+/**
+ * @brief Shuffles both sides' kings one step out and back until the start position occurs a third time.
+ * @return True if the game is drawn by repetition exactly then, false otherwise.
+ */
+bool check_repetition() {
+  checkers_engine engine(*Position::from_fen(KINGS_ENDING));
+  GameHistory history;
+  history.reset(engine);
+
+  // Eight plies bring the start position back twice.
+  Move out[2];
+  for (int ply = 1; ply <= 8; ++ply) {
+    const int side = (ply - 1) % 2;
+    Move move;
+    if ((ply - 1) % 4 < 2) {
+      const MoveList moves = engine.valid_moves();
+      move = out[side] = *std::find_if(moves.begin(), moves.end(), [&](const Move& m) {
+        return engine.position().kings() & spot_index_to_bit[m.from];
+      });
+    } else {
+      move = Move(out[side].to, out[side].from, MoveType::NORMAL);
+    }
+    if (!engine.is_valid(move)) {
+      fmt::print(stderr, "Repetition script played an illegal move at ply {}\n", ply);
+      return false;
+    }
+    engine.make_move(move);
+    history.push(engine);
+    const DrawReason expected = ply == 8 ? REPETITION : NO_DRAW;
+    if (history.draw_reason() != expected) {
+      fmt::print(stderr, "Repetition: draw reason {} at ply {}, expected {}\n", int(history.draw_reason()), ply,
+                 int(expected));
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Walks the kings without repeating a position three times, once up to the move limit and
+ * once with a man move just before it.
+ * @return True if the move limit draws exactly on the 80th reversible ply and the man move resets it.
+ */
+bool check_move_limit() {
+  for (const bool move_man : {false, true}) {
+    checkers_engine engine(*Position::from_fen(KINGS_AND_MAN_ENDING));
+    GameHistory history;
+    history.reset(engine);
+    std::unordered_map<uint64_t, int> seen{{engine.hash(), 1}};
+    std::mt19937 random(42);
+
+    const int limit_ply = 2 * DRAW_MOVE_LIMIT;
+    for (int ply = 1; ply <= limit_ply; ++ply) {
+      if (move_man && ply == limit_ply - 1) {
+        const MoveList moves = engine.valid_moves();
+        const auto man_move = std::find_if(moves.begin(), moves.end(), [&](const Move& m) {
+          return !(engine.position().kings() & spot_index_to_bit[m.from]);
+        });
+        if (man_move == moves.end()) {
+          fmt::print(stderr, "Move limit: the man can't move at ply {}\n", ply);
+          return false;
+        }
+        engine.make_move(*man_move);
+        history.push(engine);
+      } else if (!play_king_walk(engine, history, seen, random)) {
+        fmt::print(stderr, "Move limit: no safe king step at ply {}\n", ply);
+        return false;
+      }
+      const DrawReason expected = ply == limit_ply && !move_man ? MOVE_LIMIT : NO_DRAW;
+      if (history.draw_reason() != expected) {
+        fmt::print(stderr, "Move limit{}: draw reason {} at ply {}, expected {}\n", move_man ? " after a man move" : "",
+                   int(history.draw_reason()), ply, int(expected));
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Collects the engine states of games of random legal moves, ending at a win or a draw.
+ */
+std::vector<std::vector<checkers_engine>> random_games(std::mt19937& random, size_t game_count) {
+  std::vector<std::vector<checkers_engine>> games;
+  for (size_t game = 0; game < game_count; ++game) {
+    checkers_engine engine;
+    engine.reset();
+    GameHistory history;
+    history.reset(engine);
+    std::vector<checkers_engine>& states = games.emplace_back();
+    states.push_back(engine);
+    for (const Move& move : random_game(random, 400)) {
+      if (history.draw_reason() != NO_DRAW) break;
+      engine.make_move(move);
+      history.push(engine);
+      states.push_back(engine);
+    }
+  }
+  return games;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const size_t rounds = argc > 1 ? std::stoul(argv[1]) : 200;
+  if (!check_repetition() || !check_move_limit()) {
+    return 1;
+  }
+
+  std::mt19937 random(42);
+  const auto games = random_games(random, 1000);
+  size_t plies = 0;
+  size_t draws = 0;
+  GameHistory history;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round) {
+    for (const auto& states : games) {
+      history.reset(states.front());
+      for (size_t i = 1; i < states.size(); ++i) {
+        history.push(states[i]);
+        draws += history.draw_reason() != NO_DRAW;
+      }
+      plies += states.size() - 1;
+    }
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  fmt::print("games: {}, rounds: {}, drawn: {}\n", games.size(), rounds, draws / rounds);
+  fmt::print("push + draw_reason: {:8.1f} ns/ply\n", elapsed.count() * 1e9 / plies);
+  return 0;
+}
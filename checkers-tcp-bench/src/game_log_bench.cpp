@@ -0,0 +1,158 @@
+/**
+ * @file game_log_bench.cpp
+ * @brief Measures appending games to the game log and replaying them through the memory-mapped reader.
+ *
+ * Every replayed record must match the game it was written from, and a torn record at the end of
+ * a segment must be skipped by the reader and cut off by the next writer.
+ */
+
+#include "checkers_engine.h"
+#include "game_log.h"
+#include "random_game.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief Counts the records of a log directory.
+ * @param directory The log directory.
+ * @return The number of complete records.
+ */
+static size_t count_records(const std::filesystem::path& directory) {
+  size_t count = 0;
+  const GameLogReader reader(directory);
+  for (const auto& segment : reader.segments()) {
+    count += size_t(std::distance(segment.begin(), segment.end()));
+  }
+  return count;
+}
+
+/**
+ * @brief Writes a record torn in half after complete ones, as a crash during write() leaves it.
+ * The reader must stop before the torn record, and the next writer must cut it off.
+ * @param directory The empty log directory.
+ * @param moves The moves of the records.
+ * @return True if the torn record was handled, false otherwise.
+ */
+static bool check_torn_record(const std::filesystem::path& directory, const MoveList& moves) {
+  constexpr size_t complete_records = 3;
+  {
+    GameLogWriter writer(directory);
+    for (size_t i = 0; i < complete_records; ++i) {
+      writer.append(RecordHeader{}, moves);
+    }
+  }
+  std::vector<uint8_t> record;
+  encode_record(RecordHeader{}, moves, record);
+  const auto segment = list_segments(directory).back();
+  const auto complete_size = std::filesystem::file_size(segment);
+  std::ofstream(segment, std::ios::binary | std::ios::app).write(reinterpret_cast<const char*>(record.data()),
+                                                                 std::streamsize(record.size() / 2));
+  if (count_records(directory) != complete_records) {
+    fmt::print(stderr, "The reader didn't stop before the torn record\n");
+    return false;
+  }
+
+  {
+    GameLogWriter writer(directory);
+    if (std::filesystem::file_size(segment) != complete_size) {
+      fmt::print(stderr, "The writer didn't cut off the torn record\n");
+      return false;
+    }
+    writer.append(RecordHeader{}, moves);
+  }
+  if (count_records(directory) != complete_records + 1) {
+    fmt::print(stderr, "The record appended after the torn one is unreadable\n");
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const size_t game_count = argc > 1 ? std::stoul(argv[1]) : 200'000;
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / ("game_log_bench-" + std::to_string(getpid()));
+
+  std::mt19937 random(42);
+  std::vector<MoveList> games;
+  for (size_t i = 0; i < 256; ++i) {
+    games.push_back(random_game(random, 200));
+  }
+
+  size_t moves_written = 0;
+  auto start = std::chrono::steady_clock::now();
+  {
+    GameLogWriter writer(directory, 64 * 1024);
+    for (size_t i = 0; i < game_count; ++i) {
+      RecordHeader header;
+      header.result = i % 2 ? WHITE_WON : BLACK_WON;
+      header.game_id = uint32_t(i);
+      header.started_at_ms = 1'700'000'000'000 + i;
+      const MoveList& moves = games[i % games.size()];
+      if (!writer.append(header, moves)) {
+        fmt::print(stderr, "Failed to encode game {}\n", i);
+        return 1;
+      }
+      moves_written += moves.size();
+    }
+  }
+  const std::chrono::duration<double> write_time = std::chrono::steady_clock::now() - start;
+
+  size_t records_read = 0;
+  size_t moves_read = 0;
+  size_t bytes_read = 0;
+  start = std::chrono::steady_clock::now();
+  {
+    const GameLogReader reader(directory);
+    for (const auto& segment : reader.segments()) {
+      bytes_read += segment.records().size();
+      for (const GameRecordView& record : segment) {
+        const RecordHeader& header = record.header();
+        const MoveList& expected = games[header.game_id % games.size()];
+        if (header.result != (header.game_id % 2 ? WHITE_WON : BLACK_WON) ||
+            header.started_at_ms != 1'700'000'000'000u + header.game_id || size_t(header.ply_count) != expected.size()) {
+          fmt::print(stderr, "Header mismatch in game {}\n", header.game_id);
+          return 1;
+        }
+        size_t ply = 0;
+        for (const Move& move : record) {
+          if (ply >= expected.size() || move.from != expected[ply].from || move.to != expected[ply].to ||
+              move.type != expected[ply].type) {
+            fmt::print(stderr, "Replay mismatch in game {} at ply {}\n", record.header().game_id, ply);
+            return 1;
+          }
+          ++ply;
+        }
+        moves_read += ply;
+        ++records_read;
+      }
+    }
+  }
+  const std::chrono::duration<double> read_time = std::chrono::steady_clock::now() - start;
+  std::filesystem::remove_all(directory);
+
+  const bool torn_record_handled = check_torn_record(directory, games.front());
+  std::filesystem::remove_all(directory);
+  if (!torn_record_handled) {
+    return 1;
+  }
+
+  if (records_read != game_count || moves_read != moves_written) {
+    fmt::print(stderr, "Read {} records and {} moves, wrote {} and {}\n", records_read, moves_read, game_count, moves_written);
+    return 1;
+  }
+
+  fmt::print("games: {}, moves: {}, log size: {:.1f} MiB ({:.2f} bytes/move incl. headers)\n", game_count, moves_written,
+             bytes_read / 1048576.0, double(bytes_read) / moves_written);
+  fmt::print("append: {:10.0f} records/s {:12.0f} moves/s\n", game_count / write_time.count(), moves_written / write_time.count());
+  fmt::print("replay: {:10.0f} records/s {:12.0f} moves/s\n", records_read / read_time.count(), moves_read / read_time.count());
+  return 0;
+}
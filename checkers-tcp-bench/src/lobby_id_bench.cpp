@@ -0,0 +1,123 @@
+/**
+ * @file lobby_id_bench.cpp
+ * @brief Measures allocating lobby IDs while checking that the keyed permutation is a bijection.
+ *
+ * By default a whole counter cycle of a shard is allocated. Every ID must carry the shard, must
+ * not be zero and must not repeat, and the cycle must restart with its first ID. A shorter run
+ * only checks that its IDs don't repeat. Two shards must not share the low bits of their IDs.
+ */
+
+#include "lobby_id_allocator.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Mask of the bits of an ID holding the permuted counter.
+ */
+static constexpr uint32_t COUNTER_MASK = (uint32_t(1) << LobbyIdAllocator::COUNTER_BITS) - 1;
+
+/**
+ * @brief Gets the number of IDs of a shard before its counter cycle restarts.
+ * @param shard The shard.
+ * @return The cycle length, shard 0 skips the counter value that permutes to the ID zero.
+ */
+static size_t cycle_length(unsigned shard) { return size_t(COUNTER_MASK) + (shard == 0 ? 0 : 1); }
+
+/**
+ * @brief Allocates IDs of a shard.
+ * @param shard The shard.
+ * @param count The number of IDs, at most cycle_length().
+ * @param seen The bitmap of the counter values seen, one bit per value.
+ * @return True if the IDs carry the shard, aren't zero and don't repeat, and a whole cycle restarts
+ * with its first ID. False otherwise.
+ */
+static bool check_ids(unsigned shard, size_t count, std::vector<uint64_t>& seen) {
+  LobbyIdAllocator allocator(0x5eed + shard);
+  std::fill(seen.begin(), seen.end(), 0);
+
+  uint32_t first = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t id = allocator.allocate(shard);
+    if (id == 0 || LobbyIdAllocator::shard_of(id) != shard) {
+      fmt::print(stderr, "Shard {} allocated {:08X}\n", shard, id);
+      return false;
+    }
+    const uint32_t value = id & COUNTER_MASK;
+    if (seen[value / 64] & (uint64_t(1) << (value % 64))) {
+      fmt::print(stderr, "Shard {} allocated {:08X} twice within {} IDs\n", shard, id, i + 1);
+      return false;
+    }
+    seen[value / 64] |= uint64_t(1) << (value % 64);
+    if (i == 0) first = id;
+  }
+  if (count < cycle_length(shard)) {
+    return true;
+  }
+  if (const uint32_t next = allocator.allocate(shard); next != first) {
+    fmt::print(stderr, "Shard {} restarted its cycle with {:08X} instead of {:08X}\n", shard, next, first);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Checks that the key changes the sequence.
+ * @return True if two keys start with different IDs, false otherwise.
+ */
+static bool check_keys() {
+  LobbyIdAllocator allocator1(1);
+  LobbyIdAllocator allocator2(2);
+  size_t equal = 0;
+  for (int i = 0; i < 16; ++i) {
+    equal += allocator1.allocate(1) == allocator2.allocate(1);
+  }
+  if (equal == 16) {
+    fmt::print(stderr, "Keys 1 and 2 allocate the same IDs\n");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Checks that the shards permute their counters differently.
+ * @return True if the n-th IDs of two shards differ below the shard bits, false otherwise.
+ */
+static bool check_shards() {
+  LobbyIdAllocator allocator(1);
+  size_t equal = 0;
+  for (int i = 0; i < 16; ++i) {
+    equal += (allocator.allocate(1) & COUNTER_MASK) == (allocator.allocate(2) & COUNTER_MASK);
+  }
+  if (equal == 16) {
+    fmt::print(stderr, "Shards 1 and 2 share the low bits of their IDs\n");
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const size_t requested = argc > 1 ? std::stoul(argv[1]) : size_t(COUNTER_MASK) + 1;
+  if (!check_keys() || !check_shards()) {
+    return 1;
+  }
+
+  std::vector<uint64_t> seen((size_t(COUNTER_MASK) + 1) / 64);
+  // Shard 0 is the one with the zero skip, the last one has the top bits set.
+  for (const unsigned shard : {0u, LobbyIdAllocator::SHARDS - 1}) {
+    const size_t count = std::min(requested, cycle_length(shard));
+    const auto start = std::chrono::steady_clock::now();
+    if (!check_ids(shard, count, seen)) {
+      return 1;
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    fmt::print("shard {:2}: {} IDs{}, no repeats, {:5.1f} ns/ID including the check\n", shard, count,
+               count == cycle_length(shard) ? " (whole cycle)" : "", elapsed.count() / double(count));
+  }
+  return 0;
+}
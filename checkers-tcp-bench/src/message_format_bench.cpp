@@ -0,0 +1,148 @@
+/**
+ * @file message_format_bench.cpp
+ * @brief Compares the string-building message_to_string() with the fmt::formatter<MessageStorage>.
+ */
+
+#include "message.h"
+#include "message_format.h"
+#include "pack.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief The original message_to_string() implementation, kept as the baseline.
+ * @param message The MessageStorage object to convert.
+ * @return The string representation of the MessageStorage object.
+ */
+static std::string legacy_message_to_string(const MessageStorage& message) {
+  std::string result;
+  switch(message.message_type) {
+    case MessageType::HANDSHAKE: {
+      result += "HANDSHAKE (" + std::to_string(message.len) + " bytes) [";
+      switch(HandshakeType(message.payload[0])) {
+        case HandshakeType::CREATE_SESSION:
+          result += "CREATE_SESSION";
+          break;
+        case HandshakeType::CONNECT_TO_SESSION:
+          result += "CONNECT_TO_SESSION, ";
+          result += "lobby_id: " + std::to_string(unpacku32(&message.payload[1]));
+          break;
+        default:
+          break;
+      }
+      break;
+    }
+    case MessageType::LOBBY_CREATED: {
+        result += "LOBBY_CREATED (" + std::to_string(message.len) + " bytes) [";
+        uint32_t lobby_id = unpacku32(message.payload);
+        result += "lobby_id: " + std::to_string(lobby_id);
+        break;
+    }
+    case MessageType::GAME_STARTED: {
+        result += "GAME_STARTED (" + std::to_string(message.len) + " bytes) [";
+        if(GameFlags::IM_WHITE & GameFlags(message.payload[0])) {
+            result += "IM_WHITE";
+        }
+        break;
+    }
+    case MessageType::MOVE: {
+        result += "MOVE (" + std::to_string(message.len) + " bytes) [";
+        SpotIndex from = SpotIndex(message.payload[0]);
+        SpotIndex to = SpotIndex(message.payload[1]);
+        MoveType move_type = MoveType(message.payload[2]);
+        result += "from: " + std::to_string(from) + ", to: " + std::to_string(to) + ", move_type: ";
+        switch(move_type) {
+        case NORMAL:result += "NORMAL"; break;
+        case CAPTURE:result += "CAPTURE"; break;
+        case PROMOTION:result += "PROMOTION"; break;
+        case CAPTURE_PROMOTION:result += "CAPTURE_PROMOTION"; break;
+        default: break;
+        }
+        break;
+    }
+    case MessageType::DISCONNECT:
+      result += "DISCONNECT (" + std::to_string(message.len) + " bytes) [";
+      break;
+    case MessageType::RESIGN:
+      result += "RESIGN (" + std::to_string(message.len) + " bytes) [";
+      break;
+    case MessageType::ERROR:
+      result += "ERROR (" + std::to_string(message.len) + " bytes) [";
+      switch(ErrorType(message.payload[0])) {
+        case ErrorType::LOBBY_NOT_EXISTS: result += "LOBBY_NOT_EXISTS"; break;
+        case ErrorType::SERVER_ERROR: result += "SERVER_ERROR"; break;
+        case ErrorType::SERVER_DISCONNECTED: result += "SERVER_DISCONNECTED"; break;
+        case ErrorType::OPPONENT_DISCONNECTED: result += "OPPONENT_DISCONNECTED"; break;
+        case ErrorType::INVALID_MOVE: result += "INVALID_MOVE"; break;
+        case ErrorType::LOBBY_EXPIRED: result += "LOBBY_EXPIRED"; break;
+        case ErrorType::SESSION_TIMEOUT: result += "SESSION_TIMEOUT"; break;
+        case ErrorType::TIME_EXPIRED: result += "TIME_EXPIRED"; break;
+        case ErrorType::SESSION_NOT_FOUND: result += "SESSION_NOT_FOUND"; break;
+        case ErrorType::SERVER_DRAINING: result += "SERVER_DRAINING"; break;
+        default: break;
+      }
+      break;
+    default:
+      break;
+  }
+  return result + "]";
+}
+
+/**
+ * @brief Builds a representative mix of protocol messages.
+ * @return The sample messages.
+ */
+static std::array<MessageStorage, 7> sample_messages() {
+  std::array<MessageStorage, 7> messages{};
+  messages[0] = {MessageType::HANDSHAKE, 5};
+  messages[0].payload[0] = HandshakeType::CONNECT_TO_SESSION;
+  packi32(&messages[0].payload[1], 0xdeadbeefu);
+  messages[1] = {MessageType::LOBBY_CREATED, 4};
+  packi32(messages[1].payload, 123456789u);
+  messages[2] = {MessageType::GAME_STARTED, 1};
+  messages[2].payload[0] = GameFlags::IM_WHITE;
+  messages[3] = {MessageType::MOVE, 3, {9, 18, MoveType::CAPTURE}};
+  messages[4] = {MessageType::MOVE, 3, {21, 25, MoveType::NORMAL}};
+  messages[5] = {MessageType::ERROR, 1, {ErrorType::OPPONENT_DISCONNECTED}};
+  messages[6] = {MessageType::ERROR, 1, {ErrorType::SERVER_DRAINING}};
+  return messages;
+}
+
+int main(int argc, char** argv) {
+  const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 2'000'000;
+  const auto messages = sample_messages();
+
+  for (const auto& message : messages) {
+    if (legacy_message_to_string(message) != fmt::to_string(message)) {
+      fmt::print(stderr, "Output mismatch: '{}' vs '{}'\n", legacy_message_to_string(message), message);
+      return 1;
+    }
+  }
+
+  size_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    sink += legacy_message_to_string(messages[i % messages.size()]).size();
+  }
+  const std::chrono::duration<double, std::nano> legacy_time = std::chrono::steady_clock::now() - start;
+
+  // Mirrors what spdlog does with a formatted argument: append into a reused memory buffer.
+  fmt::memory_buffer buffer;
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    buffer.clear();
+    fmt::format_to(std::back_inserter(buffer), "{}", messages[i % messages.size()]);
+    sink += buffer.size();
+  }
+  const std::chrono::duration<double, std::nano> formatter_time = std::chrono::steady_clock::now() - start;
+
+  fmt::print("messages formatted: {} (checksum {})\n", iterations, sink);
+  fmt::print("legacy message_to_string: {:8.1f} ns/message\n", legacy_time.count() / iterations);
+  fmt::print("fmt::formatter:           {:8.1f} ns/message\n", formatter_time.count() / iterations);
+  return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file pdn_bench.cpp
+ * @brief Measures writing games as PDN and reading them back through PdnReader and resolve_pdn_moves().
+ *
+ * Every game read back must have the tags, result and moves it was written with. An annotated
+ * sample with comments, variations, NAGs and a malformed game checks what write_pdn() never emits.
+ */
+
+#include "checkers_engine.h"
+#include "pdn.h"
+#include "random_game.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief An annotated PDN text: a game with everything the reader skips, a malformed game and a plain one.
+ */
+static constexpr std::string_view ANNOTATED_SAMPLE = R"([Event "Annotated \"sample\""]
+[Result "1-0"]
+{Opening comment} 1. 11-15 $1 23-19 (1... 22-18 {the Cross} (1... 24-20)) 2. 8-11 22-17 ; to the end of the line
+% escape line
+3. 9-13 1-0
+
+[Event "Broken"
+1. 11-15 *
+
+[Event "After the broken one"]
+1. 11-15 23-18 *
+)";
+
+/**
+ * @brief Reads the annotated sample.
+ * @return True if every game was read as expected, false otherwise.
+ */
+static bool check_annotated_sample() {
+  PdnReader reader(ANNOTATED_SAMPLE);
+  PdnGame game;
+  MoveList moves;
+  std::string error;
+
+  if (!reader.next(game) || game.error || !resolve_pdn_moves(game, moves, error)) {
+    fmt::print(stderr, "Annotated game unreadable: {}\n", game.error ? game.error : error);
+    return false;
+  }
+  if (game.tag("Event") != R"(Annotated \"sample\")" || game.result != WHITE_WON || game.moves.size() != 5 ||
+      moves.size() != 5 || game.moves[4] != "9-13") {
+    fmt::print(stderr, "Annotated game read as {} moves, result {}\n", game.moves.size(), int(game.result));
+    return false;
+  }
+  if (!reader.next(game) || game.error == nullptr || game.line != 7) {
+    fmt::print(stderr, "Malformed game at line 7 not reported\n");
+    return false;
+  }
+  if (!reader.next(game) || game.error || game.line != 10 || game.moves.size() != 2 || game.result != IN_PROGRESS) {
+    fmt::print(stderr, "Game after the malformed one not read\n");
+    return false;
+  }
+  return !reader.next(game);
+}
+
+int main(int argc, char** argv) {
+  const size_t game_count = argc > 1 ? std::stoul(argv[1]) : 20'000;
+  if (!check_annotated_sample()) {
+    return 1;
+  }
+
+  std::mt19937 random(42);
+  std::vector<MoveList> games;
+  for (size_t i = 0; i < 256; ++i) {
+    games.push_back(random_game(random, 200));
+  }
+  constexpr std::array<GameResult, 4> results = {WHITE_WON, BLACK_WON, DRAWN, IN_PROGRESS};
+
+  std::string text;
+  size_t moves_written = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < game_count; ++i) {
+    const std::string round = std::to_string(i);
+    const std::array<PdnTag, 2> tags = {PdnTag{"Event", "Bench \"games\""}, PdnTag{"Round", round}};
+    const MoveList& moves = games[i % games.size()];
+    write_pdn(text, tags, moves, results[i % results.size()]);
+    moves_written += moves.size();
+  }
+  const std::chrono::duration<double> write_time = std::chrono::steady_clock::now() - start;
+
+  size_t games_read = 0;
+  size_t moves_read = 0;
+  PdnReader reader(text);
+  PdnGame game;
+  MoveList moves;
+  std::string error;
+  start = std::chrono::steady_clock::now();
+  while (reader.next(game)) {
+    if (game.error || !resolve_pdn_moves(game, moves, error)) {
+      fmt::print(stderr, "Game {} at line {} unreadable: {}\n", games_read, game.line, game.error ? game.error : error);
+      return 1;
+    }
+    const MoveList& expected = games[games_read % games.size()];
+    if (game.tag("Event") != R"(Bench \"games\")" || game.tag("Round") != std::to_string(games_read) ||
+        game.result != results[games_read % results.size()] || moves.size() != expected.size()) {
+      fmt::print(stderr, "Game {} at line {} differs from the game written\n", games_read, game.line);
+      return 1;
+    }
+    for (size_t ply = 0; ply < moves.size(); ++ply) {
+      if (moves[ply].from != expected[ply].from || moves[ply].to != expected[ply].to ||
+          moves[ply].type != expected[ply].type) {
+        fmt::print(stderr, "Move mismatch in game {} at ply {}\n", games_read, ply);
+        return 1;
+      }
+    }
+    moves_read += moves.size();
+    ++games_read;
+  }
+  const std::chrono::duration<double> read_time = std::chrono::steady_clock::now() - start;
+
+  if (games_read != game_count || moves_read != moves_written) {
+    fmt::print(stderr, "Read {} games and {} moves, wrote {} and {}\n", games_read, moves_read, game_count, moves_written);
+    return 1;
+  }
+
+  fmt::print("games: {}, moves: {}, PDN size: {:.1f} MiB\n", game_count, moves_written, text.size() / 1048576.0);
+  fmt::print("write_pdn:       {:10.0f} games/s {:8.1f} MiB/s\n", game_count / write_time.count(),
+             text.size() / 1048576.0 / write_time.count());
+  fmt::print("read + resolve:  {:10.0f} games/s {:8.1f} MiB/s\n", games_read / read_time.count(),
+             text.size() / 1048576.0 / read_time.count());
+  return 0;
+}
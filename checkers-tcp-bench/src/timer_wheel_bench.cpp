@@ -0,0 +1,225 @@
+/**
+ * @file timer_wheel_bench.cpp
+ * @brief Measures arming, cancelling and expiring timers in the TimerWheel.
+ *
+ * Timers are armed on both sides of every level boundary and past the horizon, from ticks that
+ * aren't aligned to a level, and more are armed while the wheel runs. The wheel is advanced from
+ * one next_deadline() to the next, so a deadline it reports too late shows up as a late timer.
+ * Every timer must fire exactly once on the first tick at or after its deadline, or at the
+ * horizon if the deadline lies beyond it, and a cancelled timer must never fire.
+ */
+
+#include "timer_wheel.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = TimerWheel::Clock;
+
+/**
+ * @brief The wheel resolution of the check.
+ */
+static constexpr Clock::duration TICK = std::chrono::milliseconds(1);
+
+/**
+ * @brief A timer of the check and what the wheel must do with it.
+ */
+struct ExpectedTimer {
+  TimerWheel::TimerId id = TimerWheel::INVALID_TIMER;
+  uint64_t expected_tick = 0;
+  uint64_t fired_tick = 0;
+  bool cancelled = false;
+};
+
+/**
+ * @brief Runs the check on a wheel and the timers armed on it.
+ */
+class WheelCheck {
+public:
+  explicit WheelCheck(Clock::time_point origin) : origin(origin), wheel(TICK, origin) {}
+
+  /**
+   * @brief Arms a timer a number of ticks and a fraction of a tick from the current tick.
+   * @param ticks The ticks to the deadline, may be zero or past the horizon.
+   * @param fraction The part of a tick added to the deadline, it must round up.
+   */
+  void arm(uint64_t ticks, Clock::duration fraction = {}) {
+    const size_t index = timers.size();
+    ExpectedTimer& timer = timers.emplace_back();
+    const uint64_t deadline_tick = current + ticks + (fraction > Clock::duration::zero() ? 1 : 0);
+    timer.expected_tick = std::min(std::max(deadline_tick, current + 1), current + TimerWheel::HORIZON - 1);
+    const Clock::time_point deadline = origin + TICK * int64_t(current + ticks) + fraction;
+    timer.id = wheel.arm(deadline, [this, index] { timers[index].fired_tick = current; });
+  }
+
+  /**
+   * @brief Cancels a timer, twice.
+   * @param index The index of the timer.
+   * @return True if the first cancel succeeded and the second one didn't, false otherwise.
+   */
+  bool cancel(size_t index) {
+    ExpectedTimer& timer = timers[index];
+    timer.cancelled = true;
+    if (!wheel.cancel(timer.id) || wheel.cancel(timer.id)) {
+      fmt::print(stderr, "Timer {} due at tick {} didn't cancel exactly once\n", index, timer.expected_tick);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Advances the wheel from one next_deadline() to the next until no timer is armed.
+   * @param rearm Number of timers to arm while running, each with a random delay.
+   * @param random The random number generator of the delays.
+   * @return True if every timer fired on its expected tick, false otherwise.
+   */
+  bool run(size_t rearm, std::mt19937_64& random) {
+    std::vector<TimerWheel::Callback> expired;
+    while (wheel.size() != 0) {
+      const Clock::time_point next = wheel.next_deadline();
+      const auto next_tick = uint64_t((next - origin) / TICK);
+      if (next_tick <= current) {
+        fmt::print(stderr, "next_deadline() is tick {}, the wheel is already at tick {}\n", next_tick, current);
+        return false;
+      }
+      // A tick before the deadline must expire nothing.
+      if (next_tick > current + 1 && wheel.advance(origin + TICK * int64_t(next_tick - 1), expired) != 0) {
+        fmt::print(stderr, "Timers expired before next_deadline() at tick {}\n", next_tick);
+        return false;
+      }
+      current = next_tick;
+      wheel.advance(next, expired);
+      for (auto& callback : expired) {
+        callback();
+      }
+      expired.clear();
+      if (rearm != 0) {
+        --rearm;
+        arm(random() % (TimerWheel::HORIZON + 4096));
+      }
+    }
+    return verify();
+  }
+
+  /**
+   * @brief Checks that every timer fired on its expected tick or not at all if it was cancelled.
+   * @return True if so, false otherwise.
+   */
+  bool verify() const {
+    for (size_t index = 0; index < timers.size(); ++index) {
+      const ExpectedTimer& timer = timers[index];
+      const uint64_t expected = timer.cancelled ? 0 : timer.expected_tick;
+      if (timer.fired_tick != expected) {
+        fmt::print(stderr, "Timer {}{} due at tick {} fired at tick {}\n", index, timer.cancelled ? " (cancelled)" : "",
+                   timer.expected_tick, timer.fired_tick);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Moves the wheel to a tick with no timer armed.
+   * @param tick The tick.
+   */
+  void skip_to(uint64_t tick) {
+    std::vector<TimerWheel::Callback> expired;
+    wheel.advance(origin + TICK * int64_t(tick), expired);
+    current = tick;
+  }
+
+  [[nodiscard]] size_t size() const { return timers.size(); }
+
+private:
+  Clock::time_point origin;
+  TimerWheel wheel;
+  uint64_t current = 0;
+  std::vector<ExpectedTimer> timers;
+};
+
+/**
+ * @brief Arms timers around the level boundaries and past the horizon, cancels some and runs the wheel.
+ * @param start_tick The tick to arm the timers from, not aligned to any level.
+ * @return True if every timer fired as expected, false otherwise.
+ */
+static bool check_boundaries(uint64_t start_tick) {
+  WheelCheck check(Clock::time_point{} + std::chrono::hours(1));
+  check.skip_to(start_tick);
+  std::mt19937_64 random(start_tick);
+
+  for (uint32_t level = 0; level <= TimerWheel::LEVELS; ++level) {
+    const uint64_t boundary = uint64_t(1) << (level * TimerWheel::SLOT_BITS);
+    for (const uint64_t ticks : {boundary - 1, boundary, boundary + 1}) {
+      check.arm(ticks);
+      check.arm(ticks, TICK / 2);
+    }
+  }
+  check.arm(0);
+  check.arm(TimerWheel::HORIZON - 2);
+  check.arm(10 * TimerWheel::HORIZON);
+  for (int i = 0; i < 2000; ++i) {
+    // Spread over all levels: a random number of bits, then a random value of that size.
+    const uint64_t bits = random() % (TimerWheel::LEVELS * TimerWheel::SLOT_BITS + 2);
+    check.arm(random() & ((uint64_t(1) << bits) - 1));
+  }
+  for (size_t index = 0; index < check.size(); index += 3) {
+    if (!check.cancel(index)) {
+      return false;
+    }
+  }
+  return check.run(500, random);
+}
+
+int main(int argc, char** argv) {
+  const size_t timer_count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  for (const uint64_t start_tick : {uint64_t(0), uint64_t(37), uint64_t(4096 * 63 + 4095), uint64_t(12345678)}) {
+    if (!check_boundaries(start_tick)) {
+      fmt::print(stderr, "Timers armed from tick {} failed\n", start_tick);
+      return 1;
+    }
+  }
+
+  // Session-like timers: a few seconds to a few minutes at a 10 ms tick, half of them cancelled.
+  std::mt19937_64 random(42);
+  const Clock::time_point origin = Clock::now();
+  TimerWheel wheel(std::chrono::milliseconds(10), origin);
+  std::vector<TimerWheel::TimerId> ids(timer_count);
+  std::vector<TimerWheel::Callback> expired;
+  expired.reserve(timer_count);
+  size_t fired = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto& id : ids) {
+    id = wheel.arm(origin + std::chrono::milliseconds(1000 + random() % 300000), [&fired] { ++fired; });
+  }
+  const std::chrono::duration<double, std::nano> arm_time = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < ids.size(); i += 2) {
+    wheel.cancel(ids[i]);
+  }
+  const std::chrono::duration<double, std::nano> cancel_time = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  wheel.advance(origin + std::chrono::milliseconds(302000), expired);
+  const std::chrono::duration<double, std::nano> advance_time = std::chrono::steady_clock::now() - start;
+  for (auto& callback : expired) {
+    callback();
+  }
+  if (fired != timer_count / 2 || wheel.size() != 0) {
+    fmt::print(stderr, "{} of {} timers fired, {} still armed\n", fired, timer_count / 2, wheel.size());
+    return 1;
+  }
+
+  fmt::print("timers: {}\n", timer_count);
+  fmt::print("arm:     {:6.1f} ns/timer\n", arm_time.count() / double(timer_count));
+  fmt::print("cancel:  {:6.1f} ns/timer\n", cancel_time.count() / double(timer_count / 2));
+  fmt::print("advance: {:6.1f} ns/expired timer, 30200 ticks\n", advance_time.count() / double(fired));
+  return 0;
+}
@@ -77,6 +77,7 @@ public:
     struct SpotData {
         quint8 piece_type = PieceColorType::None; /**< The type of the piece on the spot. */
         quint8 square_state = SpotState::Default; /**< The state of the spot. */
+        quint32 move_mask = 0; /**< The bit of every spot the piece on the spot can move to, 0 if it can't move. */
     };
 
     /**
@@ -130,6 +131,15 @@ public:
      */
     Q_INVOKABLE quint8 make_move(quint8 from, quint8 to);
 
+    /**
+     * @brief Replaces the board with a position snapshot.
+     * @param white The bitboard of the white pieces.
+     * @param black The bitboard of the black pieces.
+     * @param kings The bitboard of the kings.
+     * @param turn The color to move.
+     */
+    Q_INVOKABLE void set_position(quint32 white, quint32 black, quint32 kings, quint8 turn);
+
 signals:
     /**
      * @brief Signal emitted when a move is made on the checkers board.
@@ -143,14 +153,9 @@ private:
     std::array<SpotData, SPOT_COUNT> spots; /**< The array of spot data representing the checkers board. */
     static bool is_white_square(quint8 index); /**< Helper function to check if a square is white. */
     static quint8 to_spot_index(quint8 square_index); /**< Helper function to convert a square index to a spot index. */
+    static quint8 to_square_index(quint8 spot_index); /**< Helper function to convert a spot index to a square index. */
     checkers_engine engine; /**< The checkers engine for game logic. */
-
-    /**
-     * @brief Hides the valid moves for the given spot index.
-     * @param spot_index The index of the spot.
-     * @return The number of valid moves hidden.
-     */
-    quint8 hideValidMoves(SpotIndex spot_index);
+    MoveList legal_moves; /**< The legal moves of the engine position, generated once per position change. */
 
     /**
      * @brief Highlights the valid moves for the given spot index.
@@ -159,14 +164,19 @@ private:
      */
     quint8 highlightValidMoves(SpotIndex spot_index);
 
+    /**
+     * @brief Fills the spots with the pieces and the legal moves of the engine position.
+     */
+    void loadBoard();
+
     /**
      * @brief Resets the spot states to the default state.
      */
     void resetSpotStates();
 
     /**
-     * @brief Emits the dataChanged signal for the specified role.
-     * @param role The role for which to emit the signal.
+     * @brief Emits the dataChanged signal for the spots that differ from a previous copy, with the roles that changed.
+     * @param previous The spots before the change.
      */
-    void emitDataChanged(int role);
+    void emitSpotChanges(const std::array<SpotData, SPOT_COUNT>& previous);
 };
\ No newline at end of file
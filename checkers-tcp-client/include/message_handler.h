@@ -2,11 +2,24 @@
 
 #include "message.h"
 #include "board.h"
+#include "frame.h"
 
 #include <QObject>
 #include <QTcpSocket>
 #include <QHostAddress>
 
+#include <chrono>
+#include <span>
+
+/**
+ * @brief Gets the steady clock time, comparable between the GUI and the network thread.
+ * @return The time in nanoseconds.
+ */
+inline qint64 steady_clock_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 /**
  * @brief The NetworkConfig struct represents the network configuration.
  */
@@ -42,6 +55,12 @@ public:
    */
   void connect_to_server();
 
+  /**
+   * @brief Connects to the server unless already connected.
+   * @return True if the connection is open.
+   */
+  bool ensure_connected();
+
   /**
    * @brief Clears the server socket and disconnects from the server.
    */
@@ -64,11 +83,35 @@ public:
    */
   void send_handshake();
 
+  /**
+   * @brief Sends a handshake message to the server to play against the server-side bot.
+   * @param bot_level The bot level, 0 is the weakest.
+   */
+  void send_bot_handshake(uint8_t bot_level);
+
+  /**
+   * @brief Sends a handshake message to the server to watch the running game of a lobby.
+   * @param lobby_id The lobby ID.
+   */
+  void send_spectate_handshake(uint32_t lobby_id);
+
+  /**
+   * @brief Sends a handshake message to the server to be paired with an anonymous opponent.
+   * @param rating The rating of the player, 0 lets the server pick the default rating.
+   */
+  void send_find_game_handshake(uint16_t rating);
+
+  /**
+   * @brief Sends a handshake message to the server to resume the running game.
+   */
+  void send_resume_handshake();
+
   /**
    * @brief Sends a move message to the server.
    * @param move The move to send.
+   * @param input_at_ns The steady clock time the player made the move, in nanoseconds, 0 if unknown.
    */
-  void send_move(const Move& move);
+  void send_move(const Move& move, qint64 input_at_ns = 0);
 
   /**
    * @brief Sends a resign message to the server.
@@ -76,10 +119,12 @@ public:
   void send_resign();
 
   /**
-   * @brief Receives a message from the server.
+   * @brief Copies a received frame into a MessageStorage.
+   * @param frame_header The decoded header of the frame.
+   * @param payload The payload of the frame, at most MAX_MESSAGE_LEN bytes.
    * @param message_storage The received message.
    */
-  void receive_message(MessageStorage& message_storage);
+  void receive_message(const FrameHeader& frame_header, std::span<const quint8> payload, MessageStorage& message_storage);
 
   /**
    * @brief Gets the connection status.
@@ -116,14 +161,45 @@ signals:
   /**
    * @brief Signal emitted when a move is received.
    * @param move The received move.
+   * @param received_at_ns The steady clock time the move was read from the socket, in nanoseconds.
    */
-  void moveReceived(Move move);
+  void moveReceived(Move move, qint64 received_at_ns);
 
   /**
    * @brief Signal emitted when a resign message is received.
    */
   void resignReceived();
 
+  /**
+   * @brief Signal emitted when the remaining clock times are received.
+   * @param white_ms The remaining time of white in milliseconds.
+   * @param black_ms The remaining time of black in milliseconds.
+   */
+  void clockReceived(quint32 white_ms, quint32 black_ms);
+
+  /**
+   * @brief Signal emitted when the opponent loses or regains connection.
+   * @param is_away True if the opponent lost connection, false if the opponent is back.
+   * @param grace_seconds The time the opponent has to resume the game, valid if is_away is true.
+   */
+  void opponentStatusReceived(bool is_away, quint8 grace_seconds);
+
+  /**
+   * @brief Signal emitted when a board position snapshot is received.
+   * @param white The bitboard of the white pieces.
+   * @param black The bitboard of the black pieces.
+   * @param kings The bitboard of the kings.
+   * @param turn The color to move.
+   */
+  void positionReceived(quint32 white, quint32 black, quint32 kings, quint8 turn);
+
+  /**
+   * @brief Signal emitted when the server ends the game by the rules.
+   * @param winner The color of the winner, BOTH for a draw.
+   * @param reason Why the game ended.
+   */
+  void gameOverReceived(Color winner, GameOverReason reason);
+
 public slots:
   /**
    * @brief Slot called when a connection error occurs.
@@ -137,6 +213,29 @@ public slots:
   void handle_message();
 
 private:
+  /**
+   * @brief Offers the newest protocol version and the capabilities of this client to the server.
+   */
+  void send_hello();
+
+  /**
+   * @brief Emits moveReceived for each move of a MOVE_BATCH payload.
+   * @param payload The payload.
+   */
+  void receive_move_batch(std::span<const quint8> payload);
+
+  /**
+   * @brief Emits the signal corresponding to a received message.
+   * @param message The received message.
+   */
+  void dispatch_message(const MessageStorage &message);
+
   NetworkConfig network_config{"localhost", 3000}; /**< The network configuration. */
   QTcpSocket* server_socket = nullptr; /**< The TCP socket for communication with the server. */
+  FrameDecoder frame_decoder; /**< The received bytes not yet dispatched as messages. */
+  quint64 resume_token = 0; /**< The resume token of the running game, 0 if there is none. */
+  bool is_resuming = false; /**< Whether a resume was already attempted since the last game start. */
+  quint8 protocol_version = PROTOCOL_V1; /**< The protocol version negotiated with the server. */
+  quint32 capabilities = 0; /**< The Capability flags negotiated with the server. */
+  qint64 received_at_ns = 0; /**< The steady clock time of the readyRead being handled, in nanoseconds. */
 };
@@ -5,6 +5,9 @@
 #include <QObject>
 #include <QQmlEngine>
 #include <QJSEngine>
+#include <QThread>
+
+#include <functional>
 
 /**
  * @brief The NetworkSession class represents a network session for a checkers game.
@@ -12,6 +15,10 @@
  * This class handles the communication between the client and the server.
  * It provides methods to set the server address, create a lobby, connect to a lobby,
  * send a move, and resign from the game.
+ *
+ * The MessageHandler with its socket lives on a worker thread, so rendering never delays
+ * reading the socket and the other way round. Requests are queued to the worker, the
+ * signals of the MessageHandler come back as queued connections.
  */
 class NetworkSession : public QObject
 {
@@ -47,6 +54,11 @@ public:
      */
     explicit NetworkSession(QObject *parent = nullptr);
 
+    /**
+     * @brief Stops the network thread, which deletes the message handler.
+     */
+    ~NetworkSession() override;
+
     /**
      * @brief Sets the server address and port.
      * 
@@ -67,6 +79,27 @@ public:
      */
     Q_INVOKABLE void connect_lobby(quint32 lobby_id);
 
+    /**
+     * @brief Starts a game against the server-side bot.
+     * 
+     * @param bot_level The bot level, 0 is the weakest.
+     */
+    Q_INVOKABLE void play_against_bot(quint8 bot_level);
+
+    /**
+     * @brief Joins the quick-play queue to be paired with an anonymous opponent.
+     * 
+     * @param rating The rating of the player, 0 lets the server pick the default rating.
+     */
+    Q_INVOKABLE void find_game(quint16 rating);
+
+    /**
+     * @brief Watches the running game of a lobby.
+     * 
+     * @param lobby_id The ID of the lobby to watch.
+     */
+    Q_INVOKABLE void spectate(quint32 lobby_id);
+
     /**
      * @brief Sends a move to the server.
      * 
@@ -93,8 +126,9 @@ signals:
      * @brief Signal emitted when the game starts.
      * 
      * @param is_white Indicates whether the player is playing as white.
+     * @param is_spectator Indicates whether the player only watches the game.
      */
-    void gameStarted(bool is_white);
+    void gameStarted(bool is_white, bool is_spectator);
 
     /**
      * @brief Signal emitted when a server error occurs.
@@ -117,6 +151,39 @@ signals:
      */
     void resignReceived();
 
+    /**
+     * @brief Signal emitted when the server sends the remaining clock times.
+     * 
+     * @param white_ms The remaining time of white in milliseconds.
+     * @param black_ms The remaining time of black in milliseconds.
+     */
+    void clockUpdated(quint32 white_ms, quint32 black_ms);
+
+    /**
+     * @brief Signal emitted when the opponent loses or regains connection.
+     * 
+     * @param is_away True if the opponent lost connection, false if the opponent is back.
+     * @param grace_seconds The time the opponent has to resume the game, valid if is_away is true.
+     */
+    void opponentStatusChanged(bool is_away, quint8 grace_seconds);
+
+    /**
+     * @brief Signal emitted when the server sends the position of a watched game.
+     * 
+     * @param white The bitboard of the white pieces.
+     * @param black The bitboard of the black pieces.
+     * @param kings The bitboard of the kings.
+     * @param turn The color to move.
+     */
+    void positionReceived(quint32 white, quint32 black, quint32 kings, quint8 turn);
+
+    /**
+     * @brief Signal emitted when the server ends the game by the rules.
+     * 
+     * @param result_message The description of the result.
+     */
+    void gameOver(QString result_message);
+
 public slots:
     /**
      * @brief Slot called when an error occurs.
@@ -129,8 +196,9 @@ public slots:
      * @brief Slot called when a move is received from the server.
      * 
      * @param move The received move.
+     * @param received_at_ns The steady clock time the move was read from the socket, in nanoseconds.
      */
-    void onMoveReceived(Move move);
+    void onMoveReceived(Move move, qint64 received_at_ns);
 
     /**
      * @brief Slot called when the game starts.
@@ -139,6 +207,23 @@ public slots:
      */
     void onGameStarted(GameFlags game_flags);
 
+    /**
+     * @brief Slot called when the server ends the game by the rules.
+     * 
+     * @param winner The color of the winner, BOTH for a draw.
+     * @param reason Why the game ended.
+     */
+    void onGameOver(Color winner, GameOverReason reason);
+
 private:
+    /**
+     * @brief Runs a task with the message handler on the network thread.
+     *
+     * @param task The task.
+     */
+    void post(std::function<void(MessageHandler&)> task);
+
+    QThread network_thread; /**< The thread the message handler and its socket live on. */
     MessageHandler* network_session = nullptr; /**< The message handler for the network session. */
+    GameFlags game_flags = GameFlags::NONE; /**< The flags of the running game, to word its result. */
 };
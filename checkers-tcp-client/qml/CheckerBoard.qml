@@ -17,6 +17,7 @@ Rectangle {
     property int fromSquareIndex: -1
     property int toSquareIndex: -1
     property bool isWhiteSide: true
+    property bool isSpectator: false
 
     CheckersModel {
         id: checkers_model
@@ -28,6 +29,10 @@ Rectangle {
         function onMoveReceived(from, to, type) {
             checkers_model.make_move(from, to, type)
         }
+
+        function onPositionReceived(white, black, kings, turn) {
+            checkers_model.set_position(white, black, kings, turn)
+        }
     }
 
     Grid {
@@ -49,6 +54,7 @@ Rectangle {
                 MouseArea {
                     id: square_mouse_area
                     anchors.fill: parent;
+                    enabled: !root.isSpectator
                     hoverEnabled: true
                     onClicked: {
                         if (model.has_moves) {
@@ -9,6 +9,7 @@ Item {
     property int spot_size: 60
     property int game_flags: 0
     property alias isWhiteSide: board.isWhiteSide
+    property alias isSpectator: board.isSpectator
 
     Label {
         id: status_label
@@ -12,7 +12,10 @@ Item {
     property bool isGameRunning: false
 
     signal createLobby
+    signal playAgainstBot
+    signal findGame
     signal connectToLobby(int lobby_id)
+    signal spectateLobby(int lobby_id)
     signal resign
 
     SettingsDialog {
@@ -62,6 +65,31 @@ Item {
                 }
                 Layout.alignment: Qt.AlignHCenter
             }
+            MenuButton {
+                id: spectate_button
+                text: "Watch lobby"
+                onClicked: {
+                    let lobby_id = parseInt(lobbyid_field.text)
+                    spectateLobby(lobby_id)
+                }
+                Layout.alignment: Qt.AlignHCenter
+            }
+            MenuButton {
+                id: find_game_button
+                text: "Quick play"
+                onClicked: {
+                    findGame()
+                }
+                Layout.alignment: Qt.AlignHCenter
+            }
+            MenuButton {
+                id: bot_button
+                text: "Play against bot"
+                onClicked: {
+                    playAgainstBot()
+                }
+                Layout.alignment: Qt.AlignHCenter
+            }
             MenuButton {
                 id: settings_button
                 text: "Settings"
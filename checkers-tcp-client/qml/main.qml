@@ -22,7 +22,13 @@ Window {
         width: 300
 
         onCreateLobby: NetworkSession.create_lobby()
+        onPlayAgainstBot: NetworkSession.play_against_bot(1)
+        onFindGame: {
+            NetworkSession.find_game(0)
+            stack.push(searching_view)
+        }
         onConnectToLobby: stack.push(connecting_view, {"lobby_id": lobby_id})
+        onSpectateLobby: NetworkSession.spectate(lobby_id)
         onResign: {
             NetworkSession.resign();
             stack.pop(stack.initialItem)
@@ -53,6 +59,18 @@ Window {
         }
     }
 
+    Component {
+        id: searching_view
+        Item {
+            Text {
+                anchors.centerIn: parent
+                text: "Looking for an opponent..."
+                font.pointSize: 24
+                color: "gray"
+            }
+        }
+    }
+
     Component {
         id: lobby_view
         CreatedLobbyPane { }
@@ -94,15 +112,30 @@ Window {
             stack.push(lobby_view, {"lobby_id": lobby_id});
         }
 
-        function onGameStarted(is_white) {
-            stack.push(game_view, {"isWhiteSide": is_white});
-            game_menu.isGameRunning = true;
+        function onGameStarted(is_white, is_spectator) {
+            // A resumed game starts over from a fresh board and replays the moves.
+            stack.pop(stack.initialItem)
+            stack.push(game_view, {"isWhiteSide": is_white, "isSpectator": is_spectator});
+            game_menu.isGameRunning = !is_spectator;
+        }
+
+        function onOpponentStatusChanged(is_away, grace_seconds) {
+            if (is_away) {
+                showNotification(`Opponent lost connection. Waiting ${grace_seconds} seconds for them to return.`)
+            } else {
+                showNotification("Opponent is back.")
+            }
         }
 
         function onResignReceived() {
             showNotification("Opponent resigned.")
             stack.pop(stack.initialItem)
         }
+
+        function onGameOver(result_message) {
+            showNotification(result_message)
+            stack.pop(stack.initialItem)
+        }
     }
 
     NotificationDialog {
@@ -7,6 +7,9 @@
 
 #include <QDebug>
 
+#include <algorithm>
+#include <bit>
+
 /**
  * @brief Constructs a CheckersModel object.
  * @param parent The parent QObject.
@@ -14,6 +17,18 @@
 CheckersModel::CheckersModel(QObject *parent) : QAbstractListModel(parent)
 {
     engine.reset();
+    loadBoard();
+}
+
+/**
+ * @brief Fills the spots with the pieces and the legal moves of the engine position.
+ * The moves are generated once here, data() and the highlighting only read the move masks.
+ */
+void CheckersModel::loadBoard()
+{
+    for(auto& spot: spots) {
+        spot = SpotData{};
+    }
     Board board = engine.board();
     for(const auto& spot: board) {
         if(spot.piece.type == PieceType::MAN) {
@@ -30,6 +45,10 @@ CheckersModel::CheckersModel(QObject *parent) : QAbstractListModel(parent)
             }
         }
     }
+    legal_moves = engine.valid_moves();
+    for(const auto& move: legal_moves) {
+        spots.at(move.from).move_mask |= quint32(1) << move.to;
+    }
 }
     
 /**
@@ -64,7 +83,7 @@ QVariant CheckersModel::data(const QModelIndex &index, int role) const
         case PieceTypeRole: return spot.piece_type;
         case SquareStateRole: return spot.square_state;
         case IsOccupiedRole: return spot.piece_type != None;
-        case HasMovesRole: return !engine.valid_moves(spot_index).empty();
+        case HasMovesRole: return spot.move_mask != 0;
     }
 
     return QVariant();
@@ -105,13 +124,15 @@ bool CheckersModel::setData(const QModelIndex &index, const QVariant &value, int
         case SquareStateRole: {
             switch(value.toUInt()) {
                 case SpotState::Selected: {
-                    int valid_moves_count = highlightValidMoves(spot_index);
-                    if(valid_moves_count != 0) emitDataChanged(role);
+                    const auto previous = spots;
+                    highlightValidMoves(spot_index);
+                    emitSpotChanges(previous);
                     return true;
                 }
                 case SpotState::Default: {
+                    const auto previous = spots;
                     resetSpotStates();
-                    emitDataChanged(role);
+                    emitSpotChanges(previous);
                     return true;
                 }
                 default: return true;
@@ -139,33 +160,33 @@ Qt::ItemFlags CheckersModel::flags(const QModelIndex &index) const {
  */
 quint8 CheckersModel::make_move(quint8 from, quint8 to)
 {
-    for (const auto& valid_move: engine.valid_moves(from)) {
-        if(valid_move.from == from && valid_move.to == to) {
-            hideValidMoves(from);
-            engine.make_move(valid_move);
-            const PieceColorType piece_type = PieceColorType(spots[from].piece_type);
-            spots[from].piece_type = PieceColorType::None;
-            if (valid_move.type & MoveType::PROMOTION) {
-                if(spots[from].piece_type == PieceColorType::WhiteMan) {
-                    spots[to].piece_type = PieceColorType::WhiteKing;
-                } else if(spots[from].piece_type == PieceColorType::BlackMan) {
-                    spots[to].piece_type = PieceColorType::BlackKing;
-                } else {
-                    spots[to].piece_type = piece_type;
-                }
-            } else {
-                spots[to].piece_type = piece_type;
-            }
-            if(valid_move.type & MoveType::CAPTURE) {
-                SpotIndex captured_index = engine.get_captured_index(valid_move);
-                qDebug() << "CAPTURED INDEX from:" << valid_move.from << "to:" << valid_move.to << "captured:" << captured_index;
-                spots.at(captured_index).piece_type = PieceColorType::None;
-            }
-            emitDataChanged(PieceTypeRole);
-            return valid_move.type;
-        }
+    if (from >= SPOT_COUNT || to >= SPOT_COUNT || !(spots[from].move_mask & (quint32(1) << to))) {
+        return MoveType::INVALID;
     }
-    return MoveType::INVALID;
+    const auto found = std::find_if(legal_moves.begin(), legal_moves.end(), [from, to](const Move& move) {
+        return move.from == from && move.to == to;
+    });
+    const Move valid_move = *found;
+    const auto previous = spots;
+    engine.make_move(valid_move);
+    loadBoard();
+    emitSpotChanges(previous);
+    return valid_move.type;
+}
+
+/**
+ * @brief Replaces the board with a position snapshot.
+ * @param white The bitboard of the white pieces.
+ * @param black The bitboard of the black pieces.
+ * @param kings The bitboard of the kings.
+ * @param turn The color to move.
+ */
+void CheckersModel::set_position(quint32 white, quint32 black, quint32 kings, quint8 turn)
+{
+    engine.set_position(white, black, kings, Color(turn));
+    const auto previous = spots;
+    loadBoard();
+    emitSpotChanges(previous);
 }
 
 /**
@@ -174,15 +195,15 @@ quint8 CheckersModel::make_move(quint8 from, quint8 to)
  * @return The number of valid moves.
  */
 quint8 CheckersModel::highlightValidMoves(SpotIndex spot_index) {
-    const auto moves = engine.valid_moves(spot_index);
+    const quint32 move_mask = spots.at(spot_index).move_mask;
 
-    if (moves.empty()) return 0;
+    if (move_mask == 0) return 0;
 
     spots.at(spot_index).square_state = SpotState::Selected;
-    for (const auto& move: moves) {
-        spots.at(move.to).square_state = SpotState::PossibleMove;
+    for (quint8 to = 0; to < SPOT_COUNT; ++to) {
+        if (move_mask & (quint32(1) << to)) spots.at(to).square_state = SpotState::PossibleMove;
     }
-    return moves.size();
+    return quint8(std::popcount(move_mask));
 }
 
 /**
@@ -193,41 +214,25 @@ void CheckersModel::resetSpotStates()
     for (auto& spot: spots) {
         spot.square_state = SpotState::Default;
     }
-    emitDataChanged(SquareStateRole);
 }
 
 /**
- * @brief Hides the valid moves for a spot.
- * @param spot_index The index of the spot.
- * @return The number of valid moves.
+ * @brief Emits the dataChanged signal for the spots that differ from a previous copy, with the roles that changed.
+ * Rows of unchanged spots and white squares are left alone, so the view only refreshes what moved.
+ * @param previous The spots before the change.
  */
-quint8 CheckersModel::hideValidMoves(SpotIndex spot_index) {
-    for(auto& spot: spots) {
-        spot.square_state = SpotState::Default;
-    }
-    const auto moves = engine.valid_moves(spot_index);
-
-    if (moves.empty()) return 0;
-
-    spots.at(spot_index).square_state = SpotState::Default;
-    for (const auto& move: moves) {
-        spots.at(move.to).square_state = SpotState::Default;
-        if(move.type & MoveType::CAPTURE) {
-            SpotIndex captured_index = engine.get_captured_index(move);
-            spots.at(captured_index).square_state = SpotState::Default;
-        }
+void CheckersModel::emitSpotChanges(const std::array<SpotData, SPOT_COUNT>& previous) {
+    for (quint8 spot_index = 0; spot_index < SPOT_COUNT; ++spot_index) {
+        const SpotData& before = previous[spot_index];
+        const SpotData& after = spots[spot_index];
+        QList<int> roles;
+        if (before.piece_type != after.piece_type) roles << PieceTypeRole << IsOccupiedRole;
+        if (before.square_state != after.square_state) roles << SquareStateRole;
+        if ((before.move_mask != 0) != (after.move_mask != 0)) roles << HasMovesRole;
+        if (roles.isEmpty()) continue;
+        const auto& changed_index = QAbstractListModel::index(to_square_index(spot_index));
+        emit dataChanged(changed_index, changed_index, roles);
     }
-    return moves.size();
-}
-
-/**
- * @brief Emits the dataChanged signal for the given role.
- * @param role The role for which to emit the signal.
- */
-void CheckersModel::emitDataChanged(int role) {
-    const auto& begin_index = QAbstractListModel::index(0);
-    const auto& end_index = QAbstractListModel::index(63);
-    emit dataChanged(begin_index, end_index);
 }
 
 /**
@@ -249,3 +254,13 @@ bool CheckersModel::is_white_square(quint8 index) {
 quint8 CheckersModel::to_spot_index(quint8 square_index) {
     return square_index / 2;
 }
+
+/**
+ * @brief Converts a spot index to a square index.
+ * @param spot_index The index of the spot.
+ * @return The index of the square, the black square of the spot's row.
+ */
+quint8 CheckersModel::to_square_index(quint8 spot_index) {
+    const bool is_row_odd = (spot_index / (BOARD_SIZE / 2)) & 1;
+    return spot_index * 2 + (is_row_odd ? 0 : 1);
+}
@@ -11,6 +11,9 @@
 
 #include <QDebug>
 
+#include <algorithm>
+#include <span>
+
 static QString msg_to_qstr(const MessageStorage &msg)
 {
   return QString::fromStdString(message_to_string(msg));
@@ -40,6 +43,36 @@ void MessageHandler::connect_to_server()
   }
   qInfo() << "Connecting to server:" << network_config.address << "/" << network_config.port;
   server_socket->connectToHost(network_config.address, network_config.port);
+  // Every connection starts with v1, the HELLO goes out before the handshake.
+  frame_decoder.clear();
+  protocol_version = PROTOCOL_V1;
+  capabilities = 0;
+  send_hello();
+}
+
+/**
+ * @brief Offers the newest protocol version and the capabilities of this client to the server.
+ */
+void MessageHandler::send_hello()
+{
+  MessageStorage message_storage{MessageType::HELLO, HELLO_PAYLOAD_LEN};
+  message_storage.payload[0] = PROTOCOL_LATEST;
+  packi32(&message_storage.payload[1], CAPABILITY_MOVE_BATCH | CAPABILITY_PING);
+  send_message(message_storage);
+}
+
+/**
+ * @brief Connects to the server unless already connected.
+ *
+ * @return True if the connection is open.
+ */
+bool MessageHandler::ensure_connected()
+{
+  if (get_connection_status() == MessageHandler::DISCONNECTED)
+  {
+    connect_to_server();
+  }
+  return get_connection_status() == MessageHandler::CONNECTED;
 }
 
 /**
@@ -60,40 +93,102 @@ void MessageHandler::connectionError(QTcpSocket::SocketError socketError)
 {
   qCritical() << socketError;
   cleanup_connection();
+  // Try once to get back into the running game, the server keeps the seat for a grace period.
+  if (resume_token != 0 && !is_resuming)
+  {
+    is_resuming = true;
+    connect_to_server();
+    send_resume_handshake();
+  }
+  else
+  {
+    resume_token = 0;
+  }
 }
 
 /**
- * @brief Receives a message from the server and stores it in the provided MessageStorage object.
+ * @brief Copies a received frame into a MessageStorage object.
  *
+ * @param frame_header The decoded header of the frame.
+ * @param payload The payload of the frame, at most MAX_MESSAGE_LEN bytes.
  * @param message_storage The MessageStorage object to store the received message.
  */
-void MessageHandler::receive_message(MessageStorage &message_storage)
+void MessageHandler::receive_message(const FrameHeader &frame_header, std::span<const quint8> payload,
+                                     MessageStorage &message_storage)
 {
-  char buf[2];
-  // Receive message type and length
-  int bytes_read = server_socket->read(buf, 2);
-  if (bytes_read != 2)
+  message_storage.message_type = frame_header.message_type;
+  message_storage.len = quint8(payload.size());
+  std::copy(payload.begin(), payload.end(), message_storage.payload);
+  qInfo() << "Received message: " << msg_to_qstr(message_storage);
+}
+
+/**
+ * @brief Emits moveReceived for each move of a MOVE_BATCH payload.
+ *
+ * @param payload The payload, 3 bytes per move.
+ */
+void MessageHandler::receive_move_batch(std::span<const quint8> payload)
+{
+  qInfo() << "Received message: MOVE_BATCH with" << payload.size() / 3 << "moves";
+  for (size_t offset = 0; offset + 3 <= payload.size(); offset += 3)
   {
-    qWarning() << "Error when reading message: Bytes read for header:" << bytes_read << "of 2";
+    Move move;
+    move.from = SpotIndex(payload[offset]);
+    move.to = SpotIndex(payload[offset + 1]);
+    move.type = MoveType(payload[offset + 2]);
+    emit moveReceived(move, received_at_ns);
   }
-  message_storage.message_type = MessageType(buf[0]);
-  message_storage.len = buf[1];
-  // Receive payload
-  bytes_read = server_socket->read((char *)message_storage.payload, message_storage.len);
-  if (bytes_read != message_storage.len)
+}
+
+/**
+ * @brief Handles the readyRead signal from the server socket by buffering the received bytes and dispatching every
+ * complete message.
+ *
+ * TCP may split a message over several reads or pack several messages into one, so bytes of an incomplete message
+ * stay in the decoder until the rest arrives. A burst like the game replay after a resume or the hops of a multi-jump
+ * is dispatched in one pass.
+ */
+void MessageHandler::handle_message()
+{
+  received_at_ns = steady_clock_ns();
+  const QByteArray bytes = server_socket->readAll();
+  frame_decoder.append(std::span(reinterpret_cast<const quint8 *>(bytes.constData()), size_t(bytes.size())));
+
+  FrameHeader frame_header;
+  std::span<const quint8> payload;
+  // A HELLO switches the protocol version, the frames after it in the same read are decoded with the new one.
+  FrameDecoder::Status status;
+  while ((status = frame_decoder.next(protocol_version, frame_header, payload)) == FrameDecoder::FRAME)
   {
-    qWarning() << "Error when reading message: Bytes read for payload:" << bytes_read << "of" << message_storage.len;
+    if (frame_header.message_type == MOVE_BATCH)
+    {
+      receive_move_batch(payload);
+      continue;
+    }
+    if (payload.size() > MAX_MESSAGE_LEN)
+    {
+      qWarning() << "Skipping message of type" << int(frame_header.message_type) << "with" << payload.size() << "bytes";
+      continue;
+    }
+    MessageStorage message{};
+    receive_message(frame_header, payload, message);
+    dispatch_message(message);
+  }
+  if (status == FrameDecoder::MALFORMED)
+  {
+    qWarning() << "Malformed message header, closing the connection.";
+    frame_decoder.clear();
+    server_socket->abort();
   }
-  qInfo() << "Received message: " << msg_to_qstr(message_storage);
 }
 
 /**
- * @brief Handles the readyRead signal from the server socket by receiving and processing the message.
+ * @brief Emits the signal corresponding to a received message.
+ *
+ * @param message The received message.
  */
-void MessageHandler::handle_message()
+void MessageHandler::dispatch_message(const MessageStorage &message)
 {
-  MessageStorage message{};
-  receive_message(message);
   switch (message.message_type)
   {
     case LOBBY_CREATED:
@@ -105,12 +200,19 @@ void MessageHandler::handle_message()
     case GAME_STARTED:
     {
       GameFlags game_flags = GameFlags(message.payload[0]);
+      if (message.len >= 9)
+      {
+        resume_token = unpacku64(&message.payload[1]);
+      }
+      is_resuming = false;
       emit gameStarted(game_flags);
       break;
     }
     case ERROR:
     {
       ErrorType error_type = ErrorType(message.payload[0]);
+      // The game is over, there is nothing to resume.
+      resume_token = 0;
       emit errorOccurred(error_type);
       break;
     }
@@ -120,7 +222,7 @@ void MessageHandler::handle_message()
       move.from = SpotIndex(message.payload[0]);
       move.to = SpotIndex(message.payload[1]);
       move.type = MoveType(message.payload[2]);
-      emit moveReceived(move);
+      emit moveReceived(move, received_at_ns);
       break;
     }
     case DISCONNECT:
@@ -130,9 +232,49 @@ void MessageHandler::handle_message()
     }
     case RESIGN:
     {
+      resume_token = 0;
       emit resignReceived();
       break;
     }
+    case CLOCK:
+    {
+      emit clockReceived(unpacku32(message.payload), unpacku32(&message.payload[4]));
+      break;
+    }
+    case POSITION:
+    {
+      emit positionReceived(unpacku32(&message.payload[1]), unpacku32(&message.payload[5]),
+                            unpacku32(&message.payload[9]), message.payload[0]);
+      break;
+    }
+    case GAME_OVER:
+    {
+      // The game is over, there is nothing to resume.
+      resume_token = 0;
+      emit gameOverReceived(Color(message.payload[0]), GameOverReason(message.payload[1]));
+      break;
+    }
+    case HELLO:
+    {
+      // The server answers with the version and capabilities both sides support.
+      protocol_version = std::clamp(message.payload[0], PROTOCOL_V1, PROTOCOL_LATEST);
+      capabilities = unpacku32(&message.payload[1]);
+      break;
+    }
+    case PING:
+    {
+      // The server measures the round trip, the timestamp goes back unchanged.
+      MessageStorage pong = message;
+      pong.message_type = MessageType::PONG;
+      send_message(pong);
+      break;
+    }
+    case OPPONENT_STATUS:
+    {
+      const bool is_away = OpponentStatus(message.payload[0]) == OpponentStatus::OPPONENT_AWAY;
+      emit opponentStatusReceived(is_away, is_away ? message.payload[1] : 0);
+      break;
+    }
     case HANDSHAKE:
     default:
       break;
@@ -146,12 +288,11 @@ void MessageHandler::handle_message()
  */
 void MessageHandler::send_message(const MessageStorage &message_storage)
 {
-  unsigned char buf[2 + MAX_MESSAGE_LEN];
-  buf[0] = message_storage.message_type;
-  buf[1] = message_storage.len;
-  memcpy(&buf[2], message_storage.payload, message_storage.len);
-  // Receive message type and length
-  server_socket->write((char *)buf, 2 + message_storage.len);
+  unsigned char buf[MAX_FRAME_HEADER + MAX_MESSAGE_LEN];
+  const size_t header_len = encode_frame_header(message_storage.message_type, message_storage.len, protocol_version, buf);
+  memcpy(&buf[header_len], message_storage.payload, message_storage.len);
+  // Send message type, length and payload at once
+  server_socket->write((char *)buf, qint64(header_len + message_storage.len));
   qInfo() << "Send message: " << msg_to_qstr(message_storage);
 }
 
@@ -182,17 +323,72 @@ void MessageHandler::send_handshake()
 }
 
 /**
- * @brief Sends a move message to the server.
+ * @brief Sends a handshake message to the server to play against the server-side bot.
+ *
+ * @param bot_level The bot level, 0 is the weakest.
+ */
+void MessageHandler::send_bot_handshake(uint8_t bot_level)
+{
+  MessageStorage message_storage{MessageType::HANDSHAKE, 2};
+  message_storage.payload[0] = HandshakeType::PLAY_AGAINST_BOT;
+  message_storage.payload[1] = bot_level;
+  send_message(message_storage);
+}
+
+/**
+ * @brief Sends a handshake message to the server to watch the running game of a lobby.
+ *
+ * @param lobby_id The ID of the lobby to watch.
+ */
+void MessageHandler::send_spectate_handshake(uint32_t lobby_id)
+{
+  MessageStorage message_storage{MessageType::HANDSHAKE, 5};
+  message_storage.payload[0] = HandshakeType::SPECTATE;
+  packi32(&message_storage.payload[1], lobby_id);
+  send_message(message_storage);
+}
+
+/**
+ * @brief Sends a handshake message to the server to be paired with an anonymous opponent.
+ *
+ * @param rating The rating of the player, 0 lets the server pick the default rating.
+ */
+void MessageHandler::send_find_game_handshake(uint16_t rating)
+{
+  MessageStorage message_storage{MessageType::HANDSHAKE, 3};
+  message_storage.payload[0] = HandshakeType::FIND_GAME;
+  packi16(&message_storage.payload[1], rating);
+  send_message(message_storage);
+}
+
+/**
+ * @brief Sends a handshake message to the server to resume the running game.
+ */
+void MessageHandler::send_resume_handshake()
+{
+  MessageStorage message_storage{MessageType::HANDSHAKE, 9};
+  message_storage.payload[0] = HandshakeType::RESUME_SESSION;
+  packi64(&message_storage.payload[1], resume_token);
+  send_message(message_storage);
+}
+
+/**
+ * @brief Sends a move message to the server and logs how long it took from the input to the socket.
  *
  * @param move The Move object representing the move to send.
+ * @param input_at_ns The steady clock time the player made the move, in nanoseconds, 0 if unknown.
  */
-void MessageHandler::send_move(const Move &move)
+void MessageHandler::send_move(const Move &move, qint64 input_at_ns)
 {
   MessageStorage message_storage{MessageType::MOVE, 3};
   message_storage.payload[0] = move.from;
   message_storage.payload[1] = move.to;
   message_storage.payload[2] = move.type;
   send_message(message_storage);
+  if (input_at_ns != 0)
+  {
+    qInfo() << "Move sent" << (steady_clock_ns() - input_at_ns) / 1000 << "us after the input";
+  }
 }
 
 /**
@@ -200,6 +396,7 @@ void MessageHandler::send_move(const Move &move)
  */
 void MessageHandler::send_resign()
 {
+  resume_token = 0;
   MessageStorage message_storage{MessageType::RESIGN, 0};
   send_message(message_storage);
 }
@@ -8,16 +8,51 @@
 #include <QObject>
 
 /**
- * @brief Constructs a NetworkSession object.
+ * @brief Constructs a NetworkSession object and starts the network thread.
  * @param parent The parent QObject.
  */
-NetworkSession::NetworkSession(QObject *parent) : QObject(parent), network_session(new MessageHandler(this))
+NetworkSession::NetworkSession(QObject *parent) : QObject(parent), network_session(new MessageHandler)
 {
+    // The types travel through queued connections between the threads.
+    qRegisterMetaType<Move>("Move");
+    qRegisterMetaType<GameFlags>("GameFlags");
+    qRegisterMetaType<ErrorType>("ErrorType");
+    qRegisterMetaType<Color>("Color");
+    qRegisterMetaType<GameOverReason>("GameOverReason");
+
+    network_thread.setObjectName("network");
+    network_session->moveToThread(&network_thread);
+    connect(&network_thread, &QThread::finished, network_session, &QObject::deleteLater);
     connect(network_session, &MessageHandler::lobbyCreated, this, &NetworkSession::lobbyCreated);
     connect(network_session, &MessageHandler::gameStarted, this, &NetworkSession::onGameStarted);
     connect(network_session, &MessageHandler::errorOccurred, this, &NetworkSession::onErrorOccurred);
     connect(network_session, &MessageHandler::moveReceived, this, &NetworkSession::onMoveReceived);
     connect(network_session, &MessageHandler::resignReceived, this, &NetworkSession::resignReceived);
+    connect(network_session, &MessageHandler::clockReceived, this, &NetworkSession::clockUpdated);
+    connect(network_session, &MessageHandler::opponentStatusReceived, this, &NetworkSession::opponentStatusChanged);
+    connect(network_session, &MessageHandler::positionReceived, this, &NetworkSession::positionReceived);
+    connect(network_session, &MessageHandler::gameOverReceived, this, &NetworkSession::onGameOver);
+    network_thread.start();
+}
+
+/**
+ * @brief Stops the network thread, which deletes the message handler.
+ */
+NetworkSession::~NetworkSession()
+{
+    network_thread.quit();
+    network_thread.wait();
+}
+
+/**
+ * @brief Runs a task with the message handler on the network thread.
+ * Tasks run in the order they were posted.
+ * @param task The task.
+ */
+void NetworkSession::post(std::function<void(MessageHandler&)> task)
+{
+    MessageHandler* handler = network_session;
+    QMetaObject::invokeMethod(handler, [handler, task = std::move(task)] { task(*handler); }, Qt::QueuedConnection);
 }
 
 /**
@@ -27,7 +62,7 @@ NetworkSession::NetworkSession(QObject *parent) : QObject(parent), network_sessi
  */
 void NetworkSession::set_server_address(QString address, QString port)
 {
-    network_session->set_server_address(address, port.toUInt());
+    post([address, port = port.toUInt()](MessageHandler& handler) { handler.set_server_address(address, port); });
 }
 
 /**
@@ -37,13 +72,11 @@ void NetworkSession::set_server_address(QString address, QString port)
  */
 void NetworkSession::create_lobby()
 {
-    if(network_session->get_connection_status() == MessageHandler::DISCONNECTED) {
-        network_session->connect_to_server();
-        if(network_session->get_connection_status() == MessageHandler::DISCONNECTED) {
-            return;
+    post([](MessageHandler& handler) {
+        if(handler.ensure_connected()) {
+            handler.send_handshake();
         }
-    }
-    network_session->send_handshake();
+    });
 }
 
 /**
@@ -54,13 +87,56 @@ void NetworkSession::create_lobby()
  */
 void NetworkSession::connect_lobby(quint32 lobby_id)
 {
-    if(network_session->get_connection_status() == MessageHandler::DISCONNECTED) {
-        network_session->connect_to_server();
-        if(network_session->get_connection_status() == MessageHandler::DISCONNECTED) {
-            return;
+    post([lobby_id](MessageHandler& handler) {
+        if(handler.ensure_connected()) {
+            handler.send_handshake(lobby_id);
         }
-    }
-    network_session->send_handshake(lobby_id);
+    });
+}
+
+/**
+ * @brief Starts a game against the server-side bot.
+ * If the network session is disconnected, it connects to the server first.
+ * If the connection fails, it returns without starting the game.
+ * @param bot_level The bot level, 0 is the weakest.
+ */
+void NetworkSession::play_against_bot(quint8 bot_level)
+{
+    post([bot_level](MessageHandler& handler) {
+        if(handler.ensure_connected()) {
+            handler.send_bot_handshake(bot_level);
+        }
+    });
+}
+
+/**
+ * @brief Joins the quick-play queue to be paired with an anonymous opponent.
+ * If the network session is disconnected, it connects to the server first.
+ * If the connection fails, it returns without joining the queue.
+ * @param rating The rating of the player, 0 lets the server pick the default rating.
+ */
+void NetworkSession::find_game(quint16 rating)
+{
+    post([rating](MessageHandler& handler) {
+        if(handler.ensure_connected()) {
+            handler.send_find_game_handshake(rating);
+        }
+    });
+}
+
+/**
+ * @brief Watches the running game of a lobby.
+ * If the network session is disconnected, it connects to the server first.
+ * If the connection fails, it returns without watching the game.
+ * @param lobby_id The ID of the lobby to watch.
+ */
+void NetworkSession::spectate(quint32 lobby_id)
+{
+    post([lobby_id](MessageHandler& handler) {
+        if(handler.ensure_connected()) {
+            handler.send_spectate_handshake(lobby_id);
+        }
+    });
 }
 
 /**
@@ -72,14 +148,12 @@ void NetworkSession::connect_lobby(quint32 lobby_id)
  * @param type The type of the move.
  */
 void NetworkSession::send_move(quint8 from, quint8 to, quint8 type) {
-    if(network_session->get_connection_status() == MessageHandler::DISCONNECTED) {
-        network_session->connect_to_server();
-        if(network_session->get_connection_status() == MessageHandler::DISCONNECTED) {
-            return;
+    const Move move{SpotIndex(from), SpotIndex(to), MoveType(type)};
+    post([move, input_at_ns = steady_clock_ns()](MessageHandler& handler) {
+        if(handler.ensure_connected()) {
+            handler.send_move(move, input_at_ns);
         }
-    }
-    Move move{SpotIndex(from), SpotIndex(to), MoveType(type)};
-    network_session->send_move(move);
+    });
 }
 
 /**
@@ -87,7 +161,7 @@ void NetworkSession::send_move(quint8 from, quint8 to, quint8 type) {
  */
 void NetworkSession::resign()
 {
-  network_session->send_resign();
+    post([](MessageHandler& handler) { handler.send_resign(); });
 }
 
 /**
@@ -118,6 +192,31 @@ void NetworkSession::onErrorOccurred(ErrorType error_type)
         emit serverErrorOccurred(message_text);
         break;
     }
+    case ErrorType::LOBBY_EXPIRED: {
+        QString message_text = "Nobody joined the lobby in time.";
+        emit serverErrorOccurred(message_text);
+        break;
+    }
+    case ErrorType::SESSION_TIMEOUT: {
+        QString message_text = "Game was closed due to inactivity.";
+        emit serverErrorOccurred(message_text);
+        break;
+    }
+    case ErrorType::TIME_EXPIRED: {
+        QString message_text = "Time is up.";
+        emit serverErrorOccurred(message_text);
+        break;
+    }
+    case ErrorType::SESSION_NOT_FOUND: {
+        QString message_text = "The game could not be resumed.";
+        emit serverErrorOccurred(message_text);
+        break;
+    }
+    case ErrorType::SERVER_DRAINING: {
+        QString message_text = "Server is restarting, try again in a minute.";
+        emit serverErrorOccurred(message_text);
+        break;
+    }
     default:
         // should never reach here
         break;
@@ -126,21 +225,63 @@ void NetworkSession::onErrorOccurred(ErrorType error_type)
 
 /**
  * @brief Handles the move received signal from the network session.
- * Emits a moveReceived signal with the move details.
+ * Emits a moveReceived signal with the move details and logs how long the move took from the socket to the GUI thread.
  * @param move The move received.
+ * @param received_at_ns The steady clock time the move was read from the socket, in nanoseconds.
  */
-void NetworkSession::onMoveReceived(Move move)
+void NetworkSession::onMoveReceived(Move move, qint64 received_at_ns)
 {
     emit moveReceived(move.from, move.to, move.type);
+    qInfo() << "Move applied" << (steady_clock_ns() - received_at_ns) / 1000 << "us after it was received";
 }
 
 /**
  * @brief Handles the game started signal from the network session.
- * Emits a gameStarted signal with the information whether the player is white or not.
+ * Emits a gameStarted signal with the information whether the player is white or only watches.
+ * Spectators see the board from the white side.
  * @param game_flags The game flags indicating the player's color.
  */
 void NetworkSession::onGameStarted(GameFlags game_flags)
 {
+    this->game_flags = game_flags;
     const bool is_white = game_flags & GameFlags::IM_WHITE;
-    emit gameStarted(is_white);
+    const bool is_spectator = game_flags & GameFlags::SPECTATOR;
+    emit gameStarted(is_white || is_spectator, is_spectator);
+}
+
+/**
+ * @brief Handles the game over signal from the network session.
+ * Emits a gameOver signal with a description of the result, from the player's side unless watching.
+ * @param winner The color of the winner, BOTH for a draw.
+ * @param reason Why the game ended.
+ */
+void NetworkSession::onGameOver(Color winner, GameOverReason reason)
+{
+    QString result_text;
+    if(winner == BOTH) {
+        result_text = "Draw";
+    } else if(game_flags & GameFlags::SPECTATOR) {
+        result_text = winner == WHITE ? "White won" : "Black won";
+    } else {
+        const Color my_color = game_flags & GameFlags::IM_WHITE ? WHITE : BLACK;
+        result_text = winner == my_color ? "You won" : "You lost";
+    }
+
+    switch(reason) {
+    case GameOverReason::DRAW_BY_REPETITION:
+        emit gameOver(result_text + ": the same position occurred three times.");
+        break;
+    case GameOverReason::DRAW_BY_MOVE_LIMIT:
+        emit gameOver(result_text + ": forty moves each without a capture or a man move.");
+        break;
+    case GameOverReason::ALL_PIECES_CAPTURED:
+        emit gameOver(result_text + ": all pieces were captured.");
+        break;
+    case GameOverReason::NO_LEGAL_MOVES:
+        emit gameOver(result_text + ": no legal moves left.");
+        break;
+    default:
+        // should never reach here
+        break;
+    }
 }
@@ -15,6 +15,20 @@ constexpr size_t SPOTS_NUMBER = 32;
  */
 using SpotIndex = uint8_t;
 
+/**
+ * @brief Gets the board row of a spot, row 0 is black's base.
+ * @param spot The spot.
+ * @return The row, 0 to 7.
+ */
+constexpr int spot_row(SpotIndex spot) { return spot / 4; }
+
+/**
+ * @brief Gets the board column of a spot, dark squares alternate between odd and even columns.
+ * @param spot The spot.
+ * @return The column, 0 to 7.
+ */
+constexpr int spot_column(SpotIndex spot) { return 2 * (spot % 4) + (spot_row(spot) % 2 == 0 ? 1 : 0); }
+
 /**
  * @brief Type alias for the bitboard.
  */
@@ -260,6 +274,87 @@ constexpr Bitboard shift(Bitboard bitboard, MoveDirection direction)
     }
 }
 
+/**
+ * @brief Enum indexing the per-direction entries of the spot tables.
+ * A man of a color moves in the two directions starting at MAN_DIRECTIONS_BEGIN[color].
+ */
+enum DirectionIndex : uint8_t {
+    NORTH_EAST_INDEX,
+    NORTH_WEST_INDEX,
+    SOUTH_EAST_INDEX,
+    SOUTH_WEST_INDEX,
+    DIRECTIONS_NUMBER
+};
+
+/**
+ * @brief The directions in DirectionIndex order.
+ */
+constexpr MoveDirection DIRECTIONS[DIRECTIONS_NUMBER] { NORTH_EAST, NORTH_WEST, SOUTH_EAST, SOUTH_WEST };
+
+/**
+ * @brief The first direction index of the men of a color, white men move north and black men south.
+ */
+constexpr DirectionIndex MAN_DIRECTIONS_BEGIN[BOTH] { NORTH_EAST_INDEX, SOUTH_EAST_INDEX };
+
+/**
+ * @brief The moves masks in DirectionIndex order.
+ */
+constexpr Bitboard MOVES_MASKS[DIRECTIONS_NUMBER] { NE_MOVES_MASK, NW_MOVES_MASK, SE_MOVES_MASK, SW_MOVES_MASK };
+
+/**
+ * @brief The attacks masks in DirectionIndex order.
+ */
+constexpr Bitboard ATTACKS_MASKS[DIRECTIONS_NUMBER] { NE_ATTACKS_MASK, NW_ATTACKS_MASK, SE_ATTACKS_MASK, SW_ATTACKS_MASK };
+
+/**
+ * @brief The neighbours and jumps of a spot, per direction in DirectionIndex order.
+ * Missing squares off the board are 0 in the bitboards and SPOTS_NUMBER in the spot indices.
+ */
+struct SpotTable {
+    std::array<Bitboard, DIRECTIONS_NUMBER> step{};      /**< The adjacent square. */
+    std::array<Bitboard, DIRECTIONS_NUMBER> jumped{};    /**< The square jumped over, 0 if the landing square is off the board. */
+    std::array<Bitboard, DIRECTIONS_NUMBER> jump{};      /**< The landing square of a jump. */
+    std::array<SpotIndex, DIRECTIONS_NUMBER> jumped_spot{}; /**< The spot jumped over. */
+    std::array<SpotIndex, DIRECTIONS_NUMBER> jump_spot{};   /**< The spot of the landing square. */
+    std::array<SpotIndex, SPOTS_NUMBER> jumped_spot_by_landing{}; /**< The spot jumped over, by landing spot. */
+    std::array<Bitboard, BOTH> man_steps{};  /**< The adjacent squares a man of a color moves to. */
+    Bitboard king_steps = 0;                 /**< The adjacent squares in all directions. */
+};
+
+/**
+ * @brief Generates the spot tables from the shifts and masks of the bitboard move generation.
+ * @return The spot tables indexed by spot.
+ */
+constexpr auto generate_spot_tables()
+{
+    std::array<SpotTable, SPOTS_NUMBER> tables{};
+    for (SpotIndex spot = 0; spot < SPOTS_NUMBER; ++spot) {
+        const Bitboard bit = spot_index_to_bit[spot];
+        SpotTable& table = tables[spot];
+        table.jumped_spot_by_landing.fill(SpotIndex(SPOTS_NUMBER));
+        for (int direction = 0; direction < DIRECTIONS_NUMBER; ++direction) {
+            table.step[direction] = shift(bit & MOVES_MASKS[direction], DIRECTIONS[direction]);
+            table.jumped[direction] = shift(bit & ATTACKS_MASKS[direction], DIRECTIONS[direction]);
+            table.jump[direction] = shift(table.jumped[direction], DIRECTIONS[direction]);
+            table.jumped_spot[direction] = table.jumped[direction] ? bit_to_spot_index(table.jumped[direction]) : SpotIndex(SPOTS_NUMBER);
+            table.jump_spot[direction] = table.jump[direction] ? bit_to_spot_index(table.jump[direction]) : SpotIndex(SPOTS_NUMBER);
+            if (table.jump[direction])
+                table.jumped_spot_by_landing[table.jump_spot[direction]] = table.jumped_spot[direction];
+            table.king_steps |= table.step[direction];
+        }
+        for (const Color color : {WHITE, BLACK}) {
+            const int begin = MAN_DIRECTIONS_BEGIN[color];
+            table.man_steps[color] = table.step[begin] | table.step[begin + 1];
+        }
+    }
+    return tables;
+}
+
+/**
+ * @brief The neighbours and jumps of every spot.
+ */
+constexpr auto SPOT_TABLES = generate_spot_tables();
+
 /**
  * @brief Iterator for iterating over the bits of a bitboard and returning the corresponding spot index.
  * @tparam T The type of the bitboard.
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "board.h"
+#include "position.h"
 
 #include <vector>
 
@@ -18,6 +19,12 @@ public:
      */
     checkers_engine();
 
+    /**
+     * @brief Constructs a checkers_engine object set up in a position.
+     * @param position The position.
+     */
+    explicit checkers_engine(const Position& position);
+
     /**
      * @brief Sets the color of the player.
      * @param color The color of the player.
@@ -29,6 +36,27 @@ public:
      */
     void reset();
 
+    /**
+     * @brief Sets up an arbitrary position, e.g. a snapshot received from the server.
+     * @param white The bitboard of the white pieces.
+     * @param black The bitboard of the black pieces.
+     * @param kings_bits The bitboard of the kings of both colors.
+     * @param side_to_move The color to move.
+     */
+    void set_position(Bitboard white, Bitboard black, Bitboard kings_bits, Color side_to_move);
+
+    /**
+     * @brief Sets up a packed position.
+     * @param position The position.
+     */
+    void set_position(const Position& position);
+
+    /**
+     * @brief Gets the current position.
+     * @return The packed position.
+     */
+    Position position() const { return Position(pieces[WHITE], pieces[BLACK], kings, turn); }
+
     /**
      * @brief Makes a move on the checkers board.
      * @param move The move to be made.
@@ -42,6 +70,12 @@ public:
      */
     bool is_valid(const Move& move) const;
 
+    /**
+     * @brief Checks if the game is over, without generating the moves.
+     * @return WIN if the side to move has no pieces or no moves and lost, GOING otherwise.
+     */
+    GameStatus status() const;
+
     /**
      * @brief Gets a list of all valid moves.
      * @return A list of all valid moves.
@@ -74,6 +108,37 @@ public:
      */
     SpotIndex get_captured_index(const Move& move) const;
 
+    /**
+     * @brief Gets the bitboard of all pieces of a color.
+     * @param color The color of the pieces.
+     * @return The bitboard of the pieces.
+     */
+    Bitboard pieces_bitboard(Color color) const { return pieces[color]; }
+
+    /**
+     * @brief Gets the bitboard of all kings of both colors.
+     * @return The bitboard of the kings.
+     */
+    Bitboard kings_bitboard() const { return kings; }
+
+    /**
+     * @brief Gets the Zobrist hash of the position, maintained incrementally by make_move.
+     * @return The hash of the pieces and the side to move.
+     */
+    uint64_t hash() const { return position_hash; }
+
+    /**
+     * @brief Gets the number of plies since the last capture or man move.
+     * @return The number of consecutive king moves without a capture.
+     */
+    uint16_t reversible_plies() const { return quiet_plies; }
+
+    /**
+     * @brief Gets the sum of the piece-square values of all pieces, maintained incrementally by make_move.
+     * @return The material and positional score from white's point of view, see evaluation.h.
+     */
+    int piece_square_score() const { return square_score; }
+
     Color turn = BOTH; /**< The current turn in the game. */
 
     // Debug
@@ -101,6 +166,15 @@ private:
      */
     Bitboard captures() const;
 
+    /**
+     * @brief Gets the non-capturing moves of a single piece from the spot tables.
+     * Faster than the shifts for one piece, see BoardTablesBench; the shifts stay for captures and whole bitboards.
+     * @param spot The spot of the piece.
+     * @param is_king Whether the piece is a king.
+     * @return The bitboard representation of the possible moves.
+     */
+    Bitboard spot_steps(SpotIndex spot, bool is_king) const;
+
     /**
      * @brief Gets the bitboard representation of all possible moves for a man piece.
      * @param piece_bit The bitboard representation of the man piece.
@@ -129,6 +203,14 @@ private:
      */
     Bitboard king_capture_moves(Bitboard piece_bit) const;
 
+    /**
+     * @brief Computes the Zobrist hash and the piece-square score of the position from scratch.
+     */
+    void compute_incremental_terms();
+
     Bitboard pieces[BOTH] = {}; /**< The bitboard representation of the pieces on the board. */
     Bitboard kings = 0; /**< The bitboard representation of the king pieces on the board. */
+    uint64_t position_hash = 0; /**< The Zobrist hash of the pieces and the side to move. */
+    uint16_t quiet_plies = 0; /**< The number of plies since the last capture or man move. */
+    int16_t square_score = 0; /**< The sum of the piece-square values, from white's point of view. */
 };
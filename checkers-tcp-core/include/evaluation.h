@@ -0,0 +1,163 @@
+/**
+ * @file evaluation.h
+ * @brief Contains the static evaluation of positions.
+ */
+#pragma once
+
+#include "checkers_engine.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+/**
+ * @brief Enumerates the kinds of pieces, the index of the per-kind tables.
+ */
+enum PieceKind : uint8_t { WHITE_MAN, WHITE_KING, BLACK_MAN, BLACK_KING, PIECE_KINDS };
+
+/**
+ * @brief Value of a man.
+ */
+constexpr int MAN_VALUE = 100;
+
+/**
+ * @brief Value a man gains by promotion.
+ */
+constexpr int KING_BONUS = 200;
+
+/**
+ * @brief Bonus of a man still guarding its own base row against promotions.
+ */
+constexpr int BACK_RANK_BONUS = 12;
+
+/**
+ * @brief Bonus of a piece on one of the central squares.
+ */
+constexpr int CENTER_BONUS = 6;
+
+/**
+ * @brief Bonus of a man per row advanced from its base row.
+ */
+constexpr int TEMPO_WEIGHT = 2;
+
+/**
+ * @brief Bonus per available non-capturing move.
+ */
+constexpr int MOBILITY_WEIGHT = 3;
+
+/**
+ * @brief Gets the row of a spot counted from white's base row.
+ * @param spot The spot.
+ * @return The row, 0 on white's base row and 7 on black's.
+ */
+constexpr int white_row(SpotIndex spot) { return 7 - spot_row(spot); }
+
+/**
+ * @brief Generates the masks of the rows counted from white's base row.
+ */
+constexpr auto generate_row_masks()
+{
+    std::array<Bitboard, 8> masks{};
+    for (SpotIndex spot = 0; spot < SPOTS_NUMBER; ++spot)
+        masks[white_row(spot)] |= spot_index_to_bit[spot];
+    return masks;
+}
+
+/**
+ * @brief Masks of the rows counted from white's base row.
+ */
+constexpr auto ROW_MASKS = generate_row_masks();
+
+/**
+ * @brief Generates the mask of the central squares, the middle four columns of the middle four rows.
+ */
+constexpr Bitboard generate_center_mask()
+{
+    Bitboard mask = 0;
+    for (SpotIndex spot = 0; spot < SPOTS_NUMBER; ++spot) {
+        const int row = white_row(spot);
+        const int column = spot_column(spot);
+        if (row >= 2 && row <= 5 && column >= 2 && column <= 5)
+            mask |= spot_index_to_bit[spot];
+    }
+    return mask;
+}
+
+/**
+ * @brief Mask of the central squares.
+ */
+constexpr Bitboard CENTER_MASK = generate_center_mask();
+
+/**
+ * @brief Generates the piece-square values, the material and positional terms of a single piece.
+ */
+constexpr auto generate_piece_square_values()
+{
+    std::array<std::array<int16_t, SPOTS_NUMBER>, PIECE_KINDS> values{};
+    for (SpotIndex spot = 0; spot < SPOTS_NUMBER; ++spot) {
+        const Bitboard bit = spot_index_to_bit[spot];
+        const int bit_index = std::countr_zero(bit);
+        const int center = bit & CENTER_MASK ? CENTER_BONUS : 0;
+        values[WHITE_MAN][bit_index] = int16_t(MAN_VALUE + center + TEMPO_WEIGHT * white_row(spot) +
+                                               (bit & WHITE_BASE ? BACK_RANK_BONUS : 0));
+        values[BLACK_MAN][bit_index] = int16_t(-(MAN_VALUE + center + TEMPO_WEIGHT * (7 - white_row(spot)) +
+                                                 (bit & BLACK_BASE ? BACK_RANK_BONUS : 0)));
+        values[WHITE_KING][bit_index] = int16_t(MAN_VALUE + KING_BONUS + center);
+        values[BLACK_KING][bit_index] = int16_t(-(MAN_VALUE + KING_BONUS + center));
+    }
+    return values;
+}
+
+/**
+ * @brief Piece-square values from white's point of view, indexed by piece kind and bitboard bit index.
+ * The sum over all pieces is maintained incrementally by checkers_engine::make_move.
+ */
+constexpr auto PIECE_SQUARE_VALUES = generate_piece_square_values();
+
+/**
+ * @brief The terms of the evaluation, each from white's point of view.
+ */
+struct EvalTerms {
+    int material = 0;   /**< MAN_VALUE per piece. */
+    int kings = 0;      /**< KING_BONUS per king. */
+    int back_rank = 0;  /**< BACK_RANK_BONUS per man on its own base row. */
+    int center = 0;     /**< CENTER_BONUS per piece on a central square. */
+    int tempo = 0;      /**< TEMPO_WEIGHT per row the men advanced. */
+    int mobility = 0;   /**< MOBILITY_WEIGHT per non-capturing move. */
+
+    /**
+     * @brief Gets the sum of the terms.
+     * @return The evaluation from white's point of view.
+     */
+    int total() const { return material + kings + back_rank + center + tempo + mobility; }
+};
+
+/**
+ * @brief Computes every term of the evaluation from scratch, for analysis.
+ * @param engine The position.
+ * @return The terms, their total equals evaluate() from white's point of view.
+ */
+EvalTerms evaluation_terms(const checkers_engine& engine);
+
+/**
+ * @brief Counts the non-capturing moves of a color.
+ * @param engine The position.
+ * @param color The color, regardless of the side to move.
+ * @return The number of moves.
+ */
+int count_moves(const checkers_engine& engine, Color color);
+
+/**
+ * @brief Evaluates a position for a search.
+ *
+ * The material and positional terms come from the incrementally maintained piece-square
+ * sum, only mobility is computed per call.
+ * @param engine The position.
+ * @return The score from the point of view of the side to move.
+ */
+inline int evaluate(const checkers_engine& engine)
+{
+    const int score = engine.piece_square_score() +
+                      MOBILITY_WEIGHT * (count_moves(engine, WHITE) - count_moves(engine, BLACK));
+    return engine.turn == BLACK ? -score : score;
+}
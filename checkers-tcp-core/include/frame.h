@@ -0,0 +1,148 @@
+/**
+ * @file frame.h
+ * @brief Contains the framing of messages on the wire in both protocol versions.
+ *
+ * A v1 frame is the message type, a one-byte payload length and the payload. A v2 frame replaces
+ * the length byte with an unsigned LEB128 varint, so payloads up to MAX_FRAME_PAYLOAD fit. Lengths
+ * below 128 encode the same in both versions, so v1 messages are valid v2 frames byte for byte.
+ *
+ * Every connection starts with v1. A client that speaks v2 sends HELLO (version u8, Capability
+ * flags u32) before its HANDSHAKE; the server answers HELLO with the version and the capabilities
+ * both sides support. The HANDSHAKE is still framed v1, every later frame in both directions uses
+ * the negotiated version.
+ */
+#pragma once
+
+#include "message.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief The protocol every connection starts with: one-byte lengths.
+ */
+constexpr uint8_t PROTOCOL_V1 = 1;
+
+/**
+ * @brief The protocol with varint lengths and capability negotiation.
+ */
+constexpr uint8_t PROTOCOL_V2 = 2;
+
+/**
+ * @brief The newest protocol version of this build.
+ */
+constexpr uint8_t PROTOCOL_LATEST = PROTOCOL_V2;
+
+/**
+ * @brief The maximum payload length of a v2 frame, larger frames are rejected as malformed.
+ */
+constexpr size_t MAX_FRAME_PAYLOAD = 16 * 1024;
+
+/**
+ * @brief The maximum length of a frame header: the type and a three-byte varint.
+ */
+constexpr size_t MAX_FRAME_HEADER = 4;
+
+/**
+ * @brief Length of the HELLO payload: version u8 and Capability flags u32.
+ */
+constexpr size_t HELLO_PAYLOAD_LEN = 5;
+
+/**
+ * @brief The decoded header of a frame.
+ */
+struct FrameHeader {
+    MessageType message_type = MessageType::HANDSHAKE;   /**< The type of the message. */
+    size_t payload_len = 0;   /**< The length of the payload following the header. */
+};
+
+/**
+ * @brief Encodes a frame header.
+ * @param message_type The type of the message.
+ * @param payload_len The length of the payload, at most 255 in v1 and MAX_FRAME_PAYLOAD in v2.
+ * @param version The protocol version of the connection.
+ * @param out The buffer of at least MAX_FRAME_HEADER bytes to write the header to.
+ * @return The length of the header.
+ */
+size_t encode_frame_header(MessageType message_type, size_t payload_len, uint8_t version, uint8_t* out);
+
+/**
+ * @brief Decodes the frame header at the start of a buffer.
+ * @param bytes The received bytes.
+ * @param version The protocol version of the connection.
+ * @param header The decoded header.
+ * @return The length of the header, 0 if more bytes are needed, -1 if the header is malformed or the payload too long.
+ */
+int decode_frame_header(std::span<const uint8_t> bytes, uint8_t version, FrameHeader& header);
+
+/**
+ * @brief Splits a byte stream into frames, whatever way the stream was segmented.
+ *
+ * Received bytes are appended as they arrive and every complete frame is taken out with next(),
+ * so a read that ends inside a frame keeps its bytes for the next one. The version is passed per
+ * frame, since a HELLO switches it between two frames of the same read.
+ */
+class FrameDecoder
+{
+public:
+    /**
+     * @brief The outcome of next().
+     */
+    enum Status {
+        FRAME,      /**< A complete frame was taken out. */
+        NEED_MORE,  /**< The buffered bytes end inside a frame. */
+        MALFORMED   /**< The header is invalid, the stream can't be resynchronized. */
+    };
+
+    /**
+     * @brief Appends received bytes.
+     * @param bytes The bytes.
+     */
+    void append(std::span<const uint8_t> bytes);
+
+    /**
+     * @brief Takes the next complete frame out of the buffer.
+     * @param version The protocol version of the frame.
+     * @param header The header of the frame.
+     * @param payload The payload of the frame, valid until the next append() or clear().
+     * @return FRAME if a frame was taken out, NEED_MORE or MALFORMED otherwise.
+     */
+    Status next(uint8_t version, FrameHeader& header, std::span<const uint8_t>& payload);
+
+    /**
+     * @brief Drops the buffered bytes, for a new connection.
+     */
+    void clear();
+
+    /**
+     * @brief Gets the number of buffered bytes not yet taken out as frames.
+     * @return The number of bytes.
+     */
+    [[nodiscard]] size_t buffered() const { return buffer.size() - offset; }
+
+    /**
+     * @brief Gets the buffered bytes not yet taken out as frames.
+     * @return The bytes, valid until the next append() or clear().
+     */
+    [[nodiscard]] std::span<const uint8_t> pending() const { return {buffer.data() + offset, buffered()}; }
+
+    /**
+     * @brief Gets the number of bytes still missing to complete the next frame.
+     * A reader that never asks the socket for more leaves the bytes of later frames to whoever reads it next.
+     * @param version The protocol version of the frame.
+     * @return The number of bytes, 0 if a frame is complete or the header is malformed.
+     */
+    [[nodiscard]] size_t missing(uint8_t version) const;
+
+    /**
+     * @brief Gets the heap memory held by the buffer.
+     * @return The size in bytes.
+     */
+    [[nodiscard]] size_t memory_footprint() const { return buffer.capacity(); }
+
+private:
+    std::vector<uint8_t> buffer; /**< The received bytes, frames before offset were already taken out. */
+    size_t offset = 0; /**< The start of the first frame not yet taken out. */
+};
@@ -0,0 +1,74 @@
+/**
+ * @file game_history.h
+ * @brief Contains the position history used to detect drawn games.
+ */
+#pragma once
+
+#include "checkers_engine.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Number of occurrences of a position with the same side to move that draw the game.
+ */
+constexpr size_t REPETITION_COUNT = 3;
+
+/**
+ * @brief Number of moves of each side without a capture or a man move that draw the game.
+ */
+constexpr uint16_t DRAW_MOVE_LIMIT = 40;
+
+/**
+ * @brief Enumerates why a game is drawn.
+ */
+enum DrawReason : uint8_t {
+    NO_DRAW,        /**< The game isn't drawn. */
+    REPETITION,     /**< The position occurred REPETITION_COUNT times. */
+    MOVE_LIMIT      /**< DRAW_MOVE_LIMIT moves of each side without a capture or a man move. */
+};
+
+/**
+ * @brief Stack of the position hashes of a game, used to detect draws.
+ *
+ * Captures and man moves can't be undone, so a position can only repeat one seen since the
+ * last of them. The stack keeps just those hashes and is cleared on every irreversible move,
+ * which bounds it by the move limit. It lives next to the engine rather than inside it so
+ * that copying the engine during a search stays cheap.
+ */
+class GameHistory {
+public:
+    /**
+     * @brief Starts a new history at the current position of the engine.
+     * @param engine The engine.
+     */
+    void reset(const checkers_engine& engine);
+
+    /**
+     * @brief Records the position after a move was made on the engine.
+     * @param engine The engine.
+     */
+    void push(const checkers_engine& engine);
+
+    /**
+     * @brief Gets why the game is drawn in the last recorded position.
+     * @return The reason, NO_DRAW if the game goes on.
+     */
+    DrawReason draw_reason() const;
+
+    /**
+     * @brief Gets the status of the game as far as draws are concerned.
+     * @return DRAW if the game is drawn, GOING otherwise.
+     */
+    GameStatus status() const { return draw_reason() == NO_DRAW ? GOING : DRAW; }
+
+    /**
+     * @brief Gets the heap memory held by the history.
+     * @return The size in bytes.
+     */
+    size_t memory_footprint() const { return hashes.capacity() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> hashes; /**< The hashes since the last irreversible move, the current position last. */
+    uint16_t reversible_plies = 0; /**< The reversible plies of the current position. */
+};
@@ -0,0 +1,174 @@
+/**
+ * @file game_log.h
+ * @brief Contains the segmented append-only log of game records and its memory-mapped reader.
+ *
+ * The log is a directory of segment files named games-NNNNNN.log. Each segment starts with
+ * SEGMENT_MAGIC followed by records back to back (see game_record.h).
+ */
+#pragma once
+
+#include "game_record.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Magic bytes at the start of every segment.
+ */
+constexpr char SEGMENT_MAGIC[8] = {'C', 'H', 'K', 'L', 'O', 'G', '0', '1'};
+
+/**
+ * @brief Appends game records to the newest segment of a log directory.
+ *
+ * Records are buffered and written with a single write() once the buffer reaches the flush
+ * threshold, so a record is never split between two writes. A new segment is started when
+ * the current one would grow past the segment size. A torn record at the end of the newest
+ * segment, left by a crash, is cut off when the writer opens it. Thread-safe.
+ */
+class GameLogWriter {
+public:
+    static constexpr size_t DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024; /**< The default segment size limit. */
+
+    /**
+     * @brief Opens or creates a log directory for appending.
+     * @param directory The log directory.
+     * @param flush_threshold The number of buffered bytes that triggers a write, 0 writes every record.
+     * @param segment_size The size limit of a segment.
+     */
+    explicit GameLogWriter(std::filesystem::path directory, size_t flush_threshold = 0,
+                           size_t segment_size = DEFAULT_SEGMENT_SIZE);
+
+    /**
+     * @brief Writes the buffered records and closes the segment.
+     */
+    ~GameLogWriter();
+
+    GameLogWriter(const GameLogWriter&) = delete;
+    GameLogWriter& operator=(const GameLogWriter&) = delete;
+
+    /**
+     * @brief Appends a game record.
+     * @param header The header of the record.
+     * @param moves The moves of the game.
+     * @return True if the record was appended, false if it can't be encoded.
+     */
+    bool append(const RecordHeader& header, std::span<const Move> moves);
+
+    /**
+     * @brief Writes the buffered records to the segment.
+     */
+    void flush();
+
+private:
+    void flush_locked();
+    void open_segment(uint32_t index);
+
+    std::filesystem::path directory; /**< The log directory. */
+    const size_t flush_threshold; /**< The number of buffered bytes that triggers a write. */
+    const size_t segment_size; /**< The size limit of a segment. */
+    std::mutex mutex; /**< Guards the buffer and the segment. */
+    std::vector<uint8_t> buffer; /**< Records not written yet. */
+    int segment_fd = -1; /**< The open segment. */
+    uint32_t segment_index = 0; /**< The number of the open segment. */
+    size_t segment_bytes = 0; /**< The size of the open segment. */
+};
+
+/**
+ * @brief A read-only memory mapping of one segment.
+ */
+class GameLogSegment {
+public:
+    /**
+     * @brief Forward iterator over the complete records of a segment.
+     */
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = GameRecordView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const GameRecordView*;
+        using reference = const GameRecordView&;
+
+        Iterator() = default;
+
+        /**
+         * @brief Constructs an iterator at the start of the records.
+         * @param bytes The records after the current position.
+         */
+        explicit Iterator(std::span<const uint8_t> bytes) : rest(bytes) { advance(); }
+
+        reference operator*() const { return *record; }
+        pointer operator->() const { return &*record; }
+        Iterator& operator++() { advance(); return *this; }
+        Iterator operator++(int) { Iterator old = *this; advance(); return old; }
+        bool operator==(const Iterator& other) const { return record.has_value() == other.record.has_value() && rest.data() == other.rest.data(); }
+
+    private:
+        void advance() {
+            record = GameRecordView::parse(rest);
+            // A torn record at the end, or garbage, ends the segment.
+            rest = record ? rest.subspan(record->size()) : std::span<const uint8_t>{};
+        }
+
+        std::span<const uint8_t> rest; /**< The bytes after the current record. */
+        std::optional<GameRecordView> record; /**< The current record. */
+    };
+
+    /**
+     * @brief Maps a segment file.
+     * @param path The segment file.
+     */
+    explicit GameLogSegment(const std::filesystem::path& path);
+
+    /**
+     * @brief Gets the mapped records, without the segment magic.
+     * @return The record bytes.
+     */
+    std::span<const uint8_t> records() const { return bytes; }
+
+    Iterator begin() const { return Iterator(bytes); }
+    Iterator end() const { return Iterator(); }
+
+private:
+    MappedFile file; /**< The mapped segment file. */
+    std::span<const uint8_t> bytes; /**< The records inside the mapping. */
+};
+
+/**
+ * @brief Maps all segments of a log directory in order, for replay and analytics.
+ *
+ * @code
+ * GameLogReader reader("games");
+ * for (const auto& segment : reader.segments())
+ *     for (const GameRecordView& record : segment)
+ *         for (const Move& move : record) { ... }
+ * @endcode
+ */
+class GameLogReader {
+public:
+    /**
+     * @brief Maps the segments of a log directory.
+     * @param directory The log directory.
+     */
+    explicit GameLogReader(const std::filesystem::path& directory);
+
+    /**
+     * @brief Gets the mapped segments, oldest first.
+     * @return The segments.
+     */
+    const std::vector<GameLogSegment>& segments() const { return mapped_segments; }
+
+private:
+    std::vector<GameLogSegment> mapped_segments; /**< The mapped segments, oldest first. */
+};
+
+/**
+ * @brief Lists the segment files of a log directory.
+ * @param directory The log directory.
+ * @return The segment files, oldest first.
+ */
+std::vector<std::filesystem::path> list_segments(const std::filesystem::path& directory);
@@ -0,0 +1,175 @@
+/**
+ * @file game_record.h
+ * @brief Contains the compact binary game record format.
+ *
+ * A record is a fixed RecordHeader followed by the moves, one byte per move:
+ * bit 7 is the capture flag, bits 5-6 the direction and bits 0-4 the starting spot.
+ * Promotions are prefixed with PROMOTION_PREFIX, so a move takes 1 or 2 bytes.
+ * The prefix is the normal south-east move of spot 31, which would leave the board.
+ */
+#pragma once
+
+#include "board.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <vector>
+
+static_assert(std::endian::native == std::endian::little, "Game records are stored in little-endian byte order.");
+
+/**
+ * @brief Magic number at the start of every record.
+ */
+constexpr uint16_t RECORD_MAGIC = 0x4752;
+
+/**
+ * @brief The version of the record format.
+ */
+constexpr uint8_t RECORD_VERSION = 1;
+
+/**
+ * @brief Byte marking the next move as a promotion.
+ */
+constexpr uint8_t PROMOTION_PREFIX = 0x7f;
+
+/**
+ * @brief Enumerates the outcomes stored in a game record.
+ */
+enum GameResult : uint8_t {
+    IN_PROGRESS,    /**< The game was still running when the record was written. */
+    WHITE_WON,      /**< White won the game. */
+    BLACK_WON,      /**< Black won the game. */
+    DRAWN,          /**< The game ended in a draw. */
+    ABORTED         /**< The game ended without a result. */
+};
+
+/**
+ * @brief Header of a game record, stored as is.
+ */
+struct RecordHeader {
+    uint16_t magic = RECORD_MAGIC;      /**< RECORD_MAGIC, used to detect torn writes. */
+    uint8_t version = RECORD_VERSION;   /**< The record format version. */
+    GameResult result = IN_PROGRESS;    /**< The outcome of the game. */
+    uint32_t game_id = 0;               /**< The ID of the game, e.g. its lobby ID. */
+    uint64_t started_at_ms = 0;         /**< The start of the game in milliseconds since the Unix epoch. */
+    uint32_t duration_ms = 0;           /**< The time from the start to the last move. */
+    uint16_t move_bytes = 0;            /**< The number of encoded move bytes following the header. */
+    uint16_t ply_count = 0;             /**< The number of moves. */
+};
+static_assert(sizeof(RecordHeader) == 24, "RecordHeader is part of the on-disk format.");
+
+/**
+ * @brief Encodes a move.
+ * @param move The move, a single step or a single jump.
+ * @param out The buffer to append the 1 or 2 encoded bytes to.
+ * @return True if the move was encoded, false if it isn't a step or a jump.
+ */
+bool encode_move(const Move& move, std::vector<uint8_t>& out);
+
+/**
+ * @brief Decodes the move at the start of a buffer.
+ * @param bytes The encoded moves.
+ * @param move The decoded move.
+ * @return The number of bytes consumed, 0 if the bytes are not a valid move.
+ */
+size_t decode_move(std::span<const uint8_t> bytes, Move& move);
+
+/**
+ * @brief Appends a complete record to a buffer.
+ * @param header The header, move_bytes and ply_count are filled in.
+ * @param moves The moves of the game.
+ * @param out The buffer to append the record to.
+ * @return True if the record was encoded, false if a move can't be encoded or the game is too long.
+ */
+bool encode_record(RecordHeader header, std::span<const Move> moves, std::vector<uint8_t>& out);
+
+/**
+ * @brief A record inside a mapped log segment, read in place.
+ */
+class GameRecordView {
+public:
+    /**
+     * @brief Forward iterator decoding the moves of a record.
+     */
+    class MoveIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Move;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Move*;
+        using reference = const Move&;
+
+        MoveIterator() = default;
+
+        /**
+         * @brief Constructs an iterator at the start of the encoded moves.
+         * @param bytes The remaining encoded moves.
+         */
+        explicit MoveIterator(std::span<const uint8_t> bytes) : rest(bytes) { advance(); }
+
+        reference operator*() const { return move; }
+        pointer operator->() const { return &move; }
+        MoveIterator& operator++() { advance(); return *this; }
+        MoveIterator operator++(int) { MoveIterator old = *this; advance(); return old; }
+        bool operator==(const MoveIterator& other) const { return at_end == other.at_end && rest.data() == other.rest.data(); }
+
+    private:
+        void advance() {
+            const size_t used = rest.empty() ? 0 : decode_move(rest, move);
+            if (used == 0) {
+                at_end = true;
+                rest = {};
+                return;
+            }
+            rest = rest.subspan(used);
+        }
+
+        std::span<const uint8_t> rest; /**< The moves after the current one. */
+        Move move{}; /**< The current move. */
+        bool at_end = false; /**< Set past the last move. */
+    };
+
+    /**
+     * @brief Parses the record at the start of a buffer.
+     * @param bytes The buffer.
+     * @return The record, or nothing if the buffer doesn't start with a complete record.
+     */
+    static std::optional<GameRecordView> parse(std::span<const uint8_t> bytes) {
+        if (bytes.size() < sizeof(RecordHeader)) return std::nullopt;
+        GameRecordView view;
+        std::memcpy(&view.record_header, bytes.data(), sizeof(RecordHeader));
+        if (view.record_header.magic != RECORD_MAGIC || view.record_header.version != RECORD_VERSION) return std::nullopt;
+        if (bytes.size() < sizeof(RecordHeader) + view.record_header.move_bytes) return std::nullopt;
+        view.move_data = bytes.subspan(sizeof(RecordHeader), view.record_header.move_bytes);
+        return view;
+    }
+
+    /**
+     * @brief Gets the header of the record.
+     * @return The header.
+     */
+    const RecordHeader& header() const { return record_header; }
+
+    /**
+     * @brief Gets the size of the record including its header.
+     * @return The size in bytes.
+     */
+    size_t size() const { return sizeof(RecordHeader) + move_data.size(); }
+
+    /**
+     * @brief Gets the encoded moves.
+     * @return The encoded moves.
+     */
+    std::span<const uint8_t> encoded_moves() const { return move_data; }
+
+    MoveIterator begin() const { return MoveIterator(move_data); }
+    MoveIterator end() const { return MoveIterator(move_data.subspan(move_data.size())); }
+
+private:
+    RecordHeader record_header{}; /**< Copy of the header, the mapping may be unaligned. */
+    std::span<const uint8_t> move_data; /**< The encoded moves inside the mapping. */
+};
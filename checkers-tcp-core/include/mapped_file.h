@@ -0,0 +1,60 @@
+/**
+ * @file mapped_file.h
+ * @brief Contains a read-only memory mapping of a whole file.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+/**
+ * @brief A read-only memory mapping of a whole file, unmapped on destruction.
+ *
+ * The mapping is private and read-only, so a file growing or shrinking underneath stays
+ * readable up to the size it had when it was mapped.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Constructs an empty mapping.
+     */
+    MappedFile() = default;
+
+    /**
+     * @brief Maps a file.
+     * @param path The file.
+     * @param sequential Whether the file is read front to back, which makes the kernel read ahead aggressively.
+     */
+    explicit MappedFile(const std::filesystem::path& path, bool sequential = true);
+
+    /**
+     * @brief Unmaps the file.
+     */
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Gets the mapped bytes.
+     * @return The contents of the file.
+     */
+    std::span<const uint8_t> bytes() const { return {static_cast<const uint8_t*>(mapping), mapping_size}; }
+
+    /**
+     * @brief Gets the mapped bytes as text.
+     * @return The contents of the file.
+     */
+    std::string_view text() const { return {static_cast<const char*>(mapping), mapping_size}; }
+
+private:
+    void unmap();
+
+    void* mapping = nullptr; /**< The mapped file, null if empty. */
+    size_t mapping_size = 0; /**< The size of the mapping. */
+};
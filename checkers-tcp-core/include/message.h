@@ -2,11 +2,12 @@
 
 #include <cstdint>
 #include <ostream>
+#include <string>
 
 /**
  * @brief The maximum length of a message.
  */
-constexpr size_t MAX_MESSAGE_LEN = 10;
+constexpr size_t MAX_MESSAGE_LEN = 16;
 
 /**
  * @brief Enumerates the types of messages.
@@ -18,7 +19,23 @@ enum MessageType: uint8_t {
     MOVE,               /**< Move message type. */
     RESIGN,             /**< Resign message type. */
     ERROR,              /**< Error message type. */
-    GAME_STARTED        /**< Game started message type. */
+    GAME_STARTED,       /**< Game started message type. */
+    CLOCK,              /**< Remaining clock time message type. */
+    OPPONENT_STATUS,    /**< Opponent connection status message type. */
+    POSITION,           /**< Board position snapshot message type: turn u8, white, black and kings u32 bitboards. */
+    GAME_OVER,          /**< Game decided on the board message type: winner Color u8 (BOTH for a draw), GameOverReason u8. */
+    HELLO,              /**< Protocol negotiation before the handshake: version u8, Capability flags u32, see frame.h. */
+    MOVE_BATCH,         /**< Several moves in one v2 frame, 3 bytes each as in MOVE. Sent with CAPABILITY_MOVE_BATCH only. */
+    PING,               /**< Heartbeat: timestamp u64 of the sender, answered with PONG. Sent with CAPABILITY_PING only. */
+    PONG                /**< Heartbeat answer: the timestamp u64 of the PING, echoed unchanged. */
+};
+
+/**
+ * @brief Enumerates the optional protocol features negotiated with HELLO.
+ */
+enum Capability: uint32_t {
+    CAPABILITY_MOVE_BATCH = 1 << 0,  /**< The game replay after a resume arrives as MOVE_BATCH frames. */
+    CAPABILITY_PING = 1 << 1         /**< The client answers PING with PONG, so the server measures its round trip. */
 };
 
 /**
@@ -29,7 +46,22 @@ enum ErrorType: uint8_t {
     OPPONENT_DISCONNECTED,  /**< Opponent disconnected error type. */
     SERVER_DISCONNECTED,    /**< Server disconnected error type. */
     SERVER_ERROR,           /**< Server error type. */
-    INVALID_MOVE            /**< Invalid move error type. */
+    INVALID_MOVE,           /**< Invalid move error type. */
+    LOBBY_EXPIRED,          /**< Nobody joined the lobby in time error type. */
+    SESSION_TIMEOUT,        /**< Game session was idle for too long error type. */
+    TIME_EXPIRED,           /**< Player to move ran out of time error type. */
+    SESSION_NOT_FOUND,      /**< No game session for the resume token error type. */
+    SERVER_DRAINING         /**< Server is shutting down and starts no new games error type. */
+};
+
+/**
+ * @brief Enumerates why the game ended in a GAME_OVER message.
+ */
+enum GameOverReason: uint8_t {
+    DRAW_BY_REPETITION,     /**< The same position occurred three times with the same side to move. */
+    DRAW_BY_MOVE_LIMIT,     /**< Forty moves of each side without a capture or a man move. */
+    ALL_PIECES_CAPTURED,    /**< The loser has no pieces left. */
+    NO_LEGAL_MOVES          /**< The loser is to move but all its pieces are blocked. */
 };
 
 /**
@@ -37,7 +69,8 @@ enum ErrorType: uint8_t {
  */
 enum GameFlags: uint8_t {
     NONE = 0,          /**< None game flag. */
-    IM_WHITE = 1 << 0   /**< I am white game flag. */
+    IM_WHITE = 1 << 0,  /**< I am white game flag. */
+    SPECTATOR = 1 << 1  /**< I am watching the game flag. */
 };
 
 /**
@@ -54,7 +87,19 @@ struct MessageStorage {
  */
 enum HandshakeType: uint8_t {
     CREATE_SESSION,     /**< Create session handshake type. */
-    CONNECT_TO_SESSION  /**< Connect to session handshake type. */
+    CONNECT_TO_SESSION, /**< Connect to session handshake type. */
+    PLAY_AGAINST_BOT,   /**< Play against the server-side bot handshake type. */
+    RESUME_SESSION,     /**< Reconnect to a running game session handshake type. */
+    FIND_GAME,          /**< Quick-play against an anonymous opponent handshake type, payload[1..2] is the rating. */
+    SPECTATE            /**< Watch the running game of a lobby handshake type. */
+};
+
+/**
+ * @brief Enumerates the opponent connection states of an OPPONENT_STATUS message.
+ */
+enum OpponentStatus: uint8_t {
+    OPPONENT_AWAY,      /**< Opponent lost connection, the game waits for the grace period in payload[1] seconds. */
+    OPPONENT_BACK       /**< Opponent reconnected. */
 };
 
 /**
@@ -71,12 +116,30 @@ struct MoveMessage {
     uint32_t from_to;   /**< The move from-to value. */
 };
 
+/**
+ * @brief Structure for the time control requested with CREATE_SESSION. Zero base means untimed.
+ */
+struct TimeControl {
+    uint16_t base_seconds = 0;        /**< The initial time of each player in seconds. */
+    uint16_t increment_seconds = 0;   /**< The time added after each move in seconds. */
+
+    /**
+     * @brief Checks if the game is timed.
+     * @return True if the game is timed, false otherwise.
+     */
+    [[nodiscard]] bool is_timed() const { return base_seconds != 0; }
+};
+
 /**
  * @brief Structure for the result of a handshake.
  */
 struct HandshakeResult {
     HandshakeType handshake_type = HandshakeType::CREATE_SESSION;   /**< The type of the handshake. */
     uint32_t lobby_id = 0;   /**< The ID of the lobby. */
+    TimeControl time_control{};   /**< The time control of the created lobby. */
+    uint8_t bot_level = 0;   /**< The requested bot level, 0 is the weakest. */
+    uint64_t resume_token = 0;   /**< The resume token of RESUME_SESSION. */
+    uint16_t rating = 0;   /**< The rating of the player looking for a game, 0 if not sent. */
 };
 
 /**
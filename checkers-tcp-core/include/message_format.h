@@ -0,0 +1,190 @@
+/**
+ * @file message_format.h
+ * @brief fmt formatter for MessageStorage, writing straight into the output buffer.
+ */
+
+#pragma once
+
+#include "message.h"
+#include "board.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <string_view>
+
+/**
+ * @brief Unpacks a 32-bit unsigned integer stored in network byte order (same layout as packi32()).
+ * @param buf The buffer holding the packed integer.
+ * @return The unpacked integer.
+ */
+constexpr uint32_t message_payload_u32(const unsigned char *buf) {
+  return (uint32_t(buf[0]) << 24) | (uint32_t(buf[1]) << 16) | (uint32_t(buf[2]) << 8) | uint32_t(buf[3]);
+}
+
+/**
+ * @brief Unpacks a 16-bit unsigned integer stored in network byte order (same layout as packi16()).
+ * @param buf The buffer holding the packed integer.
+ * @return The unpacked integer.
+ */
+constexpr uint16_t message_payload_u16(const unsigned char *buf) {
+  return uint16_t((buf[0] << 8) | buf[1]);
+}
+
+/**
+ * @brief Returns the name of an error type.
+ * @param error The error type.
+ * @return The name of the error type, or an empty view for unknown values.
+ */
+constexpr std::string_view error_type_name(ErrorType error) {
+  switch(error) {
+    case ErrorType::LOBBY_NOT_EXISTS: return "LOBBY_NOT_EXISTS";
+    case ErrorType::OPPONENT_DISCONNECTED: return "OPPONENT_DISCONNECTED";
+    case ErrorType::SERVER_DISCONNECTED: return "SERVER_DISCONNECTED";
+    case ErrorType::SERVER_ERROR: return "SERVER_ERROR";
+    case ErrorType::INVALID_MOVE: return "INVALID_MOVE";
+    case ErrorType::LOBBY_EXPIRED: return "LOBBY_EXPIRED";
+    case ErrorType::SESSION_TIMEOUT: return "SESSION_TIMEOUT";
+    case ErrorType::TIME_EXPIRED: return "TIME_EXPIRED";
+    case ErrorType::SESSION_NOT_FOUND: return "SESSION_NOT_FOUND";
+    case ErrorType::SERVER_DRAINING: return "SERVER_DRAINING";
+  }
+  return {};
+}
+
+/**
+ * @brief Returns the name of a game over reason.
+ * @param reason The game over reason.
+ * @return The name of the reason, or an empty view for unknown values.
+ */
+constexpr std::string_view game_over_reason_name(GameOverReason reason) {
+  switch(reason) {
+    case GameOverReason::DRAW_BY_REPETITION: return "DRAW_BY_REPETITION";
+    case GameOverReason::DRAW_BY_MOVE_LIMIT: return "DRAW_BY_MOVE_LIMIT";
+    case GameOverReason::ALL_PIECES_CAPTURED: return "ALL_PIECES_CAPTURED";
+    case GameOverReason::NO_LEGAL_MOVES: return "NO_LEGAL_MOVES";
+  }
+  return {};
+}
+
+/**
+ * @brief Returns the name of a move type.
+ * @param move_type The move type.
+ * @return The name of the move type, or an empty view for unknown values.
+ */
+constexpr std::string_view move_type_name(MoveType move_type) {
+  switch(move_type) {
+    case NORMAL: return "NORMAL";
+    case CAPTURE: return "CAPTURE";
+    case PROMOTION: return "PROMOTION";
+    case CAPTURE_PROMOTION: return "CAPTURE_PROMOTION";
+    default: return {};
+  }
+}
+
+/**
+ * @brief Formats MessageStorage objects, e.g. `spdlog::info("Sent message: {}", message)`.
+ *
+ * Produces the same text as message_to_string() without building intermediate strings.
+ */
+template <>
+struct fmt::formatter<MessageStorage> {
+  constexpr auto parse(format_parse_context& ctx) { return ctx.begin(); }
+
+  template <typename FormatContext>
+  auto format(const MessageStorage& message, FormatContext& ctx) {
+    auto out = ctx.out();
+    switch(message.message_type) {
+      case MessageType::HANDSHAKE:
+        out = fmt::format_to(out, "HANDSHAKE ({} bytes) [", message.len);
+        switch(HandshakeType(message.payload[0])) {
+          case HandshakeType::CREATE_SESSION:
+            out = fmt::format_to(out, "CREATE_SESSION");
+            if(message.len >= 5) {
+              out = fmt::format_to(out, ", base: {}s, increment: {}s",
+                                   (message.payload[1] << 8) | message.payload[2], (message.payload[3] << 8) | message.payload[4]);
+            }
+            break;
+          case HandshakeType::CONNECT_TO_SESSION:
+            out = fmt::format_to(out, "CONNECT_TO_SESSION, lobby_id: {}", message_payload_u32(&message.payload[1]));
+            break;
+          case HandshakeType::RESUME_SESSION:
+            // The resume token is a credential and is never logged.
+            out = fmt::format_to(out, "RESUME_SESSION");
+            break;
+          case HandshakeType::FIND_GAME:
+            out = fmt::format_to(out, "FIND_GAME, rating: {}", message.len >= 3 ? message_payload_u16(&message.payload[1]) : 0);
+            break;
+          case HandshakeType::SPECTATE:
+            out = fmt::format_to(out, "SPECTATE, lobby_id: {}", message_payload_u32(&message.payload[1]));
+            break;
+          case HandshakeType::PLAY_AGAINST_BOT:
+            out = fmt::format_to(out, "PLAY_AGAINST_BOT, level: {}", message.len >= 2 ? message.payload[1] : 0);
+            break;
+          default:
+            break;
+        }
+        break;
+      case MessageType::LOBBY_CREATED:
+        out = fmt::format_to(out, "LOBBY_CREATED ({} bytes) [lobby_id: {}", message.len, message_payload_u32(message.payload));
+        break;
+      case MessageType::GAME_STARTED:
+        out = fmt::format_to(out, "GAME_STARTED ({} bytes) [{}", message.len,
+                             GameFlags(message.payload[0]) & GameFlags::SPECTATOR ? "SPECTATOR"
+                             : GameFlags(message.payload[0]) & GameFlags::IM_WHITE ? "IM_WHITE" : "");
+        break;
+      case MessageType::POSITION:
+        out = fmt::format_to(out, "POSITION ({} bytes) [turn: {}, white: {:#010x}, black: {:#010x}, kings: {:#010x}",
+                             message.len, Color(message.payload[0]) == WHITE ? "WHITE" : "BLACK",
+                             message_payload_u32(&message.payload[1]), message_payload_u32(&message.payload[5]),
+                             message_payload_u32(&message.payload[9]));
+        break;
+      case MessageType::MOVE:
+        out = fmt::format_to(out, "MOVE ({} bytes) [from: {}, to: {}, move_type: {}", message.len,
+                             message.payload[0], message.payload[1], move_type_name(MoveType(message.payload[2])));
+        break;
+      case MessageType::DISCONNECT:
+        out = fmt::format_to(out, "DISCONNECT ({} bytes) [", message.len);
+        break;
+      case MessageType::RESIGN:
+        out = fmt::format_to(out, "RESIGN ({} bytes) [", message.len);
+        break;
+      case MessageType::OPPONENT_STATUS:
+        out = fmt::format_to(out, "OPPONENT_STATUS ({} bytes) [{}", message.len,
+                             OpponentStatus(message.payload[0]) == OPPONENT_AWAY ? "AWAY" : "BACK");
+        if(OpponentStatus(message.payload[0]) == OPPONENT_AWAY) {
+          out = fmt::format_to(out, ", grace: {}s", message.payload[1]);
+        }
+        break;
+      case MessageType::CLOCK:
+        out = fmt::format_to(out, "CLOCK ({} bytes) [white_ms: {}, black_ms: {}", message.len,
+                             message_payload_u32(message.payload), message_payload_u32(&message.payload[4]));
+        break;
+      case MessageType::GAME_OVER:
+        out = fmt::format_to(out, "GAME_OVER ({} bytes) [winner: {}, reason: {}", message.len,
+                             Color(message.payload[0]) == WHITE ? "WHITE" : Color(message.payload[0]) == BLACK ? "BLACK" : "NONE",
+                             game_over_reason_name(GameOverReason(message.payload[1])));
+        break;
+      case MessageType::ERROR:
+        out = fmt::format_to(out, "ERROR ({} bytes) [{}", message.len, error_type_name(ErrorType(message.payload[0])));
+        break;
+      case MessageType::HELLO:
+        out = fmt::format_to(out, "HELLO ({} bytes) [version: {}, capabilities: {:#x}", message.len, message.payload[0],
+                             message.len >= 5 ? message_payload_u32(&message.payload[1]) : 0);
+        break;
+      case MessageType::MOVE_BATCH:
+        out = fmt::format_to(out, "MOVE_BATCH ({} bytes) [moves: {}", message.len, message.len / 3);
+        break;
+      case MessageType::PING:
+        out = fmt::format_to(out, "PING ({} bytes) [", message.len);
+        break;
+      case MessageType::PONG:
+        out = fmt::format_to(out, "PONG ({} bytes) [", message.len);
+        break;
+      default:
+        // should never reach here
+        break;
+    }
+    *out++ = ']';
+    return out;
+  }
+};
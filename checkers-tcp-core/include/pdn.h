@@ -0,0 +1,120 @@
+/**
+ * @file pdn.h
+ * @brief Contains Portable Draughts Notation (PDN) import and export for English checkers.
+ *
+ * PDN numbers the dark squares 1 to 32 from the side moving first, which PDN calls Black and
+ * this engine calls WHITE. Square n is spot 32 - n, so the opening 11-15 is the move 21 -> 17.
+ * Results follow the same order: "1-0" is a win of the side moving first, i.e. WHITE_WON.
+ */
+#pragma once
+
+#include "checkers_engine.h"
+#include "game_record.h"
+#include "position.h"
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief A tag pair such as [Event "Casual game"].
+ */
+struct PdnTag {
+    std::string_view name;  /**< The tag name. */
+    std::string_view value; /**< The tag value without the quotes, escapes are kept as written when reading. */
+};
+
+/**
+ * @brief A game read from PDN text. All views point into the text, which must outlive the game.
+ */
+struct PdnGame {
+    std::vector<PdnTag> tags;             /**< The tag pairs. */
+    std::vector<std::string_view> moves;  /**< The moves as written, e.g. "11-15" or "15x24x31", without annotations. */
+    GameResult result = IN_PROGRESS;      /**< The result token ending the movetext, IN_PROGRESS for "*" or none. */
+    size_t line = 0;                      /**< The line the game starts at, counting from 1. */
+    const char* error = nullptr;          /**< Why the game couldn't be read, nullptr if it was read completely. */
+
+    /**
+     * @brief Gets the value of a tag.
+     * @param name The tag name.
+     * @return The value, empty if the game has no such tag.
+     */
+    std::string_view tag(std::string_view name) const;
+};
+
+/**
+ * @brief Streaming tokenizer splitting PDN text into games without copying it.
+ *
+ * Comments, variations, move numbers and NAGs are skipped. A malformed game sets PdnGame::error
+ * and the reader continues with the next line starting with a tag. Reusing one PdnGame for all
+ * games keeps the reader free of allocations once the vectors have grown.
+ *
+ * @code
+ * MappedFile file("games.pdn");
+ * PdnReader reader(file.text());
+ * PdnGame game;
+ * MoveList moves;
+ * std::string error;
+ * while (reader.next(game))
+ *     if (!game.error && resolve_pdn_moves(game, moves, error)) { ... }
+ * @endcode
+ */
+class PdnReader {
+public:
+    /**
+     * @brief Constructs a reader over PDN text.
+     * @param text The text, it must outlive the reader and the games read.
+     */
+    explicit PdnReader(std::string_view text) : text(text) {}
+
+    /**
+     * @brief Reads the next game.
+     * @param game The game to fill, its previous contents are discarded.
+     * @return True if a game was read, false at the end of the text.
+     */
+    bool next(PdnGame& game);
+
+    /**
+     * @brief Gets the number of bytes consumed so far.
+     * @return The offset of the next game in the text.
+     */
+    size_t offset() const { return pos; }
+
+private:
+    bool at_end() const { return pos >= text.size(); }
+    char peek() const { return text[pos]; }
+    bool at_line_start() const { return pos == 0 || text[pos - 1] == '\n'; }
+    void skip_space();
+    bool skip_comment();
+    bool skip_variation();
+    bool read_tag(PdnTag& tag);
+    bool read_token(PdnGame& game, bool& finished);
+    void resync();
+
+    std::string_view text; /**< The PDN text. */
+    size_t pos = 0; /**< The current position in the text. */
+    size_t line = 1; /**< The line of the current position. */
+};
+
+/**
+ * @brief Replays the moves of a game and converts them to engine moves.
+ *
+ * Multi-jumps become one move per jump. Shortened jumps such as "15x31" for 15x24x31 are
+ * resolved against the position. A [FEN] tag sets up the starting position.
+ *
+ * @param game The game.
+ * @param moves The engine moves, its previous contents are discarded.
+ * @param error Why the game couldn't be replayed.
+ * @return True if the server would accept all moves, false otherwise.
+ */
+bool resolve_pdn_moves(const PdnGame& game, MoveList& moves, std::string& error);
+
+/**
+ * @brief Appends a game played from the initial position as PDN.
+ * @param out The text to append to.
+ * @param tags The tag pairs, a Result tag is added unless given.
+ * @param moves The engine moves, one per jump.
+ * @param result The result of the game.
+ */
+void write_pdn(std::string& out, std::span<const PdnTag> tags, std::span<const Move> moves, GameResult result);
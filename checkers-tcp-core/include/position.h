@@ -0,0 +1,105 @@
+/**
+ * @file position.h
+ * @brief Contains the packed position type and its FEN text form.
+ */
+#pragma once
+
+#include "board.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Converts a PDN square number to a spot.
+ * @param square The square number, 1 to 32.
+ * @return The spot.
+ */
+constexpr SpotIndex pdn_square_to_spot(int square) { return SpotIndex(SPOTS_NUMBER - square); }
+
+/**
+ * @brief Converts a spot to a PDN square number.
+ * @param spot The spot.
+ * @return The square number, 1 to 32.
+ */
+constexpr int spot_to_pdn_square(SpotIndex spot) { return int(SPOTS_NUMBER - spot); }
+
+/**
+ * @brief A position packed into the three bitboards, 12 bytes.
+ *
+ * The kings bitboard only matters on occupied squares, so the side to move is stored in it on
+ * the empty squares: the kings word has empty-square bits set exactly when black is to move.
+ * Every reachable position has an empty square, a position without one can't have black to move.
+ *
+ * The text form is the FEN of the PDN standard, e.g. "B:W21-32:B1-12" for the initial position.
+ * PDN numbers the squares from the side moving first and calls it Black (see pdn.h), so the
+ * engine's WHITE is "B" in the text and square n is spot 32 - n.
+ */
+class Position {
+public:
+    /**
+     * @brief Constructs an empty board with white to move.
+     */
+    constexpr Position() = default;
+
+    /**
+     * @brief Constructs a position.
+     * @param white The bitboard of the white pieces.
+     * @param black The bitboard of the black pieces.
+     * @param kings The bitboard of the kings of both colors.
+     * @param side_to_move The color to move.
+     */
+    constexpr Position(Bitboard white, Bitboard black, Bitboard kings, Color side_to_move)
+        : white_bits(white), black_bits(black), kings_bits(kings & (white | black))
+    {
+        const Bitboard empty = ~(white | black);
+        if (side_to_move == BLACK) kings_bits |= empty;
+    }
+
+    /**
+     * @brief Gets the initial position.
+     * @return The initial position, white to move.
+     */
+    static constexpr Position initial() { return Position(WHITE_PIECES_SQUARES, BLACK_PIECES_SQUARES, 0, WHITE); }
+
+    /**
+     * @brief Parses a position from FEN text.
+     * @param fen The text, e.g. "W:W21,K30:B1-3,12".
+     * @return The position, or nothing if the text is malformed or a square is taken twice.
+     */
+    static std::optional<Position> from_fen(std::string_view fen);
+
+    /**
+     * @brief Formats the position as FEN text.
+     * @return The text, squares ascending with kings prefixed by K.
+     */
+    std::string to_fen() const;
+
+    /**
+     * @brief Gets the bitboard of the pieces of a color.
+     * @param color The color.
+     * @return The bitboard of the pieces.
+     */
+    constexpr Bitboard pieces(Color color) const { return color == WHITE ? white_bits : black_bits; }
+
+    /**
+     * @brief Gets the bitboard of the kings of both colors.
+     * @return The bitboard of the kings.
+     */
+    constexpr Bitboard kings() const { return kings_bits & (white_bits | black_bits); }
+
+    /**
+     * @brief Gets the color to move.
+     * @return The color to move.
+     */
+    constexpr Color side_to_move() const { return kings_bits & ~(white_bits | black_bits) ? BLACK : WHITE; }
+
+    constexpr bool operator==(const Position&) const = default;
+
+private:
+    Bitboard white_bits = 0; /**< The white pieces. */
+    Bitboard black_bits = 0; /**< The black pieces. */
+    Bitboard kings_bits = 0; /**< The kings, and the side to move on the empty squares. */
+};
+
+static_assert(sizeof(Position) == 12, "Position is meant to be packed into three bitboards.");
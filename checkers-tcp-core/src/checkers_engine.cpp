@@ -4,6 +4,63 @@
  */
 
 #include "checkers_engine.h"
+#include "evaluation.h"
+
+#include <array>
+
+namespace {
+
+/**
+ * @brief Generates the Zobrist keys with splitmix64, one per piece kind and bitboard bit.
+ */
+constexpr auto generate_zobrist_keys()
+{
+    std::array<std::array<uint64_t, SPOTS_NUMBER>, PIECE_KINDS> keys{};
+    uint64_t state = 0x636865636b657273u;
+    for (auto& piece_keys : keys) {
+        for (auto& key : piece_keys) {
+            uint64_t z = (state += 0x9e3779b97f4a7c15u);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+            key = z ^ (z >> 31);
+        }
+    }
+    return keys;
+}
+
+/**
+ * @brief Zobrist keys indexed by piece kind and bitboard bit index.
+ */
+constexpr auto zobrist_keys = generate_zobrist_keys();
+
+/**
+ * @brief Zobrist key of black to move.
+ */
+constexpr uint64_t ZOBRIST_BLACK_TO_MOVE = 0x5bd1e9955bd1e995u;
+
+/**
+ * @brief Updates the hash and the piece-square score for the squares of a piece kind that changed.
+ * @param hash The hash.
+ * @param score The piece-square score.
+ * @param piece The piece kind.
+ * @param before The squares of the piece kind before the change.
+ * @param after The squares of the piece kind after the change.
+ */
+constexpr void update_pieces(uint64_t& hash, int16_t& score, PieceKind piece, Bitboard before, Bitboard after)
+{
+    for (Bitboard removed = before & ~after; removed; removed &= removed - 1) {
+        const int bit_index = std::countr_zero(removed);
+        hash ^= zobrist_keys[piece][bit_index];
+        score = int16_t(score - PIECE_SQUARE_VALUES[piece][bit_index]);
+    }
+    for (Bitboard added = after & ~before; added; added &= added - 1) {
+        const int bit_index = std::countr_zero(added);
+        hash ^= zobrist_keys[piece][bit_index];
+        score = int16_t(score + PIECE_SQUARE_VALUES[piece][bit_index]);
+    }
+}
+
+}
 
 /**
  * @brief Default constructor for the Checkers Engine class.
@@ -13,6 +70,15 @@ checkers_engine::checkers_engine()
 
 }
 
+/**
+ * @brief Constructor setting up a position.
+ * @param position The position.
+ */
+checkers_engine::checkers_engine(const Position& position)
+{
+    set_position(position);
+}
+
 /**
  * @brief Reset the game state to the initial state.
  */
@@ -22,6 +88,34 @@ void checkers_engine::reset()
     pieces[BLACK] = BLACK_PIECES_SQUARES;
     kings = 0;
     turn = WHITE;
+    compute_incremental_terms();
+    quiet_plies = 0;
+}
+
+/**
+ * @brief Set up an arbitrary position.
+ * @param white The bitboard of the white pieces.
+ * @param black The bitboard of the black pieces.
+ * @param kings_bits The bitboard of the kings of both colors.
+ * @param side_to_move The color to move.
+ */
+void checkers_engine::set_position(Bitboard white, Bitboard black, Bitboard kings_bits, Color side_to_move)
+{
+    pieces[WHITE] = white;
+    pieces[BLACK] = black;
+    kings = kings_bits & (white | black);
+    turn = side_to_move;
+    compute_incremental_terms();
+    quiet_plies = 0;
+}
+
+/**
+ * @brief Set up a packed position.
+ * @param position The position.
+ */
+void checkers_engine::set_position(const Position& position)
+{
+    set_position(position.pieces(WHITE), position.pieces(BLACK), position.kings(), position.side_to_move());
 }
 
 /**
@@ -32,6 +126,14 @@ void checkers_engine::make_move(const Move &move)
 {
     const auto from_bitboard = spot_index_to_bit[move.from];
     const auto to_bitboard = spot_index_to_bit[move.to];
+    const Bitboard old_white = pieces[WHITE];
+    const Bitboard old_black = pieces[BLACK];
+    const Bitboard old_kings = kings;
+
+    if (move.type & CAPTURE || !(kings & from_bitboard))
+        quiet_plies = 0;
+    else
+        ++quiet_plies;
 
     // Add "to" bit
     pieces[turn] |= to_bitboard;
@@ -42,30 +144,38 @@ void checkers_engine::make_move(const Move &move)
     pieces[turn] &= ~from_bitboard;
     kings &= ~from_bitboard;
 
-    if (move.type & CAPTURE) {
-        switch (int(spot_index_to_bit_index[move.to]) - int(spot_index_to_bit_index[move.from])) {
-            case NORTH_EAST * 2:
-                pieces[~turn]   &= ~(from_bitboard << NORTH_EAST);
-                kings           &= ~(from_bitboard << NORTH_EAST);
-                break;
-            case NORTH_WEST * 2:
-                pieces[~turn]   &= ~(from_bitboard << NORTH_WEST);
-                kings           &= ~(from_bitboard << NORTH_WEST);
-                break;
-            case SOUTH_EAST * 2:
-                pieces[~turn]   &= ~(to_bitboard << NORTH_WEST);
-                kings           &= ~(to_bitboard << NORTH_WEST);
-                break;
-            case SOUTH_WEST * 2:
-                pieces[~turn]   &= ~(to_bitboard << NORTH_EAST);
-                kings           &= ~(to_bitboard << NORTH_EAST);
-                break;
-        }
-        // If another move available with same piece
-        if (man_capture_moves(to_bitboard) || king_capture_moves(from_bitboard))
-            return;
+    // The jump may cross the wrap of the rotated bitboard, so the captured spot comes from the table.
+    if (const SpotIndex captured = get_captured_index(move); captured != SPOTS_NUMBER) {
+        const Bitboard captured_bitboard = spot_index_to_bit[captured];
+        pieces[~turn]   &= ~captured_bitboard;
+        kings           &= ~captured_bitboard;
     }
+
+    // Update the hash and the score of every square whose contents changed.
+    update_pieces(position_hash, square_score, WHITE_MAN, old_white & ~old_kings, pieces[WHITE] & ~kings);
+    update_pieces(position_hash, square_score, WHITE_KING, old_white & old_kings, pieces[WHITE] & kings);
+    update_pieces(position_hash, square_score, BLACK_MAN, old_black & ~old_kings, pieces[BLACK] & ~kings);
+    update_pieces(position_hash, square_score, BLACK_KING, old_black & old_kings, pieces[BLACK] & kings);
+
+    // If another move available with same piece
+    if (move.type & CAPTURE && (man_capture_moves(to_bitboard) || king_capture_moves(from_bitboard)))
+        return;
     turn = ~turn;
+    position_hash ^= ZOBRIST_BLACK_TO_MOVE;
+}
+
+/**
+ * @brief Check if the game is over, without generating the moves.
+ * The move functions work on whole bitboards, so one call per piece kind covers all pieces.
+ * @return WIN if the side to move has no pieces or no moves and lost, GOING otherwise.
+ */
+GameStatus checkers_engine::status() const
+{
+    const auto turn_kings = pieces[turn] & kings;
+    const auto turn_mans = pieces[turn] & ~kings;
+    if (man_moves(turn_mans) || king_moves(turn_kings) || captures())
+        return GOING;
+    return WIN;
 }
 
 /**
@@ -89,11 +199,11 @@ MoveList checkers_engine::valid_moves() const
     }
 
     for (const SpotIndex from : SpotsBitIterator(pieces[turn] & kings))
-        for (const SpotIndex to : SpotsBitIterator(king_moves(spot_index_to_bit[from])))
+        for (const SpotIndex to : SpotsBitIterator(spot_steps(from, true)))
             list.emplace_back(from, to, MoveType::NORMAL);
 
     for (const SpotIndex from : SpotsBitIterator(pieces[turn] & ~kings))
-        for (const SpotIndex to : SpotsBitIterator(man_moves(spot_index_to_bit[from])))
+        for (const SpotIndex to : SpotsBitIterator(spot_steps(from, false)))
             list.emplace_back(from, to, spot_index_to_bit[to] & OPPOSITE_BASE[turn] ? MoveType::PROMOTION : MoveType::NORMAL);
 
     return list;
@@ -121,10 +231,10 @@ MoveList checkers_engine::valid_moves(SpotIndex from_index) const
    if (captures()) return list;
 
    if(king_bit) {
-	 for (const SpotIndex to : SpotsBitIterator(king_moves(king_bit)))
+	 for (const SpotIndex to : SpotsBitIterator(spot_steps(from_index, true)))
 	   list.emplace_back(from_index, to, MoveType::NORMAL);
    } else {
-	 for (const SpotIndex to : SpotsBitIterator(man_moves(piece_bit)))
+	 for (const SpotIndex to : SpotsBitIterator(spot_steps(from_index, false)))
 	   list.emplace_back(from_index, to, spot_index_to_bit[to] & OPPOSITE_BASE[turn] ? MoveType::PROMOTION : MoveType::NORMAL);
    }
 
@@ -164,14 +274,8 @@ Board checkers_engine::board() const
  */
 SpotIndex checkers_engine::get_captured_index(const Move &move) const
 {
-    if (move.type & CAPTURE) {
-        const auto from_bit = spot_index_to_bit[move.from];
-        const auto to_bit = spot_index_to_bit[move.to];
-        if(shift(shift(from_bit, NORTH_WEST), NORTH_WEST) & to_bit) return bit_to_spot_index(shift(from_bit, NORTH_WEST));
-        if(shift(shift(from_bit, NORTH_EAST), NORTH_EAST) & to_bit) return bit_to_spot_index(shift(from_bit, NORTH_EAST));
-        if(shift(shift(from_bit, SOUTH_WEST), SOUTH_WEST) & to_bit) return bit_to_spot_index(shift(from_bit, SOUTH_WEST));
-        if(shift(shift(from_bit, SOUTH_EAST), SOUTH_EAST) & to_bit) return bit_to_spot_index(shift(from_bit, SOUTH_EAST));
-    }
+    if (move.type & CAPTURE && is_valid_index(move.from) && is_valid_index(move.to))
+        return SPOT_TABLES[move.from].jumped_spot_by_landing[move.to];
     return SPOTS_NUMBER;
 }
 
@@ -198,11 +302,25 @@ Board checkers_engine::bitboard_to_board(Bitboard bitboard)
  */
 bool checkers_engine::is_valid(const Move& move) const
 {
+    if (!is_valid_index(move.from) || !is_valid_index(move.to)) return false;
     const auto from_bit = spot_index_to_bit[move.from] & pieces[turn];
     if (!from_bit) return false;
-    return (kings & from_bit ?
-                (king_moves(from_bit) | king_capture_moves(from_bit)) :
-                (man_moves(from_bit) | man_capture_moves(from_bit))) & spot_index_to_bit[move.to];
+    const bool is_king = kings & from_bit;
+    return (spot_steps(move.from, is_king) |
+            (is_king ? king_capture_moves(from_bit) : man_capture_moves(from_bit))) & spot_index_to_bit[move.to];
+}
+
+/**
+ * @brief Compute the Zobrist hash and the piece-square score of the position from scratch.
+ */
+void checkers_engine::compute_incremental_terms()
+{
+    position_hash = turn == BLACK ? ZOBRIST_BLACK_TO_MOVE : 0;
+    square_score = 0;
+    update_pieces(position_hash, square_score, WHITE_MAN, 0, pieces[WHITE] & ~kings);
+    update_pieces(position_hash, square_score, WHITE_KING, 0, pieces[WHITE] & kings);
+    update_pieces(position_hash, square_score, BLACK_MAN, 0, pieces[BLACK] & ~kings);
+    update_pieces(position_hash, square_score, BLACK_KING, 0, pieces[BLACK] & kings);
 }
 
 /**
@@ -219,6 +337,17 @@ Bitboard checkers_engine::captures() const {
     return captures;
 }
 
+/**
+ * @brief Get the non-capturing moves of a single piece from the spot tables.
+ * @param spot The spot of the piece.
+ * @param is_king Whether the piece is a king.
+ * @return The bitboard representation of the possible moves.
+ */
+Bitboard checkers_engine::spot_steps(SpotIndex spot, bool is_king) const {
+    const SpotTable& table = SPOT_TABLES[spot];
+    return (is_king ? table.king_steps : table.man_steps[turn]) & ~all();
+}
+
 /**
  * @brief Get the possible moves for a man piece.
  * @param man_bit The bitboard representation of the man piece.
@@ -0,0 +1,52 @@
+/**
+ * @file evaluation.cpp
+ * @brief Implementation of the static evaluation of positions.
+ */
+
+#include "evaluation.h"
+
+/**
+ * @brief Count the non-capturing moves of a color.
+ * Each direction is one shift of the whole bitboard, so every move is counted once.
+ * @param engine The position.
+ * @param color The color, regardless of the side to move.
+ * @return The number of moves.
+ */
+int count_moves(const checkers_engine& engine, Color color)
+{
+    const Bitboard kings = engine.kings_bitboard();
+    const Bitboard own = engine.pieces_bitboard(color);
+    const Bitboard empty = ~(engine.pieces_bitboard(WHITE) | engine.pieces_bitboard(BLACK));
+    const Bitboard forward = color == WHITE ? own : own & kings;
+    const Bitboard backward = color == BLACK ? own : own & kings;
+    return std::popcount(shift(forward & NE_MOVES_MASK, NORTH_EAST) & empty) +
+           std::popcount(shift(forward & NW_MOVES_MASK, NORTH_WEST) & empty) +
+           std::popcount(shift(backward & SE_MOVES_MASK, SOUTH_EAST) & empty) +
+           std::popcount(shift(backward & SW_MOVES_MASK, SOUTH_WEST) & empty);
+}
+
+/**
+ * @brief Compute every term of the evaluation from scratch, for analysis.
+ * @param engine The position.
+ * @return The terms, their total equals evaluate() from white's point of view.
+ */
+EvalTerms evaluation_terms(const checkers_engine& engine)
+{
+    const Bitboard kings = engine.kings_bitboard();
+    const Bitboard white = engine.pieces_bitboard(WHITE);
+    const Bitboard black = engine.pieces_bitboard(BLACK);
+    const Bitboard white_men = white & ~kings;
+    const Bitboard black_men = black & ~kings;
+
+    EvalTerms terms;
+    terms.material = MAN_VALUE * (std::popcount(white) - std::popcount(black));
+    terms.kings = KING_BONUS * (std::popcount(white & kings) - std::popcount(black & kings));
+    terms.back_rank = BACK_RANK_BONUS * (std::popcount(white_men & WHITE_BASE) - std::popcount(black_men & BLACK_BASE));
+    terms.center = CENTER_BONUS * (std::popcount(white & CENTER_MASK) - std::popcount(black & CENTER_MASK));
+    for (int row = 0; row < int(ROW_MASKS.size()); ++row) {
+        terms.tempo += TEMPO_WEIGHT * (row * std::popcount(white_men & ROW_MASKS[row]) -
+                                       (7 - row) * std::popcount(black_men & ROW_MASKS[row]));
+    }
+    terms.mobility = MOBILITY_WEIGHT * (count_moves(engine, WHITE) - count_moves(engine, BLACK));
+    return terms;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file frame.cpp
+ * @brief Implementation of the message framing.
+ */
+
+#include "frame.h"
+
+/**
+ * @brief Encodes a frame header.
+ * @param message_type The type of the message.
+ * @param payload_len The length of the payload, at most 255 in v1 and MAX_FRAME_PAYLOAD in v2.
+ * @param version The protocol version of the connection.
+ * @param out The buffer of at least MAX_FRAME_HEADER bytes to write the header to.
+ * @return The length of the header.
+ */
+size_t encode_frame_header(MessageType message_type, size_t payload_len, uint8_t version, uint8_t* out)
+{
+    size_t used = 0;
+    out[used++] = message_type;
+    if (version < PROTOCOL_V2) {
+        out[used++] = uint8_t(payload_len);
+        return used;
+    }
+    while (payload_len >= 0x80) {
+        out[used++] = uint8_t(payload_len | 0x80);
+        payload_len >>= 7;
+    }
+    out[used++] = uint8_t(payload_len);
+    return used;
+}
+
+/**
+ * @brief Decodes the frame header at the start of a buffer.
+ * @param bytes The received bytes.
+ * @param version The protocol version of the connection.
+ * @param header The decoded header.
+ * @return The length of the header, 0 if more bytes are needed, -1 if the header is malformed or the payload too long.
+ */
+int decode_frame_header(std::span<const uint8_t> bytes, uint8_t version, FrameHeader& header)
+{
+    if (bytes.size() < 2) {
+        return 0;
+    }
+    header.message_type = MessageType(bytes[0]);
+    if (version < PROTOCOL_V2) {
+        header.payload_len = bytes[1];
+        return 2;
+    }
+    size_t payload_len = 0;
+    for (size_t i = 1; i < MAX_FRAME_HEADER; ++i) {
+        if (i >= bytes.size()) {
+            return 0;
+        }
+        payload_len |= size_t(bytes[i] & 0x7f) << (7 * (i - 1));
+        if ((bytes[i] & 0x80) == 0) {
+            if (payload_len > MAX_FRAME_PAYLOAD) {
+                return -1;
+            }
+            header.payload_len = payload_len;
+            return int(i + 1);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Appends received bytes.
+ * The bytes of frames already taken out are dropped first, so the buffer only grows to the largest burst.
+ * @param bytes The bytes.
+ */
+void FrameDecoder::append(std::span<const uint8_t> bytes)
+{
+    if (offset != 0) {
+        buffer.erase(buffer.begin(), buffer.begin() + std::ptrdiff_t(offset));
+        offset = 0;
+    }
+    buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+}
+
+/**
+ * @brief Takes the next complete frame out of the buffer.
+ * @param version The protocol version of the frame.
+ * @param header The header of the frame.
+ * @param payload The payload of the frame, valid until the next append() or clear().
+ * @return FRAME if a frame was taken out, NEED_MORE or MALFORMED otherwise.
+ */
+FrameDecoder::Status FrameDecoder::next(uint8_t version, FrameHeader& header, std::span<const uint8_t>& payload)
+{
+    const std::span<const uint8_t> bytes = pending();
+    const int header_len = decode_frame_header(bytes, version, header);
+    if (header_len < 0) {
+        return MALFORMED;
+    }
+    if (header_len == 0 || bytes.size() < size_t(header_len) + header.payload_len) {
+        return NEED_MORE;
+    }
+    payload = bytes.subspan(size_t(header_len), header.payload_len);
+    offset += size_t(header_len) + header.payload_len;
+    return FRAME;
+}
+
+/**
+ * @brief Gets the number of bytes still missing to complete the next frame.
+ * An unfinished v2 length asks for one byte at a time, since only its last byte tells where the frame ends.
+ * @param version The protocol version of the frame.
+ * @return The number of bytes, 0 if a frame is complete or the header is malformed.
+ */
+size_t FrameDecoder::missing(uint8_t version) const
+{
+    const std::span<const uint8_t> bytes = pending();
+    FrameHeader header;
+    const int header_len = decode_frame_header(bytes, version, header);
+    if (header_len < 0) {
+        return 0;
+    }
+    if (header_len == 0) {
+        return bytes.size() < 2 ? 2 - bytes.size() : 1;
+    }
+    const size_t frame_len = size_t(header_len) + header.payload_len;
+    return frame_len > bytes.size() ? frame_len - bytes.size() : 0;
+}
+
+/**
+ * @brief Drops the buffered bytes, for a new connection.
+ */
+void FrameDecoder::clear()
+{
+    buffer.clear();
+    offset = 0;
+}
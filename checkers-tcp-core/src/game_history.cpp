@@ -0,0 +1,48 @@
+/**
+ * @file game_history.cpp
+ * @brief Implementation of the draw detection of the position history.
+ */
+
+#include "game_history.h"
+
+#include <algorithm>
+
+/**
+ * @brief Start a new history at the current position of the engine.
+ * @param engine The engine.
+ */
+void GameHistory::reset(const checkers_engine& engine)
+{
+    hashes.clear();
+    hashes.reserve(2 * DRAW_MOVE_LIMIT + 1);
+    hashes.push_back(engine.hash());
+    reversible_plies = engine.reversible_plies();
+}
+
+/**
+ * @brief Record the position after a move was made on the engine.
+ * @param engine The engine.
+ */
+void GameHistory::push(const checkers_engine& engine)
+{
+    reversible_plies = engine.reversible_plies();
+    if (reversible_plies == 0)
+        hashes.clear();
+    hashes.push_back(engine.hash());
+}
+
+/**
+ * @brief Get why the game is drawn in the last recorded position.
+ * @return The reason, NO_DRAW if the game goes on.
+ */
+DrawReason GameHistory::draw_reason() const
+{
+    if (reversible_plies >= 2 * DRAW_MOVE_LIMIT)
+        return MOVE_LIMIT;
+    if (hashes.empty())
+        return NO_DRAW;
+    // The hash covers the side to move, so equal hashes are the same position with the same side.
+    if (size_t(std::count(hashes.begin(), hashes.end(), hashes.back())) >= REPETITION_COUNT)
+        return REPETITION;
+    return NO_DRAW;
+}
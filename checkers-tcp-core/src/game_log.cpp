@@ -0,0 +1,228 @@
+/**
+ * @file game_log.cpp
+ * @brief Implementation of the segmented append-only game log and its memory-mapped reader.
+ */
+
+#include "game_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr const char* SEGMENT_PREFIX = "games-";
+constexpr const char* SEGMENT_SUFFIX = ".log";
+
+/**
+ * @brief Builds an exception from errno.
+ */
+std::runtime_error system_error(const std::string& what, const std::filesystem::path& path)
+{
+    return std::runtime_error(what + " " + path.string() + ": " + strerror(errno));
+}
+
+/**
+ * @brief Gets the path of a segment.
+ */
+std::filesystem::path segment_path(const std::filesystem::path& directory, uint32_t index)
+{
+    char name[32];
+    std::snprintf(name, sizeof name, "%s%06u%s", SEGMENT_PREFIX, index, SEGMENT_SUFFIX);
+    return directory / name;
+}
+
+/**
+ * @brief Gets the number of a segment file, or -1 if the file isn't a segment.
+ */
+long segment_number(const std::filesystem::path& path)
+{
+    const std::string name = path.filename().string();
+    const size_t prefix = std::strlen(SEGMENT_PREFIX);
+    const size_t suffix = std::strlen(SEGMENT_SUFFIX);
+    if (name.size() <= prefix + suffix || !name.starts_with(SEGMENT_PREFIX) || !name.ends_with(SEGMENT_SUFFIX)) return -1;
+    const std::string digits = name.substr(prefix, name.size() - prefix - suffix);
+    if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) return -1;
+    return std::stol(digits);
+}
+
+/**
+ * @brief Writes a whole buffer.
+ */
+void write_all(int fd, const uint8_t* data, size_t size, const std::filesystem::path& path)
+{
+    while (size > 0) {
+        const auto n = ::write(fd, data, size);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw system_error("Failed to write game log segment", path);
+        }
+        data += n;
+        size -= size_t(n);
+    }
+}
+
+}
+
+/**
+ * @brief Lists the segment files of a log directory.
+ * @param directory The log directory.
+ * @return The segment files, oldest first.
+ */
+std::vector<std::filesystem::path> list_segments(const std::filesystem::path& directory)
+{
+    std::vector<std::pair<long, std::filesystem::path>> numbered;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        const long number = segment_number(entry.path());
+        if (entry.is_regular_file() && number >= 0) {
+            numbered.emplace_back(number, entry.path());
+        }
+    }
+    std::sort(numbered.begin(), numbered.end());
+    std::vector<std::filesystem::path> paths;
+    for (auto& [number, path] : numbered) {
+        paths.push_back(std::move(path));
+    }
+    return paths;
+}
+
+/**
+ * @brief Opens or creates a log directory for appending.
+ * @param directory The log directory.
+ * @param flush_threshold The number of buffered bytes that triggers a write, 0 writes every record.
+ * @param segment_size The size limit of a segment.
+ */
+GameLogWriter::GameLogWriter(std::filesystem::path directory, size_t flush_threshold, size_t segment_size)
+    : directory(std::move(directory)), flush_threshold(flush_threshold), segment_size(segment_size)
+{
+    std::filesystem::create_directories(this->directory);
+    const auto segments = list_segments(this->directory);
+    open_segment(segments.empty() ? 0 : uint32_t(segment_number(segments.back())));
+}
+
+/**
+ * @brief Writes the buffered records and closes the segment.
+ */
+GameLogWriter::~GameLogWriter()
+{
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Nothing left to report to.
+    }
+    ::close(segment_fd);
+}
+
+/**
+ * @brief Appends a game record.
+ * @param header The header of the record.
+ * @param moves The moves of the game.
+ * @return True if the record was appended, false if it can't be encoded.
+ */
+bool GameLogWriter::append(const RecordHeader& header, std::span<const Move> moves)
+{
+    std::scoped_lock<std::mutex> lock(mutex);
+    const size_t start = buffer.size();
+    if (!encode_record(header, moves, buffer)) return false;
+    const size_t record_size = buffer.size() - start;
+    if (segment_bytes + start + record_size > segment_size && segment_bytes + start > sizeof SEGMENT_MAGIC) {
+        // The record goes to a new segment, records never span two segments.
+        std::vector<uint8_t> record(buffer.begin() + long(start), buffer.end());
+        buffer.resize(start);
+        flush_locked();
+        ::close(segment_fd);
+        open_segment(segment_index + 1);
+        buffer = std::move(record);
+    }
+    if (buffer.size() >= flush_threshold) {
+        flush_locked();
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the buffered records to the segment.
+ */
+void GameLogWriter::flush()
+{
+    std::scoped_lock<std::mutex> lock(mutex);
+    flush_locked();
+}
+
+/**
+ * @brief Writes the buffered records to the segment, the mutex is held.
+ */
+void GameLogWriter::flush_locked()
+{
+    if (buffer.empty()) return;
+    write_all(segment_fd, buffer.data(), buffer.size(), segment_path(directory, segment_index));
+    segment_bytes += buffer.size();
+    buffer.clear();
+}
+
+/**
+ * @brief Opens a segment for appending, creating it or cutting off a torn record at its end.
+ * @param index The number of the segment.
+ */
+void GameLogWriter::open_segment(uint32_t index)
+{
+    const auto path = segment_path(directory, index);
+    segment_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (segment_fd == -1) {
+        throw system_error("Failed to open game log segment", path);
+    }
+    segment_index = index;
+
+    struct stat info{};
+    fstat(segment_fd, &info);
+    if (size_t(info.st_size) < sizeof SEGMENT_MAGIC) {
+        // New, or created by a crash before the magic was complete.
+        if (info.st_size != 0 && ftruncate(segment_fd, 0) == -1) {
+            throw system_error("Failed to reset game log segment", path);
+        }
+        write_all(segment_fd, reinterpret_cast<const uint8_t*>(SEGMENT_MAGIC), sizeof SEGMENT_MAGIC, path);
+        segment_bytes = sizeof SEGMENT_MAGIC;
+        return;
+    }
+
+    size_t valid_size = sizeof SEGMENT_MAGIC;
+    {
+        const GameLogSegment segment(path);
+        for (const auto& record : segment) {
+            valid_size += record.size();
+        }
+    }
+    if (valid_size < size_t(info.st_size) && ftruncate(segment_fd, off_t(valid_size)) == -1) {
+        throw system_error("Failed to cut off torn record in", path);
+    }
+    segment_bytes = valid_size;
+}
+
+/**
+ * @brief Maps a segment file.
+ * @param path The segment file.
+ */
+GameLogSegment::GameLogSegment(const std::filesystem::path& path) : file(path)
+{
+    const auto contents = file.bytes();
+    if (contents.size() < sizeof SEGMENT_MAGIC || std::memcmp(contents.data(), SEGMENT_MAGIC, sizeof SEGMENT_MAGIC) != 0) {
+        throw std::runtime_error("Not a game log segment: " + path.string());
+    }
+    bytes = contents.subspan(sizeof SEGMENT_MAGIC);
+}
+
+/**
+ * @brief Maps the segments of a log directory.
+ * @param directory The log directory.
+ */
+GameLogReader::GameLogReader(const std::filesystem::path& directory)
+{
+    for (const auto& path : list_segments(directory)) {
+        mapped_segments.emplace_back(path);
+    }
+}
@@ -0,0 +1,112 @@
+/**
+ * @file game_record.cpp
+ * @brief Implementation of the compact binary game record format.
+ */
+
+#include "game_record.h"
+
+#include <cstdlib>
+#include <limits>
+
+namespace {
+
+constexpr uint8_t SPOTS_PER_ROW = 4;
+constexpr uint8_t ROW_COUNT = 8;
+constexpr uint8_t CAPTURE_BIT = 0x80;
+
+/**
+ * @brief Gets the spot of a dark square.
+ */
+constexpr SpotIndex spot_at(int row, int column) { return SpotIndex(row * SPOTS_PER_ROW + column / 2); }
+
+/**
+ * @brief Directions of the encoding: north-west, north-east, south-west, south-east.
+ */
+constexpr int ROW_STEP[4] = {-1, -1, 1, 1};
+constexpr int COLUMN_STEP[4] = {-1, 1, -1, 1};
+
+}
+
+/**
+ * @brief Encodes a move.
+ * @param move The move, a single step or a single jump.
+ * @param out The buffer to append the 1 or 2 encoded bytes to.
+ * @return True if the move was encoded, false if it isn't a step or a jump.
+ */
+bool encode_move(const Move& move, std::vector<uint8_t>& out)
+{
+    if (move.from >= SPOTS_PER_ROW * ROW_COUNT || move.to >= SPOTS_PER_ROW * ROW_COUNT) return false;
+    const int row_delta = spot_row(move.to) - spot_row(move.from);
+    const int column_delta = spot_column(move.to) - spot_column(move.from);
+    const int distance = std::abs(row_delta);
+    const bool is_capture = move.type & MoveType::CAPTURE;
+    if (distance != std::abs(column_delta) || distance != (is_capture ? 2 : 1)) return false;
+
+    const uint8_t direction = (row_delta > 0 ? 2 : 0) | (column_delta > 0 ? 1 : 0);
+    if (move.type & MoveType::PROMOTION) {
+        out.push_back(PROMOTION_PREFIX);
+    }
+    out.push_back(uint8_t((is_capture ? CAPTURE_BIT : 0) | (direction << 5) | move.from));
+    return true;
+}
+
+/**
+ * @brief Decodes the move at the start of a buffer.
+ * @param bytes The encoded moves.
+ * @param move The decoded move.
+ * @return The number of bytes consumed, 0 if the bytes are not a valid move.
+ */
+size_t decode_move(std::span<const uint8_t> bytes, Move& move)
+{
+    size_t used = 0;
+    uint8_t type = MoveType::NORMAL;
+    if (!bytes.empty() && bytes[0] == PROMOTION_PREFIX) {
+        type |= MoveType::PROMOTION;
+        ++used;
+    }
+    if (bytes.size() <= used) return 0;
+
+    const uint8_t code = bytes[used++];
+    const SpotIndex from = code & 0x1f;
+    const uint8_t direction = (code >> 5) & 0x3;
+    const int distance = code & CAPTURE_BIT ? 2 : 1;
+    const int row = spot_row(from) + ROW_STEP[direction] * distance;
+    const int column = spot_column(from) + COLUMN_STEP[direction] * distance;
+    if (row < 0 || row >= ROW_COUNT || column < 0 || column >= 2 * SPOTS_PER_ROW) return 0;
+
+    if (code & CAPTURE_BIT) {
+        type |= MoveType::CAPTURE;
+    }
+    move = Move(from, spot_at(row, column), MoveType(type));
+    return used;
+}
+
+/**
+ * @brief Appends a complete record to a buffer.
+ * @param header The header, move_bytes and ply_count are filled in.
+ * @param moves The moves of the game.
+ * @param out The buffer to append the record to.
+ * @return True if the record was encoded, false if a move can't be encoded or the game is too long.
+ */
+bool encode_record(RecordHeader header, std::span<const Move> moves, std::vector<uint8_t>& out)
+{
+    const size_t start = out.size();
+    out.resize(start + sizeof(RecordHeader));
+    for (const auto& move : moves) {
+        if (!encode_move(move, out)) {
+            out.resize(start);
+            return false;
+        }
+    }
+    const size_t move_bytes = out.size() - start - sizeof(RecordHeader);
+    if (move_bytes > std::numeric_limits<uint16_t>::max()) {
+        out.resize(start);
+        return false;
+    }
+    header.magic = RECORD_MAGIC;
+    header.version = RECORD_VERSION;
+    header.move_bytes = uint16_t(move_bytes);
+    header.ply_count = uint16_t(moves.size());
+    std::memcpy(out.data() + start, &header, sizeof(RecordHeader));
+    return true;
+}
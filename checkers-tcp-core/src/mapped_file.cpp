@@ -0,0 +1,93 @@
+/**
+ * @file mapped_file.cpp
+ * @brief Implementation of the read-only file mapping.
+ */
+
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * @brief Maps a file.
+ * @param path The file.
+ * @param sequential Whether the file is read front to back, which makes the kernel read ahead aggressively.
+ */
+MappedFile::MappedFile(const std::filesystem::path& path, bool sequential)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open " + path.string() + ": " + strerror(errno));
+    }
+    struct stat info{};
+    if (fstat(fd, &info) == -1) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to stat " + path.string() + ": " + strerror(error));
+    }
+    mapping_size = size_t(info.st_size);
+    if (mapping_size > 0) {
+        mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    const int error = errno;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        mapping_size = 0;
+        throw std::runtime_error("Failed to map " + path.string() + ": " + strerror(error));
+    }
+    if (mapping != nullptr) {
+        madvise(mapping, mapping_size, sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+    }
+}
+
+/**
+ * @brief Unmaps the file.
+ */
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+/**
+ * @brief Takes over the mapping of another file.
+ * @param other The mapping to move from.
+ */
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : mapping(std::exchange(other.mapping, nullptr)), mapping_size(std::exchange(other.mapping_size, 0))
+{
+}
+
+/**
+ * @brief Takes over the mapping of another file.
+ * @param other The mapping to move from.
+ * @return This mapping.
+ */
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        unmap();
+        mapping = std::exchange(other.mapping, nullptr);
+        mapping_size = std::exchange(other.mapping_size, 0);
+    }
+    return *this;
+}
+
+/**
+ * @brief Unmaps the file if one is mapped.
+ */
+void MappedFile::unmap()
+{
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+}
@@ -0,0 +1,472 @@
+/**
+ * @file pdn.cpp
+ * @brief Implementation of the PDN reader and writer.
+ */
+
+#include "pdn.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <optional>
+
+namespace {
+
+/**
+ * @brief Maximum number of jumps a shortened jump is searched for.
+ */
+constexpr size_t MAX_SEARCHED_JUMPS = 12;
+
+/**
+ * @brief Line length the writer wraps the movetext at.
+ */
+constexpr size_t LINE_LENGTH = 79;
+
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+bool is_move_separator(char c) { return c == '-' || c == 'x' || c == ':'; }
+
+/**
+ * @brief Parses a result token.
+ */
+std::optional<GameResult> parse_result(std::string_view token)
+{
+    if (token == "1-0" || token == "2-0") return WHITE_WON;
+    if (token == "0-1" || token == "0-2") return BLACK_WON;
+    if (token == "1/2-1/2" || token == "1-1") return DRAWN;
+    if (token == "0-0") return ABORTED;
+    return std::nullopt;
+}
+
+/**
+ * @brief Gets the result token of a result.
+ */
+std::string_view result_token(GameResult result)
+{
+    switch (result) {
+        case WHITE_WON: return "1-0";
+        case BLACK_WON: return "0-1";
+        case DRAWN: return "1/2-1/2";
+        default: return "*";
+    }
+}
+
+/**
+ * @brief Splits a move token into its squares.
+ * @param squares The squares, nullptr to only check the token.
+ * @return The number of squares, 0 if the token isn't a move.
+ */
+size_t parse_squares(std::string_view token, std::vector<int>* squares, bool& is_capture)
+{
+    size_t count = 0;
+    size_t pos = 0;
+    is_capture = false;
+    if (squares) squares->clear();
+    while (pos < token.size()) {
+        if (count > 0) {
+            if (!is_move_separator(token[pos])) return 0;
+            is_capture |= token[pos] != '-';
+            ++pos;
+        }
+        int square = 0;
+        const auto [end, ec] = std::from_chars(token.data() + pos, token.data() + token.size(), square);
+        if (ec != std::errc() || square < 1 || square > int(SPOTS_NUMBER)) return 0;
+        if (squares) squares->push_back(square);
+        ++count;
+        pos = size_t(end - token.data());
+    }
+    return count >= 2 ? count : 0;
+}
+
+/**
+ * @brief Finds the move between two spots the server would accept.
+ */
+bool find_move(const checkers_engine& engine, SpotIndex from, SpotIndex to, bool is_capture, Move& found)
+{
+    const int rows = std::abs(to / 4 - from / 4);
+    if (rows != (is_capture ? 2 : 1) || !engine.is_valid(Move(from, to, MoveType::NORMAL))) return false;
+    const bool promotes = !(engine.kings_bitboard() & spot_index_to_bit[from]) && (spot_index_to_bit[to] & OPPOSITE_BASE[engine.turn]);
+    found = Move(from, to, MoveType((is_capture ? MoveType::CAPTURE : 0) | (promotes ? MoveType::PROMOTION : 0)));
+    return true;
+}
+
+/**
+ * @brief Finds a jump sequence from a spot landing on another, for shortened jumps.
+ * The sequence follows the engine, which decides whether the jumping piece must continue.
+ */
+bool find_jumps(checkers_engine& engine, SpotIndex from, SpotIndex to, MoveList& moves, size_t depth = 0)
+{
+    if (depth == MAX_SEARCHED_JUMPS) return false;
+    const Color side = engine.turn;
+    for (const Move& move : engine.valid_moves(from)) {
+        if (!(move.type & MoveType::CAPTURE)) continue;
+        checkers_engine next = engine;
+        next.make_move(move);
+        moves.push_back(move);
+        if (move.to == to || (next.turn == side && find_jumps(next, move.to, to, moves, depth + 1))) {
+            engine = next;
+            return true;
+        }
+        moves.pop_back();
+    }
+    return false;
+}
+
+/**
+ * @brief Appends a number.
+ */
+void append_number(std::string& out, size_t number)
+{
+    char buffer[20];
+    const auto [end, ec] = std::to_chars(buffer, buffer + sizeof buffer, number);
+    out.append(buffer, end);
+}
+
+}
+
+/**
+ * @brief Gets the value of a tag.
+ * @param name The tag name.
+ * @return The value, empty if the game has no such tag.
+ */
+std::string_view PdnGame::tag(std::string_view name) const
+{
+    for (const auto& tag : tags) {
+        if (tag.name == name) return tag.value;
+    }
+    return {};
+}
+
+/**
+ * @brief Reads the next game.
+ * @param game The game to fill, its previous contents are discarded.
+ * @return True if a game was read, false at the end of the text.
+ */
+bool PdnReader::next(PdnGame& game)
+{
+    game.tags.clear();
+    game.moves.clear();
+    game.result = IN_PROGRESS;
+    game.error = nullptr;
+
+    do {
+        skip_space();
+        if (at_end()) return false;
+    } while (skip_comment());
+    game.line = line;
+
+    while (!at_end() && peek() == '[') {
+        PdnTag tag;
+        if (!read_tag(tag)) {
+            game.error = "malformed tag";
+            resync();
+            return true;
+        }
+        game.tags.push_back(tag);
+        do {
+            skip_space();
+        } while (!at_end() && skip_comment());
+    }
+
+    bool finished = false;
+    while (!finished) {
+        skip_space();
+        if (at_end()) break;
+        const char c = peek();
+        if (c == '[') {
+            // The next game, this one has no result token.
+            break;
+        } else if (c == '{' || c == ';' || (c == '%' && at_line_start())) {
+            if (!skip_comment()) {
+                game.error = "unterminated comment";
+                return true;
+            }
+        } else if (c == '(') {
+            if (!skip_variation()) {
+                game.error = "unterminated variation";
+                return true;
+            }
+        } else if (c == '$') {
+            for (++pos; !at_end() && is_digit(peek()); ++pos) {}
+        } else if (c == '*') {
+            ++pos;
+            finished = true;
+        } else if (!is_digit(c) || !read_token(game, finished)) {
+            game.error = is_digit(c) ? "malformed move" : "unexpected character";
+            resync();
+            return true;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Skips whitespace, counting lines.
+ */
+void PdnReader::skip_space()
+{
+    for (; !at_end(); ++pos) {
+        const char c = peek();
+        if (c == '\n') {
+            ++line;
+        } else if (c != ' ' && c != '\t' && c != '\r') {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Skips a {brace} comment, a ; comment or a % escape line.
+ * @return True if a comment was skipped, false if there is none or it is unterminated.
+ */
+bool PdnReader::skip_comment()
+{
+    if (at_end()) return false;
+    const char c = peek();
+    if (c == '{') {
+        const size_t end = text.find('}', pos);
+        if (end == std::string_view::npos) {
+            pos = text.size();
+            return false;
+        }
+        for (; pos <= end; ++pos) {
+            line += text[pos] == '\n';
+        }
+        return true;
+    }
+    if (c == ';' || (c == '%' && at_line_start())) {
+        const size_t end = text.find('\n', pos);
+        pos = end == std::string_view::npos ? text.size() : end;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Skips a variation including nested variations and comments.
+ * @return True if the variation was skipped, false if it is unterminated.
+ */
+bool PdnReader::skip_variation()
+{
+    int depth = 0;
+    while (!at_end()) {
+        const char c = peek();
+        if (c == '{') {
+            if (!skip_comment()) return false;
+            continue;
+        }
+        if (c == '\n') {
+            ++line;
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')' && --depth == 0) {
+            ++pos;
+            return true;
+        }
+        ++pos;
+    }
+    return false;
+}
+
+/**
+ * @brief Reads a tag pair.
+ * @param tag The tag read.
+ * @return True if the tag is well-formed, false otherwise.
+ */
+bool PdnReader::read_tag(PdnTag& tag)
+{
+    ++pos;
+    while (!at_end() && peek() == ' ') ++pos;
+    const size_t name_begin = pos;
+    while (!at_end() && (std::isalnum(static_cast<unsigned char>(peek())) || peek() == '_')) ++pos;
+    if (pos == name_begin) return false;
+    tag.name = text.substr(name_begin, pos - name_begin);
+
+    while (!at_end() && peek() == ' ') ++pos;
+    if (at_end() || peek() != '"') return false;
+    const size_t value_begin = ++pos;
+    while (!at_end() && peek() != '"') {
+        if (peek() == '\n') return false;
+        pos += peek() == '\\' ? 2 : 1;
+    }
+    if (at_end()) return false;
+    tag.value = text.substr(value_begin, pos - value_begin);
+    ++pos;
+
+    while (!at_end() && peek() == ' ') ++pos;
+    if (at_end() || peek() != ']') return false;
+    ++pos;
+    return true;
+}
+
+/**
+ * @brief Reads a move number, a move or a result.
+ * @param game The game to add the move or result to.
+ * @param finished Set if the token was the result.
+ * @return True if the token is well-formed, false otherwise.
+ */
+bool PdnReader::read_token(PdnGame& game, bool& finished)
+{
+    const size_t begin = pos;
+    while (!at_end() && (is_digit(peek()) || is_move_separator(peek()) || peek() == '/' || peek() == '.')) ++pos;
+    std::string_view token = text.substr(begin, pos - begin);
+    // Annotations such as 11-15! or 9-14?! carry no move information.
+    while (!at_end() && (peek() == '!' || peek() == '?')) ++pos;
+
+    if (const auto result = parse_result(token)) {
+        game.result = *result;
+        finished = true;
+        return true;
+    }
+    // Move numbers, 12. or 12..., possibly glued to the move.
+    const size_t dot = token.find_last_of('.');
+    if (dot != std::string_view::npos) {
+        if (!std::all_of(token.begin(), token.begin() + long(dot), [](char c) { return is_digit(c) || c == '.'; })) {
+            return false;
+        }
+        token.remove_prefix(dot + 1);
+        if (token.empty()) return true;
+    }
+    bool is_capture = false;
+    if (parse_squares(token, nullptr, is_capture) == 0) return false;
+    game.moves.push_back(token);
+    return true;
+}
+
+/**
+ * @brief Skips to the next line starting with a tag.
+ */
+void PdnReader::resync()
+{
+    while (!at_end()) {
+        if (peek() == '\n') {
+            ++line;
+            if (pos + 1 < text.size() && text[pos + 1] == '[') {
+                ++pos;
+                return;
+            }
+        }
+        ++pos;
+    }
+}
+
+/**
+ * @brief Replays the moves of a game and converts them to engine moves.
+ * @param game The game.
+ * @param moves The engine moves, its previous contents are discarded.
+ * @param error Why the game couldn't be replayed.
+ * @return True if all moves are legal, false otherwise.
+ */
+bool resolve_pdn_moves(const PdnGame& game, MoveList& moves, std::string& error)
+{
+    moves.clear();
+    checkers_engine engine;
+    engine.reset();
+    if (const auto fen = game.tag("FEN"); !fen.empty()) {
+        const auto position = Position::from_fen(fen);
+        if (!position) {
+            error = "invalid FEN tag \"" + std::string(fen) + "\"";
+            return false;
+        }
+        engine.set_position(*position);
+    }
+
+    std::vector<int> squares;
+    for (size_t ply = 0; ply < game.moves.size(); ++ply) {
+        const std::string_view token = game.moves[ply];
+        bool is_capture = false;
+        const size_t count = parse_squares(token, &squares, is_capture);
+        const Color side = engine.turn;
+        bool is_legal = count == 2 || (count > 2 && is_capture);
+
+        for (size_t hop = 0; is_legal && hop + 1 < count; ++hop) {
+            const SpotIndex from = pdn_square_to_spot(squares[hop]);
+            const SpotIndex to = pdn_square_to_spot(squares[hop + 1]);
+            if (is_capture && hop + 2 == count) {
+                // The last landing square, possibly with the jumps in between left out.
+                is_legal = find_jumps(engine, from, to, moves);
+                break;
+            }
+            Move move;
+            is_legal = find_move(engine, from, to, is_capture, move);
+            if (is_legal) {
+                engine.make_move(move);
+                moves.push_back(move);
+                is_legal = !is_capture || engine.turn == side;
+            }
+        }
+        if (!is_legal) {
+            error = "illegal move " + std::to_string(ply / 2 + 1) + (side == WHITE ? ". " : "... ") + std::string(token);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Appends a game played from the initial position as PDN.
+ * @param out The text to append to.
+ * @param tags The tag pairs, a Result tag is added unless given.
+ * @param moves The engine moves, one per jump.
+ * @param result The result of the game.
+ */
+void write_pdn(std::string& out, std::span<const PdnTag> tags, std::span<const Move> moves, GameResult result)
+{
+    bool has_result = false;
+    for (const auto& tag : tags) {
+        out += '[';
+        out += tag.name;
+        out += " \"";
+        for (const char c : tag.value) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        out += "\"]\n";
+        has_result |= tag.name == "Result";
+    }
+    if (!has_result) {
+        out += "[Result \"";
+        out += result_token(result);
+        out += "\"]\n";
+    }
+    out += '\n';
+
+    checkers_engine engine;
+    engine.reset();
+    size_t line_begin = out.size();
+    size_t move_number = 1;
+    std::string token;
+    const auto append_token = [&](std::string_view text) {
+        if (out.size() > line_begin) {
+            if (out.size() - line_begin + 1 + text.size() > LINE_LENGTH) {
+                out += '\n';
+                line_begin = out.size();
+            } else {
+                out += ' ';
+            }
+        }
+        out += text;
+    };
+
+    for (size_t i = 0; i < moves.size();) {
+        const Color side = engine.turn;
+        token.clear();
+        if (side == WHITE) {
+            append_number(token, move_number++);
+            token += ". ";
+        }
+        append_number(token, size_t(spot_to_pdn_square(moves[i].from)));
+        // A multi-jump is one PDN move listing every landing square.
+        do {
+            token += moves[i].type & MoveType::CAPTURE ? 'x' : '-';
+            append_number(token, size_t(spot_to_pdn_square(moves[i].to)));
+            engine.make_move(moves[i]);
+            ++i;
+        } while (i < moves.size() && engine.turn == side && moves[i].from == moves[i - 1].to &&
+                 (moves[i - 1].type & moves[i].type & MoveType::CAPTURE));
+        append_token(token);
+    }
+    append_token(result_token(result));
+    out += "\n\n";
+}
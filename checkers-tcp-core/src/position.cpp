@@ -0,0 +1,112 @@
+/**
+ * @file position.cpp
+ * @brief Implementation of the FEN text form of positions.
+ */
+
+#include "position.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace {
+
+/**
+ * @brief Gets the color of a FEN color letter, the letters follow PDN where Black moves first.
+ */
+std::optional<Color> fen_color(char letter)
+{
+    if (letter == 'B') return WHITE;
+    if (letter == 'W') return BLACK;
+    return std::nullopt;
+}
+
+/**
+ * @brief Appends the squares of a color to FEN text.
+ */
+void append_squares(std::string& out, Bitboard pieces, Bitboard kings)
+{
+    bool is_first = true;
+    for (int square = 1; square <= int(SPOTS_NUMBER); ++square) {
+        const Bitboard bit = spot_index_to_bit[pdn_square_to_spot(square)];
+        if (!(pieces & bit)) continue;
+        if (!is_first) out += ',';
+        if (kings & bit) out += 'K';
+        char buffer[4];
+        const auto [end, ec] = std::to_chars(buffer, buffer + sizeof buffer, square);
+        out.append(buffer, end);
+        is_first = false;
+    }
+}
+
+}
+
+/**
+ * @brief Parses a position from FEN text.
+ * @param fen The text, e.g. "W:W21,K30:B1-3,12".
+ * @return The position, or nothing if the text is malformed or a square is taken twice.
+ */
+std::optional<Position> Position::from_fen(std::string_view fen)
+{
+    while (!fen.empty() && (fen.back() == ' ' || fen.back() == '.')) fen.remove_suffix(1);
+    while (!fen.empty() && fen.front() == ' ') fen.remove_prefix(1);
+    if (fen.size() < 2 || fen[1] != ':') return std::nullopt;
+    const auto turn = fen_color(fen[0]);
+    if (!turn) return std::nullopt;
+
+    Bitboard pieces[BOTH] = {};
+    Bitboard kings = 0;
+    size_t pos = 2;
+    while (pos < fen.size()) {
+        const size_t section_end = std::min(fen.find(':', pos), fen.size());
+        const std::string_view section = fen.substr(pos, section_end - pos);
+        pos = section_end + 1;
+        const auto color = section.empty() ? std::nullopt : fen_color(section[0]);
+        if (!color) return std::nullopt;
+
+        size_t item_pos = 1;
+        while (item_pos < section.size()) {
+            const size_t item_end = std::min(section.find(',', item_pos), section.size());
+            std::string_view item = section.substr(item_pos, item_end - item_pos);
+            item_pos = item_end + 1;
+            while (!item.empty() && item.front() == ' ') item.remove_prefix(1);
+            if (item.empty()) continue;
+            const bool is_king = item[0] == 'K';
+            if (is_king) item.remove_prefix(1);
+
+            // A single square or a range such as 1-12.
+            int first = 0;
+            int last = 0;
+            const auto [end, ec] = std::from_chars(item.data(), item.data() + item.size(), first);
+            if (ec != std::errc()) return std::nullopt;
+            last = first;
+            if (end != item.data() + item.size()) {
+                if (*end != '-') return std::nullopt;
+                const auto range = std::from_chars(end + 1, item.data() + item.size(), last);
+                if (range.ec != std::errc() || range.ptr != item.data() + item.size()) return std::nullopt;
+            }
+            if (first < 1 || last > int(SPOTS_NUMBER) || first > last) return std::nullopt;
+            for (int square = first; square <= last; ++square) {
+                const Bitboard bit = spot_index_to_bit[pdn_square_to_spot(square)];
+                pieces[*color] |= bit;
+                if (is_king) kings |= bit;
+            }
+        }
+    }
+    if (pieces[WHITE] & pieces[BLACK]) return std::nullopt;
+    if (*turn == BLACK && (pieces[WHITE] | pieces[BLACK]) == BITBOARD_FULL) return std::nullopt;
+    return Position(pieces[WHITE], pieces[BLACK], kings, *turn);
+}
+
+/**
+ * @brief Formats the position as FEN text.
+ * @return The text, squares ascending with kings prefixed by K.
+ */
+std::string Position::to_fen() const
+{
+    std::string fen;
+    fen += side_to_move() == WHITE ? "B:W" : "W:W";
+    append_squares(fen, black_bits, kings());
+    fen += ":B";
+    append_squares(fen, white_bits, kings());
+    return fen;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file bot_search.h
+ * @brief Contains the declaration of the server-side bot move search.
+ */
+
+#pragma once
+
+#include "checkers_engine.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Limits of a single bot move search.
+ */
+struct BotBudget {
+  int max_depth = 4; /**< The maximum search depth in plies. */
+  uint64_t max_nodes = 20000; /**< The maximum number of visited nodes. */
+  std::chrono::milliseconds max_time{100}; /**< The maximum search time. */
+};
+
+/**
+ * @brief Gets the search budget of a bot level.
+ * @param level The bot level requested in the handshake, 0 is the weakest.
+ * @return The search budget.
+ */
+BotBudget bot_budget(uint8_t level);
+
+/**
+ * @brief Result of a bot move search.
+ */
+struct BotSearchResult {
+  Move move{0, 0, MoveType::INVALID}; /**< The best move found, INVALID if the bot has no moves. */
+  int depth = 0; /**< The last fully searched depth. */
+  uint64_t nodes = 0; /**< The number of visited nodes. */
+};
+
+/**
+ * @brief Searches the best move for the side to move with iterative deepening alpha-beta.
+ *
+ * The search stops at the first exhausted limit of the budget, or when cancelled is set,
+ * and returns the best move of the last completed iteration.
+ * @param engine The position to search.
+ * @param budget The search limits.
+ * @param cancelled Flag set by the session when the result is no longer needed.
+ * @return The search result.
+ */
+BotSearchResult find_bot_move(const checkers_engine& engine, const BotBudget& budget, const std::atomic<bool>& cancelled);
@@ -0,0 +1,131 @@
+/**
+ * @file bot_session.h
+ * @brief Contains the declaration of the game session against the server-side bot.
+ */
+
+#pragma once
+
+#include "bot_search.h"
+#include "checkers_engine.h"
+#include "game_session.h"
+#include "message.h"
+#include "socket.h"
+#include "timer_service.h"
+#include "worker_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <poll.h>
+#include <vector>
+
+/**
+ * @brief A bot move search handed to the worker pool.
+ */
+struct BotRequest {
+  checkers_engine position; /**< Copy of the position to search. */
+  BotBudget budget; /**< The search limits. */
+  std::atomic<bool> cancelled = false; /**< Set when the session no longer needs the result. */
+  BotSearchResult result; /**< The search result, valid once BOT_MOVE_READY is posted. */
+  std::weak_ptr<SessionEvents> events; /**< The events of the requesting session. */
+};
+
+/**
+ * @brief Structure representing the data for a game session against the bot.
+ */
+struct BotSessionData {
+  checkers_engine engine; /**< The checkers engine for the game session. */
+  Socket player_socket; /**< The socket of the human player. */
+  struct pollfd pfds[2]{}; /**< Array of poll file descriptors: the player and the session events. */
+  FrameDecoder decoder; /**< The received bytes of the unfinished frame of the player. */
+  std::shared_ptr<SessionEvents> events; /**< Events posted by timers and bot searches. */
+  TimerService& timers; /**< The server timer service. */
+  WorkerPool& bot_pool; /**< The pool running bot searches. */
+  TimerService::TimerId idle_timer = TimerWheel::INVALID_TIMER; /**< The idle disconnect timer. */
+  BotBudget budget; /**< The search limits of the bot. */
+  std::shared_ptr<BotRequest> pending_request; /**< The running bot search, if any. */
+  GameHistory positions; /**< The position hashes since the last irreversible move, for draw detection. */
+  uint8_t bot_level; /**< The bot level requested in the handshake. */
+  std::vector<Move> history; /**< The moves played so far, replayed when the game is handed over. */
+
+  /**
+   * @brief Constructor for BotSessionData.
+   * @param player_socket The socket of the human player.
+   * @param bot_level The bot level requested in the handshake.
+   * @param timers The server timer service.
+   * @param bot_pool The pool running bot searches.
+   */
+  BotSessionData(Socket player_socket, uint8_t bot_level, TimerService& timers, WorkerPool& bot_pool);
+
+  /**
+   * @brief Constructor for a bot game handed over by the previous server process.
+   * @param record The HANDOVER_BOT_GAME record written by hand_over().
+   * @param timers The server timer service.
+   * @param bot_pool The pool running bot searches.
+   * @throws std::runtime_error if the record is malformed.
+   */
+  BotSessionData(const HandoverRecord& record, TimerService& timers, WorkerPool& bot_pool);
+
+  /**
+   * @brief Cancels the session timers and the pending bot search.
+   */
+  ~BotSessionData();
+
+  /**
+   * @brief Re-arms the idle disconnect timer.
+   */
+  void touch();
+
+  /**
+   * @brief Hands a search of the current position to the bot pool.
+   */
+  void request_bot_move();
+
+  /**
+   * @brief Plays the move found by the finished bot search.
+   * @param is_exit Atomic flag indicating if the session should exit.
+   */
+  void play_bot_move(std::atomic<bool>& is_exit);
+
+  /**
+   * @brief Ends the game if the last move decided it: the side to move can't move, or the game is drawn.
+   * @param is_exit Atomic flag indicating if the session should exit.
+   * @return True if the game is over, false otherwise.
+   */
+  bool check_game_over(std::atomic<bool>& is_exit);
+
+  /**
+   * @brief Handles a message of the human player.
+   * @param message The message storage.
+   * @param is_exit Atomic flag indicating if the session should exit.
+   */
+  void handle_message(const struct MessageStorage &message, std::atomic<bool>& is_exit);
+
+  /**
+   * @brief Stops the game to continue it in a new server process.
+   * A running bot search is cancelled, the next process searches again.
+   * @return The HANDOVER_BOT_GAME record, the player socket goes with it.
+   */
+  HandoverRecord hand_over();
+};
+
+/**
+ * @brief Function for running a game session between a player and the server-side bot.
+ * The player plays white.
+ * @param player_socket The socket of the human player.
+ * @param bot_level The bot level requested in the handshake.
+ * @param timers The server timer service.
+ * @param bot_pool The pool running bot searches.
+ * @param handover The collector of handed over games.
+ */
+void bot_session_routine(Socket player_socket, uint8_t bot_level, TimerService& timers, WorkerPool& bot_pool,
+                         SessionHandover& handover);
+
+/**
+ * @brief Function for continuing a bot game handed over by the previous server process.
+ * @param record The HANDOVER_BOT_GAME record.
+ * @param timers The server timer service.
+ * @param bot_pool The pool running bot searches.
+ * @param handover The collector of handed over games.
+ */
+void resumed_bot_session_routine(const HandoverRecord& record, TimerService& timers, WorkerPool& bot_pool,
+                                 SessionHandover& handover);
@@ -0,0 +1,109 @@
+/**
+ * @file connection_rtt.h
+ * @brief Contains the round-trip time tracking of player connections through PING and PONG.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/**
+ * @brief Time between two PINGs to a connection.
+ */
+constexpr auto PING_INTERVAL = std::chrono::seconds(5);
+
+/**
+ * @brief Number of PINGs in a row a connection may leave unanswered before it is considered dead.
+ */
+constexpr uint32_t MAX_MISSED_PONGS = 3;
+
+/**
+ * @brief Time between two reports of the server-wide RTT distribution.
+ */
+constexpr auto RTT_REPORT_INTERVAL = std::chrono::minutes(1);
+
+/**
+ * @brief Smoothed round-trip time and jitter of one connection, estimated as TCP does (RFC 6298).
+ *
+ * The server sends PING with its monotonic time in nanoseconds, the client echoes it in PONG, so
+ * the client needs no clock of its own. Unanswered PINGs are counted to detect a dead peer long
+ * before TCP gives up on it.
+ */
+class ConnectionRtt {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Counts a sent PING.
+   * @param now The time the PING was sent.
+   * @return The timestamp to send in the PING.
+   */
+  uint64_t ping_sent(Clock::time_point now);
+
+  /**
+   * @brief Takes the echoed timestamp of a PONG.
+   * @param timestamp The timestamp of the PONG.
+   * @param now The time the PONG was received.
+   * @return The round-trip time, nothing if the timestamp is not one this server sent.
+   */
+  std::optional<Clock::duration> pong_received(uint64_t timestamp, Clock::time_point now);
+
+  /**
+   * @brief Checks whether the peer answered recently enough to be alive.
+   * @return False if MAX_MISSED_PONGS PINGs in a row are unanswered.
+   */
+  [[nodiscard]] bool is_alive() const { return unanswered < MAX_MISSED_PONGS; }
+
+  [[nodiscard]] Clock::duration smoothed() const { return srtt; } /**< @brief The smoothed round-trip time. */
+  [[nodiscard]] Clock::duration jitter() const { return rttvar; } /**< @brief The round-trip time variation. */
+  [[nodiscard]] uint64_t samples() const { return sample_count; } /**< @brief The number of answered PINGs. */
+
+private:
+  Clock::duration srtt{}; /**< The smoothed round-trip time. */
+  Clock::duration rttvar{}; /**< The mean deviation of the round-trip time. */
+  uint64_t sample_count = 0; /**< The number of answered PINGs. */
+  uint32_t unanswered = 0; /**< The PINGs sent since the last PONG. */
+};
+
+/**
+ * @brief Lock-free histogram of round-trip times of all connections of the server.
+ *
+ * Buckets are a quarter of a power of two wide, so a percentile is within 25% of the exact value.
+ */
+class RttHistogram {
+public:
+  /**
+   * @brief Percentiles of the recorded round-trip times.
+   */
+  struct Summary {
+    uint64_t count = 0; /**< The number of recorded round trips. */
+    std::chrono::microseconds p50{}; /**< The median. */
+    std::chrono::microseconds p90{}; /**< The 90th percentile. */
+    std::chrono::microseconds p99{}; /**< The 99th percentile. */
+  };
+
+  /**
+   * @brief Records a round-trip time. Safe to call from any thread.
+   * @param rtt The round-trip time.
+   */
+  void record(std::chrono::microseconds rtt);
+
+  /**
+   * @brief Computes the percentiles of everything recorded so far.
+   * @return The percentiles, the upper bounds of their buckets.
+   */
+  Summary summarize() const;
+
+private:
+  static constexpr size_t BUCKET_COUNT = 4 * 26; /**< Up to 2^26 us, about a minute. */
+
+  static size_t bucket_of(uint64_t us);
+  static uint64_t upper_bound_of(size_t bucket);
+
+  std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{}; /**< The number of round trips per bucket. */
+};
@@ -0,0 +1,103 @@
+/**
+ * @file game_clock.h
+ * @brief Contains the declaration of the server-authoritative game clock.
+ */
+
+#pragma once
+
+#include "board.h"
+#include "message.h"
+
+#include <chrono>
+
+struct HandoverRecord;
+class HandoverReader;
+
+/**
+ * @brief Chess-style clock with base time and increment for both players.
+ *
+ * Time is measured on the server's monotonic clock only. The clock doesn't sleep or own a
+ * thread; the session arms a TimerService timer for flag_deadline() instead.
+ */
+class GameClock {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Constructs an untimed GameClock.
+   */
+  GameClock() = default;
+
+  /**
+   * @brief Constructs a GameClock for the given time control.
+   * @param time_control The time control.
+   */
+  explicit GameClock(TimeControl time_control);
+
+  /**
+   * @brief Checks if the game is timed.
+   * @return True if the game is timed, false otherwise.
+   */
+  [[nodiscard]] bool is_timed() const { return timed; }
+
+  /**
+   * @brief Starts the clock of the given side.
+   * @param side The side to move.
+   * @param now The current time.
+   */
+  void start(Color side, Clock::time_point now);
+
+  /**
+   * @brief Stops the clock of the side to move, adds its increment and starts the opponent's clock.
+   * @param now The time the move was received.
+   */
+  void switch_turn(Clock::time_point now);
+
+  /**
+   * @brief Gets the remaining time of a side.
+   * @param side The side.
+   * @param now The current time.
+   * @return The remaining time, never negative.
+   */
+  [[nodiscard]] std::chrono::milliseconds remaining(Color side, Clock::time_point now) const;
+
+  /**
+   * @brief Checks if the side to move ran out of time.
+   * @param now The current time.
+   * @return True if the flag fell, false otherwise.
+   */
+  [[nodiscard]] bool is_flagged(Clock::time_point now) const;
+
+  /**
+   * @brief Gets the time point at which the side to move runs out of time.
+   * @return The flag deadline.
+   */
+  [[nodiscard]] Clock::time_point flag_deadline() const { return turn_started + remaining_time[running]; }
+
+  /**
+   * @brief Gets the side whose clock is running.
+   * @return The side to move.
+   */
+  [[nodiscard]] Color running_side() const { return running; }
+
+  /**
+   * @brief Writes the clock to a hand-over record.
+   * Monotonic time points are shared by all processes of the machine, so a running clock keeps running.
+   * @param record The record.
+   */
+  void save(HandoverRecord& record) const;
+
+  /**
+   * @brief Reads a clock written by save().
+   * @param reader The reader of the record.
+   * @return The clock.
+   */
+  static GameClock load(HandoverReader& reader);
+
+private:
+  bool timed = false; /**< Whether the game is timed. */
+  Clock::duration remaining_time[BOTH] = {}; /**< The remaining time of each side at turn_started. */
+  Clock::duration increment = Clock::duration::zero(); /**< The time added after each move. */
+  Color running = WHITE; /**< The side whose clock is running. */
+  Clock::time_point turn_started; /**< The time the running clock was started. */
+};
@@ -6,12 +6,38 @@
 #pragma once
 
 #include "checkers_engine.h"
+#include "connection_rtt.h"
+#include "game_clock.h"
+#include "game_history.h"
+#include "game_log.h"
+#include "hot_restart.h"
 #include "socket.h"
 #include "message.h"
+#include "session_registry.h"
+#include "session_snapshots.h"
+#include "spectator_hub.h"
+#include "timer_service.h"
 
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <poll.h>
 #include <atomic>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Time without any message from either player after which a game session is closed.
+ */
+constexpr auto SESSION_IDLE_TIMEOUT = std::chrono::minutes(10);
+
+/**
+ * @brief Time a disconnected player has to resume the game before the opponent wins.
+ */
+constexpr auto RESUME_GRACE_PERIOD = std::chrono::seconds(60);
 
 /**
  * @brief Enum representing the socket numbers for player 1 and player 2.
@@ -21,36 +47,363 @@ enum SocketNumber {
   PLAYER2_SOCKET  /**< Socket number for player 2. */
 };
 
+/**
+ * @brief Bit flags of the events posted to a game session from other threads.
+ */
+enum SessionEvent : uint32_t {
+  IDLE_EXPIRED = 1 << 0, /**< Nobody sent anything for SESSION_IDLE_TIMEOUT. */
+  FLAG_FALL = 1 << 1,    /**< The clock of the side to move reached its flag deadline. */
+  BOT_MOVE_READY = 1 << 2, /**< The bot finished searching its move. */
+  RECONNECT = 1 << 3,     /**< A player resumed the session, the socket waits in the reconnect inbox. */
+  GRACE_EXPIRED = 1 << 4, /**< The resume grace period of a disconnected player ended. */
+  HANDOVER = 1 << 5,      /**< The server hands its games over to a new process, see hot_restart.h. */
+  DRAIN_DEADLINE = 1 << 6, /**< The server drains and the game outlived the drain deadline. */
+  HEARTBEAT = 1 << 7      /**< Time to PING the players, see connection_rtt.h. */
+};
+
+/**
+ * @brief Event channel into a game session thread, polled next to the player sockets.
+ *
+ * Timer callbacks hold it through a weak_ptr, so a callback racing with session teardown is harmless.
+ */
+struct SessionEvents {
+  int fd = -1; /**< The eventfd polled by the session thread. */
+  std::atomic<uint32_t> pending = 0; /**< The posted SessionEvent flags. */
+  std::mutex inbox_mutex; /**< Guards reconnects. */
+  std::vector<std::pair<uint64_t, Socket>> reconnects; /**< Resumed sockets with their tokens, not yet taken. */
+
+  /**
+   * @brief Constructs SessionEvents and its eventfd.
+   */
+  SessionEvents();
+
+  /**
+   * @brief Closes the eventfd.
+   */
+  ~SessionEvents();
+
+  SessionEvents(const SessionEvents&) = delete;
+  SessionEvents& operator=(const SessionEvents&) = delete;
+
+  /**
+   * @brief Posts an event and wakes up the session thread.
+   * @param event The event to post.
+   */
+  void post(SessionEvent event);
+
+  /**
+   * @brief Takes all posted events.
+   * @return The posted SessionEvent flags.
+   */
+  uint32_t take();
+
+  /**
+   * @brief Hands a resumed socket to the session thread and posts RECONNECT.
+   * @param token The resume token presented by the player.
+   * @param socket The resumed socket.
+   */
+  void post_reconnect(uint64_t token, Socket socket);
+
+  /**
+   * @brief Takes all resumed sockets.
+   * @return The resumed sockets with their tokens.
+   */
+  std::vector<std::pair<uint64_t, Socket>> take_reconnects();
+};
+
+/**
+ * @brief Arms a timer that posts an event to a session.
+ * @param timers The server timer service.
+ * @param delay The delay from now.
+ * @param events The events of the session.
+ * @param event The event to post on expiry.
+ * @return The id of the armed timer.
+ */
+TimerService::TimerId schedule_session_event(TimerService& timers, TimerService::Clock::duration delay,
+                                             const std::shared_ptr<SessionEvents>& events, SessionEvent event);
+
+class SessionWorkers;
+
+/**
+ * @brief The server-wide services a game session works with.
+ */
+struct SessionServices {
+  TimerService& timers; /**< The server timer service. */
+  SessionRegistry& registry; /**< The registry of resumable sessions. */
+  SpectatorHub& spectators; /**< The hub fanning games out to spectators. */
+  SessionHandover& handover; /**< Collects the running games when the server hands over to a new process. */
+  SessionWorkers& workers; /**< The threads the games run on. */
+  GameLogWriter* game_log = nullptr; /**< The log finished games are appended to, null if logging is disabled. */
+  SessionSnapshots* snapshots = nullptr; /**< The file running games are snapshotted to, null if disabled. */
+  RttHistogram* rtt_histogram = nullptr; /**< The server-wide round-trip times, null if not collected. */
+};
+
 /**
  * @brief Structure representing the data for a game session.
  */
 struct SessionData {
   checkers_engine engine; /**< The checkers engine for the game session. */
   Socket player_sockets[2]; /**< Array of player sockets. */
-  struct pollfd pfds[2]{}; /**< Array of poll file descriptors. */
-  std::mutex session_mutex; /**< Mutex for session synchronization. */
+  struct pollfd pfds[3]{}; /**< Array of poll file descriptors: both players and the session events. */
+  FrameDecoder decoders[2]; /**< The received bytes of the unfinished frames of both seats. */
+  std::shared_ptr<SessionEvents> events; /**< Events posted by timers. */
+  TimerService& timers; /**< The server timer service. */
+  TimerService::TimerId idle_timer = TimerWheel::INVALID_TIMER; /**< The idle disconnect timer. */
+  GameClock clock; /**< The game clock, untimed unless requested by the lobby creator. */
+  TimerService::TimerId flag_timer = TimerWheel::INVALID_TIMER; /**< The flag fall timer of the side to move. */
+  SessionRegistry& registry; /**< The registry the resume tokens are registered in. */
+  uint64_t resume_tokens[2]{}; /**< The resume tokens of both seats. */
+  bool away[2]{}; /**< Whether the player of a seat lost connection and may still resume. */
+  GameClock::Clock::time_point grace_deadlines[2]; /**< The end of the resume grace period of away seats. */
+  TimerService::TimerId grace_timers[2]{TimerWheel::INVALID_TIMER, TimerWheel::INVALID_TIMER}; /**< The grace period timers. */
+  std::vector<Move> history; /**< The moves played so far, replayed to resumed players. */
+  GameHistory positions; /**< The position hashes since the last irreversible move, for draw detection. */
+  SpectatorHub& spectators; /**< The hub fanning the game out to spectators. */
+  uint32_t game_id; /**< The ID spectators watch the game with. */
+  bool is_watchable = false; /**< Whether the game got a spectator channel. */
+  GameLogWriter* game_log; /**< The log the game is appended to when it ends, null if logging is disabled. */
+  GameResult result = ABORTED; /**< The outcome of the game, set when a player wins. */
+  std::chrono::system_clock::time_point started_at; /**< The wall clock start of the game. */
+  GameClock::Clock::time_point start_time; /**< The monotonic start of the game. */
+  GameClock::Clock::time_point last_move_at; /**< The monotonic time of the last move, or the start. */
+  bool handed_over = false; /**< Whether the game continues in a new server process, which logs it. */
+  SessionSnapshots* snapshots; /**< The file the game is snapshotted to, null if disabled. */
+  size_t snapshot_slot = SessionSnapshots::NO_SLOT; /**< The slot of the game in the snapshot file. */
+  ConnectionRtt rtts[2]; /**< The round-trip times of the current connections of both seats. */
+  RttHistogram* rtt_histogram; /**< The server-wide round-trip times, null if not collected. */
+  TimerService::TimerId heartbeat_timer = TimerWheel::INVALID_TIMER; /**< The timer of the next PING. */
 
   /**
    * @brief Constructor for SessionData.
    * @param player1_socket The socket for player 1.
    * @param player2_socket The socket for player 2.
+   * @param services The server-wide services.
+   * @param time_control The time control of the game.
+   * @param game_id The ID spectators watch the game with and the game is logged under.
+   */
+  SessionData(Socket player1_socket, Socket player2_socket, const SessionServices& services, TimeControl time_control,
+              uint32_t game_id);
+
+  /**
+   * @brief Constructor for a game handed over by the previous server process or recovered from its snapshot.
+   * The moves are replayed to restore the position and the draw history, the timers are re-armed at their deadlines.
+   * A recovered game has no sockets, both players get RESUME_GRACE_PERIOD to resume it.
+   * @param record The HANDOVER_GAME record written by hand_over() or snapshot().
+   * @param services The server-wide services.
+   * @param is_recovered Whether the record is a snapshot left by a crashed server.
+   * @throws std::runtime_error if the record is malformed.
+   */
+  SessionData(const HandoverRecord& record, const SessionServices& services, bool is_recovered = false);
+
+  /**
+   * @brief Logs the game, unregisters the resume tokens, closes unclaimed resumed sockets and spectators and cancels
+   * the session timers.
+   */
+  ~SessionData();
+
+  /**
+   * @brief Gets the memory a game costs: its slab slot, its events and the heap of its histories and decoders.
+   * @return The size in bytes.
+   */
+  size_t memory_footprint() const;
+
+  /**
+   * @brief Sends to the player of a seat unless the player is away.
+   * A failed send is only logged, the hang-up is picked up by the next poll.
+   * @param seat The seat to send to.
+   * @param send The function sending through the socket of the seat.
+   */
+  void send_to(SocketNumber seat, const std::function<void(Socket&)>& send);
+
+  /**
+   * @brief Sends a message to the spectators.
+   * @param message The message.
+   * @param position_changed Whether the message changed the position late joiners get.
    */
-  SessionData(Socket player1_socket, Socket player2_socket);
+  void broadcast(const MessageStorage& message, bool position_changed = false);
+
+  /**
+   * @brief Serializes the current position for spectators.
+   * @return The POSITION frame.
+   */
+  SharedFrame position_frame() const;
+
+  /**
+   * @brief Sends an error that ends the game to both players and the spectators.
+   * @param error The error.
+   */
+  void send_error_to_all(ErrorType error);
+
+  /**
+   * @brief Sends the decided result to both players and the spectators.
+   * @param winner The color of the winner, BOTH for a draw.
+   * @param reason Why the game ended.
+   */
+  void send_game_over(Color winner, GameOverReason reason);
+
+  /**
+   * @brief Ends the game if the last move decided it: the side to move can't move, or the game is drawn.
+   * @param is_exit Atomic flag indicating if the session should exit.
+   * @return True if the game is over, false otherwise.
+   */
+  bool check_game_over(std::atomic<bool>& is_exit);
+
+  /**
+   * @brief Appends the game to the game log.
+   */
+  void write_record();
+
+  /**
+   * @brief Writes the state of the game to a HANDOVER_GAME record, without the sockets.
+   * @param record The record.
+   */
+  void save(HandoverRecord& record) const;
+
+  /**
+   * @brief Writes the state of the game and the position to the snapshot slot of the game.
+   */
+  void snapshot();
+
+  /**
+   * @brief Stops the game to continue it in a new server process.
+   * The sockets of the attached players go with the record and must no longer be used.
+   * @return The HANDOVER_GAME record.
+   */
+  HandoverRecord hand_over();
+
+  /**
+   * @brief Sends GAME_STARTED with the seat colour and its resume token.
+   * @param seat The seat to send to.
+   */
+  void send_game_started(SocketNumber seat);
+
+  /**
+   * @brief Detaches a disconnected player and starts the resume grace period.
+   * The game ends right away if the opponent is away as well.
+   * @param seat The seat of the disconnected player.
+   * @param now The current time.
+   * @param is_exit Atomic flag indicating if the session should exit.
+   */
+  void player_left(SocketNumber seat, GameClock::Clock::time_point now, std::atomic<bool>& is_exit);
+
+  /**
+   * @brief Attaches resumed sockets to their seats and replays the game to them.
+   * A resumed socket takes the seat over even if the previous connection still looks alive.
+   * @param now The current time.
+   */
+  void attach_reconnects(GameClock::Clock::time_point now);
+
+  /**
+   * @brief Ends the game if an away player did not resume within the grace period.
+   * @param now The current time.
+   * @param is_exit Atomic flag indicating if the session should exit.
+   */
+  void check_grace(GameClock::Clock::time_point now, std::atomic<bool>& is_exit);
+
+  /**
+   * @brief Re-arms the idle disconnect timer.
+   */
+  void touch();
+
+  /**
+   * @brief PINGs the players that negotiated CAPABILITY_PING and detaches those that stopped answering.
+   * @param now The current time.
+   * @param is_exit Atomic flag indicating if the session should exit.
+   */
+  void heartbeat(GameClock::Clock::time_point now, std::atomic<bool>& is_exit);
+
+  /**
+   * @brief Takes a PONG of a player into its round-trip time.
+   * @param seat The seat of the player.
+   * @param pong The PONG.
+   * @param now The time the PONG was received.
+   */
+  void take_pong(SocketNumber seat, const MessageStorage& pong, GameClock::Clock::time_point now);
+
+  /**
+   * @brief Logs the round-trip time of the current connection of a seat, if it was measured.
+   * @param seat The seat.
+   */
+  void log_rtt(SocketNumber seat) const;
+
+  /**
+   * @brief Starts the clock of the side to move and sends both clocks to the players.
+   * @param now The current time.
+   */
+  void start_clock(GameClock::Clock::time_point now);
+
+  /**
+   * @brief Sends the remaining clock times to both players.
+   * @param now The current time.
+   */
+  void send_clocks(GameClock::Clock::time_point now);
+
+  /**
+   * @brief Ends the game if the side to move ran out of time.
+   * @param now The current time.
+   * @param is_exit Atomic flag indicating if the session should exit.
+   * @return True if the flag fell, false otherwise.
+   */
+  bool check_flag(GameClock::Clock::time_point now, std::atomic<bool>& is_exit);
+
+  /**
+   * @brief Serves what woke the game up: the posted events and the players whose revents are set in pfds.
+   * @param is_exit Atomic flag indicating if the session should exit.
+   * @return The HANDOVER_GAME record if the game stopped to be handed over, nothing otherwise.
+   */
+  std::optional<HandoverRecord> serve(std::atomic<bool>& is_exit);
+
+  /**
+   * @brief Reads from the socket of a seat without blocking and handles the message once its frame is complete.
+   * A closed connection or a malformed frame detaches the player.
+   * @param seat The seat.
+   * @param received_at The monotonic time the bytes were received.
+   * @param is_exit Atomic flag indicating if the session should exit.
+   */
+  void receive_from(SocketNumber seat, GameClock::Clock::time_point received_at, std::atomic<bool>& is_exit);
 
   /**
    * @brief Handles the incoming message for the specified socket.
    * @param socket_number The socket number.
    * @param message The message storage.
    * @param is_exit Atomic flag indicating if the session should exit.
+   * @param received_at The monotonic time the message was received.
    */
-  void handle_message(SocketNumber socket_number, const struct MessageStorage &message, std::atomic<bool>& is_exit);
+  void handle_message(SocketNumber socket_number, const struct MessageStorage &message, std::atomic<bool>& is_exit,
+                      GameClock::Clock::time_point received_at);
 };
 
 /**
- * @brief Function for running the game session routine.
+ * @brief Cleans up the game session by closing the sockets of attached players.
+ * @param session_data Reference to the SessionData struct.
+ */
+void cleanup_session(SessionData& session_data);
+
+/**
+ * @brief Starts a game between two players on a session worker.
  * @param player1_socket The socket for player 1.
  * @param player2_socket The socket for player 2.
- * @param is_exit Atomic flag indicating if the session should exit.
+ * @param is_exit Atomic flag ending the game from outside, it must outlive the game. Null if only the game ends itself.
  * @param lobby_id The ID of the lobby.
+ * @param services The server-wide services.
+ * @param time_control The time control of the game.
+ * @param player1_received The bytes of an unfinished frame player 1 sent while waiting in the lobby.
+ * @param on_finished Called on the worker thread once the game is over and the lobby is no longer used.
+ */
+void start_game_session(Socket player1_socket, Socket player2_socket, std::atomic<bool>* is_exit, uint32_t lobby_id,
+                        const SessionServices& services, TimeControl time_control,
+                        std::span<const uint8_t> player1_received = {}, std::function<void()> on_finished = {});
+
+/**
+ * @brief Continues a game handed over by the previous server process on a session worker.
+ * @param record The HANDOVER_GAME record.
+ * @param services The server-wide services.
+ */
+void resume_game_session(HandoverRecord record, const SessionServices& services);
+
+/**
+ * @brief Continues a game recovered from the snapshot file of a crashed server on a session worker.
+ * @param record The snapshot.
+ * @param services The server-wide services.
  */
-void game_session_routine(Socket player1_socket, Socket player2_socket, std::atomic<bool> &is_exit, uint32_t lobby_id);
+void recover_game_session(HandoverRecord record, const SessionServices& services);
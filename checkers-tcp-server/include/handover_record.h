@@ -0,0 +1,108 @@
+/**
+ * @file handover_record.h
+ * @brief Contains the records the state of a running server is handed over in.
+ */
+
+#pragma once
+
+#include "board.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Maximum number of descriptors attached to one record.
+ */
+constexpr size_t HANDOVER_MAX_FDS = 2;
+
+/**
+ * @brief Kinds of the records sent from the running server to its successor.
+ */
+enum HandoverKind : uint8_t {
+  HANDOVER_HELLO,       /**< Successor to server: the version it speaks. */
+  HANDOVER_LISTENER,    /**< The listening socket. */
+  HANDOVER_LOBBY_IDS,   /**< The state of the lobby ID allocator. */
+  HANDOVER_PENDING,     /**< A connection that hasn't sent its handshake yet, with its protocol if it sent HELLO and the bytes of an unfinished frame. */
+  HANDOVER_LOBBY,       /**< A lobby waiting for its second player. */
+  HANDOVER_GAME,        /**< A running game between two players. */
+  HANDOVER_BOT_GAME,    /**< A running game against the bot. */
+  HANDOVER_END,         /**< Everything was sent. */
+  HANDOVER_ACK          /**< Successor to server: everything was taken over. */
+};
+
+/**
+ * @brief One hand-over message: a kind, big-endian fields and the descriptors it owns.
+ */
+struct HandoverRecord {
+  HandoverKind kind = HANDOVER_END; /**< The kind of the record. */
+  std::vector<uint8_t> bytes; /**< The fields of the record. */
+  std::vector<int> fds; /**< The descriptors sent with the record, at most HANDOVER_MAX_FDS. */
+
+  /**
+   * @brief Appends an unsigned field of 8, 16, 32 or 64 bits.
+   * @param value The value.
+   */
+  void put_u8(uint8_t value) { bytes.push_back(value); }
+  void put_u16(uint16_t value); /**< @copydoc put_u8 */
+  void put_u32(uint32_t value); /**< @copydoc put_u8 */
+  void put_u64(uint64_t value); /**< @copydoc put_u8 */
+
+  /**
+   * @brief Appends a move count and the moves in the game log encoding.
+   * @param moves The moves.
+   */
+  void put_moves(const std::vector<Move>& moves);
+
+  /**
+   * @brief Appends a byte count and the received bytes of an unfinished frame.
+   * @param received The bytes, at most 255, try_receive_message() refuses longer frames.
+   */
+  void put_received(std::span<const uint8_t> received);
+};
+
+/**
+ * @brief Reads the fields of a record in the order they were put.
+ * Reading past the end yields zeros and clears ok(), so a record is validated once after parsing.
+ */
+class HandoverReader {
+public:
+  /**
+   * @brief Constructs a reader of a record.
+   * @param record The record.
+   */
+  explicit HandoverReader(const HandoverRecord& record) : record(record) {}
+
+  /**
+   * @brief Reads an unsigned field of 8, 16, 32 or 64 bits.
+   * @return The value, zero past the end of the record.
+   */
+  uint8_t u8();
+  uint16_t u16(); /**< @copydoc u8 */
+  uint32_t u32(); /**< @copydoc u8 */
+  uint64_t u64(); /**< @copydoc u8 */
+
+  /**
+   * @brief Reads a move count and the moves.
+   * @return The moves.
+   */
+  std::vector<Move> moves();
+
+  /**
+   * @brief Reads a byte count and the received bytes of an unfinished frame.
+   * @return The bytes.
+   */
+  std::vector<uint8_t> received();
+
+  /**
+   * @brief Checks that no read ran past the end of the record.
+   * @return True if every field was read from the record.
+   */
+  [[nodiscard]] bool ok() const { return is_ok; }
+
+private:
+  const HandoverRecord& record; /**< The record. */
+  size_t offset = 0; /**< The offset of the next field. */
+  bool is_ok = true; /**< Whether every read stayed within the record. */
+};
@@ -0,0 +1,171 @@
+/**
+ * @file hot_restart.h
+ * @brief Contains the declaration of the hand-over of a running server to a new server process.
+ */
+
+#pragma once
+
+#include "handover_record.h"
+#include "socket.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct SessionEvents;
+enum SessionEvent : uint32_t;
+
+/**
+ * @brief Path of the Unix socket a running server accepts its successor on, relative to the working directory.
+ */
+constexpr const char* UPGRADE_SOCKET_PATH = "checkers-tcp-server.upgrade";
+
+/**
+ * @brief Version of the hand-over records, a successor speaking another version is turned away.
+ */
+constexpr uint8_t HANDOVER_VERSION = 4;
+
+/**
+ * @brief Time running sessions have to hand themselves over, and each side of the channel has to answer.
+ */
+constexpr auto HANDOVER_TIMEOUT = std::chrono::seconds(5);
+
+/**
+ * @brief Adopts a descriptor received in a record as a non-blocking socket.
+ * @param fd The descriptor.
+ * @return The socket with its peer address.
+ */
+Socket adopt_socket(int fd);
+
+/**
+ * @brief Unix SEQPACKET connection between a running server and its successor.
+ * Each record is one packet, its descriptors travel with it as SCM_RIGHTS.
+ */
+class HandoverChannel {
+public:
+  /**
+   * @brief Takes ownership of a connected descriptor.
+   * @param fd The descriptor.
+   */
+  explicit HandoverChannel(int fd) : fd(fd) {}
+
+  /**
+   * @brief Connects to the server accepting successors on a path.
+   * @param path The path of the upgrade socket.
+   * @return The channel.
+   * @throws std::runtime_error if nothing accepts on the path.
+   */
+  static HandoverChannel connect(const char* path);
+
+  /**
+   * @brief Closes the connection.
+   */
+  ~HandoverChannel();
+
+  HandoverChannel(HandoverChannel&& other) noexcept : fd(std::exchange(other.fd, -1)) {}
+  HandoverChannel(const HandoverChannel&) = delete;
+  HandoverChannel& operator=(const HandoverChannel&) = delete;
+
+  /**
+   * @brief Sends a record with its descriptors. The descriptors stay open in this process.
+   * @param record The record.
+   * @throws std::runtime_error if the record could not be sent.
+   */
+  void send(const HandoverRecord& record);
+
+  /**
+   * @brief Receives the next record.
+   * @return The record, its descriptors are owned by the caller.
+   * @throws std::runtime_error if the connection failed, closed or the record was truncated.
+   */
+  HandoverRecord receive();
+
+  /**
+   * @brief Bounds how long receive() waits for the next record.
+   * @param timeout The maximum time to wait, zero waits forever.
+   * @throws std::runtime_error if the timeout could not be set.
+   */
+  void set_receive_timeout(std::chrono::milliseconds timeout);
+
+  /**
+   * @brief Gets the connected descriptor, to poll it for the next record.
+   * @return The descriptor.
+   */
+  [[nodiscard]] int descriptor() const { return fd; }
+
+private:
+  int fd = -1; /**< The connected descriptor. */
+};
+
+/**
+ * @brief Opens the socket successors connect to, replacing a stale one.
+ * @param path The path of the upgrade socket.
+ * @return The listening descriptor.
+ * @throws std::runtime_error if the socket could not be opened.
+ */
+int open_upgrade_listener(const char* path);
+
+/**
+ * @brief Collects the state of the running game sessions when the server hands over.
+ *
+ * Sessions enroll when they start and leave when they end. A hand-over posts HANDOVER to
+ * every enrolled session; a session stops at its next poll, leaves with a record of its game
+ * and its sockets, and no longer touches them. Sessions enrolling during a hand-over are asked
+ * right away. The enrolled sessions are also the games a draining server waits for.
+ */
+class SessionHandover {
+public:
+  /**
+   * @brief Enrolls a running session.
+   * @param events The events of the session.
+   * @return The ticket the session leaves with.
+   */
+  uint64_t enroll(const std::shared_ptr<SessionEvents>& events);
+
+  /**
+   * @brief Removes a session that ended, or stopped to hand its game over.
+   * @param ticket The ticket of the session.
+   * @param record The record of the game, nothing if the game ended.
+   */
+  void leave(uint64_t ticket, std::optional<HandoverRecord> record);
+
+  /**
+   * @brief Asks every session to hand its game over and waits for all of them to leave.
+   * @param timeout The maximum time to wait.
+   * @return The records of the handed over games.
+   */
+  std::vector<HandoverRecord> collect(std::chrono::milliseconds timeout);
+
+  /**
+   * @brief Posts an event to every enrolled session and to every session enrolling later.
+   * @param event The event.
+   */
+  void post_to_all(SessionEvent event);
+
+  /**
+   * @brief Stops posting an event to sessions enrolling later, once a hand-over failed and the games run here again.
+   * @param event The event.
+   * @return The records of the sessions that handed over after collect() gave up waiting.
+   */
+  std::vector<HandoverRecord> withdraw(SessionEvent event);
+
+  /**
+   * @brief Gets the number of enrolled sessions.
+   * @return The number of running games.
+   */
+  size_t running() const;
+
+private:
+  mutable std::mutex mutex; /**< Guards the members. */
+  std::condition_variable session_left; /**< Signalled when a session leaves. */
+  std::unordered_map<uint64_t, std::weak_ptr<SessionEvents>> sessions; /**< The enrolled sessions by ticket. */
+  std::vector<HandoverRecord> records; /**< The records of the sessions that handed over. */
+  uint64_t next_ticket = 0; /**< The ticket of the next enrolled session. */
+  uint32_t sticky_events = 0; /**< The events posted to sessions as they enroll. */
+};
@@ -0,0 +1,109 @@
+/**
+ * @file lobby_id_allocator.h
+ * @brief Contains the declaration of the allocator of lobby and game IDs.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+struct HandoverRecord;
+class HandoverReader;
+
+/**
+ * @brief Allocates unguessable, collision-free lobby IDs without system calls.
+ *
+ * An ID is a shard number in the top SHARD_BITS bits and a per-shard counter, run through a
+ * keyed Feistel permutation, in the remaining bits. The permutation is a bijection, so IDs of
+ * one shard never collide until its counter wraps after 2^28 allocations, and without the key
+ * an ID says nothing about the next one. The key is drawn once at construction. The shard is
+ * mixed into every round, so the shards permute their counters differently and the n-th IDs
+ * of two shards don't share their low bits.
+ *
+ * The shard of an ID is readable without the key, so a join can be routed to the shard that
+ * owns the lobby without looking it up anywhere else. Each shard has its own counter, so
+ * allocating in different shards doesn't share a cache line.
+ */
+class LobbyIdAllocator {
+public:
+  /**
+   * @brief Number of bits of an ID holding the shard.
+   */
+  static constexpr unsigned SHARD_BITS = 4;
+
+  /**
+   * @brief Number of shards.
+   */
+  static constexpr unsigned SHARDS = 1u << SHARD_BITS;
+
+  /**
+   * @brief Number of bits of an ID holding the permuted counter.
+   */
+  static constexpr unsigned COUNTER_BITS = 32 - SHARD_BITS;
+
+  /**
+   * @brief Constructs an allocator with a random key.
+   */
+  LobbyIdAllocator();
+
+  /**
+   * @brief Constructs an allocator with a given key, e.g. for reproducible tests.
+   * @param key The key of the permutation.
+   */
+  explicit LobbyIdAllocator(uint64_t key);
+
+  /**
+   * @brief Allocates the next ID of a shard.
+   * @param shard The shard, less than SHARDS.
+   * @return The non-zero ID.
+   */
+  uint32_t allocate(unsigned shard);
+
+  /**
+   * @brief Gets the shard that allocated an ID.
+   * @param id The ID.
+   * @return The shard.
+   */
+  static constexpr unsigned shard_of(uint32_t id) { return id >> COUNTER_BITS; }
+
+  /**
+   * @brief Writes the key and the counters to a hand-over record, so the next process continues the sequences.
+   * @param record The record.
+   */
+  void save(HandoverRecord& record) const;
+
+  /**
+   * @brief Continues the sequences written by save().
+   * Must not run concurrently with allocate().
+   * @param reader The reader of the record.
+   */
+  void load(HandoverReader& reader);
+
+private:
+  /**
+   * @brief Permutes a counter value with the keyed Feistel network.
+   * @param counter The counter value, less than 2^COUNTER_BITS.
+   * @param shard The shard, it selects one of SHARDS permutations.
+   * @return The permuted value, less than 2^COUNTER_BITS.
+   */
+  uint32_t permute(uint32_t counter, unsigned shard) const;
+
+  /**
+   * @brief Derives the round keys from the key.
+   * @param new_key The key.
+   */
+  void set_key(uint64_t new_key);
+
+  /**
+   * @brief The counter of a shard, on its own cache line.
+   */
+  struct alignas(64) Shard {
+    std::atomic<uint32_t> counter = 0; /**< The number of IDs allocated in the shard. */
+  };
+
+  uint64_t key = 0; /**< The key of the permutation. */
+  std::array<uint64_t, 4> round_keys{}; /**< The keys of the Feistel rounds. */
+  std::array<Shard, SHARDS> shards; /**< The counters of the shards. */
+};
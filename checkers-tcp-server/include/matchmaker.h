@@ -0,0 +1,107 @@
+/**
+ * @file matchmaker.h
+ * @brief Contains the declaration of the rating-bucketed matchmaking queue.
+ */
+
+#pragma once
+
+#include "message.h"
+#include "socket.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Quick-play queue pairing anonymous players of a similar rating.
+ *
+ * Joins only lock the bucket of their rating. A dedicated thread drains all buckets every
+ * PAIRING_INTERVAL and pairs the waiting players in batches, oldest first. A player left
+ * alone in a bucket for CROSS_BUCKET_WAIT is also paired with the neighbouring bucket.
+ * Players that hang up while queued are dropped, players nobody was found for within
+ * QUEUE_TIMEOUT get LOBBY_EXPIRED.
+ */
+class Matchmaker {
+public:
+  using Clock = std::chrono::steady_clock;
+  /**
+   * @brief Starts the game of a pair, the first player plays white.
+   */
+  using StartGame = std::function<void(Socket, Socket)>;
+
+  static constexpr uint16_t DEFAULT_RATING = 1200; /**< Rating of players that don't send one. */
+  static constexpr uint16_t BUCKET_WIDTH = 100; /**< Rating points per bucket. */
+  static constexpr size_t BUCKET_COUNT = 32; /**< Number of buckets, the last one takes all higher ratings. */
+  static constexpr auto PAIRING_INTERVAL = std::chrono::milliseconds(5); /**< Time between pairing batches. */
+  static constexpr auto CROSS_BUCKET_WAIT = std::chrono::seconds(3); /**< Wait after which neighbours pair. */
+  static constexpr auto QUEUE_TIMEOUT = std::chrono::minutes(2); /**< Wait after which a player gives up. */
+
+  /**
+   * @brief Constructs a Matchmaker and starts its pairing thread.
+   * @param start_game Called on the pairing thread for every pair.
+   */
+  explicit Matchmaker(StartGame start_game);
+
+  /**
+   * @brief Stops the pairing thread and closes the sockets of queued players.
+   */
+  ~Matchmaker();
+
+  /**
+   * @brief Stops pairing and turns the queued players away. Does nothing once stopped.
+   * @param reason The error sent to the queued players.
+   */
+  void stop(ErrorType reason);
+
+  Matchmaker(const Matchmaker&) = delete;
+  Matchmaker& operator=(const Matchmaker&) = delete;
+
+  /**
+   * @brief Queues a player for the next pairing batch.
+   * @param socket The socket of the player.
+   * @param rating The rating of the player.
+   */
+  void enqueue(Socket socket, uint16_t rating);
+
+  /**
+   * @brief Gets the number of players waiting for an opponent.
+   * @return The number of queued players.
+   */
+  [[nodiscard]] size_t queued() const { return queued_count; }
+
+private:
+  /**
+   * @brief A player waiting for an opponent.
+   */
+  struct Entry {
+    Socket socket; /**< The socket of the player. */
+    Clock::time_point enqueued_at; /**< The time the player joined the queue. */
+  };
+
+  /**
+   * @brief Players of one rating range.
+   */
+  struct Bucket {
+    std::mutex mutex; /**< Guards incoming. */
+    std::vector<Entry> incoming; /**< Players queued since the last batch. */
+    std::vector<Entry> waiting; /**< Unpaired players, only touched by the pairing thread. */
+  };
+
+  void run();
+  void pair_batch(Clock::time_point now);
+  void start(Entry& white, Entry& black);
+  void drop(Entry& entry, bool expired);
+  static size_t bucket_index(uint16_t rating);
+  static bool is_alive(const Socket& socket);
+
+  StartGame start_game; /**< Starts the game of a pair. */
+  std::array<Bucket, BUCKET_COUNT> buckets; /**< The queued players by rating. */
+  std::atomic<size_t> queued_count = 0; /**< The number of queued players. */
+  std::atomic<bool> stopping = false; /**< Set when the matchmaker shuts down. */
+  std::thread pairing_thread; /**< The thread pairing the players. */
+};
@@ -4,16 +4,31 @@
  */
 #pragma once
 
+#include "board.h"
 #include "socket.h"
 #include "message.h"
 
+#include <cstdint>
+#include <span>
+
 /**
- * @brief Receives a message from the socket and stores it in the message storage.
- * 
+ * @brief The capabilities this server grants to clients that ask for them.
+ */
+constexpr uint32_t SERVER_CAPABILITIES = CAPABILITY_MOVE_BATCH | CAPABILITY_PING;
+
+/**
+ * @brief Receives a message without blocking, player connections are non-blocking.
+ *
+ * Only the bytes the socket has ready are read, and never past the end of the next frame, so the
+ * bytes of later frames stay in the socket for a session thread that takes the connection over.
  * @param socket The socket to receive the message from.
+ * @param decoder The decoder keeping the bytes of an unfinished frame between calls.
  * @param message_storage The storage to store the received message.
+ * @param version The protocol version of the frame.
+ * @return True if a message was stored, false if the frame isn't complete yet.
+ * @throws std::runtime_error if the peer closed the connection, the frame is malformed or the payload doesn't fit.
  */
-void receive_message(const Socket& socket, MessageStorage& message_storage);
+bool try_receive_message(const Socket& socket, FrameDecoder& decoder, MessageStorage& message_storage, uint8_t version);
 
 /**
  * @brief Sends a message through the socket.
@@ -23,6 +38,38 @@ void receive_message(const Socket& socket, MessageStorage& message_storage);
  */
 void send_message(Socket &socket, const MessageStorage &message_storage);
 
+/**
+ * @brief Sends moves through the socket, batched into MOVE_BATCH frames if the client negotiated them.
+ * 
+ * @param socket The socket to send the moves through.
+ * @param moves The moves, in order.
+ */
+void send_moves(Socket &socket, std::span<const Move> moves);
+
+/**
+ * @brief Answers a HELLO and switches the socket to the negotiated protocol version and capabilities.
+ * 
+ * @param socket The socket of the client.
+ * @param hello The HELLO received from the client.
+ */
+void negotiate_protocol(Socket &socket, const MessageStorage &hello);
+
+/**
+ * @brief Sends a PING through the socket.
+ * 
+ * @param socket The socket to send the message through.
+ * @param timestamp The timestamp the peer echoes in its PONG.
+ */
+void send_ping(Socket &socket, uint64_t timestamp);
+
+/**
+ * @brief Answers a PING with a PONG through the socket.
+ * 
+ * @param socket The socket to send the message through.
+ * @param ping The received PING, its timestamp is echoed.
+ */
+void send_pong(Socket &socket, const MessageStorage &ping);
+
 /**
  * @brief Sends a lobby created message through the socket.
  * 
@@ -36,38 +83,40 @@ void send_lobby_created(Socket &socket, uint32_t lobby_id);
  * 
  * @param socket The socket to send the message through.
  * @param game_flags The flags indicating the game settings.
+ * @param resume_token The resume token of the player, 0 if the game can't be resumed.
  */
-void send_game_started(Socket &socket, GameFlags game_flags);
+void send_game_started(Socket &socket, GameFlags game_flags, uint64_t resume_token = 0);
 
 /**
- * @brief Sends an error message through the socket.
+ * @brief Sends the remaining clock times of both players through the socket.
  * 
  * @param socket The socket to send the message through.
- * @param error_type The type of the error.
+ * @param white_ms The remaining time of white in milliseconds.
+ * @param black_ms The remaining time of black in milliseconds.
  */
-void send_error(Socket &socket, ErrorType error_type);
+void send_clock(Socket &socket, uint32_t white_ms, uint32_t black_ms);
 
 /**
- * @brief Receives a handshake result from the socket.
+ * @brief Sends an error message through the socket.
  * 
- * @param socket The socket to receive the handshake result from.
- * @return The received handshake result.
+ * @param socket The socket to send the message through.
+ * @param error_type The type of the error.
  */
-struct HandshakeResult receive_handshake(const Socket &socket);
+void send_error(Socket &socket, ErrorType error_type);
 
 /**
- * @brief Overloads the << operator to output the contents of the message storage to the output stream.
+ * @brief Sends a game over message through the socket.
  * 
- * @param os The output stream.
- * @param message_storage The message storage to output.
- * @return The modified output stream.
+ * @param socket The socket to send the message through.
+ * @param winner The color of the winner, BOTH for a draw.
+ * @param reason Why the game ended.
  */
-std::ostream& operator<<(std::ostream& os, const MessageStorage& message_storage);
+void send_game_over(Socket &socket, Color winner, GameOverReason reason);
 
 /**
- * @brief Converts the message storage to a string representation.
+ * @brief Parses a received handshake message.
  * 
- * @param message The message storage to convert.
- * @return The string representation of the message storage.
+ * @param message_storage The handshake message.
+ * @return The handshake result.
  */
-std::string message_to_string(const MessageStorage& message);
+struct HandshakeResult parse_handshake(const MessageStorage &message_storage);
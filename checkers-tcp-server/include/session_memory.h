@@ -0,0 +1,157 @@
+/**
+ * @file session_memory.h
+ * @brief Contains the slab pool game sessions are allocated from and the thread they run on.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Stack size of session threads, which run the games against the bot. A session only
+ * polls, formats messages and checks moves, so it needs a fraction of the default 8 MiB.
+ */
+constexpr size_t SESSION_STACK_SIZE = 256 * 1024;
+
+/**
+ * @brief Starts a detached thread with a SESSION_STACK_SIZE stack.
+ * @param routine The routine the thread runs.
+ * @throws std::runtime_error if the thread could not be started.
+ */
+void start_session_thread(std::function<void()> routine);
+
+/**
+ * @brief Fixed-size slots for objects of one type, carved out of slabs of SLAB_SLOTS slots.
+ *
+ * Freed slots go to a free list and are reused before a new slab is allocated, so a
+ * server that once held N games keeps their memory for the next N instead of returning
+ * it to the allocator. Objects are constructed and destroyed outside the lock; the lock
+ * is only taken once when a game starts and once when it ends. Each session worker owns
+ * a pool, so the lock is never contended.
+ * @tparam T The type of the objects.
+ */
+template <typename T>
+class SlabPool {
+public:
+  /**
+   * @brief Number of slots in a slab.
+   */
+  static constexpr size_t SLAB_SLOTS = 64;
+
+  /**
+   * @brief Destroys an object and returns its slot to the pool.
+   */
+  struct Deleter {
+    SlabPool* pool; /**< The pool the object was created in. */
+
+    /**
+     * @brief Destroys an object and returns its slot to the pool.
+     * @param object The object.
+     */
+    void operator()(T* object) const { pool->destroy(object); }
+  };
+
+  /**
+   * @brief Owning pointer to an object of the pool, reclaimed when it goes out of scope.
+   */
+  using Ptr = std::unique_ptr<T, Deleter>;
+
+  /**
+   * @brief Constructs an object in a free slot.
+   * @param args The constructor arguments.
+   * @return The owning pointer to the object.
+   */
+  template <typename... Args>
+  Ptr create(Args&&... args) {
+    Slot* slot = acquire();
+    try {
+      return Ptr(new (slot->storage) T(std::forward<Args>(args)...), Deleter{this});
+    } catch (...) {
+      release(slot);
+      throw;
+    }
+  }
+
+  /**
+   * @brief Gets the number of live objects.
+   * @return The number of live objects.
+   */
+  size_t live() const {
+    std::scoped_lock<std::mutex> lock(mutex);
+    return live_count;
+  }
+
+  /**
+   * @brief Gets the memory held by the slabs, in use or free.
+   * @return The size of all slabs in bytes.
+   */
+  size_t reserved_bytes() const {
+    std::scoped_lock<std::mutex> lock(mutex);
+    return slabs.size() * SLAB_SLOTS * sizeof(Slot);
+  }
+
+  /**
+   * @brief Gets the memory of a slot, the cost of an object without what it allocates itself.
+   * @return The size of a slot in bytes.
+   */
+  static constexpr size_t slot_bytes() { return sizeof(Slot); }
+
+private:
+  /**
+   * @brief Storage for one object, or the link to the next free slot.
+   */
+  union Slot {
+    Slot* next_free; /**< The next free slot while the slot is free. */
+    alignas(T) unsigned char storage[sizeof(T)]; /**< The object while the slot is in use. */
+  };
+
+  /**
+   * @brief Takes a free slot, allocating a slab if there is none.
+   * @return The slot.
+   */
+  Slot* acquire() {
+    std::scoped_lock<std::mutex> lock(mutex);
+    if (free_slots == nullptr) {
+      auto& slab = slabs.emplace_back(std::make_unique<Slot[]>(SLAB_SLOTS));
+      for (size_t i = SLAB_SLOTS; i-- > 0;) {
+        slab[i].next_free = free_slots;
+        free_slots = &slab[i];
+      }
+    }
+    Slot* slot = free_slots;
+    free_slots = slot->next_free;
+    ++live_count;
+    return slot;
+  }
+
+  /**
+   * @brief Puts a slot back on the free list.
+   * @param slot The slot.
+   */
+  void release(Slot* slot) {
+    std::scoped_lock<std::mutex> lock(mutex);
+    slot->next_free = free_slots;
+    free_slots = slot;
+    --live_count;
+  }
+
+  /**
+   * @brief Destroys an object and releases its slot.
+   * @param object The object.
+   */
+  void destroy(T* object) {
+    object->~T();
+    release(reinterpret_cast<Slot*>(object));
+  }
+
+  mutable std::mutex mutex; /**< Guards the slabs, the free list and the live count. */
+  std::vector<std::unique_ptr<Slot[]>> slabs; /**< The slabs, never freed before the pool. */
+  Slot* free_slots = nullptr; /**< The head of the free list. */
+  size_t live_count = 0; /**< The number of slots in use. */
+};
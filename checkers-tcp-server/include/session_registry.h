@@ -0,0 +1,55 @@
+/**
+ * @file session_registry.h
+ * @brief Contains the declaration of the registry mapping resume tokens to running game sessions.
+ */
+
+#pragma once
+
+#include "socket.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+struct SessionEvents;
+
+/**
+ * @brief Maps the resume tokens issued at GAME_STARTED to the sessions that issued them.
+ *
+ * Sessions register their tokens while running; a RESUME_SESSION handshake hands the new
+ * socket to the session thread through its SessionEvents.
+ */
+class SessionRegistry {
+public:
+  /**
+   * @brief Generates an unguessable, non-zero resume token.
+   * @return The resume token.
+   */
+  static uint64_t generate_token();
+
+  /**
+   * @brief Registers a resume token of a session.
+   * @param token The resume token.
+   * @param events The events of the session.
+   */
+  void add(uint64_t token, const std::shared_ptr<SessionEvents>& events);
+
+  /**
+   * @brief Unregisters a resume token.
+   * @param token The resume token.
+   */
+  void remove(uint64_t token);
+
+  /**
+   * @brief Hands a reconnected socket to the session that issued the token.
+   * @param token The resume token.
+   * @param socket The reconnected socket.
+   * @return True if the session is running and took the socket, false otherwise.
+   */
+  bool resume(uint64_t token, Socket socket);
+
+private:
+  std::mutex mutex; /**< Guards sessions. */
+  std::unordered_map<uint64_t, std::weak_ptr<SessionEvents>> sessions; /**< The registered sessions by token. */
+};
@@ -0,0 +1,101 @@
+/**
+ * @file session_snapshots.h
+ * @brief Contains the memory-mapped file running games are snapshotted to, so they survive a server crash.
+ */
+
+#pragma once
+
+#include "hot_restart.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Path of the snapshot file, relative to the working directory.
+ */
+constexpr const char* SNAPSHOT_FILE_PATH = "checkers-tcp-server.snapshots";
+
+/**
+ * @brief Fixed-size slots of a shared file mapping, one per running game.
+ *
+ * A game writes its state into its slot after every move with plain stores into the mapping.
+ * Nothing is synced: the kernel keeps the dirty pages when the process dies and writes them back
+ * on its own, so a crashed server loses nothing, only a crash of the machine loses recent moves.
+ *
+ * A slot holds two copies written alternately, each with a generation and a checksum. A process
+ * dying in the middle of a write leaves a copy whose checksum doesn't match, and recovery takes
+ * the other copy, one move older.
+ */
+class SessionSnapshots {
+public:
+  static constexpr size_t SLOT_COUNT = 1024; /**< Number of games that can be snapshotted at once. */
+  static constexpr size_t SLOT_BYTES = 4096; /**< Size of a slot, both copies. */
+  static constexpr size_t NO_SLOT = SIZE_MAX; /**< Slot index of a game that isn't snapshotted. */
+
+  /**
+   * @brief Opens the snapshot file, creating or resetting it if it doesn't have the expected layout.
+   * The slots are kept for recover().
+   * @param path The path of the file.
+   * @throws std::runtime_error if the file could not be opened or mapped.
+   */
+  explicit SessionSnapshots(const char* path);
+
+  /**
+   * @brief Unmaps the file. The slots stay in the file.
+   */
+  ~SessionSnapshots();
+
+  SessionSnapshots(const SessionSnapshots&) = delete;
+  SessionSnapshots& operator=(const SessionSnapshots&) = delete;
+
+  /**
+   * @brief Reads the games left by a previous process and clears their slots.
+   * Slots written before the machine rebooted are dropped, their monotonic times are meaningless.
+   * @return The snapshots as HANDOVER_GAME records.
+   */
+  std::vector<HandoverRecord> recover();
+
+  /**
+   * @brief Takes a free slot.
+   * @return The index of the slot, NO_SLOT if all slots are taken.
+   */
+  size_t acquire();
+
+  /**
+   * @brief Writes a snapshot into a slot, over the older of its copies.
+   * @param slot The index of the slot.
+   * @param record The snapshot.
+   * @return True if the snapshot was written, false if it is larger than a copy.
+   */
+  bool write(size_t slot, const HandoverRecord& record);
+
+  /**
+   * @brief Clears a slot and returns it to the free slots.
+   * @param slot The index of the slot.
+   */
+  void release(size_t slot);
+
+private:
+  /**
+   * @brief Header of one copy of a slot, followed by the snapshot bytes.
+   */
+  struct CopyHeader {
+    uint64_t generation; /**< Incremented by every write of the slot, 0 if the copy is empty. */
+    uint32_t length; /**< The number of snapshot bytes. */
+    uint32_t checksum; /**< The checksum of the generation, the length and the snapshot bytes. */
+  };
+
+  static constexpr size_t COPY_BYTES = SLOT_BYTES / 2; /**< Size of a copy, header included. */
+  static constexpr size_t MAX_SNAPSHOT_BYTES = COPY_BYTES - sizeof(CopyHeader); /**< Largest snapshot. */
+
+  CopyHeader* copy(size_t slot, size_t index) const;
+  static uint32_t checksum(uint64_t generation, const uint8_t* bytes, uint32_t length);
+
+  uint8_t* mapping = nullptr; /**< The mapped file: a header page followed by the slots. */
+  bool is_same_boot = false; /**< Whether the slots were written since the machine booted. */
+  size_t mapping_size = 0; /**< The size of the mapping. */
+  std::mutex mutex; /**< Guards free_slots. */
+  std::vector<size_t> free_slots; /**< The indices of the slots no game writes to. */
+};
@@ -0,0 +1,167 @@
+/**
+ * @file session_workers.h
+ * @brief Contains the declaration of the worker threads running the game sessions.
+ */
+
+#pragma once
+
+#include "game_session.h"
+#include "hot_restart.h"
+#include "session_memory.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Runs game sessions on one thread and owns their memory.
+ *
+ * The games of a worker are allocated from its own SlabPool and stay on the worker until they
+ * end. Their player sockets and event fds are watched by the epoll instance of the worker, and a
+ * game is served only when one of them is ready. Sessions never block on a read, so a game parked
+ * between moves costs its slab slot, what it allocates and the bookkeeping of the worker, and no
+ * thread. A send to a peer that stopped reading can still hold the worker for Socket::SEND_TIMEOUT.
+ */
+class SessionWorker {
+public:
+  /**
+   * @brief Creates a session in the pool of the worker, on the worker thread.
+   * It returns null if the session could not be created, after releasing what it was given; the game is
+   * finished right away then.
+   */
+  using Factory = std::function<SlabPool<SessionData>::Ptr(SlabPool<SessionData>&)>;
+
+  /**
+   * @brief Maximum number of ready descriptors taken from the epoll instance at once.
+   */
+  static constexpr int MAX_READY = 64;
+
+  /**
+   * @brief Constructs a SessionWorker and starts its thread.
+   * @param handover The collector the games enroll in.
+   * @throws std::runtime_error if the epoll instance or the eventfd could not be created.
+   */
+  explicit SessionWorker(SessionHandover& handover);
+
+  /**
+   * @brief Stops the worker thread. Games still running are abandoned like the threads of a process that exits.
+   */
+  ~SessionWorker();
+
+  SessionWorker(const SessionWorker&) = delete;
+  SessionWorker& operator=(const SessionWorker&) = delete;
+
+  /**
+   * @brief Queues a game to be created and run by the worker.
+   * @param create Creates the session.
+   * @param is_exit Flag ending the game from outside, it must outlive the game. Null if only the game ends itself.
+   * @param on_finished Called on the worker thread once the game ended or was handed over.
+   */
+  void start(Factory create, std::atomic<bool>* is_exit, std::function<void()> on_finished);
+
+  /**
+   * @brief Gets the number of games started on the worker and not finished yet.
+   * @return The number of games.
+   */
+  [[nodiscard]] size_t game_count() const {
+    const size_t finished = games_finished;
+    return games_started - finished;
+  }
+
+  /**
+   * @brief Gets the memory the worker spends on a game besides its session: the entry of the game and the
+   * entries of its three watched descriptors, without the overhead of the allocator.
+   * @return The size in bytes.
+   */
+  static size_t bookkeeping_bytes();
+
+private:
+  /**
+   * @brief A game run by the worker.
+   */
+  struct Game {
+    SlabPool<SessionData>::Ptr session; /**< The session, allocated from the pool of the worker. */
+    std::atomic<bool> own_exit = false; /**< The exit flag of a game nobody ends from outside. */
+    std::atomic<bool>* is_exit = nullptr; /**< The exit flag of the game. */
+    std::function<void()> on_finished; /**< Called once the game ended or was handed over. */
+    uint64_t ticket = 0; /**< The ticket of the game in the hand-over collector. */
+    int watched[3]{-1, -1, -1}; /**< The descriptors in the epoll instance: both players and the session events. */
+    bool is_woken = false; /**< Whether the game is already queued to be served. */
+  };
+
+  /**
+   * @brief A descriptor in the epoll instance and the slot of the game it belongs to.
+   */
+  struct Watch {
+    Game* game; /**< The game. */
+    size_t slot; /**< The index of the descriptor in the pfds of the session. */
+  };
+
+  /**
+   * @brief A game waiting to be created on the worker thread.
+   */
+  struct QueuedGame {
+    Factory create; /**< Creates the session. */
+    std::atomic<bool>* is_exit; /**< The exit flag, null if the game has its own. */
+    std::function<void()> on_finished; /**< Called once the game ended or was handed over. */
+  };
+
+  void run();
+  void create_queued();
+  void serve(Game& game);
+  void watch(Game& game);
+  void finish(Game& game, std::optional<HandoverRecord> record);
+
+  SessionHandover& handover; /**< The collector the games enroll in. */
+  SlabPool<SessionData> pool; /**< The sessions of the games of the worker. */
+  int epoll_fd = -1; /**< The epoll instance watching the descriptors of all games. */
+  int wake_fd = -1; /**< The eventfd waking the worker for queued games or to stop. */
+  std::mutex mutex; /**< Guards queued. */
+  std::vector<QueuedGame> queued; /**< The games waiting to be created. */
+  std::unordered_map<SessionData*, Game> games; /**< The running games by session. */
+  std::unordered_map<int, Watch> watches; /**< The watched descriptors. */
+  std::vector<Game*> woken; /**< The games to serve after the current epoll_wait(). */
+  std::atomic<size_t> games_started = 0; /**< The number of games queued so far. */
+  std::atomic<size_t> games_finished = 0; /**< The number of games that ended, were handed over or failed to start. */
+  std::atomic<bool> stopping = false; /**< Set when the worker shuts down. */
+  std::thread worker_thread; /**< The thread serving the games. */
+};
+
+/**
+ * @brief The workers running all game sessions between players, so a game costs no thread of its own.
+ * Games against the bot still run on a session thread each, see bot_session.h.
+ */
+class SessionWorkers {
+public:
+  /**
+   * @brief Constructs the workers and starts their threads.
+   * @param worker_count The number of workers, at least one is started.
+   * @param handover The collector the games enroll in.
+   */
+  SessionWorkers(unsigned worker_count, SessionHandover& handover);
+
+  /**
+   * @brief Starts a game on the worker running the fewest games.
+   * @param create Creates the session on the worker thread.
+   * @param is_exit Flag ending the game from outside, it must outlive the game. Null if only the game ends itself.
+   * @param on_finished Called on the worker thread once the game ended or was handed over.
+   */
+  void start(SessionWorker::Factory create, std::atomic<bool>* is_exit = nullptr,
+             std::function<void()> on_finished = {});
+
+  /**
+   * @brief Gets the number of workers.
+   * @return The number of workers.
+   */
+  [[nodiscard]] size_t size() const { return workers.size(); }
+
+private:
+  std::vector<std::unique_ptr<SessionWorker>> workers; /**< The workers. */
+};
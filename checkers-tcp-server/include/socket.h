@@ -1,5 +1,9 @@
 #pragma once
 
+#include "frame.h"
+
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <netdb.h>
 
@@ -10,6 +14,11 @@
 class Socket
 {
 public:
+    /**
+     * @brief How long sendAll() waits for a peer that stopped reading.
+     */
+    static constexpr std::chrono::milliseconds SEND_TIMEOUT{5000};
+
     /**
      * @brief Default constructor for Socket class.
      */
@@ -72,7 +81,7 @@ public:
     [[nodiscard]] Socket accept() const;
 
     /**
-     * @brief Send data on the socket.
+     * @brief Send data on the socket. On a non-blocking socket it waits up to SEND_TIMEOUT for room.
      * @param buf The buffer containing the data to send.
      * @param len The length of the data to send.
      * @return The number of bytes sent.
@@ -87,12 +96,46 @@ public:
      */
     size_t receiveAll(unsigned char *buf, int len) const;
 
+    /**
+     * @brief Make receive and send operations return instead of blocking, see sendAll().
+     */
+    void setNonBlocking();
+
     /**
      * @brief Close the socket.
      */
     void close();
 
+    /**
+     * @brief Get the protocol version negotiated on the connection, see frame.h.
+     * @return The protocol version.
+     */
+    [[nodiscard]] uint8_t getProtocolVersion() const {return protocolVersion;}
+
+    /**
+     * @brief Get the capabilities negotiated on the connection.
+     * @return The Capability flags.
+     */
+    [[nodiscard]] uint32_t getCapabilities() const {return capabilities;}
+
+    /**
+     * @brief Set the protocol negotiated on the connection. Copies made before keep the old protocol.
+     * @param version The protocol version.
+     * @param negotiated The Capability flags.
+     */
+    void setProtocol(uint8_t version, uint32_t negotiated) {protocolVersion = version; capabilities = negotiated;}
+
 private:
+    /**
+     * @brief Store the address of the socket in its compact form.
+     * @param addr The IPv4 or IPv6 address.
+     */
+    void setAddress(const struct sockaddr *addr);
+
     int socketFD = -1; /**< The file descriptor of the socket. */
-    struct sockaddr_storage address; /**< The address of the socket. */
+    uint16_t family = AF_UNSPEC; /**< The address family, AF_INET or AF_INET6. */
+    uint16_t port = 0; /**< The port in network byte order. */
+    unsigned char ip[16]{}; /**< The IPv4 or IPv6 address in network byte order, sockaddr_storage is 128 bytes. */
+    uint32_t capabilities = 0; /**< The Capability flags negotiated with HELLO. */
+    uint8_t protocolVersion = PROTOCOL_V1; /**< The framing of the messages after the handshake. */
 };
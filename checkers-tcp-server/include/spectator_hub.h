@@ -0,0 +1,147 @@
+/**
+ * @file spectator_hub.h
+ * @brief Contains the declaration of the hub fanning out running games to spectators.
+ */
+
+#pragma once
+
+#include "message.h"
+#include "socket.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A message serialized once into its wire format and shared by all watchers.
+ */
+struct BroadcastFrame {
+  uint8_t size = 0; /**< The number of bytes in the frame. */
+  unsigned char bytes[2 + MAX_MESSAGE_LEN]{}; /**< The message type, length and payload. */
+};
+
+/**
+ * @brief Reference-counted frame, queued to every watcher without copying.
+ */
+using SharedFrame = std::shared_ptr<const BroadcastFrame>;
+
+/**
+ * @brief Fans the messages of running games out to their spectators.
+ *
+ * Game sessions publish every message once; the frame is shared by the send queues of all
+ * watchers and written by the hub thread, so a slow or huge audience never stalls the players.
+ * Each game keeps the frames a late joiner needs: GAME_STARTED, the current POSITION and
+ * the last CLOCK. Watchers that fall MAX_QUEUED_FRAMES behind are dropped, and the watchers of a
+ * closed game get CLOSE_LINGER_TIMEOUT to take their last frames.
+ */
+class SpectatorHub {
+public:
+  static constexpr size_t MAX_QUEUED_FRAMES = 256; /**< Send queue length at which a watcher is dropped. */
+  static constexpr auto CLOSE_LINGER_TIMEOUT = std::chrono::seconds(5); /**< Time the watchers of a closed game have to take their last frames. */
+
+  /**
+   * @brief Serializes a message into a shareable frame.
+   * @param message The message.
+   * @return The frame.
+   */
+  static SharedFrame make_frame(const MessageStorage& message);
+
+  /**
+   * @brief Constructs a SpectatorHub and starts its thread.
+   */
+  SpectatorHub();
+
+  /**
+   * @brief Stops the hub thread and disconnects all watchers.
+   */
+  ~SpectatorHub();
+
+  SpectatorHub(const SpectatorHub&) = delete;
+  SpectatorHub& operator=(const SpectatorHub&) = delete;
+
+  /**
+   * @brief Makes a game watchable.
+   * @param game_id The ID spectators join with.
+   * @param position The POSITION frame of the starting position.
+   * @return True if the game was opened, false if the ID is taken.
+   */
+  bool open_channel(uint32_t game_id, SharedFrame position);
+
+  /**
+   * @brief Queues a frame to all watchers of a game.
+   * @param game_id The ID of the game.
+   * @param frame The frame to send.
+   * @param position The POSITION frame after the message, if it changed the position.
+   */
+  void publish(uint32_t game_id, SharedFrame frame, SharedFrame position = nullptr);
+
+  /**
+   * @brief Closes a game, its watchers are disconnected once their queues are flushed.
+   * @param game_id The ID of the game.
+   */
+  void close_channel(uint32_t game_id);
+
+  /**
+   * @brief Adds a watcher to a game and queues the late-join snapshot.
+   * @param game_id The ID of the game.
+   * @param socket The socket of the spectator.
+   * @return True if the game is running, false otherwise.
+   */
+  bool watch(uint32_t game_id, Socket socket);
+
+  /**
+   * @brief Gets the number of connected watchers.
+   * @return The number of watchers.
+   */
+  [[nodiscard]] size_t watcher_count() const { return watcher_total; }
+
+private:
+  /**
+   * @brief A connected spectator.
+   */
+  struct Watcher {
+    Socket socket; /**< The socket of the spectator. */
+    uint32_t game_id = 0; /**< The watched game. */
+    std::deque<SharedFrame> queue; /**< The frames not fully sent yet. */
+    size_t offset = 0; /**< The sent bytes of the front frame. */
+    bool want_write = false; /**< Whether the socket is polled for writability. */
+    bool closing = false; /**< Whether to disconnect once the queue is flushed. */
+    std::chrono::steady_clock::time_point linger_deadline{}; /**< When a watcher of a closed game is dropped with frames left. */
+  };
+
+  /**
+   * @brief The late-join state and the audience of a game.
+   */
+  struct Channel {
+    SharedFrame started; /**< The GAME_STARTED frame for spectators. */
+    SharedFrame position; /**< The current POSITION frame. */
+    SharedFrame clock; /**< The last CLOCK frame, if the game is timed. */
+    std::vector<int> watchers; /**< The file descriptors of the watchers. */
+  };
+
+  void run();
+  void enqueue(int fd, Watcher& watcher, const SharedFrame& frame);
+  void flush(int fd);
+  void set_want_write(int fd, Watcher& watcher, bool want_write);
+  void remove_watcher(int fd);
+  void drop_lingering();
+  [[nodiscard]] int wait_timeout() const;
+  void wake();
+
+  int epoll_fd = -1; /**< The epoll instance watching all spectator sockets. */
+  int wake_fd = -1; /**< The eventfd waking the hub thread. */
+  std::mutex mutex; /**< Guards channels, watchers, dirty and lingering. */
+  std::unordered_map<uint32_t, Channel> channels; /**< The watchable games by ID. */
+  std::unordered_map<int, Watcher> watchers; /**< The watchers by file descriptor. */
+  std::vector<int> dirty; /**< Watchers with newly queued frames. */
+  std::vector<int> lingering; /**< Watchers of closed games, dropped at their linger_deadline. */
+  std::atomic<size_t> watcher_total = 0; /**< The number of watchers. */
+  std::atomic<bool> stopping = false; /**< Set when the hub shuts down. */
+  std::thread hub_thread; /**< The thread writing the send queues. */
+};
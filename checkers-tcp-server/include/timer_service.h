@@ -0,0 +1,92 @@
+/**
+ * @file timer_service.h
+ * @brief Contains the declaration of the thread-safe timer service driven by the server event loop.
+ */
+
+#pragma once
+
+#include "timer_wheel.h"
+
+#include <mutex>
+
+/**
+ * @brief Thread-safe front end of a TimerWheel.
+ *
+ * Timers can be armed and cancelled from any thread. The server event loop polls wake_fd()
+ * with poll_timeout() and calls run_expired(), so callbacks always run on the event loop thread,
+ * outside of the service lock. Callbacks must be short; a callback may still run after cancel()
+ * returned false, so callbacks must not capture objects whose lifetime they don't share.
+ */
+class TimerService {
+public:
+  using Clock = TimerWheel::Clock;
+  using Callback = TimerWheel::Callback;
+  using TimerId = TimerWheel::TimerId;
+
+  /**
+   * @brief Constructs a TimerService and its wake-up eventfd.
+   */
+  TimerService();
+
+  /**
+   * @brief Closes the wake-up eventfd.
+   */
+  ~TimerService();
+
+  TimerService(const TimerService&) = delete;
+  TimerService& operator=(const TimerService&) = delete;
+
+  /**
+   * @brief Arms a timer that expires after the given delay.
+   * @param delay The delay from now.
+   * @param callback The callback to run on the event loop thread.
+   * @return The id of the armed timer.
+   */
+  TimerId arm(Clock::duration delay, Callback callback);
+
+  /**
+   * @brief Arms a timer that expires at the given time point.
+   * @param deadline The expiry time point.
+   * @param callback The callback to run on the event loop thread.
+   * @return The id of the armed timer.
+   */
+  TimerId arm_at(Clock::time_point deadline, Callback callback);
+
+  /**
+   * @brief Cancels a timer.
+   * @param id The id of the timer.
+   * @return True if the timer was cancelled before expiring, false otherwise.
+   */
+  bool cancel(TimerId id);
+
+  /**
+   * @brief Gets the file descriptor the event loop polls to be woken up by earlier timers.
+   * @return The eventfd descriptor.
+   */
+  [[nodiscard]] int wake_fd() const { return event_fd; }
+
+  /**
+   * @brief Gets the poll() timeout until the next timer is due.
+   * @return The timeout in milliseconds, or -1 if no timers are armed.
+   */
+  int poll_timeout();
+
+  /**
+   * @brief Runs the callbacks of all expired timers. Called by the event loop after poll().
+   * @return The number of callbacks run.
+   */
+  size_t run_expired();
+
+  /**
+   * @brief Gets the number of armed timers.
+   * @return The number of armed timers.
+   */
+  size_t size();
+
+private:
+  std::mutex mutex; /**< Guards the wheel and sleeping_until. */
+  TimerWheel wheel; /**< The underlying timer wheel. */
+  Clock::time_point sleeping_until = Clock::time_point::max(); /**< The time point the event loop sleeps until. */
+  std::vector<Callback> expired; /**< Scratch buffer for expired callbacks, used by the event loop only. */
+  int event_fd = -1; /**< The wake-up eventfd. */
+};
@@ -0,0 +1,106 @@
+/**
+ * @file timer_wheel.h
+ * @brief Contains the declaration of the hierarchical timer wheel.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Hierarchical timer wheel with O(1) arm and cancel.
+ *
+ * Four levels of 64 slots each cover 2^24 ticks; timers further away are clamped to the
+ * wheel's horizon. Timers are kept in intrusive lists inside a node pool, so arming and
+ * cancelling never search. The wheel itself is not thread safe, see TimerService.
+ */
+class TimerWheel {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void()>;
+  using TimerId = uint64_t;
+
+  static constexpr TimerId INVALID_TIMER = 0; /**< Id never returned by arm(). */
+  static constexpr uint32_t LEVELS = 4; /**< Number of levels of the wheel. */
+  static constexpr uint32_t SLOT_BITS = 6; /**< Number of bits of the slot index of a level. */
+  static constexpr uint64_t HORIZON = uint64_t(1) << (LEVELS * SLOT_BITS); /**< Number of ticks the levels cover. */
+
+  /**
+   * @brief Constructs a TimerWheel.
+   * @param tick The wheel resolution.
+   * @param start The time point of tick zero.
+   */
+  explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(10), Clock::time_point start = Clock::now());
+
+  /**
+   * @brief Arms a timer. The callback fires on the first tick at or after the deadline, but a
+   * deadline HORIZON - 1 ticks or more away is clamped and fires early, at the horizon.
+   * @param deadline The time point at which the timer expires.
+   * @param callback The callback to run on expiry.
+   * @return The id of the armed timer.
+   */
+  TimerId arm(Clock::time_point deadline, Callback callback);
+
+  /**
+   * @brief Cancels an armed timer.
+   * @param id The id of the timer.
+   * @return True if the timer was armed and is now cancelled, false if it already expired or was cancelled.
+   */
+  bool cancel(TimerId id);
+
+  /**
+   * @brief Advances the wheel and collects the callbacks of expired timers.
+   * @param now The current time.
+   * @param expired The vector the expired callbacks are appended to.
+   * @return The number of expired timers.
+   */
+  size_t advance(Clock::time_point now, std::vector<Callback>& expired);
+
+  /**
+   * @brief Gets the time point at which the wheel next needs to be advanced.
+   * @return The next time point, or Clock::time_point::max() if no timers are armed.
+   */
+  [[nodiscard]] Clock::time_point next_deadline() const;
+
+  /**
+   * @brief Gets the number of armed timers.
+   * @return The number of armed timers.
+   */
+  [[nodiscard]] size_t size() const { return armed_count; }
+
+private:
+  static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+  static constexpr uint32_t SLOT_MASK = SLOTS - 1;
+  static constexpr uint32_t NIL = UINT32_MAX;
+
+  /**
+   * @brief Pool node holding one timer.
+   */
+  struct Node {
+    Callback callback;         /**< The callback to run on expiry. */
+    uint64_t expiry = 0;       /**< The tick at which the timer expires. */
+    uint32_t prev = NIL;       /**< Previous node in the slot list. */
+    uint32_t next = NIL;       /**< Next node in the slot list, or next free node. */
+    uint32_t generation = 0;   /**< Incremented on every reuse to reject stale ids. */
+    uint32_t slot = NIL;       /**< Global slot index (level * SLOTS + slot), NIL when not armed. */
+  };
+
+  void link(uint32_t index);
+  void unlink(uint32_t index);
+  void release(uint32_t index);
+  void cascade(uint32_t level);
+  void step(std::vector<Callback>& expired, size_t& count);
+
+  Clock::duration tick; /**< The wheel resolution. */
+  Clock::time_point origin; /**< The time point of tick zero. */
+  uint64_t current = 0; /**< The last processed tick. */
+  size_t armed_count = 0; /**< The number of armed timers. */
+  std::vector<Node> nodes; /**< The node pool. */
+  uint32_t free_head = NIL; /**< The head of the free node list. */
+  std::array<uint32_t, LEVELS * SLOTS> heads; /**< The heads of the slot lists. */
+  std::array<uint64_t, LEVELS> occupied{}; /**< Bitmask of non-empty slots per level. */
+};
@@ -0,0 +1,83 @@
+/**
+ * @file worker_pool.h
+ * @brief Contains the declaration of the bounded work-stealing worker pool.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size pool of worker threads for CPU-bound jobs such as bot searches.
+ *
+ * Each worker owns a task deque. Submitted tasks are spread round-robin over the deques,
+ * workers take from the front of their own deque and steal from the back of the others.
+ * The number of queued tasks is bounded, so an overloaded pool rejects work instead of
+ * growing without limit. The pool never runs network I/O.
+ */
+class WorkerPool {
+public:
+  using Task = std::function<void()>;
+
+  /**
+   * @brief Constructs a WorkerPool and starts its threads.
+   * @param thread_count The number of worker threads.
+   * @param max_queued The maximum number of tasks waiting to run.
+   */
+  WorkerPool(size_t thread_count, size_t max_queued);
+
+  /**
+   * @brief Stops and joins the worker threads. Queued tasks are dropped.
+   */
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /**
+   * @brief Submits a task.
+   * @param task The task to run.
+   * @return True if the task was queued, false if the pool is full or stopping.
+   */
+  bool submit(Task task);
+
+  /**
+   * @brief Gets the number of tasks waiting to run.
+   * @return The number of queued tasks.
+   */
+  [[nodiscard]] size_t queued() const { return queued_count; }
+
+  /**
+   * @brief Gets the number of worker threads.
+   * @return The number of worker threads.
+   */
+  [[nodiscard]] size_t size() const { return threads.size(); }
+
+private:
+  /**
+   * @brief Per-thread task deque.
+   */
+  struct Worker {
+    std::mutex mutex;          /**< Guards tasks. */
+    std::deque<Task> tasks;    /**< The queued tasks. */
+  };
+
+  void run(size_t index);
+  bool try_take(size_t index, Task& task);
+
+  std::vector<std::unique_ptr<Worker>> workers; /**< The task deques, one per thread. */
+  std::vector<std::thread> threads; /**< The worker threads. */
+  const size_t max_queued; /**< The maximum number of queued tasks. */
+  std::atomic<size_t> queued_count = 0; /**< The number of queued tasks. */
+  std::atomic<size_t> next_worker = 0; /**< Round-robin submit cursor. */
+  std::mutex sleep_mutex; /**< Guards stopping and the idle wait. */
+  std::condition_variable wake; /**< Signalled when tasks are submitted or the pool stops. */
+  bool stopping = false; /**< Set when the pool shuts down. */
+};
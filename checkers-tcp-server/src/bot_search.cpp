@@ -0,0 +1,121 @@
+/**
+ * @file bot_search.cpp
+ * @brief Implementation of the server-side bot move search.
+ */
+
+#include "bot_search.h"
+#include "evaluation.h"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+constexpr int WIN_SCORE = 1000000;
+
+/**
+ * @brief Alpha-beta search state shared by all nodes of one search.
+ */
+struct Search {
+  const BotBudget& budget;
+  const std::atomic<bool>& cancelled;
+  std::chrono::steady_clock::time_point deadline;
+  uint64_t nodes = 0;
+  bool stopped = false;
+
+  /**
+   * @brief Checks the node, time and cancellation limits.
+   * @return True if the search has to stop.
+   */
+  bool out_of_budget() {
+    if (stopped) return true;
+    if (nodes >= budget.max_nodes || cancelled) {
+      stopped = true;
+    } else if ((nodes & 1023) == 0 && std::chrono::steady_clock::now() >= deadline) {
+      stopped = true;
+    }
+    return stopped;
+  }
+
+  /**
+   * @brief Negamax alpha-beta. Hops of a multi-jump keep the side to move, so their score isn't negated.
+   * @param engine The position.
+   * @param depth The remaining depth.
+   * @param alpha The lower bound.
+   * @param beta The upper bound.
+   * @return The score from the point of view of the side to move.
+   */
+  int negamax(const checkers_engine& engine, int depth, int alpha, int beta) {
+    ++nodes;
+    const MoveList moves = engine.valid_moves();
+    if (moves.empty()) return -WIN_SCORE;
+    if (depth <= 0 || out_of_budget()) return evaluate(engine);
+
+    for (const auto& move : moves) {
+      checkers_engine child = engine;
+      child.make_move(move);
+      const int score = child.turn == engine.turn ? negamax(child, depth - 1, alpha, beta)
+                                                  : -negamax(child, depth - 1, -beta, -alpha);
+      if (stopped) return alpha;
+      alpha = std::max(alpha, score);
+      if (alpha >= beta) break;
+    }
+    return alpha;
+  }
+};
+
+}
+
+/**
+ * @brief Gets the search budget of a bot level.
+ * @param level The bot level requested in the handshake, 0 is the weakest.
+ * @return The search budget.
+ */
+BotBudget bot_budget(uint8_t level) {
+  static constexpr std::array<BotBudget, 4> budgets = {{
+    {2, 2000, std::chrono::milliseconds(50)},
+    {4, 20000, std::chrono::milliseconds(100)},
+    {8, 200000, std::chrono::milliseconds(300)},
+    {16, 1000000, std::chrono::milliseconds(1000)},
+  }};
+  return budgets[std::min<size_t>(level, budgets.size() - 1)];
+}
+
+/**
+ * @brief Searches the best move for the side to move with iterative deepening alpha-beta.
+ * @param engine The position to search.
+ * @param budget The search limits.
+ * @param cancelled Flag set by the session when the result is no longer needed.
+ * @return The search result.
+ */
+BotSearchResult find_bot_move(const checkers_engine& engine, const BotBudget& budget, const std::atomic<bool>& cancelled) {
+  BotSearchResult result;
+  MoveList moves = engine.valid_moves();
+  if (moves.empty()) return result;
+  result.move = moves.front();
+  if (moves.size() == 1) return result;
+
+  Search search{budget, cancelled, std::chrono::steady_clock::now() + budget.max_time};
+  for (int depth = 1; depth <= budget.max_depth && !search.stopped; ++depth) {
+    int alpha = -WIN_SCORE - 1;
+    size_t best_index = 0;
+    for (size_t i = 0; i < moves.size(); ++i) {
+      checkers_engine child = engine;
+      child.make_move(moves[i]);
+      const int score = child.turn == engine.turn ? search.negamax(child, depth - 1, alpha, WIN_SCORE + 1)
+                                                  : -search.negamax(child, depth - 1, -WIN_SCORE - 1, -alpha);
+      if (search.stopped) break;
+      if (score > alpha) {
+        alpha = score;
+        best_index = i;
+      }
+    }
+    if (search.stopped) break;
+    // Search the best move first in the next iteration.
+    std::rotate(moves.begin(), moves.begin() + best_index, moves.begin() + best_index + 1);
+    result.move = moves.front();
+    result.depth = depth;
+  }
+  result.nodes = search.nodes;
+  return result;
+}
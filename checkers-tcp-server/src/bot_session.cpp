@@ -0,0 +1,345 @@
+/**
+ * @file bot_session.cpp
+ * @brief Implementation of the game session against the server-side bot.
+ */
+
+#include "bot_session.h"
+
+#include "message_handler.h"
+#include "message_format.h"
+
+#include <spdlog/spdlog.h>
+
+#include <optional>
+#include <stdexcept>
+#include <unistd.h>
+
+/**
+ * @brief Runs the game loop of a bot session until the game ends or is handed over.
+ * @param session The session, destroyed before the session leaves the hand-over.
+ * @param handover The collector of handed over games.
+ * @param greet Whether to send GAME_STARTED first, a handed over game already started.
+ */
+static void run_bot_session(std::unique_ptr<BotSessionData> session, SessionHandover& handover, bool greet) {
+	BotSessionData& session_data = *session;
+	std::atomic<bool> is_exit = false;
+	const uint64_t ticket = handover.enroll(session_data.events);
+	std::optional<HandoverRecord> handover_record;
+	Socket& player_socket = session_data.player_socket;
+	const nfds_t fd_count = 2;
+	MessageStorage incoming_message{};
+
+	try {
+		if (greet) {
+			send_game_started(player_socket, GameFlags::IM_WHITE);
+		}
+
+		while (!is_exit) {
+			if (poll(session_data.pfds, fd_count, -1) == -1) {
+				spdlog::error("Error occurred when polling data.");
+				break;
+			}
+
+			if (session_data.pfds[1].revents & POLLIN) {
+				const uint32_t session_events = session_data.events->take();
+				if (session_events & IDLE_EXPIRED) {
+					spdlog::info("Closing idle bot game session.");
+					send_error(player_socket, SESSION_TIMEOUT);
+					break;
+				}
+				if (session_events & DRAIN_DEADLINE) {
+					spdlog::info("Closing bot game session, the server shuts down.");
+					send_error(player_socket, SERVER_DISCONNECTED);
+					break;
+				}
+				if (session_events & BOT_MOVE_READY) {
+					session_data.play_bot_move(is_exit);
+				}
+				// Unread messages stay in the socket for the next process, an unfinished one goes with the record.
+				if (session_events & HANDOVER && !is_exit) {
+					handover_record = session_data.hand_over();
+					break;
+				}
+			}
+
+			const auto revents = session_data.pfds[0].revents;
+			if (revents & POLLHUP) {
+				spdlog::info("Client closed connection.");
+				break;
+			} else if (revents & POLLIN) {
+				if (try_receive_message(player_socket, session_data.decoder, incoming_message,
+				                        player_socket.getProtocolVersion())) {
+					session_data.touch();
+					session_data.handle_message(incoming_message, is_exit);
+				}
+			} else if (revents) {
+				spdlog::error("Unknown error occurred.");
+				break;
+			}
+		}
+	} catch (const std::exception& e) {
+		spdlog::warn("Bot game session ended: {}", e.what());
+	}
+
+	if (!handover_record) {
+		try {
+			player_socket.close();
+		} catch (const std::exception& e) {
+			spdlog::warn("Failed to close socket: {}", e.what());
+		}
+	}
+	session.reset();
+	handover.leave(ticket, std::move(handover_record));
+}
+
+/**
+ * @brief Game session routine between a player and the server-side bot.
+ * @param player_socket The socket of the human player.
+ * @param bot_level The bot level requested in the handshake.
+ * @param timers The server timer service.
+ * @param bot_pool The pool running bot searches.
+ * @param handover The collector of handed over games.
+ */
+void bot_session_routine(Socket player_socket, uint8_t bot_level, TimerService& timers, WorkerPool& bot_pool,
+                         SessionHandover& handover) {
+	spdlog::info("Started bot game session thread for {} (level {}).", player_socket.getAddressString(), bot_level);
+	run_bot_session(std::make_unique<BotSessionData>(player_socket, bot_level, timers, bot_pool), handover, true);
+}
+
+/**
+ * @brief Function for continuing a bot game handed over by the previous server process.
+ * @param record The HANDOVER_BOT_GAME record.
+ * @param timers The server timer service.
+ * @param bot_pool The pool running bot searches.
+ * @param handover The collector of handed over games.
+ */
+void resumed_bot_session_routine(const HandoverRecord& record, TimerService& timers, WorkerPool& bot_pool,
+                                 SessionHandover& handover) {
+	std::unique_ptr<BotSessionData> session;
+	try {
+		session = std::make_unique<BotSessionData>(record, timers, bot_pool);
+	} catch (const std::exception& e) {
+		spdlog::error("Failed to take over a bot game: {}", e.what());
+		for (const int fd : record.fds) {
+			::close(fd);
+		}
+		return;
+	}
+	spdlog::info("Took over bot game of {} after {} moves.", session->player_socket.getAddressString(),
+	             session->history.size());
+	run_bot_session(std::move(session), handover, false);
+}
+
+/**
+ * @brief Constructs a BotSessionData object.
+ * @param player_socket The socket of the human player.
+ * @param bot_level The bot level requested in the handshake.
+ * @param timers The server timer service.
+ * @param bot_pool The pool running bot searches.
+ */
+BotSessionData::BotSessionData(Socket player_socket, uint8_t bot_level, TimerService& timers, WorkerPool& bot_pool)
+	: player_socket(player_socket), events(std::make_shared<SessionEvents>()), timers(timers), bot_pool(bot_pool),
+	  budget(bot_budget(bot_level)), bot_level(bot_level) {
+	pfds[0].fd = player_socket.getSocketFd();
+	pfds[1].fd = events->fd;
+	pfds[0].events = POLLIN;
+	pfds[1].events = POLLIN;
+	engine.reset();
+	positions.reset(engine);
+	touch();
+}
+
+/**
+ * @brief Constructs a BotSessionData object for a bot game handed over by the previous server process.
+ * The moves are replayed, and the bot searches again if it was to move.
+ * @param record The HANDOVER_BOT_GAME record written by hand_over().
+ * @param timers The server timer service.
+ * @param bot_pool The pool running bot searches.
+ * @throws std::runtime_error if the record is malformed.
+ */
+BotSessionData::BotSessionData(const HandoverRecord& record, TimerService& timers, WorkerPool& bot_pool)
+	: events(std::make_shared<SessionEvents>()), timers(timers), bot_pool(bot_pool) {
+	HandoverReader reader(record);
+	bot_level = reader.u8();
+	history = reader.moves();
+	const uint8_t version = reader.u8();
+	const uint32_t capabilities = reader.u32();
+	decoder.append(reader.received());
+	if (!reader.ok() || record.fds.size() != 1) {
+		throw std::runtime_error("Malformed bot game hand-over record.");
+	}
+	budget = bot_budget(bot_level);
+	player_socket = adopt_socket(record.fds[0]);
+	player_socket.setProtocol(version, capabilities);
+	pfds[0].fd = player_socket.getSocketFd();
+	pfds[1].fd = events->fd;
+	pfds[0].events = POLLIN;
+	pfds[1].events = POLLIN;
+	engine.reset();
+	positions.reset(engine);
+	for (const auto& move : history) {
+		engine.make_move(move);
+		positions.push(engine);
+	}
+	touch();
+	if (engine.turn == BLACK) {
+		request_bot_move();
+	}
+}
+
+/**
+ * @brief Cancels the session timers and the pending bot search.
+ */
+BotSessionData::~BotSessionData() {
+	timers.cancel(idle_timer);
+	if (pending_request) {
+		pending_request->cancelled = true;
+	}
+}
+
+/**
+ * @brief Re-arms the idle disconnect timer.
+ */
+void BotSessionData::touch() {
+	timers.cancel(idle_timer);
+	idle_timer = schedule_session_event(timers, SESSION_IDLE_TIMEOUT, events, IDLE_EXPIRED);
+}
+
+/**
+ * @brief Hands a search of the current position to the bot pool.
+ * If the pool is saturated or stopping the bot plays its first legal move instead of waiting.
+ */
+void BotSessionData::request_bot_move() {
+	auto request = std::make_shared<BotRequest>();
+	request->position = engine;
+	request->budget = budget;
+	request->events = events;
+	pending_request = request;
+
+	const bool queued = bot_pool.submit([request] {
+		request->result = find_bot_move(request->position, request->budget, request->cancelled);
+		if (auto session_events = request->events.lock()) {
+			session_events->post(BOT_MOVE_READY);
+		}
+	});
+	if (!queued) {
+		spdlog::warn("Bot pool is saturated or stopping, playing the first legal move.");
+		const MoveList moves = engine.valid_moves();
+		if (!moves.empty()) {
+			request->result.move = moves.front();
+		}
+		events->post(BOT_MOVE_READY);
+	}
+}
+
+/**
+ * @brief Plays the move found by the finished bot search.
+ * @param is_exit Atomic flag indicating if the session should exit.
+ */
+void BotSessionData::play_bot_move(std::atomic<bool>& is_exit) {
+	if (!pending_request) return;
+	const auto result = pending_request->result;
+	pending_request.reset();
+
+	if (result.move.type == MoveType::INVALID || !engine.is_valid(result.move)) {
+		spdlog::info("Bot has no moves left and resigns.");
+		send_message(player_socket, MessageStorage{MessageType::RESIGN, 0});
+		is_exit = true;
+		return;
+	}
+	spdlog::info("Bot searched {} nodes to depth {}.", result.nodes, result.depth);
+
+	const Color bot_color = engine.turn;
+	engine.make_move(result.move);
+	history.push_back(result.move);
+	MessageStorage message{MessageType::MOVE, 3};
+	message.payload[0] = result.move.from;
+	message.payload[1] = result.move.to;
+	message.payload[2] = result.move.type;
+	send_message(player_socket, message);
+	positions.push(engine);
+	if (check_game_over(is_exit)) return;
+
+	if (engine.turn == bot_color) {
+		request_bot_move();
+	}
+}
+
+/**
+ * @brief Ends the game if the last move decided it: the side to move can't move, or the game is drawn.
+ * @param is_exit Atomic flag indicating if the session should exit.
+ * @return True if the game is over, false otherwise.
+ */
+bool BotSessionData::check_game_over(std::atomic<bool>& is_exit) {
+	if (engine.status() == WIN) {
+		const Color winner = ~engine.turn;
+		spdlog::info("Bot game is won by {}.", winner == WHITE ? "the player" : "the bot");
+		send_game_over(player_socket, winner, engine.pieces_bitboard(engine.turn) ? NO_LEGAL_MOVES : ALL_PIECES_CAPTURED);
+		is_exit = true;
+		return true;
+	}
+	const DrawReason reason = positions.draw_reason();
+	if (reason == NO_DRAW) return false;
+	spdlog::info("Bot game is drawn by {}.", reason == REPETITION ? "repetition" : "the move limit");
+	send_game_over(player_socket, BOTH, reason == REPETITION ? DRAW_BY_REPETITION : DRAW_BY_MOVE_LIMIT);
+	is_exit = true;
+	return true;
+}
+
+/**
+ * @brief Handles a message of the human player.
+ * @param message The received message.
+ * @param is_exit Reference to an atomic boolean flag indicating if the game session should exit.
+ */
+void BotSessionData::handle_message(const struct MessageStorage& message, std::atomic<bool>& is_exit) {
+	switch (message.message_type) {
+		case MOVE: {
+			Move move;
+			move.from = SpotIndex(message.payload[0]);
+			move.to = SpotIndex(message.payload[1]);
+			move.type = MoveType(message.payload[2]);
+			if (engine.turn == WHITE && !pending_request && engine.is_valid(move)) {
+				engine.make_move(move);
+				history.push_back(move);
+				positions.push(engine);
+				if (check_game_over(is_exit)) break;
+				if (engine.turn == BLACK) {
+					request_bot_move();
+				}
+			} else {
+				send_error(player_socket, ErrorType::INVALID_MOVE);
+				is_exit = true;
+			}
+			break;
+		}
+		case RESIGN: {
+			is_exit = true;
+			break;
+		}
+		default: {
+			spdlog::error("Unknown message type received {}.", message.message_type);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Stops the game to continue it in a new server process.
+ * @return The HANDOVER_BOT_GAME record, the player socket goes with it.
+ */
+HandoverRecord BotSessionData::hand_over() {
+	if (pending_request) {
+		pending_request->cancelled = true;
+		pending_request.reset();
+	}
+	HandoverRecord record;
+	record.kind = HANDOVER_BOT_GAME;
+	record.put_u8(bot_level);
+	record.put_moves(history);
+	record.put_u8(player_socket.getProtocolVersion());
+	record.put_u32(player_socket.getCapabilities());
+	record.put_received(decoder.pending());
+	record.fds.push_back(player_socket.getSocketFd());
+	spdlog::info("Handing bot game over after {} moves.", history.size());
+	return record;
+}
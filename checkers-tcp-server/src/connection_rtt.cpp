@@ -0,0 +1,111 @@
+/**
+ * @file connection_rtt.cpp
+ * @brief Implementation of the round-trip time tracking.
+ */
+
+#include "connection_rtt.h"
+
+#include <algorithm>
+#include <bit>
+
+/**
+ * @brief Counts a sent PING.
+ * @param now The time the PING was sent.
+ * @return The timestamp to send in the PING, the monotonic time in nanoseconds.
+ */
+uint64_t ConnectionRtt::ping_sent(Clock::time_point now) {
+  ++unanswered;
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+}
+
+/**
+ * @brief Takes the echoed timestamp of a PONG and updates the estimates with the gains of RFC 6298.
+ * A late PONG still gives a valid sample since it carries its own send time.
+ * @param timestamp The timestamp of the PONG.
+ * @param now The time the PONG was received.
+ * @return The round-trip time, nothing if the timestamp is not one this server sent.
+ */
+std::optional<ConnectionRtt::Clock::duration> ConnectionRtt::pong_received(uint64_t timestamp, Clock::time_point now) {
+  const Clock::time_point sent{std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(timestamp))};
+  if (timestamp == 0 || sent > now || now - sent > PING_INTERVAL * (MAX_MISSED_PONGS + 1)) {
+    return std::nullopt;
+  }
+  const auto rtt = now - sent;
+  unanswered = 0;
+  if (sample_count++ == 0) {
+    srtt = rtt;
+    rttvar = rtt / 2;
+  } else {
+    const auto deviation = srtt > rtt ? srtt - rtt : rtt - srtt;
+    rttvar = (3 * rttvar + deviation) / 4;
+    srtt = (7 * srtt + rtt) / 8;
+  }
+  return rtt;
+}
+
+/**
+ * @brief Gets the bucket of a round-trip time: exact below 4 us, then four buckets per power of two.
+ * @param us The round-trip time in microseconds.
+ * @return The index of the bucket.
+ */
+size_t RttHistogram::bucket_of(uint64_t us) {
+  if (us < 4) {
+    return size_t(us);
+  }
+  const auto exponent = size_t(std::bit_width(us) - 1);
+  const auto quarter = size_t(us >> (exponent - 2)) & 3;
+  return std::min(4 * (exponent - 1) + quarter, BUCKET_COUNT - 1);
+}
+
+/**
+ * @brief Gets the exclusive upper bound of a bucket.
+ * @param bucket The index of the bucket.
+ * @return The upper bound in microseconds.
+ */
+uint64_t RttHistogram::upper_bound_of(size_t bucket) {
+  if (bucket < 4) {
+    return bucket + 1;
+  }
+  const size_t exponent = bucket / 4 + 1;
+  return uint64_t(5 + bucket % 4) << (exponent - 2);
+}
+
+/**
+ * @brief Records a round-trip time. Safe to call from any thread.
+ * @param rtt The round-trip time.
+ */
+void RttHistogram::record(std::chrono::microseconds rtt) {
+  buckets[bucket_of(uint64_t(std::max<int64_t>(rtt.count(), 0)))].fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Computes the percentiles of everything recorded so far.
+ * Buckets are read one by one while sessions keep recording, which only skews a report by the round trips in flight.
+ * @return The percentiles, the upper bounds of their buckets.
+ */
+RttHistogram::Summary RttHistogram::summarize() const {
+  std::array<uint64_t, BUCKET_COUNT> counts{};
+  Summary summary;
+  for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+    counts[bucket] = buckets[bucket].load(std::memory_order_relaxed);
+    summary.count += counts[bucket];
+  }
+  if (summary.count == 0) {
+    return summary;
+  }
+  const auto percentile = [&](uint64_t per_mille) {
+    const uint64_t rank = (summary.count * per_mille + 999) / 1000;
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+      seen += counts[bucket];
+      if (seen >= rank) {
+        return std::chrono::microseconds(upper_bound_of(bucket));
+      }
+    }
+    return std::chrono::microseconds(upper_bound_of(BUCKET_COUNT - 1));
+  };
+  summary.p50 = percentile(500);
+  summary.p90 = percentile(900);
+  summary.p99 = percentile(990);
+  return summary;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file game_clock.cpp
+ * @brief Implementation of the server-authoritative game clock.
+ */
+
+#include "game_clock.h"
+
+#include "hot_restart.h"
+
+#include <algorithm>
+
+/**
+ * @brief Constructs a GameClock for the given time control.
+ * @param time_control The time control.
+ */
+GameClock::GameClock(TimeControl time_control)
+  : timed(time_control.is_timed()),
+    remaining_time{std::chrono::seconds(time_control.base_seconds), std::chrono::seconds(time_control.base_seconds)},
+    increment(std::chrono::seconds(time_control.increment_seconds)) {}
+
+/**
+ * @brief Starts the clock of the given side.
+ * @param side The side to move.
+ * @param now The current time.
+ */
+void GameClock::start(Color side, Clock::time_point now) {
+  running = side;
+  turn_started = now;
+}
+
+/**
+ * @brief Stops the clock of the side to move, adds its increment and starts the opponent's clock.
+ * @param now The time the move was received.
+ */
+void GameClock::switch_turn(Clock::time_point now) {
+  remaining_time[running] -= now - turn_started;
+  remaining_time[running] += increment;
+  start(~running, now);
+}
+
+/**
+ * @brief Gets the remaining time of a side.
+ * @param side The side.
+ * @param now The current time.
+ * @return The remaining time, never negative.
+ */
+std::chrono::milliseconds GameClock::remaining(Color side, Clock::time_point now) const {
+  auto time = remaining_time[side];
+  if (side == running) time -= now - turn_started;
+  return std::max(std::chrono::duration_cast<std::chrono::milliseconds>(time), std::chrono::milliseconds::zero());
+}
+
+/**
+ * @brief Checks if the side to move ran out of time.
+ * @param now The current time.
+ * @return True if the flag fell, false otherwise.
+ */
+bool GameClock::is_flagged(Clock::time_point now) const {
+  return timed && now >= flag_deadline();
+}
+
+/**
+ * @brief Writes the clock to a hand-over record.
+ * @param record The record.
+ */
+void GameClock::save(HandoverRecord& record) const {
+  using std::chrono::nanoseconds;
+  record.put_u8(timed);
+  record.put_u64(uint64_t(std::chrono::duration_cast<nanoseconds>(remaining_time[WHITE]).count()));
+  record.put_u64(uint64_t(std::chrono::duration_cast<nanoseconds>(remaining_time[BLACK]).count()));
+  record.put_u64(uint64_t(std::chrono::duration_cast<nanoseconds>(increment).count()));
+  record.put_u8(running);
+  record.put_u64(uint64_t(std::chrono::duration_cast<nanoseconds>(turn_started.time_since_epoch()).count()));
+}
+
+/**
+ * @brief Reads a clock written by save().
+ * @param reader The reader of the record.
+ * @return The clock.
+ */
+GameClock GameClock::load(HandoverReader& reader) {
+  using std::chrono::nanoseconds;
+  GameClock clock;
+  clock.timed = reader.u8() != 0;
+  clock.remaining_time[WHITE] = nanoseconds(int64_t(reader.u64()));
+  clock.remaining_time[BLACK] = nanoseconds(int64_t(reader.u64()));
+  clock.increment = nanoseconds(int64_t(reader.u64()));
+  clock.running = reader.u8() == BLACK ? BLACK : WHITE;
+  clock.turn_started = Clock::time_point(nanoseconds(int64_t(reader.u64())));
+  return clock;
+}
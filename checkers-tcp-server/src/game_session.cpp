@@ -6,149 +6,849 @@
 
 #include "game_session.h"
 
+#include "frame.h"
 #include "message_handler.h"
+#include "message_format.h"
+#include "pack.h"
+#include "session_memory.h"
+#include "session_workers.h"
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstdio>
 #include <cstring>
+#include <optional>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
 
 /**
- * @brief Checks for error in the received data.
- * @param nbytes The number of bytes received.
- * @return 0 if no error, -1 if error occurred.
+ * @brief Cleans up the game session by closing the sockets of attached players.
+ * @param session_data Reference to the SessionData struct.
  */
-int check_error_recv(size_t nbytes) {
-		if (nbytes <= 0) {
-				if (nbytes == 0) {
-						// Connection closed
-						return -1;
-				} else {
-						perror("recv");
-						return -1;
-				}
+void cleanup_session(SessionData& session_data) {
+	for(int socket_number = 0; socket_number < 2; ++socket_number) {
+		if(!session_data.away[socket_number]) {
+			session_data.player_sockets[socket_number].close();
 		}
-		return 0;
+	}
 }
 
 /**
- * @brief Receives a message from the socket.
- * @param socket_fd The socket file descriptor.
- * @param message Pointer to the MessageStorage struct to store the received message.
- * @return 0 if successful, -1 if error occurred.
+ * @brief Starts a game between two players on a session worker.
+ * @param player1_socket The socket for player 1.
+ * @param player2_socket The socket for player 2.
+ * @param is_exit Atomic flag ending the game from outside, it must outlive the game. Null if only the game ends itself.
+ * @param lobby_id The ID of the lobby.
+ * @param services The server-wide services.
+ * @param time_control The time control of the game.
+ * @param player1_received The bytes of an unfinished frame player 1 sent while waiting in the lobby.
+ * @param on_finished Called on the worker thread once the game is over and the lobby is no longer used.
  */
-int receive_message(int socket_fd, struct MessageStorage* message) {
-		size_t nbytes;
-		// Read message type
-		nbytes = recv(socket_fd, &(message->message_type), sizeof message->message_type, 0);
-		if(check_error_recv(nbytes) < 0) return -1;
-
-		// Read message length
-		nbytes = recv(socket_fd, &(message->len), sizeof message->len, 0);
-		if(check_error_recv(nbytes) < 0) return -1;
+void start_game_session(Socket player1_socket, Socket player2_socket, std::atomic<bool>* is_exit, uint32_t lobby_id,
+                        const SessionServices& services, TimeControl time_control,
+                        std::span<const uint8_t> player1_received, std::function<void()> on_finished) {
+	std::vector<uint8_t> received(player1_received.begin(), player1_received.end());
+	services.workers.start([=, &services, received = std::move(received)](SlabPool<SessionData>& pool) mutable {
+		SlabPool<SessionData>::Ptr session;
+		try {
+			session = pool.create(player1_socket, player2_socket, services, time_control, lobby_id);
+		} catch(const std::exception& e) {
+			spdlog::error("Failed to start game session for lobby {}: {}", lobby_id, e.what());
+			player1_socket.close();
+			player2_socket.close();
+			return session;
+		}
+		spdlog::info("Started game session for lobby {}.", lobby_id);
+		session->decoders[PLAYER1_SOCKET].append(received);
+		session->send_game_started(PLAYER1_SOCKET);
+		session->send_game_started(PLAYER2_SOCKET);
+		session->start_clock(GameClock::Clock::now());
+		session->snapshot();
+		return session;
+	}, is_exit, std::move(on_finished));
+}
 
-		if(message->len == 0) return 0;
+/**
+ * @brief Continues a game handed over by the previous server process on a session worker.
+ * The players notice nothing, the game goes on from the next message they send.
+ * @param record The HANDOVER_GAME record.
+ * @param services The server-wide services.
+ */
+void resume_game_session(HandoverRecord record, const SessionServices& services) {
+	services.workers.start([record = std::move(record), &services](SlabPool<SessionData>& pool) {
+		SlabPool<SessionData>::Ptr session;
+		try {
+			session = pool.create(record, services);
+		} catch(const std::exception& e) {
+			spdlog::error("Failed to take over a game: {}", e.what());
+			for(const int fd : record.fds) {
+				::close(fd);
+			}
+			return session;
+		}
+		spdlog::info("Took over game {} after {} moves.", session->game_id, session->history.size());
+		return session;
+	});
+}
 
-		// Read all payload
-		size_t total = 0, bytesleft = message->len;
-		while(total < message->len) {
-				nbytes = recv(socket_fd, message->payload+total, bytesleft, 0);
-				if (check_error_recv(nbytes) < 0) return -1;
-				total += nbytes;
-				bytesleft -= nbytes;
+/**
+ * @brief Continues a game recovered from the snapshot file of a crashed server on a session worker.
+ * The game waits RESUME_GRACE_PERIOD for the players to resume it with their tokens.
+ * @param record The snapshot.
+ * @param services The server-wide services.
+ */
+void recover_game_session(HandoverRecord record, const SessionServices& services) {
+	services.workers.start([record = std::move(record), &services](SlabPool<SessionData>& pool) {
+		SlabPool<SessionData>::Ptr session;
+		try {
+			session = pool.create(record, services, true);
+		} catch(const std::exception& e) {
+			spdlog::error("Failed to recover a game: {}", e.what());
+			return session;
 		}
-		return 0;
+		spdlog::info("Recovered game {} after {} moves, waiting for the players to resume.", session->game_id,
+		             session->history.size());
+		return session;
+	});
 }
 
 /**
- * @brief Cleans up the game session by closing player sockets.
- * @param session_data Reference to the SessionData struct.
+ * @brief Constructs SessionEvents and its eventfd.
  */
-void cleanup_session(SessionData& session_data) {
-	session_data.player_sockets[0].close();
-	session_data.player_sockets[1].close();
+SessionEvents::SessionEvents() {
+	fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(fd == -1) {
+		throw std::runtime_error("Failed to create session eventfd: " + std::string(strerror(errno)));
+	}
 }
 
 /**
- * @brief Game session routine that handles the game logic between two players.
- * @param player1_socket The socket for player 1.
- * @param player2_socket The socket for player 2.
- * @param is_exit Reference to an atomic boolean flag indicating if the game session should exit.
- * @param lobby_id The ID of the lobby.
+ * @brief Closes the eventfd.
  */
-void game_session_routine(Socket player1_socket, Socket player2_socket, std::atomic<bool>& is_exit, uint32_t lobby_id) {
-	spdlog::info("Started game session thread for lobby {}.", lobby_id);
+SessionEvents::~SessionEvents() {
+	::close(fd);
+}
 
-	SessionData session_data(player1_socket, player2_socket);
-	const nfds_t fd_count = 2;
-	send_game_started(player1_socket, GameFlags::IM_WHITE);
-	send_game_started(player2_socket, GameFlags::NONE);
+/**
+ * @brief Posts an event and wakes up the session thread.
+ * @param event The event to post.
+ */
+void SessionEvents::post(SessionEvent event) {
+	pending |= event;
+	const uint64_t one = 1;
+	if(::write(fd, &one, sizeof one) == -1 && errno != EAGAIN) {
+		spdlog::error("Failed to post session event: {}", strerror(errno));
+	}
+}
 
-	struct MessageStorage incoming_message{};
+/**
+ * @brief Takes all posted events.
+ * @return The posted SessionEvent flags.
+ */
+uint32_t SessionEvents::take() {
+	uint64_t counter;
+	while(::read(fd, &counter, sizeof counter) > 0) {}
+	return pending.exchange(0);
+}
 
-	while (!is_exit) {
-		spdlog::info("Waiting for new messages in game session...");
-		const int poll_count = poll(session_data.pfds, fd_count, -1);
+/**
+ * @brief Hands a resumed socket to the session thread and posts RECONNECT.
+ * @param token The resume token presented by the player.
+ * @param socket The resumed socket.
+ */
+void SessionEvents::post_reconnect(uint64_t token, Socket socket) {
+	{
+		std::scoped_lock<std::mutex> lock(inbox_mutex);
+		reconnects.emplace_back(token, socket);
+	}
+	post(RECONNECT);
+}
 
-		if (poll_count == -1) {
-			spdlog::error("Error occurred when polling data.");
-			cleanup_session(session_data);
-			is_exit = true;
-			return;
-		}
+/**
+ * @brief Takes all resumed sockets.
+ * @return The resumed sockets with their tokens.
+ */
+std::vector<std::pair<uint64_t, Socket>> SessionEvents::take_reconnects() {
+	std::scoped_lock<std::mutex> lock(inbox_mutex);
+	return std::exchange(reconnects, {});
+}
 
-		for(int socket_number = 0; socket_number < fd_count; ++socket_number) {
-			const auto& pfd = session_data.pfds[socket_number];
-			if(pfd.revents & POLLHUP) {
-				spdlog::error("Client closed connection.");
-				if(socket_number == PLAYER1_SOCKET) {
-					send_error(player2_socket, OPPONENT_DISCONNECTED);
-				} else {
-					send_error(player1_socket, OPPONENT_DISCONNECTED);
-				}
-				is_exit = true;
-			} else if(pfd.revents & POLLIN) {
-				spdlog::info("Reading new message...");
-				if(receive_message(pfd.fd, &incoming_message) == -1) {
-					//handle error here
-					spdlog::error("Error occurred when trying to receive message.");
-					if(socket_number == PLAYER1_SOCKET) {
-							send_error(player2_socket, OPPONENT_DISCONNECTED);
-					} else {
-							send_error(player1_socket, OPPONENT_DISCONNECTED);
-					}
-					is_exit = true;
-				} else {
-					spdlog::info("Received new session message: {}", message_to_string(incoming_message));
-					session_data.handle_message(SocketNumber(socket_number), incoming_message, is_exit);
-				}
-			} else if(pfd.revents) {
-				spdlog::error("Unknown error occurred.");
-				send_error(player1_socket, SERVER_DISCONNECTED);
-				send_error(player2_socket, SERVER_DISCONNECTED);
-				is_exit = true;
-			}
+/**
+ * @brief Arms a timer that posts an event to a session.
+ * The timer holds the events weakly, so it may outlive the session.
+ * @param timers The server timer service.
+ * @param delay The delay from now.
+ * @param events The events of the session.
+ * @param event The event to post on expiry.
+ * @return The id of the armed timer.
+ */
+TimerService::TimerId schedule_session_event(TimerService& timers, TimerService::Clock::duration delay,
+                                             const std::shared_ptr<SessionEvents>& events, SessionEvent event) {
+	return timers.arm(delay, [weak_events = std::weak_ptr<SessionEvents>(events), event] {
+		if(auto session_events = weak_events.lock()) {
+			session_events->post(event);
 		}
-	}
-	cleanup_session(session_data);
+	});
 }
 
 /**
  * @brief Constructs a SessionData object with player sockets and poll file descriptors.
  * @param player1_socket The socket for player 1.
  * @param player2_socket The socket for player 2.
+ * @param services The server-wide services.
+ * @param time_control The time control of the game.
+ * @param game_id The ID spectators watch the game with and the game is logged under.
  */
-SessionData::SessionData(Socket player1_socket, Socket player2_socket) {
+SessionData::SessionData(Socket player1_socket, Socket player2_socket, const SessionServices& services,
+                         TimeControl time_control, uint32_t game_id)
+	: events(std::make_shared<SessionEvents>()), timers(services.timers), clock(time_control),
+	  registry(services.registry), spectators(services.spectators), game_id(game_id), game_log(services.game_log),
+	  started_at(std::chrono::system_clock::now()), start_time(GameClock::Clock::now()), last_move_at(start_time),
+	  snapshots(services.snapshots), rtt_histogram(services.rtt_histogram) {
 	player_sockets[0] = player1_socket;
 	player_sockets[1] = player2_socket;
 	pfds[0].fd = player1_socket.getSocketFd();
 	pfds[1].fd = player2_socket.getSocketFd();
+	pfds[2].fd = events->fd;
 	pfds[0].events = POLLIN;
 	pfds[1].events = POLLIN;
+	pfds[2].events = POLLIN;
 	engine.reset();
+	positions.reset(engine);
+	for(auto& token : resume_tokens) {
+		token = SessionRegistry::generate_token();
+		registry.add(token, events);
+	}
+	is_watchable = spectators.open_channel(game_id, position_frame());
+	if(!is_watchable) {
+		spdlog::warn("Game {} can't be watched, the ID is taken.", game_id);
+	}
+	if(snapshots != nullptr && (snapshot_slot = snapshots->acquire()) == SessionSnapshots::NO_SLOT) {
+		spdlog::warn("Game {} won't survive a crash, all snapshot slots are taken.", game_id);
+	}
+	touch();
+	heartbeat_timer = schedule_session_event(timers, PING_INTERVAL, events, HEARTBEAT);
+}
+
+/**
+ * @brief Constructs a SessionData object for a game handed over by the previous server process or recovered from its
+ * snapshot.
+ * @param record The HANDOVER_GAME record written by hand_over() or snapshot().
+ * @param services The server-wide services.
+ * @param is_recovered Whether the record is a snapshot left by a crashed server.
+ * @throws std::runtime_error if the record is malformed.
+ */
+SessionData::SessionData(const HandoverRecord& record, const SessionServices& services, bool is_recovered)
+	: events(std::make_shared<SessionEvents>()), timers(services.timers), registry(services.registry),
+	  spectators(services.spectators), game_log(services.game_log), snapshots(services.snapshots),
+	  rtt_histogram(services.rtt_histogram) {
+	using std::chrono::nanoseconds;
+	HandoverReader reader(record);
+	game_id = reader.u32();
+	clock = GameClock::load(reader);
+	for(auto& token : resume_tokens) {
+		token = reader.u64();
+	}
+	for(auto& seat_away : away) {
+		seat_away = reader.u8() != 0;
+	}
+	for(auto& deadline : grace_deadlines) {
+		deadline = GameClock::Clock::time_point(nanoseconds(int64_t(reader.u64())));
+	}
+	started_at = std::chrono::system_clock::time_point(
+		std::chrono::duration_cast<std::chrono::system_clock::duration>(nanoseconds(int64_t(reader.u64()))));
+	start_time = GameClock::Clock::time_point(nanoseconds(int64_t(reader.u64())));
+	last_move_at = GameClock::Clock::time_point(nanoseconds(int64_t(reader.u64())));
+	history = reader.moves();
+	Position snapshot_position;
+	if(is_recovered) {
+		const auto turn = Color(reader.u8());
+		const Bitboard white = reader.u32();
+		const Bitboard black = reader.u32();
+		const Bitboard kings = reader.u32();
+		snapshot_position = Position(white, black, kings, turn);
+		away[PLAYER1_SOCKET] = away[PLAYER2_SOCKET] = true;
+	}
+	uint8_t versions[2] = {PROTOCOL_V1, PROTOCOL_V1};
+	uint32_t capabilities[2] = {0, 0};
+	for(const auto seat : {PLAYER1_SOCKET, PLAYER2_SOCKET}) {
+		if(!away[seat] && !is_recovered) {
+			versions[seat] = reader.u8();
+			capabilities[seat] = reader.u32();
+			decoders[seat].append(reader.received());
+		}
+	}
+	const size_t attached = size_t(!away[PLAYER1_SOCKET]) + size_t(!away[PLAYER2_SOCKET]);
+	if(!reader.ok() || record.fds.size() != attached) {
+		throw std::runtime_error("Malformed game hand-over record.");
+	}
+
+	engine.reset();
+	positions.reset(engine);
+	for(const auto& move : history) {
+		engine.make_move(move);
+		positions.push(engine);
+	}
+	if(is_recovered && engine.position() != snapshot_position) {
+		throw std::runtime_error("The moves of the snapshot don't lead to its position.");
+	}
+	size_t next_fd = 0;
+	for(const auto seat : {PLAYER1_SOCKET, PLAYER2_SOCKET}) {
+		pfds[seat].fd = -1;
+		pfds[seat].events = POLLIN;
+		if(!away[seat]) {
+			player_sockets[seat] = adopt_socket(record.fds[next_fd++]);
+			player_sockets[seat].setProtocol(versions[seat], capabilities[seat]);
+			pfds[seat].fd = player_sockets[seat].getSocketFd();
+		}
+	}
+	pfds[2].fd = events->fd;
+	pfds[2].events = POLLIN;
+	for(const auto token : resume_tokens) {
+		registry.add(token, events);
+	}
+	is_watchable = spectators.open_channel(game_id, position_frame());
+
+	const auto now = GameClock::Clock::now();
+	if(is_recovered) {
+		grace_deadlines[PLAYER1_SOCKET] = grace_deadlines[PLAYER2_SOCKET] = now + RESUME_GRACE_PERIOD;
+	}
+	if(snapshots != nullptr && (snapshot_slot = snapshots->acquire()) == SessionSnapshots::NO_SLOT) {
+		spdlog::warn("Game {} won't survive a crash, all snapshot slots are taken.", game_id);
+	}
+	snapshot();
+	touch();
+	heartbeat_timer = schedule_session_event(timers, PING_INTERVAL, events, HEARTBEAT);
+	if(clock.is_timed()) {
+		flag_timer = schedule_session_event(timers, std::max(clock.flag_deadline() - now, GameClock::Clock::duration::zero()),
+		                                    events, FLAG_FALL);
+	}
+	for(const auto seat : {PLAYER1_SOCKET, PLAYER2_SOCKET}) {
+		if(away[seat]) {
+			grace_timers[seat] = schedule_session_event(
+				timers, std::max(grace_deadlines[seat] - now, GameClock::Clock::duration::zero()), events, GRACE_EXPIRED);
+		}
+	}
+}
+
+/**
+ * @brief Logs the game, unregisters the resume tokens, closes unclaimed resumed sockets and spectators and cancels
+ * the session timers.
+ */
+SessionData::~SessionData() {
+	if(!handed_over) {
+		write_record();
+	}
+	if(is_watchable) {
+		spectators.close_channel(game_id);
+	}
+	for(const auto token : resume_tokens) {
+		registry.remove(token);
+	}
+	// Nothing can be posted once the tokens are unregistered.
+	for(auto& [token, socket] : events->take_reconnects()) {
+		send_error(socket, SESSION_NOT_FOUND);
+		socket.close();
+	}
+	timers.cancel(idle_timer);
+	timers.cancel(flag_timer);
+	timers.cancel(grace_timers[PLAYER1_SOCKET]);
+	timers.cancel(grace_timers[PLAYER2_SOCKET]);
+	timers.cancel(heartbeat_timer);
+	for(const auto seat : {PLAYER1_SOCKET, PLAYER2_SOCKET}) {
+		if(!away[seat]) {
+			log_rtt(seat);
+		}
+	}
+	if(snapshot_slot != SessionSnapshots::NO_SLOT) {
+		snapshots->release(snapshot_slot);
+	}
+}
+
+/**
+ * @brief Gets the memory a game costs: its slab slot, its events and the heap of its histories and decoders.
+ * @return The size in bytes.
+ */
+size_t SessionData::memory_footprint() const {
+	return SlabPool<SessionData>::slot_bytes() + sizeof(SessionEvents) +
+	       events->reconnects.capacity() * sizeof(events->reconnects[0]) + history.capacity() * sizeof(Move) +
+	       positions.memory_footprint() + decoders[PLAYER1_SOCKET].memory_footprint() +
+	       decoders[PLAYER2_SOCKET].memory_footprint();
+}
+
+/**
+ * @brief Sends to the player of a seat unless the player is away.
+ * A failed send is only logged, the hang-up is picked up by the next poll.
+ * @param seat The seat to send to.
+ * @param send The function sending through the socket of the seat.
+ */
+void SessionData::send_to(SocketNumber seat, const std::function<void(Socket&)>& send) {
+	if(away[seat]) return;
+	try {
+		send(player_sockets[seat]);
+	} catch(const std::exception& e) {
+		spdlog::warn("Failed to send to player {}: {}", int(seat) + 1, e.what());
+	}
+}
+
+/**
+ * @brief Sends a message to the spectators.
+ * @param message The message.
+ * @param position_changed Whether the message changed the position late joiners get.
+ */
+void SessionData::broadcast(const MessageStorage& message, bool position_changed) {
+	if(!is_watchable) return;
+	spectators.publish(game_id, SpectatorHub::make_frame(message), position_changed ? position_frame() : nullptr);
+}
+
+/**
+ * @brief Serializes the current position for spectators.
+ * @return The POSITION frame.
+ */
+SharedFrame SessionData::position_frame() const {
+	const Position position = engine.position();
+	MessageStorage message{MessageType::POSITION, 13};
+	message.payload[0] = position.side_to_move();
+	packi32(&message.payload[1], position.pieces(WHITE));
+	packi32(&message.payload[5], position.pieces(BLACK));
+	packi32(&message.payload[9], position.kings());
+	return SpectatorHub::make_frame(message);
+}
+
+/**
+ * @brief Sends an error that ends the game to both players and the spectators.
+ * @param error The error.
+ */
+void SessionData::send_error_to_all(ErrorType error) {
+	send_to(PLAYER1_SOCKET, [error](Socket& socket) { send_error(socket, error); });
+	send_to(PLAYER2_SOCKET, [error](Socket& socket) { send_error(socket, error); });
+	MessageStorage message{MessageType::ERROR, 1};
+	message.payload[0] = error;
+	broadcast(message);
+}
+
+/**
+ * @brief Sends the decided result to both players and the spectators.
+ * @param winner The color of the winner, BOTH for a draw.
+ * @param reason Why the game ended.
+ */
+void SessionData::send_game_over(Color winner, GameOverReason reason) {
+	send_to(PLAYER1_SOCKET, [&](Socket& socket) { ::send_game_over(socket, winner, reason); });
+	send_to(PLAYER2_SOCKET, [&](Socket& socket) { ::send_game_over(socket, winner, reason); });
+	MessageStorage message{MessageType::GAME_OVER, 2};
+	message.payload[0] = winner;
+	message.payload[1] = reason;
+	broadcast(message);
+}
+
+/**
+ * @brief Ends the game if the last move decided it: the side to move can't move, or the game is drawn.
+ * @param is_exit Reference to an atomic boolean flag indicating if the game session should exit.
+ * @return True if the game is over, false otherwise.
+ */
+bool SessionData::check_game_over(std::atomic<bool>& is_exit) {
+	if(engine.status() == WIN) {
+		const Color winner = ~engine.turn;
+		const auto reason = engine.pieces_bitboard(engine.turn) ? NO_LEGAL_MOVES : ALL_PIECES_CAPTURED;
+		spdlog::info("Game {} is won by {} after {} moves.", game_id, winner == WHITE ? "white" : "black", history.size());
+		result = winner == WHITE ? WHITE_WON : BLACK_WON;
+		send_game_over(winner, reason);
+		is_exit = true;
+		return true;
+	}
+	const DrawReason reason = positions.draw_reason();
+	if(reason == NO_DRAW) return false;
+	spdlog::info("Game {} is drawn by {} after {} moves.", game_id, reason == REPETITION ? "repetition" : "the move limit",
+	             history.size());
+	result = DRAWN;
+	send_game_over(BOTH, reason == REPETITION ? DRAW_BY_REPETITION : DRAW_BY_MOVE_LIMIT);
+	is_exit = true;
+	return true;
+}
+
+/**
+ * @brief Appends the game to the game log.
+ * A failure is only logged, the game is over either way.
+ */
+void SessionData::write_record() {
+	if(game_log == nullptr) return;
+	RecordHeader header;
+	header.result = result;
+	header.game_id = game_id;
+	header.started_at_ms = uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(started_at.time_since_epoch()).count());
+	header.duration_ms = uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(last_move_at - start_time).count());
+	try {
+		if(!game_log->append(header, history)) {
+			spdlog::warn("Game {} can't be encoded, it isn't logged.", game_id);
+		}
+	} catch(const std::exception& e) {
+		spdlog::error("Failed to log game {}: {}", game_id, e.what());
+	}
+}
+
+/**
+ * @brief Writes the state of the game to a HANDOVER_GAME record, without the sockets.
+ * @param record The record.
+ */
+void SessionData::save(HandoverRecord& record) const {
+	using std::chrono::duration_cast;
+	using std::chrono::nanoseconds;
+	record.kind = HANDOVER_GAME;
+	record.put_u32(game_id);
+	clock.save(record);
+	for(const auto token : resume_tokens) {
+		record.put_u64(token);
+	}
+	for(const auto seat_away : away) {
+		record.put_u8(seat_away);
+	}
+	for(const auto deadline : grace_deadlines) {
+		record.put_u64(uint64_t(duration_cast<nanoseconds>(deadline.time_since_epoch()).count()));
+	}
+	record.put_u64(uint64_t(duration_cast<nanoseconds>(started_at.time_since_epoch()).count()));
+	record.put_u64(uint64_t(duration_cast<nanoseconds>(start_time.time_since_epoch()).count()));
+	record.put_u64(uint64_t(duration_cast<nanoseconds>(last_move_at.time_since_epoch()).count()));
+	record.put_moves(history);
+}
+
+/**
+ * @brief Writes the state of the game and the position to the snapshot slot of the game.
+ * The position lets recovery check that the moves replay to it.
+ */
+void SessionData::snapshot() {
+	if(snapshot_slot == SessionSnapshots::NO_SLOT) return;
+	HandoverRecord record;
+	save(record);
+	const Position position = engine.position();
+	record.put_u8(position.side_to_move());
+	record.put_u32(position.pieces(WHITE));
+	record.put_u32(position.pieces(BLACK));
+	record.put_u32(position.kings());
+	if(!snapshots->write(snapshot_slot, record)) {
+		spdlog::warn("Game {} outgrew its snapshot slot after {} moves and won't survive a crash.", game_id, history.size());
+		snapshots->release(snapshot_slot);
+		snapshot_slot = SessionSnapshots::NO_SLOT;
+	}
+}
+
+/**
+ * @brief Stops the game to continue it in a new server process.
+ * Reconnects waiting in the inbox were attached before, the main thread doesn't resume sessions while it hands over.
+ * @return The HANDOVER_GAME record.
+ */
+HandoverRecord SessionData::hand_over() {
+	HandoverRecord record;
+	save(record);
+	for(const auto seat : {PLAYER1_SOCKET, PLAYER2_SOCKET}) {
+		if(!away[seat]) {
+			record.put_u8(player_sockets[seat].getProtocolVersion());
+			record.put_u32(player_sockets[seat].getCapabilities());
+			record.put_received(decoders[seat].pending());
+			record.fds.push_back(player_sockets[seat].getSocketFd());
+		}
+	}
+	handed_over = true;
+	spdlog::info("Handing game {} over after {} moves.", game_id, history.size());
+	return record;
+}
+
+/**
+ * @brief Sends GAME_STARTED with the seat colour and its resume token.
+ * @param seat The seat to send to.
+ */
+void SessionData::send_game_started(SocketNumber seat) {
+	const GameFlags flags = seat == PLAYER1_SOCKET ? GameFlags::IM_WHITE : GameFlags::NONE;
+	send_to(seat, [&](Socket& socket) { ::send_game_started(socket, flags, resume_tokens[seat]); });
+}
+
+/**
+ * @brief Detaches a disconnected player and starts the resume grace period.
+ * The game ends right away if the opponent is away as well.
+ * @param seat The seat of the disconnected player.
+ * @param now The current time.
+ * @param is_exit Reference to an atomic boolean flag indicating if the game session should exit.
+ */
+void SessionData::player_left(SocketNumber seat, GameClock::Clock::time_point now, std::atomic<bool>& is_exit) {
+	const auto opponent = SocketNumber(!seat);
+	log_rtt(seat);
+	rtts[seat] = {};
+	player_sockets[seat].close();
+	pfds[seat].fd = -1;
+	pfds[seat].revents = 0;
+	decoders[seat].clear();
+	away[seat] = true;
+	if(away[opponent]) {
+		spdlog::info("Both players are away, ending the game.");
+		is_exit = true;
+		return;
+	}
+
+	spdlog::info("Player {} is away, waiting {}s for a resume.", int(seat) + 1, RESUME_GRACE_PERIOD.count());
+	grace_deadlines[seat] = now + RESUME_GRACE_PERIOD;
+	timers.cancel(grace_timers[seat]);
+	grace_timers[seat] = schedule_session_event(timers, RESUME_GRACE_PERIOD, events, GRACE_EXPIRED);
+	MessageStorage message{MessageType::OPPONENT_STATUS, 2};
+	message.payload[0] = OpponentStatus::OPPONENT_AWAY;
+	message.payload[1] = uint8_t(RESUME_GRACE_PERIOD.count());
+	send_to(opponent, [&](Socket& socket) { send_message(socket, message); });
+}
+
+/**
+ * @brief Attaches resumed sockets to their seats and replays the game to them.
+ * A resumed socket takes the seat over even if the previous connection still looks alive.
+ * @param now The current time.
+ */
+void SessionData::attach_reconnects(GameClock::Clock::time_point now) {
+	for(auto& [token, socket] : events->take_reconnects()) {
+		const auto seat = token == resume_tokens[PLAYER1_SOCKET] ? PLAYER1_SOCKET : PLAYER2_SOCKET;
+		const auto opponent = SocketNumber(!seat);
+		if(!away[seat]) {
+			spdlog::info("Player {} resumed over a live connection, replacing it.", int(seat) + 1);
+			log_rtt(seat);
+			player_sockets[seat].close();
+		}
+		rtts[seat] = {};
+		timers.cancel(grace_timers[seat]);
+		player_sockets[seat] = socket;
+		pfds[seat].fd = socket.getSocketFd();
+		// The revents and the unfinished frame belong to the replaced connection.
+		pfds[seat].revents = 0;
+		decoders[seat].clear();
+		const bool was_away = away[seat];
+		away[seat] = false;
+		spdlog::info("Player {} resumed the game after {} moves.", int(seat) + 1, history.size());
+
+		send_game_started(seat);
+		send_to(seat, [&](Socket& socket) { send_moves(socket, history); });
+		if(clock.is_timed()) {
+			const auto white_ms = uint32_t(clock.remaining(WHITE, now).count());
+			const auto black_ms = uint32_t(clock.remaining(BLACK, now).count());
+			send_to(seat, [&](Socket& socket) { send_clock(socket, white_ms, black_ms); });
+		}
+		if(was_away) {
+			MessageStorage message{MessageType::OPPONENT_STATUS, 1};
+			message.payload[0] = OpponentStatus::OPPONENT_BACK;
+			send_to(opponent, [&](Socket& socket) { send_message(socket, message); });
+		}
+	}
+	touch();
+}
+
+/**
+ * @brief Ends the game if an away player did not resume within the grace period.
+ * @param now The current time.
+ * @param is_exit Reference to an atomic boolean flag indicating if the game session should exit.
+ */
+void SessionData::check_grace(GameClock::Clock::time_point now, std::atomic<bool>& is_exit) {
+	// Only a recovered game has both players away, nobody wins if neither comes back.
+	if(away[PLAYER1_SOCKET] && away[PLAYER2_SOCKET] && now >= grace_deadlines[PLAYER1_SOCKET] &&
+	   now >= grace_deadlines[PLAYER2_SOCKET]) {
+		spdlog::info("Neither player resumed in time.");
+		is_exit = true;
+		return;
+	}
+	for(const auto seat : {PLAYER1_SOCKET, PLAYER2_SOCKET}) {
+		if(away[seat] && now >= grace_deadlines[seat]) {
+			spdlog::info("Player {} did not resume in time.", int(seat) + 1);
+			result = seat == PLAYER1_SOCKET ? BLACK_WON : WHITE_WON;
+			send_to(SocketNumber(!seat), [](Socket& socket) { send_error(socket, OPPONENT_DISCONNECTED); });
+			MessageStorage message{MessageType::ERROR, 1};
+			message.payload[0] = OPPONENT_DISCONNECTED;
+			broadcast(message);
+			is_exit = true;
+		}
+	}
+}
+
+/**
+ * @brief Re-arms the idle disconnect timer.
+ */
+void SessionData::touch() {
+	timers.cancel(idle_timer);
+	idle_timer = schedule_session_event(timers, SESSION_IDLE_TIMEOUT, events, IDLE_EXPIRED);
+}
+
+/**
+ * @brief PINGs the players that negotiated CAPABILITY_PING and detaches those that stopped answering.
+ * A dead peer is handled like a hang-up, also one that stopped in the middle of a frame: the seat gets the resume
+ * grace period.
+ * @param now The current time.
+ * @param is_exit Atomic flag indicating if the session should exit.
+ */
+void SessionData::heartbeat(GameClock::Clock::time_point now, std::atomic<bool>& is_exit) {
+	for(const auto seat : {PLAYER1_SOCKET, PLAYER2_SOCKET}) {
+		if(away[seat] || !(player_sockets[seat].getCapabilities() & CAPABILITY_PING)) continue;
+		if(!rtts[seat].is_alive()) {
+			spdlog::warn("Player {} left {} PINGs unanswered, dropping the connection.", int(seat) + 1, MAX_MISSED_PONGS);
+			player_left(seat, now, is_exit);
+			if(is_exit) return;
+			continue;
+		}
+		const uint64_t timestamp = rtts[seat].ping_sent(now);
+		send_to(seat, [&](Socket& socket) { send_ping(socket, timestamp); });
+	}
+	heartbeat_timer = schedule_session_event(timers, PING_INTERVAL, events, HEARTBEAT);
+}
+
+/**
+ * @brief Takes a PONG of a player into its round-trip time and the server-wide distribution.
+ * @param seat The seat of the player.
+ * @param pong The PONG.
+ * @param now The time the PONG was received.
+ */
+void SessionData::take_pong(SocketNumber seat, const MessageStorage& pong, GameClock::Clock::time_point now) {
+	if(pong.len < 8) return;
+	const auto rtt = rtts[seat].pong_received(unpacku64(pong.payload), now);
+	if(rtt && rtt_histogram != nullptr) {
+		rtt_histogram->record(std::chrono::duration_cast<std::chrono::microseconds>(*rtt));
+	}
+}
+
+/**
+ * @brief Logs the round-trip time of the current connection of a seat, if it was measured.
+ * @param seat The seat.
+ */
+void SessionData::log_rtt(SocketNumber seat) const {
+	using milliseconds = std::chrono::duration<double, std::milli>;
+	const ConnectionRtt& rtt = rtts[seat];
+	if(rtt.samples() == 0) return;
+	spdlog::info("Player {} of game {} at {}: RTT {:.1f} ms, jitter {:.1f} ms over {} PONGs.", int(seat) + 1, game_id,
+	             player_sockets[seat].getAddressString(), milliseconds(rtt.smoothed()).count(),
+	             milliseconds(rtt.jitter()).count(), rtt.samples());
+}
+
+/**
+ * @brief Starts the clock of the side to move and sends both clocks to the players.
+ * @param now The current time.
+ */
+void SessionData::start_clock(GameClock::Clock::time_point now) {
+	if(!clock.is_timed()) return;
+	clock.start(engine.turn, now);
+	send_clocks(now);
+	timers.cancel(flag_timer);
+	flag_timer = schedule_session_event(timers, clock.flag_deadline() - now, events, FLAG_FALL);
+}
+
+/**
+ * @brief Sends the remaining clock times to both players.
+ * @param now The current time.
+ */
+void SessionData::send_clocks(GameClock::Clock::time_point now) {
+	const auto white_ms = uint32_t(clock.remaining(WHITE, now).count());
+	const auto black_ms = uint32_t(clock.remaining(BLACK, now).count());
+	send_to(PLAYER1_SOCKET, [&](Socket& socket) { send_clock(socket, white_ms, black_ms); });
+	send_to(PLAYER2_SOCKET, [&](Socket& socket) { send_clock(socket, white_ms, black_ms); });
+	MessageStorage message{MessageType::CLOCK, 8};
+	packi32(message.payload, white_ms);
+	packi32(&message.payload[4], black_ms);
+	broadcast(message);
+}
+
+/**
+ * @brief Ends the game if the side to move ran out of time.
+ * @param now The current time.
+ * @param is_exit Reference to an atomic boolean flag indicating if the game session should exit.
+ * @return True if the flag fell, false otherwise.
+ */
+bool SessionData::check_flag(GameClock::Clock::time_point now, std::atomic<bool>& is_exit) {
+	if(!clock.is_flagged(now)) {
+		// Stale timer from before the last move.
+		return false;
+	}
+	result = engine.turn == WHITE ? BLACK_WON : WHITE_WON;
+	send_clocks(now);
+	send_error_to_all(ErrorType::TIME_EXPIRED);
+	is_exit = true;
+	return true;
+}
+
+/**
+ * @brief Serves what woke the game up: the posted events and the players whose revents are set in pfds.
+ * @param is_exit Reference to an atomic boolean flag indicating if the game session should exit.
+ * @return The HANDOVER_GAME record if the game stopped to be handed over, nothing otherwise.
+ */
+std::optional<HandoverRecord> SessionData::serve(std::atomic<bool>& is_exit) {
+	std::optional<HandoverRecord> handover_record;
+	const auto received_at = GameClock::Clock::now();
+
+	if(pfds[2].revents & POLLIN) {
+		const uint32_t session_events = events->take();
+		if(session_events & RECONNECT) {
+			attach_reconnects(received_at);
+		}
+		if(session_events & FLAG_FALL && !is_exit && check_flag(received_at, is_exit)) {
+			spdlog::info("Flag fell in game session for lobby {}.", game_id);
+		}
+		// Events coalesce, each one is handled unless an earlier one ended the game.
+		if(session_events & GRACE_EXPIRED && !is_exit) {
+			check_grace(received_at, is_exit);
+		}
+		if(session_events & IDLE_EXPIRED && !is_exit) {
+			spdlog::info("Closing idle game session for lobby {}.", game_id);
+			send_error_to_all(SESSION_TIMEOUT);
+			is_exit = true;
+		}
+		if(session_events & HEARTBEAT && !is_exit) {
+			heartbeat(received_at, is_exit);
+		}
+		if(session_events & DRAIN_DEADLINE && !is_exit) {
+			spdlog::info("Closing game session for lobby {}, the server shuts down.", game_id);
+			send_error_to_all(SERVER_DISCONNECTED);
+			is_exit = true;
+		}
+		// Unread messages stay in the sockets for the next process, unfinished ones go with the record.
+		if(session_events & HANDOVER && !is_exit) {
+			handover_record = hand_over();
+			is_exit = true;
+		}
+	}
+
+	for(const auto seat : {PLAYER1_SOCKET, PLAYER2_SOCKET}) {
+		if(is_exit) break;
+		const auto revents = pfds[seat].revents;
+		if(revents & POLLHUP) {
+			spdlog::error("Client closed connection.");
+			player_left(seat, received_at, is_exit);
+		} else if(revents & POLLIN) {
+			receive_from(seat, received_at, is_exit);
+		} else if(revents) {
+			spdlog::error("Unknown error occurred.");
+			send_error_to_all(SERVER_DISCONNECTED);
+			is_exit = true;
+		}
+	}
+	return handover_record;
+}
+
+/**
+ * @brief Reads from the socket of a seat without blocking and handles the message once its frame is complete.
+ * A peer that stops in the middle of a frame only leaves its bytes in the decoder, the session keeps serving events.
+ * @param seat The seat.
+ * @param received_at The monotonic time the bytes were received.
+ * @param is_exit Reference to an atomic boolean flag indicating if the game session should exit.
+ */
+void SessionData::receive_from(SocketNumber seat, GameClock::Clock::time_point received_at, std::atomic<bool>& is_exit) {
+	MessageStorage message{};
+	try {
+		if(!try_receive_message(player_sockets[seat], decoders[seat], message, player_sockets[seat].getProtocolVersion())) {
+			return;
+		}
+	} catch(const std::exception& e) {
+		spdlog::error("Failed to receive from player {}: {}", int(seat) + 1, e.what());
+		player_left(seat, received_at, is_exit);
+		return;
+	}
+	// Heartbeats keep the connection alive, not the game.
+	if(message.message_type != PING && message.message_type != PONG) {
+		touch();
+	}
+	handle_message(seat, message, is_exit, received_at);
 }
 
 /**
@@ -156,29 +856,52 @@ SessionData::SessionData(Socket player1_socket, Socket player2_socket) {
  * @param socket_number The socket number (0 or 1) indicating the player.
  * @param message The received message.
  * @param is_exit Reference to an atomic boolean flag indicating if the game session should exit.
+ * @param received_at The monotonic time the message was received, charged to the player's clock.
  */
-void SessionData::handle_message(SocketNumber socket_number, const struct MessageStorage& message, std::atomic<bool>& is_exit) {
+void SessionData::handle_message(SocketNumber socket_number, const struct MessageStorage& message, std::atomic<bool>& is_exit,
+                                 GameClock::Clock::time_point received_at) {
 		switch(message.message_type) {
 			case MOVE: {
+				if(check_flag(received_at, is_exit)) break;
 				Move move;
 				move.from = SpotIndex(message.payload[0]);
 				move.to = SpotIndex(message.payload[1]);
 				move.type = MoveType(message.payload[2]);
-				if(engine.is_valid(move)) {
+				const Color player_color = socket_number == PLAYER1_SOCKET ? WHITE : BLACK;
+				if(engine.turn == player_color && engine.is_valid(move)) {
 					engine.make_move(move);
-					send_message(player_sockets[!socket_number], message);
+					history.push_back(move);
+					positions.push(engine);
+					last_move_at = received_at;
+					send_to(SocketNumber(!socket_number), [&](Socket& socket) { send_message(socket, message); });
+					broadcast(message, true);
+					if(check_game_over(is_exit)) break;
+					if(clock.is_timed() && engine.turn != player_color) {
+						clock.switch_turn(received_at);
+						start_clock(received_at);
+					}
+					snapshot();
 				} else {
-					send_error(player_sockets[0], ErrorType::INVALID_MOVE);
-					send_error(player_sockets[1], ErrorType::INVALID_MOVE);
+					send_error_to_all(ErrorType::INVALID_MOVE);
 					is_exit = true;
 				}
 				break;
 			}
 			case RESIGN: {
-				send_message(player_sockets[!socket_number], message);
+				result = socket_number == PLAYER1_SOCKET ? BLACK_WON : WHITE_WON;
+				send_to(SocketNumber(!socket_number), [&](Socket& socket) { send_message(socket, message); });
+				broadcast(message);
 				is_exit = true;
 				break;
 			}
+			case PING: {
+				send_to(socket_number, [&](Socket& socket) { send_pong(socket, message); });
+				break;
+			}
+			case PONG: {
+				take_pong(socket_number, message, received_at);
+				break;
+			}
 			default: {
 				spdlog::error("Unknown message type received {}.", message.message_type);
 				break;
@@ -0,0 +1,129 @@
+/**
+ * @file handover_record.cpp
+ * @brief Implementation of the hand-over records.
+ */
+
+#include "handover_record.h"
+
+#include "game_record.h"
+
+#include <algorithm>
+#include <span>
+
+/**
+ * @brief Appends a big-endian 16-bit field.
+ * @param value The value.
+ */
+void HandoverRecord::put_u16(uint16_t value) {
+  put_u8(uint8_t(value >> 8));
+  put_u8(uint8_t(value));
+}
+
+/**
+ * @brief Appends a big-endian 32-bit field.
+ * @param value The value.
+ */
+void HandoverRecord::put_u32(uint32_t value) {
+  put_u16(uint16_t(value >> 16));
+  put_u16(uint16_t(value));
+}
+
+/**
+ * @brief Appends a big-endian 64-bit field.
+ * @param value The value.
+ */
+void HandoverRecord::put_u64(uint64_t value) {
+  put_u32(uint32_t(value >> 32));
+  put_u32(uint32_t(value));
+}
+
+/**
+ * @brief Appends a move count and the moves in the game log encoding.
+ * @param moves The moves.
+ */
+void HandoverRecord::put_moves(const std::vector<Move>& moves) {
+  put_u32(uint32_t(moves.size()));
+  for (const Move& move : moves) {
+    encode_move(move, bytes);
+  }
+}
+
+/**
+ * @brief Appends a byte count and the received bytes of an unfinished frame.
+ * @param received The bytes, at most 255.
+ */
+void HandoverRecord::put_received(std::span<const uint8_t> received) {
+  put_u8(uint8_t(received.size()));
+  bytes.insert(bytes.end(), received.begin(), received.end());
+}
+
+/**
+ * @brief Reads an 8-bit field.
+ * @return The value, zero past the end of the record.
+ */
+uint8_t HandoverReader::u8() {
+  if (offset >= record.bytes.size()) {
+    is_ok = false;
+    return 0;
+  }
+  return record.bytes[offset++];
+}
+
+/**
+ * @brief Reads a big-endian 16-bit field.
+ * @return The value, zero past the end of the record.
+ */
+uint16_t HandoverReader::u16() {
+  const uint16_t high = u8();
+  return uint16_t(high << 8 | u8());
+}
+
+/**
+ * @brief Reads a big-endian 32-bit field.
+ * @return The value, zero past the end of the record.
+ */
+uint32_t HandoverReader::u32() {
+  const uint32_t high = u16();
+  return high << 16 | u16();
+}
+
+/**
+ * @brief Reads a big-endian 64-bit field.
+ * @return The value, zero past the end of the record.
+ */
+uint64_t HandoverReader::u64() {
+  const uint64_t high = u32();
+  return high << 32 | u32();
+}
+
+/**
+ * @brief Reads a move count and the moves.
+ * @return The moves.
+ */
+std::vector<Move> HandoverReader::moves() {
+  const uint32_t count = u32();
+  std::vector<Move> moves;
+  for (uint32_t i = 0; i < count && is_ok; ++i) {
+    Move move;
+    const size_t used = decode_move(std::span(record.bytes).subspan(std::min(offset, record.bytes.size())), move);
+    if (used == 0) {
+      is_ok = false;
+      break;
+    }
+    offset += used;
+    moves.push_back(move);
+  }
+  return moves;
+}
+
+/**
+ * @brief Reads a byte count and the received bytes of an unfinished frame.
+ * @return The bytes.
+ */
+std::vector<uint8_t> HandoverReader::received() {
+  std::vector<uint8_t> received(u8());
+  for (uint8_t& byte : received) {
+    byte = u8();
+  }
+  return received;
+}
@@ -0,0 +1,266 @@
+/**
+ * @file hot_restart.cpp
+ * @brief Implementation of the hand-over of a running server to a new server process.
+ */
+
+#include "hot_restart.h"
+
+#include "game_session.h"
+#include "lobby_id_allocator.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief Maximum size of a record, a game of the longest possible length fits easily.
+ */
+constexpr size_t MAX_RECORD_BYTES = 64 * 1024;
+
+/**
+ * @brief Fills the address of a Unix socket path.
+ * @param path The path.
+ * @return The address.
+ * @throws std::runtime_error if the path is too long.
+ */
+sockaddr_un unix_address(const char* path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof address.sun_path) {
+    throw std::runtime_error("Upgrade socket path is too long: " + std::string(path));
+  }
+  strcpy(address.sun_path, path);
+  return address;
+}
+
+}
+
+/**
+ * @brief Adopts a descriptor received in a record as a non-blocking socket.
+ * @param fd The descriptor.
+ * @return The socket with its peer address, an empty address if the peer is already gone.
+ */
+Socket adopt_socket(int fd) {
+  sockaddr_storage address{};
+  socklen_t length = sizeof address;
+  Socket socket = getpeername(fd, (sockaddr*)&address, &length) == -1 ? Socket(fd) : Socket(fd, address);
+  socket.setNonBlocking();
+  return socket;
+}
+
+/**
+ * @brief Connects to the server accepting successors on a path.
+ * @param path The path of the upgrade socket.
+ * @return The channel.
+ * @throws std::runtime_error if nothing accepts on the path.
+ */
+HandoverChannel HandoverChannel::connect(const char* path) {
+  const sockaddr_un address = unix_address(path);
+  HandoverChannel channel(socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0));
+  if (channel.fd == -1 || ::connect(channel.fd, (const sockaddr*)&address, sizeof address) == -1) {
+    throw std::runtime_error("Failed to connect to " + std::string(path) + ": " + strerror(errno));
+  }
+  return channel;
+}
+
+/**
+ * @brief Closes the connection.
+ */
+HandoverChannel::~HandoverChannel() {
+  if (fd != -1) {
+    ::close(fd);
+  }
+}
+
+/**
+ * @brief Sends a record with its descriptors. The descriptors stay open in this process.
+ * @param record The record.
+ * @throws std::runtime_error if the record could not be sent.
+ */
+void HandoverChannel::send(const HandoverRecord& record) {
+  if (record.bytes.size() + 1 > MAX_RECORD_BYTES || record.fds.size() > HANDOVER_MAX_FDS) {
+    throw std::runtime_error("Hand-over record is too large.");
+  }
+  const uint8_t kind = record.kind;
+  iovec parts[2] = {{(void*)&kind, 1}, {(void*)record.bytes.data(), record.bytes.size()}};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * HANDOVER_MAX_FDS)]{};
+
+  msghdr message{};
+  message.msg_iov = parts;
+  message.msg_iovlen = 2;
+  if (!record.fds.empty()) {
+    message.msg_control = control;
+    message.msg_controllen = CMSG_SPACE(sizeof(int) * record.fds.size());
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int) * record.fds.size());
+    memcpy(CMSG_DATA(header), record.fds.data(), sizeof(int) * record.fds.size());
+  }
+  if (sendmsg(fd, &message, MSG_NOSIGNAL) == -1) {
+    throw std::runtime_error("Failed to send hand-over record: " + std::string(strerror(errno)));
+  }
+}
+
+/**
+ * @brief Receives the next record.
+ * @return The record, its descriptors are owned by the caller.
+ * @throws std::runtime_error if the connection failed, closed or the record was truncated.
+ */
+HandoverRecord HandoverChannel::receive() {
+  std::vector<uint8_t> buffer(MAX_RECORD_BYTES);
+  iovec part{buffer.data(), buffer.size()};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * HANDOVER_MAX_FDS)]{};
+
+  msghdr message{};
+  message.msg_iov = &part;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof control;
+  const ssize_t received = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+  if (received <= 0) {
+    throw std::runtime_error(received == 0 ? "Hand-over connection closed."
+                                           : "Failed to receive hand-over record: " + std::string(strerror(errno)));
+  }
+
+  HandoverRecord record;
+  for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+    if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+      const size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      record.fds.resize(count);
+      memcpy(record.fds.data(), CMSG_DATA(header), sizeof(int) * count);
+    }
+  }
+  if (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+    for (const int received_fd : record.fds) {
+      ::close(received_fd);
+    }
+    throw std::runtime_error("Hand-over record was truncated.");
+  }
+  record.kind = HandoverKind(buffer[0]);
+  record.bytes.assign(buffer.begin() + 1, buffer.begin() + received);
+  return record;
+}
+
+/**
+ * @brief Bounds how long receive() waits for the next record.
+ * @param timeout The maximum time to wait, zero waits forever.
+ * @throws std::runtime_error if the timeout could not be set.
+ */
+void HandoverChannel::set_receive_timeout(std::chrono::milliseconds timeout) {
+  timeval tv{};
+  tv.tv_sec = timeout.count() / 1000;
+  tv.tv_usec = (timeout.count() % 1000) * 1000;
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv) == -1) {
+    throw std::runtime_error("Failed to set hand-over timeout: " + std::string(strerror(errno)));
+  }
+}
+
+/**
+ * @brief Opens the socket successors connect to, replacing a stale one.
+ * @param path The path of the upgrade socket.
+ * @return The listening descriptor.
+ * @throws std::runtime_error if the socket could not be opened.
+ */
+int open_upgrade_listener(const char* path) {
+  const sockaddr_un address = unix_address(path);
+  const int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (listener == -1) {
+    throw std::runtime_error("Failed to create upgrade socket: " + std::string(strerror(errno)));
+  }
+  unlink(path);
+  if (bind(listener, (const sockaddr*)&address, sizeof address) == -1 || listen(listener, 1) == -1) {
+    const std::string error = strerror(errno);
+    ::close(listener);
+    throw std::runtime_error("Failed to open upgrade socket " + std::string(path) + ": " + error);
+  }
+  return listener;
+}
+
+/**
+ * @brief Enrolls a running session.
+ * @param events The events of the session.
+ * @return The ticket the session leaves with.
+ */
+uint64_t SessionHandover::enroll(const std::shared_ptr<SessionEvents>& events) {
+  std::scoped_lock<std::mutex> lock(mutex);
+  const uint64_t ticket = next_ticket++;
+  sessions.emplace(ticket, events);
+  if (sticky_events != 0) {
+    events->post(SessionEvent(sticky_events));
+  }
+  return ticket;
+}
+
+/**
+ * @brief Removes a session that ended, or stopped to hand its game over.
+ * @param ticket The ticket of the session.
+ * @param record The record of the game, nothing if the game ended.
+ */
+void SessionHandover::leave(uint64_t ticket, std::optional<HandoverRecord> record) {
+  {
+    std::scoped_lock<std::mutex> lock(mutex);
+    sessions.erase(ticket);
+    if (record) {
+      records.push_back(std::move(*record));
+    }
+  }
+  session_left.notify_all();
+}
+
+/**
+ * @brief Asks every session to hand its game over and waits for all of them to leave.
+ * Sessions still running after the timeout are left to die with the process.
+ * @param timeout The maximum time to wait.
+ * @return The records of the handed over games.
+ */
+std::vector<HandoverRecord> SessionHandover::collect(std::chrono::milliseconds timeout) {
+  post_to_all(HANDOVER);
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!session_left.wait_for(lock, timeout, [this] { return sessions.empty(); })) {
+    spdlog::error("{} sessions did not hand over within {} ms.", sessions.size(), timeout.count());
+  }
+  return std::exchange(records, {});
+}
+
+/**
+ * @brief Posts an event to every enrolled session and to every session enrolling later.
+ * @param event The event.
+ */
+void SessionHandover::post_to_all(SessionEvent event) {
+  std::scoped_lock<std::mutex> lock(mutex);
+  sticky_events |= event;
+  for (const auto& [ticket, weak_events] : sessions) {
+    if (auto events = weak_events.lock()) {
+      events->post(event);
+    }
+  }
+}
+
+/**
+ * @brief Stops posting an event to sessions enrolling later, once a hand-over failed and the games run here again.
+ * @param event The event.
+ * @return The records of the sessions that handed over after collect() gave up waiting.
+ */
+std::vector<HandoverRecord> SessionHandover::withdraw(SessionEvent event) {
+  std::scoped_lock<std::mutex> lock(mutex);
+  sticky_events &= ~uint32_t(event);
+  return std::exchange(records, {});
+}
+
+/**
+ * @brief Gets the number of enrolled sessions.
+ * @return The number of running games.
+ */
+size_t SessionHandover::running() const {
+  std::scoped_lock<std::mutex> lock(mutex);
+  return sessions.size();
+}
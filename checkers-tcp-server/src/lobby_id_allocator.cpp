@@ -0,0 +1,122 @@
+/**
+ * @file lobby_id_allocator.cpp
+ * @brief Implementation of the allocator of lobby and game IDs.
+ */
+
+#include "lobby_id_allocator.h"
+
+#include "handover_record.h"
+
+#include <random>
+
+namespace {
+
+/**
+ * @brief Number of bits of each half of the Feistel network.
+ */
+constexpr unsigned HALF_BITS = LobbyIdAllocator::COUNTER_BITS / 2;
+
+/**
+ * @brief Mask of a half of the Feistel network.
+ */
+constexpr uint32_t HALF_MASK = (1u << HALF_BITS) - 1;
+
+static_assert(LobbyIdAllocator::COUNTER_BITS % 2 == 0, "The Feistel network needs equal halves.");
+
+/**
+ * @brief The splitmix64 finalizer, used to derive the round keys and as the round function.
+ * @param value The value to mix.
+ * @return The mixed value.
+ */
+constexpr uint64_t mix64(uint64_t value) {
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9u;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebu;
+  return value ^ (value >> 31);
+}
+
+}
+
+/**
+ * @brief Constructs an allocator with a random key.
+ */
+LobbyIdAllocator::LobbyIdAllocator() : LobbyIdAllocator([] {
+  std::random_device rd;
+  return (uint64_t(rd()) << 32) | rd();
+}()) {}
+
+/**
+ * @brief Constructs an allocator with a given key.
+ * @param key The key of the permutation.
+ */
+LobbyIdAllocator::LobbyIdAllocator(uint64_t key) {
+  set_key(key);
+}
+
+/**
+ * @brief Derives the round keys from the key.
+ * @param new_key The key.
+ */
+void LobbyIdAllocator::set_key(uint64_t new_key) {
+  key = new_key;
+  for (auto& round_key : round_keys) {
+    new_key += 0x9e3779b97f4a7c15u;
+    round_key = mix64(new_key);
+  }
+}
+
+/**
+ * @brief Permutes a counter value with the keyed Feistel network.
+ * @param counter The counter value, less than 2^COUNTER_BITS.
+ * @param shard The shard, it selects one of SHARDS permutations.
+ * @return The permuted value, less than 2^COUNTER_BITS.
+ */
+uint32_t LobbyIdAllocator::permute(uint32_t counter, unsigned shard) const {
+  // The round function only sees the right half; the shard sits above it, so each shard's rounds differ.
+  const uint64_t tweak = uint64_t(shard) << 32;
+  uint32_t left = counter >> HALF_BITS;
+  uint32_t right = counter & HALF_MASK;
+  for (const uint64_t round_key : round_keys) {
+    const uint32_t next_right = left ^ (uint32_t(mix64(round_key ^ tweak ^ right)) & HALF_MASK);
+    left = right;
+    right = next_right;
+  }
+  return (left << HALF_BITS) | right;
+}
+
+/**
+ * @brief Allocates the next ID of a shard.
+ * @param shard The shard, less than SHARDS.
+ * @return The non-zero ID.
+ */
+uint32_t LobbyIdAllocator::allocate(unsigned shard) {
+  constexpr uint32_t counter_mask = (uint32_t(1) << COUNTER_BITS) - 1;
+  uint32_t id = 0;
+  while (id == 0) {
+    // Zero means "no lobby" on the wire; only shard 0 can produce it, once per counter cycle.
+    const uint32_t counter = shards[shard].counter.fetch_add(1, std::memory_order_relaxed) & counter_mask;
+    id = (uint32_t(shard) << COUNTER_BITS) | permute(counter, shard);
+  }
+  return id;
+}
+
+/**
+ * @brief Writes the key and the counters to a hand-over record.
+ * @param record The record.
+ */
+void LobbyIdAllocator::save(HandoverRecord& record) const {
+  record.put_u64(key);
+  for (const auto& shard : shards) {
+    record.put_u32(shard.counter.load(std::memory_order_relaxed));
+  }
+}
+
+/**
+ * @brief Continues the sequences written by save().
+ * @param reader The reader of the record.
+ */
+void LobbyIdAllocator::load(HandoverReader& reader) {
+  set_key(reader.u64());
+  for (auto& shard : shards) {
+    shard.counter.store(reader.u32(), std::memory_order_relaxed);
+  }
+}
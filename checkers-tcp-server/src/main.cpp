@@ -6,29 +6,131 @@
 #define FMT_HEADER_ONLY
 #define FMTLOG_HEADER_ONLY
 
+#include "bot_session.h"
+#include "connection_rtt.h"
 #include "game_session.h"
+#include "hot_restart.h"
+#include "lobby_id_allocator.h"
 #include "message_handler.h"
+#include "matchmaker.h"
+#include "message_format.h"
+#include "session_memory.h"
+#include "session_registry.h"
+#include "session_snapshots.h"
+#include "session_workers.h"
+#include "spectator_hub.h"
+#include "timer_service.h"
+#include "worker_pool.h"
 
 #include "spdlog/spdlog.h"
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
-#include <random>
+#include <memory>
+#include <optional>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 #include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * @brief Time a new connection has to send its handshake.
+ */
+constexpr auto HANDSHAKE_TIMEOUT = std::chrono::seconds(10);
+
+/**
+ * @brief Time a created lobby waits for the second player.
+ */
+constexpr auto LOBBY_TTL = std::chrono::minutes(15);
+
+/**
+ * @brief Directory finished games are logged to.
+ */
+constexpr const char* GAME_LOG_DIRECTORY = "games";
+
+/**
+ * @brief Time running games have to finish once the server drains.
+ */
+constexpr auto DRAIN_TIMEOUT = std::chrono::minutes(2);
+
+/**
+ * @brief Time the games closed at the drain deadline have to leave and the spectators to receive their last frames.
+ */
+constexpr auto DRAIN_FLUSH_TIMEOUT = std::chrono::seconds(5);
+
+/**
+ * @brief Interval at which a draining server checks whether its games ended.
+ */
+constexpr auto DRAIN_CHECK_INTERVAL = std::chrono::milliseconds(200);
+
+/**
+ * @brief Interval at which a draining server logs its progress.
+ */
+constexpr auto DRAIN_REPORT_INTERVAL = std::chrono::seconds(5);
+
+/**
+ * @brief Maximum number of bot searches waiting for a worker.
+ */
+constexpr size_t BOT_MAX_QUEUED = 4096;
 
 Socket server_socket;
+static TimerService timer_service;
+static WorkerPool bot_pool(std::thread::hardware_concurrency() / 2, BOT_MAX_QUEUED);
+static SessionRegistry session_registry;
+static SpectatorHub spectator_hub;
+static SessionHandover session_handover;
+static SessionWorkers session_workers(std::thread::hardware_concurrency() / 2, session_handover);
+static std::unique_ptr<GameLogWriter> game_log;
+static std::unique_ptr<SessionSnapshots> session_snapshots;
+static RttHistogram rtt_histogram;
+static SessionServices session_services{timer_service, session_registry, spectator_hub, session_handover, session_workers};
+
+/**
+ * @brief Number of ID shards of lobbies created by players, the only ones a player can join.
+ * Each of them has its own lobby map and lock, see LobbiesList.
+ */
+static constexpr unsigned LOBBY_SHARDS = LobbyIdAllocator::SHARDS - 1;
+
+/**
+ * @brief Shard of the IDs of games started by the matchmaker, the last one.
+ */
+static constexpr unsigned MATCHED_GAME_SHARD = LobbyIdAllocator::SHARDS - 1;
 
 /**
- * @brief Generates a random ID.
- * @return The generated random ID.
+ * @brief Allocates the IDs of lobbies and matched games, which share the spectator hub and the logs.
  */
-uint32_t random_id() {
-	static std::random_device rd;
-	static std::mt19937 mt(rd());
-	static std::uniform_int_distribution<uint32_t> dist(1, UINT32_MAX);
-	return dist(rd);
+static LobbyIdAllocator lobby_ids;
+
+/**
+ * @brief Starts an untimed game between two players paired by the matchmaker.
+ * @param player1 The socket of the player playing white.
+ * @param player2 The socket of the player playing black.
+ */
+void start_matched_game(Socket player1, Socket player2) {
+	const uint32_t game_id = lobby_ids.allocate(MATCHED_GAME_SHARD);
+	start_game_session(player1, player2, nullptr, game_id, session_services, TimeControl{});
+}
+
+static Matchmaker matchmaker(start_matched_game);
+
+/**
+ * @brief Closes a socket, logging instead of throwing on failure.
+ * @param socket The socket to close.
+ */
+void close_socket(Socket& socket) {
+	try {
+		socket.close();
+	} catch (const std::exception& e) {
+		spdlog::warn("Failed to close socket: {}", e.what());
+	}
 }
 
 /**
@@ -40,13 +142,18 @@ struct LobbyInfo {
 	Socket player1{};
 	Socket player2{};
 	std::atomic<bool> is_closed = false;
+	TimerService::TimerId expiry_timer = TimerWheel::INVALID_TIMER;
+	TimeControl time_control{};
+	FrameDecoder decoder{};
 
 	/**
 	 * @brief Constructs a LobbyInfo object with the given lobby ID and player socket.
 	 * @param lobby_id The ID of the lobby.
 	 * @param _player1 The socket of player 1.
+	 * @param time_control The time control requested by player 1.
 	 */
-	LobbyInfo(uint32_t lobby_id, Socket _player1) : lobby_id(lobby_id), player1(_player1) {}
+	LobbyInfo(uint32_t lobby_id, Socket _player1, TimeControl time_control = {})
+		: lobby_id(lobby_id), player1(_player1), time_control(time_control) {}
 
 	/**
 	 * @brief Default constructor for LobbyInfo.
@@ -76,20 +183,33 @@ struct LobbyInfo {
 	}
 
 	/**
-	 * @brief Starts the game session in a separate thread.
+	 * @brief Starts the game session on a session worker.
+	 * @param on_finished Called on the worker thread once the game is over and the lobby is no longer used.
 	 */
-	void start_game() {
-		std::thread session_thread(game_session_routine, player1, player2, std::ref(is_closed), lobby_id);
-		session_thread.detach();
+	void start_game(std::function<void()> on_finished) {
+		start_game_session(player1, player2, &is_closed, lobby_id, session_services, time_control, decoder.pending(),
+		                   std::move(on_finished));
 	}
 };
 
 /**
- * @brief Structure representing the list of lobbies.
+ * @brief Structure representing the lobbies of one ID shard.
  */
-struct LobbiesList {
+struct LobbyShard {
 	std::unordered_map <uint32_t, LobbyInfo> lobbies;
 	std::mutex list_mutex;
+};
+
+/**
+ * @brief Structure representing the list of lobbies.
+ *
+ * The lobbies are split by the shard bits of their IDs, and every shard has its own map and lock.
+ * A join decodes the shard from the ID it was given and only locks that shard, so joins and
+ * finished games in different shards don't wait for each other. New lobbies take the shards in turn.
+ */
+struct LobbiesList {
+	std::array<LobbyShard, LOBBY_SHARDS> shards;
+	std::atomic<unsigned> next_shard = 0;
 
 	/**
 	 * @brief Default constructor for LobbiesList.
@@ -99,22 +219,59 @@ struct LobbiesList {
 	/**
 	 * @brief Adds a lobby to the list.
 	 * @param player_sock The socket of the player creating the lobby.
-	 * @return The ID of the added lobby.
+	 * @param time_control The time control requested by the player.
+	 * @return The ID of the added lobby, 0 if it could not be added.
 	 */
-	uint32_t add_lobby(Socket player_sock) {
-		std::scoped_lock<std::mutex> lock(list_mutex);
-
-		uint32_t lobby_id = random_id();
-		while (lobbies.find(lobby_id) != lobbies.end()) {
-			lobby_id = random_id();
+	uint32_t add_lobby(Socket player_sock, TimeControl time_control) {
+		const uint32_t lobby_id = lobby_ids.allocate(next_shard.fetch_add(1, std::memory_order_relaxed) % LOBBY_SHARDS);
+		if (!insert_lobby(lobby_id, player_sock, time_control)) {
+			// Only possible once the shard counter wrapped with the lobby still open.
+			spdlog::error("Lobby id {:X} is already in use.", lobby_id);
+			return 0;
 		}
 		spdlog::info("Adding new lobby with id: {} ({:X})", lobby_id, lobby_id);
-		lobbies.emplace(std::piecewise_construct,
-										std::forward_as_tuple(lobby_id),
-										std::forward_as_tuple(lobby_id, player_sock));
 		return lobby_id;
 	}
 
+	/**
+	 * @brief Adds a lobby handed over by the previous server process. It waits LOBBY_TTL again.
+	 * @param lobby_id The ID of the lobby.
+	 * @param player_sock The socket of the player who created the lobby.
+	 * @param time_control The time control requested by the player.
+	 * @return True if the lobby was added, false if the ID is taken or isn't a lobby ID.
+	 */
+	bool restore_lobby(uint32_t lobby_id, Socket player_sock, TimeControl time_control) {
+		return insert_lobby(lobby_id, player_sock, time_control);
+	}
+
+	/**
+	 * @brief Removes the lobbies still waiting for the second player to hand them over to a new server process.
+	 * @param records The vector to append the HANDOVER_LOBBY records to.
+	 */
+	void hand_over_waiting(std::vector<HandoverRecord>& records) {
+		for (auto& [lobbies, list_mutex] : shards) {
+			std::scoped_lock<std::mutex> lock(list_mutex);
+
+			for (auto lobby_it = lobbies.begin(); lobby_it != lobbies.end();) {
+				LobbyInfo& lobby = lobby_it->second;
+				if (lobby.is_lobby_full()) {
+					++lobby_it;
+					continue;
+				}
+				timer_service.cancel(lobby.expiry_timer);
+				HandoverRecord record{HANDOVER_LOBBY};
+				record.put_u32(lobby.lobby_id);
+				record.put_u16(lobby.time_control.base_seconds);
+				record.put_u16(lobby.time_control.increment_seconds);
+				record.put_u8(lobby.player1.getProtocolVersion());
+				record.put_u32(lobby.player1.getCapabilities());
+				record.fds.push_back(lobby.player1.getSocketFd());
+				records.push_back(std::move(record));
+				lobby_it = lobbies.erase(lobby_it);
+			}
+		}
+	}
+
 	/**
 	 * @brief Adds a player to a lobby.
 	 * @param player_socket The socket of the player.
@@ -122,106 +279,918 @@ struct LobbiesList {
 	 * @return 0 if the player was added successfully, -1 if the lobby does not exist.
 	 */
 	int add_player_to_lobby(Socket player_socket, uint32_t lobby_id) {
-		std::scoped_lock<std::mutex> lock(list_mutex);
+		LobbyShard* shard = find_shard(lobby_id);
+		if (shard == nullptr) {
+			return -1;
+		}
+		auto& lobbies = shard->lobbies;
+		std::scoped_lock<std::mutex> lock(shard->list_mutex);
 
 		auto lobby_it = lobbies.find(lobby_id);
-		if (lobby_it == lobbies.end()) {
+		if (lobby_it == lobbies.end() || lobby_it->second.is_lobby_full()) {
 			return -1;
 		}
 		spdlog::info("Adding new player {} to lobby with id {}", player_socket.getAddressString(), lobby_id);
+		timer_service.cancel(lobby_it->second.expiry_timer);
 		lobby_it->second.add_player2(player_socket);
-		lobby_it->second.start_game();
+		lobby_it->second.start_game([this, lobby_id] { finish_game(lobby_id); });
 		return 0;
 	}
 
+	/**
+	 * @brief Reads a message the creator of a waiting lobby sent, without blocking. Nothing is expected
+	 * before the game starts, so the message is logged and dropped.
+	 * @param lobby_id The ID of the lobby.
+	 * @return False if the creator left or sent a malformed frame, true otherwise.
+	 */
+	bool read_waiting_player(uint32_t lobby_id) {
+		LobbyShard* shard = find_shard(lobby_id);
+		if (shard == nullptr) {
+			return true;
+		}
+		auto& lobbies = shard->lobbies;
+		std::scoped_lock<std::mutex> lock(shard->list_mutex);
+
+		auto lobby_it = lobbies.find(lobby_id);
+		if (lobby_it == lobbies.end() || lobby_it->second.is_lobby_full()) {
+			return true;
+		}
+		LobbyInfo& lobby = lobby_it->second;
+		try {
+			MessageStorage message{};
+			if (try_receive_message(lobby.player1, lobby.decoder, message, lobby.player1.getProtocolVersion())) {
+				spdlog::warn("Ignoring {} from player waiting in lobby {}.", message, lobby_id);
+			}
+		} catch (const std::exception& e) {
+			spdlog::warn("Failed to read from player waiting in lobby {}: {}", lobby_id, e.what());
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Frees the lobby of a finished game. Called by the session worker of the game.
+	 * @param lobby_id The ID of the lobby.
+	 */
+	void finish_game(uint32_t lobby_id) {
+		LobbyShard* shard = find_shard(lobby_id);
+		if (shard == nullptr) {
+			return;
+		}
+		auto& lobbies = shard->lobbies;
+		std::scoped_lock<std::mutex> lock(shard->list_mutex);
+
+		lobbies.erase(lobby_id);
+	}
+
 	/**
 	 * @brief Removes a lobby from the list.
 	 * @param lobby_id The ID of the lobby to remove.
 	 */
-	void remove_lobby(int lobby_id) {
-		std::scoped_lock<std::mutex> lock(list_mutex);
+	void remove_lobby(uint32_t lobby_id) {
+		LobbyShard* shard = find_shard(lobby_id);
+		if (shard == nullptr) {
+			return;
+		}
+		auto& lobbies = shard->lobbies;
+		std::scoped_lock<std::mutex> lock(shard->list_mutex);
 
-		lobbies.at(lobby_id).is_closed = true;
+		auto& lobby = lobbies.at(lobby_id);
+		timer_service.cancel(lobby.expiry_timer);
+		lobby.is_closed = true;
 		lobbies.erase(lobby_id);
 	}
 
+	/**
+	 * @brief Closes a lobby nobody joined within LOBBY_TTL. Called by its expiry timer.
+	 * @param lobby_id The ID of the lobby.
+	 */
+	void expire_lobby(uint32_t lobby_id) {
+		LobbyShard* shard = find_shard(lobby_id);
+		if (shard == nullptr) {
+			return;
+		}
+		auto& lobbies = shard->lobbies;
+		std::scoped_lock<std::mutex> lock(shard->list_mutex);
+
+		auto lobby_it = lobbies.find(lobby_id);
+		if (lobby_it == lobbies.end() || lobby_it->second.is_lobby_full()) {
+			return;
+		}
+		spdlog::info("Lobby {} expired.", lobby_id);
+		try {
+			send_error(lobby_it->second.player1, ErrorType::LOBBY_EXPIRED);
+		} catch (const std::exception& e) {
+			spdlog::warn("Failed to notify player about expired lobby: {}", e.what());
+		}
+		close_socket(lobby_it->second.player1);
+		lobbies.erase(lobby_it);
+	}
+
+	/**
+	 * @brief Closes a lobby whose creator left before anybody joined.
+	 * @param lobby_id The ID of the lobby.
+	 */
+	void drop_waiting_lobby(uint32_t lobby_id) {
+		LobbyShard* shard = find_shard(lobby_id);
+		if (shard == nullptr) {
+			return;
+		}
+		auto& lobbies = shard->lobbies;
+		std::scoped_lock<std::mutex> lock(shard->list_mutex);
+
+		auto lobby_it = lobbies.find(lobby_id);
+		if (lobby_it == lobbies.end() || lobby_it->second.is_lobby_full()) {
+			return;
+		}
+		spdlog::info("Creator of lobby {} disconnected.", lobby_id);
+		timer_service.cancel(lobby_it->second.expiry_timer);
+		close_socket(lobby_it->second.player1);
+		lobbies.erase(lobby_it);
+	}
+
+	/**
+	 * @brief Collects the lobbies still waiting for the second player.
+	 * @param waiting The vector to fill with lobby ID and creator socket pairs.
+	 */
+	void collect_waiting(std::vector<std::pair<uint32_t, Socket>>& waiting) {
+		for (auto& [lobbies, list_mutex] : shards) {
+			std::scoped_lock<std::mutex> lock(list_mutex);
+
+			for (const auto& [lobby_id, lobby]: lobbies) {
+				if (!lobby.is_lobby_full()) {
+					waiting.emplace_back(lobby_id, lobby.player1);
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Closes the lobbies still waiting for the second player, telling their creators why.
+	 * @param reason The error sent to the creators.
+	 * @return The number of closed lobbies.
+	 */
+	size_t close_waiting(ErrorType reason) {
+		size_t closed_count = 0;
+		for (auto& [lobbies, list_mutex] : shards) {
+			std::scoped_lock<std::mutex> lock(list_mutex);
+
+			for (auto lobby_it = lobbies.begin(); lobby_it != lobbies.end();) {
+				LobbyInfo& lobby = lobby_it->second;
+				if (lobby.is_lobby_full()) {
+					++lobby_it;
+					continue;
+				}
+				timer_service.cancel(lobby.expiry_timer);
+				try {
+					send_error(lobby.player1, reason);
+				} catch (const std::exception& e) {
+					spdlog::warn("Failed to notify player about closed lobby: {}", e.what());
+				}
+				close_socket(lobby.player1);
+				lobby_it = lobbies.erase(lobby_it);
+				++closed_count;
+			}
+		}
+		return closed_count;
+	}
+
 	/**
 	 * @brief Closes all lobbies in the list.
 	 */
 	void close_all() {
-		std::scoped_lock<std::mutex> lock(list_mutex);
+		for (auto& [lobbies, list_mutex] : shards) {
+			std::scoped_lock<std::mutex> lock(list_mutex);
+
+			for (auto& [lobby_id, lobby]: lobbies) {
+				lobby.is_closed = true;
+			}
+		}
+	}
+
+private:
+	/**
+	 * @brief Gets the shard owning a lobby ID.
+	 * @param lobby_id The ID of the lobby.
+	 * @return The shard, nullptr if the ID wasn't allocated in a lobby shard.
+	 */
+	LobbyShard* find_shard(uint32_t lobby_id) {
+		const unsigned shard = LobbyIdAllocator::shard_of(lobby_id);
+		return shard < LOBBY_SHARDS ? &shards[shard] : nullptr;
+	}
+
+	/**
+	 * @brief Inserts a waiting lobby and arms its expiry timer.
+	 * @param lobby_id The ID of the lobby.
+	 * @param player_sock The socket of the player who created the lobby.
+	 * @param time_control The time control requested by the player.
+	 * @return True if the lobby was inserted, false if the ID is taken.
+	 */
+	bool insert_lobby(uint32_t lobby_id, Socket player_sock, TimeControl time_control) {
+		LobbyShard* shard = find_shard(lobby_id);
+		if (shard == nullptr) {
+			return false;
+		}
+		auto& lobbies = shard->lobbies;
+		std::scoped_lock<std::mutex> lock(shard->list_mutex);
 
-		for (auto& [lobby_id, lobby]: lobbies) {
-			lobby.is_closed = true;
+		auto [lobby_it, inserted] = lobbies.emplace(std::piecewise_construct,
+										std::forward_as_tuple(lobby_id),
+										std::forward_as_tuple(lobby_id, player_sock, time_control));
+		if (inserted) {
+			lobby_it->second.expiry_timer = timer_service.arm(LOBBY_TTL, [this, lobby_id] { expire_lobby(lobby_id); });
 		}
+		return inserted;
 	}
 };
 
 static bool is_done = false;
 static LobbiesList lobbies_list;
 
+/**
+ * @brief The socket a successor connects to for a hot restart, -1 if there is none.
+ */
+static int upgrade_listener = -1;
+
+/**
+ * @brief A successor that connected and hasn't sent its HELLO yet.
+ */
+static std::optional<HandoverChannel> successor;
+
+/**
+ * @brief Drops the successor if it didn't send its HELLO within HANDOVER_TIMEOUT.
+ */
+static TimerService::TimerId successor_timer = TimerWheel::INVALID_TIMER;
+
 /**
  * @brief Cleans up resources and shuts down the server.
  */
 void cleanup() {
 	lobbies_list.close_all();
-	server_socket.close();
+	if (server_socket.getSocketFd() != -1) {
+		server_socket.close();
+	}
+	if (upgrade_listener != -1) {
+		::close(upgrade_listener);
+		unlink(UPGRADE_SOCKET_PATH);
+		upgrade_listener = -1;
+	}
 	is_done = true;
 }
 
+/**
+ * @brief Eventfd the signal handler wakes the event loop with to start the drain.
+ */
+static int drain_request_fd = -1;
+
+/**
+ * @brief Set by the first SIGINT or SIGTERM.
+ */
+static std::atomic<bool> is_drain_requested = false;
+
 /**
  * @brief Signal handler for SIGINT and SIGTERM signals.
+ * The first signal asks the event loop to drain, see begin_drain(). A second signal shuts down right away.
  * @param signum The signal number.
  */
 void signalHandler( int signum ) {
-	spdlog::info("Shutting down server...");
-	cleanup();
-	exit(signum);
+	if (is_drain_requested.exchange(true)) {
+		spdlog::info("Shutting down server...");
+		cleanup();
+		exit(signum);
+	}
+	const uint64_t one = 1;
+	[[maybe_unused]] const ssize_t written = ::write(drain_request_fd, &one, sizeof one);
+}
+
+/**
+ * @brief Progress of a draining server.
+ */
+struct DrainState {
+	bool is_draining = false;
+	bool is_deadline_passed = false;
+	std::chrono::steady_clock::time_point deadline{};
+	std::chrono::steady_clock::time_point next_report{};
+};
+
+static DrainState drain_state;
+
+/**
+ * @brief Structure representing an accepted connection that hasn't sent its handshake yet.
+ */
+struct PendingConnection {
+	Socket socket;
+	TimerService::TimerId handshake_timer = TimerWheel::INVALID_TIMER;
+	bool is_negotiated = false; /**< Whether the client already sent its HELLO. */
+	FrameDecoder decoder{}; /**< The bytes of a HELLO or handshake that hasn't fully arrived yet. */
+};
+
+static std::unordered_map<int, PendingConnection> pending_connections;
+
+/**
+ * @brief Drops a connection that didn't send its handshake within HANDSHAKE_TIMEOUT.
+ * @param socket_fd The file descriptor of the connection.
+ */
+void expire_handshake(int socket_fd) {
+	auto pending_it = pending_connections.find(socket_fd);
+	if (pending_it == pending_connections.end()) {
+		return;
+	}
+	spdlog::warn("Handshake timed out for {}", pending_it->second.socket.getAddressString());
+	close_socket(pending_it->second.socket);
+	pending_connections.erase(pending_it);
+}
+
+/**
+ * @brief Waits for the handshake of a connection, at most HANDSHAKE_TIMEOUT.
+ * The connection is read without blocking, so a client that trickles its handshake holds up nothing else.
+ * @param player_socket The socket of the connection.
+ * @param is_negotiated Whether the connection already sent its HELLO.
+ * @param received The bytes of an unfinished frame already read from the connection.
+ */
+void add_pending_connection(Socket player_socket, bool is_negotiated = false, std::span<const uint8_t> received = {}) {
+	const int socket_fd = player_socket.getSocketFd();
+	const auto timer = timer_service.arm(HANDSHAKE_TIMEOUT, [socket_fd] { expire_handshake(socket_fd); });
+	auto [pending_it, inserted] = pending_connections.emplace(socket_fd, PendingConnection{player_socket, timer, is_negotiated});
+	pending_it->second.decoder.append(received);
+}
+
+/**
+ * @brief Accepts a new connection and arms its handshake deadline.
+ */
+void accept_connection() {
+	Socket player_socket = server_socket.accept();
+	player_socket.setNonBlocking();
+	spdlog::info("Received new connection from {}", player_socket.getAddressString());
+	add_pending_connection(player_socket);
+}
+
+/**
+ * @brief Reads the handshake of a pending connection and creates or joins a lobby.
+ * @param socket_fd The file descriptor of the connection.
+ */
+void handle_handshake(int socket_fd) {
+	auto pending_it = pending_connections.find(socket_fd);
+	if (pending_it == pending_connections.end()) {
+		return;
+	}
+	PendingConnection& pending = pending_it->second;
+	const auto handshake_timer = pending.handshake_timer;
+	MessageStorage message{};
+	try {
+		// A HELLO comes first and keeps the connection waiting for its handshake under the same deadline.
+		// Both are framed v1, and nothing is handled before a whole frame arrived.
+		while (true) {
+			if (!try_receive_message(pending.socket, pending.decoder, message, PROTOCOL_V1)) {
+				return;
+			}
+			if (message.message_type != MessageType::HELLO || pending.is_negotiated) {
+				break;
+			}
+			negotiate_protocol(pending.socket, message);
+			pending.is_negotiated = true;
+		}
+	} catch (const std::exception& e) {
+		spdlog::warn("Failed to read handshake from {}: {}", pending.socket.getAddressString(), e.what());
+		timer_service.cancel(handshake_timer);
+		close_socket(pending.socket);
+		pending_connections.erase(pending_it);
+		return;
+	}
+	Socket player_socket = pending.socket;
+	pending_connections.erase(pending_it);
+	timer_service.cancel(handshake_timer);
+
+	try {
+		HandshakeResult handshake_result = parse_handshake(message);
+
+		// A draining server still lets players back into running games and spectators watch them.
+		if (drain_state.is_draining && handshake_result.handshake_type != HandshakeType::RESUME_SESSION &&
+		    handshake_result.handshake_type != HandshakeType::SPECTATE) {
+			spdlog::info("Refusing handshake from {}, the server is draining.", player_socket.getAddressString());
+			send_error(player_socket, ErrorType::SERVER_DRAINING);
+			close_socket(player_socket);
+		} else if (handshake_result.handshake_type == HandshakeType::CREATE_SESSION) {
+			spdlog::info("Player is creating new lobby.");
+			const uint32_t lobby_id = lobbies_list.add_lobby(player_socket, handshake_result.time_control);
+			if (lobby_id != 0) {
+				send_lobby_created(player_socket, lobby_id);
+			} else {
+				spdlog::error("Failed to create new lobby.");
+				send_error(player_socket, ErrorType::SERVER_ERROR);
+				close_socket(player_socket);
+			}
+		} else if (handshake_result.handshake_type == HandshakeType::CONNECT_TO_SESSION) {
+			spdlog::info("Player is connecting to lobby.");
+			// IDs of other shards are never lobbies, so they are refused without locking any shard.
+			if (lobbies_list.add_player_to_lobby(player_socket, handshake_result.lobby_id) == -1) {
+				spdlog::warn("Lobby with provided id doesn't exist.");
+				send_error(player_socket, ErrorType::LOBBY_NOT_EXISTS);
+				close_socket(player_socket);
+			}
+		} else if (handshake_result.handshake_type == HandshakeType::PLAY_AGAINST_BOT) {
+			spdlog::info("Player is starting a game against the bot.");
+			start_session_thread([player_socket, bot_level = handshake_result.bot_level] {
+				bot_session_routine(player_socket, bot_level, timer_service, bot_pool, session_handover);
+			});
+		} else if (handshake_result.handshake_type == HandshakeType::FIND_GAME) {
+			const uint16_t rating = handshake_result.rating != 0 ? handshake_result.rating : Matchmaker::DEFAULT_RATING;
+			spdlog::info("Player is looking for a game at rating {}.", rating);
+			matchmaker.enqueue(player_socket, rating);
+		} else if (handshake_result.handshake_type == HandshakeType::SPECTATE) {
+			spdlog::info("Player wants to watch lobby {}.", handshake_result.lobby_id);
+			if (!spectator_hub.watch(handshake_result.lobby_id, player_socket)) {
+				spdlog::warn("No running game to watch in lobby {}.", handshake_result.lobby_id);
+				send_error(player_socket, ErrorType::LOBBY_NOT_EXISTS);
+				close_socket(player_socket);
+			}
+		} else if (handshake_result.handshake_type == HandshakeType::RESUME_SESSION) {
+			spdlog::info("Player is resuming a game session.");
+			if (!session_registry.resume(handshake_result.resume_token, player_socket)) {
+				spdlog::warn("No game session for the provided resume token.");
+				send_error(player_socket, ErrorType::SESSION_NOT_FOUND);
+				close_socket(player_socket);
+			}
+		} else {
+			spdlog::warn("Unknown handshake type {}.", int(handshake_result.handshake_type));
+			close_socket(player_socket);
+		}
+	} catch (const std::exception& e) {
+		spdlog::warn("Failed to handle handshake from {}: {}", player_socket.getAddressString(), e.what());
+		close_socket(player_socket);
+	}
+}
+
+/**
+ * @brief Handles activity on the socket of a player waiting in a lobby.
+ * @param lobby_id The ID of the lobby.
+ * @param revents The returned poll events.
+ */
+void handle_waiting_player(uint32_t lobby_id, short revents) {
+	if (revents & (POLLHUP | POLLERR) || !lobbies_list.read_waiting_player(lobby_id)) {
+		lobbies_list.drop_waiting_lobby(lobby_id);
+	}
+}
+
+/**
+ * @brief Continues a record handed over by the previous server process.
+ * @param record The record.
+ */
+void take_over_record(HandoverRecord record) {
+	HandoverReader reader(record);
+	switch (record.kind) {
+		case HANDOVER_LISTENER:
+			if (record.fds.size() == 1) {
+				server_socket = Socket(record.fds[0]);
+				return;
+			}
+			break;
+		case HANDOVER_LOBBY_IDS:
+			lobby_ids.load(reader);
+			if (reader.ok()) return;
+			break;
+		case HANDOVER_PENDING: {
+			const bool is_negotiated = reader.u8();
+			const uint8_t version = reader.u8();
+			const uint32_t capabilities = reader.u32();
+			const std::vector<uint8_t> received = reader.received();
+			if (reader.ok() && record.fds.size() == 1) {
+				Socket socket = adopt_socket(record.fds[0]);
+				socket.setProtocol(version, capabilities);
+				add_pending_connection(socket, is_negotiated, received);
+				return;
+			}
+			break;
+		}
+		case HANDOVER_LOBBY: {
+			const uint32_t lobby_id = reader.u32();
+			TimeControl time_control;
+			time_control.base_seconds = reader.u16();
+			time_control.increment_seconds = reader.u16();
+			const uint8_t version = reader.u8();
+			const uint32_t capabilities = reader.u32();
+			if (reader.ok() && record.fds.size() == 1) {
+				Socket socket = adopt_socket(record.fds[0]);
+				socket.setProtocol(version, capabilities);
+				if (lobbies_list.restore_lobby(lobby_id, socket, time_control)) {
+					return;
+				}
+			}
+			break;
+		}
+		case HANDOVER_GAME:
+			resume_game_session(std::move(record), session_services);
+			return;
+		case HANDOVER_BOT_GAME:
+			start_session_thread([record = std::move(record)] {
+				resumed_bot_session_routine(record, timer_service, bot_pool, session_handover);
+			});
+			return;
+		default:
+			break;
+	}
+	spdlog::warn("Dropping malformed hand-over record of kind {}.", int(record.kind));
+	for (const int fd : record.fds) {
+		::close(fd);
+	}
+}
+
+/**
+ * @brief Continues the records a failed hand-over collected, so the games keep running in this process.
+ * @param records The records, including the ones already sent to the new process, which drops its copies.
+ */
+void take_back(std::vector<HandoverRecord>& records) {
+	for (auto& record : session_handover.withdraw(HANDOVER)) {
+		records.push_back(std::move(record));
+	}
+	spdlog::warn("Taking back {} records, the server keeps running.", records.size());
+	for (auto& record : records) {
+		take_over_record(std::move(record));
+	}
+	try {
+		upgrade_listener = open_upgrade_listener(UPGRADE_SOCKET_PATH);
+	} catch (const std::exception& e) {
+		spdlog::warn("Hot restart is unavailable: {}", e.what());
+	}
+}
+
+/**
+ * @brief Hands the listening socket, the waiting connections and lobbies and the running games over to a new
+ * server process, see hot_restart.h.
+ *
+ * Nothing is accepted while the records are collected, new connections wait in the listen backlog for the new
+ * process. Queued matchmaking players and spectators are not handed over, they are disconnected when this
+ * process exits. If the records can't be sent or the new process doesn't acknowledge them within
+ * HANDOVER_TIMEOUT, this process takes everything back and keeps serving.
+ * @param channel The connection from the new process, its HELLO is ready to be received.
+ * @return True if the new process took over and this one must exit without closing the sockets it handed over.
+ */
+bool hand_over(HandoverChannel& channel) {
+	channel.set_receive_timeout(HANDOVER_TIMEOUT);
+	const HandoverRecord hello = channel.receive();
+	HandoverReader hello_reader(hello);
+	if (hello.kind != HANDOVER_HELLO || hello_reader.u8() != HANDOVER_VERSION) {
+		spdlog::error("The new server process speaks another hand-over version, not handing over.");
+		return false;
+	}
+	spdlog::info("Handing the server over to a new process.");
+	::close(upgrade_listener);
+	upgrade_listener = -1;
+
+	std::vector<HandoverRecord> records;
+	HandoverRecord listener{HANDOVER_LISTENER};
+	listener.fds.push_back(server_socket.getSocketFd());
+	records.push_back(std::move(listener));
+	HandoverRecord allocator{HANDOVER_LOBBY_IDS};
+	lobby_ids.save(allocator);
+	records.push_back(std::move(allocator));
+	for (const auto& [socket_fd, pending] : pending_connections) {
+		timer_service.cancel(pending.handshake_timer);
+		HandoverRecord record{HANDOVER_PENDING, {}, {socket_fd}};
+		record.put_u8(pending.is_negotiated);
+		record.put_u8(pending.socket.getProtocolVersion());
+		record.put_u32(pending.socket.getCapabilities());
+		record.put_received(pending.decoder.pending());
+		records.push_back(std::move(record));
+	}
+	pending_connections.clear();
+	lobbies_list.hand_over_waiting(records);
+	size_t game_count = 0;
+	for (auto& record : session_handover.collect(HANDOVER_TIMEOUT)) {
+		records.push_back(std::move(record));
+		++game_count;
+	}
+
+	bool is_acknowledged = false;
+	try {
+		for (const auto& record : records) {
+			channel.send(record);
+		}
+		channel.send(HandoverRecord{HANDOVER_END});
+		is_acknowledged = channel.receive().kind == HANDOVER_ACK;
+		if (!is_acknowledged) {
+			spdlog::error("The new server process did not acknowledge the hand-over.");
+		}
+	} catch (const std::exception& e) {
+		spdlog::error("Hand-over failed: {}", e.what());
+	}
+	if (!is_acknowledged) {
+		take_back(records);
+		return false;
+	}
+	spdlog::info("Handed over {} records with {} games.", records.size(), game_count);
+	for (const auto& record : records) {
+		for (const int fd : record.fds) {
+			::close(fd);
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Accepts a successor on the upgrade socket. Its HELLO is awaited by the event loop, at most HANDOVER_TIMEOUT.
+ */
+void accept_successor() {
+	const int successor_fd = accept4(upgrade_listener, nullptr, nullptr, SOCK_CLOEXEC);
+	if (successor_fd == -1) {
+		return;
+	}
+	if (successor) {
+		spdlog::warn("Another server process is already taking over, refusing a second one.");
+		::close(successor_fd);
+		return;
+	}
+	successor.emplace(successor_fd);
+	successor_timer = timer_service.arm(HANDOVER_TIMEOUT, [] {
+		spdlog::error("The new server process sent no HELLO, not handing over.");
+		successor.reset();
+	});
+}
+
+/**
+ * @brief Hands the server over to the successor once its HELLO arrived.
+ * @return True if the successor took over and this process must exit.
+ */
+bool handle_successor() {
+	timer_service.cancel(successor_timer);
+	bool is_handed_over = false;
+	try {
+		is_handed_over = hand_over(*successor);
+	} catch (const std::exception& e) {
+		spdlog::error("Failed to hand over: {}", e.what());
+	}
+	successor.reset();
+	return is_handed_over;
+}
+
+/**
+ * @brief Receives the records of the running process and acknowledges them, see hand_over().
+ * The records are continued by the caller once the game log is open, after the old process stopped writing it.
+ * @param records The vector to fill with the received records.
+ * @return True if the records were taken over, false if no server runs in the working directory.
+ * @throws std::runtime_error if the running server could not hand over. It keeps serving, and the
+ * descriptors received so far are closed.
+ */
+bool take_over(std::vector<HandoverRecord>& records) {
+	std::optional<HandoverChannel> channel;
+	try {
+		channel.emplace(HandoverChannel::connect(UPGRADE_SOCKET_PATH));
+	} catch (const std::exception& e) {
+		spdlog::warn("No server to take over: {}", e.what());
+		return false;
+	}
+	try {
+		channel->set_receive_timeout(HANDOVER_TIMEOUT * 2);
+		HandoverRecord hello{HANDOVER_HELLO};
+		hello.put_u8(HANDOVER_VERSION);
+		channel->send(hello);
+		for (HandoverRecord record = channel->receive(); record.kind != HANDOVER_END; record = channel->receive()) {
+			records.push_back(std::move(record));
+		}
+		channel->send(HandoverRecord{HANDOVER_ACK});
+	} catch (const std::exception&) {
+		for (const auto& record : records) {
+			for (const int fd : record.fds) {
+				::close(fd);
+			}
+		}
+		records.clear();
+		throw;
+	}
+	spdlog::info("Took over {} records from the previous server process.", records.size());
+	return true;
+}
+
+/**
+ * @brief Logs the distribution of the round-trip times of the players once there are new ones.
+ * Rearms itself every RTT_REPORT_INTERVAL.
+ */
+void report_rtt() {
+	using milliseconds = std::chrono::duration<double, std::milli>;
+	static uint64_t reported_count = 0;
+	const RttHistogram::Summary summary = rtt_histogram.summarize();
+	if (summary.count != reported_count) {
+		spdlog::info("RTT over {} PONGs: p50 {:.1f} ms, p90 {:.1f} ms, p99 {:.1f} ms.", summary.count,
+		             milliseconds(summary.p50).count(), milliseconds(summary.p90).count(),
+		             milliseconds(summary.p99).count());
+		reported_count = summary.count;
+	}
+	timer_service.arm(RTT_REPORT_INTERVAL, report_rtt);
+}
+
+/**
+ * @brief Logs the progress of the drain and ends it once the games and spectators are gone.
+ * At the deadline the remaining games are closed with SERVER_DISCONNECTED, DRAIN_FLUSH_TIMEOUT later the
+ * server exits whatever is left. Rearms itself every DRAIN_CHECK_INTERVAL until the drain ends.
+ */
+void check_drain() {
+	const auto now = std::chrono::steady_clock::now();
+	const size_t game_count = session_handover.running();
+	const size_t watcher_count = spectator_hub.watcher_count();
+	if (game_count == 0 && watcher_count == 0) {
+		spdlog::info("Drained, shutting down server.");
+		is_done = true;
+		return;
+	}
+	if (drain_state.is_deadline_passed && now >= drain_state.deadline) {
+		spdlog::error("Shutting down server with {} games and {} spectators left after the drain deadline.",
+		              game_count, watcher_count);
+		is_done = true;
+		return;
+	}
+	if (!drain_state.is_deadline_passed && now >= drain_state.deadline) {
+		spdlog::warn("Drain deadline passed, closing {} running games.", game_count);
+		session_handover.post_to_all(DRAIN_DEADLINE);
+		drain_state.is_deadline_passed = true;
+		drain_state.deadline = now + DRAIN_FLUSH_TIMEOUT;
+	} else if (now >= drain_state.next_report) {
+		const auto left = std::chrono::duration_cast<std::chrono::seconds>(drain_state.deadline - now);
+		spdlog::info("Draining: {} games running, {} spectators, {} s to the {}.", game_count, watcher_count,
+		             left.count(), drain_state.is_deadline_passed ? "forced shutdown" : "drain deadline");
+		drain_state.next_report = now + DRAIN_REPORT_INTERVAL;
+	}
+	timer_service.arm(DRAIN_CHECK_INTERVAL, check_drain);
+}
+
+/**
+ * @brief Starts draining the server after the first SIGINT or SIGTERM.
+ *
+ * Stops accepting successors, turns away the players waiting in lobbies and in the matchmaking queue and
+ * refuses handshakes that would start a game. Connections are still accepted: running games get
+ * DRAIN_TIMEOUT to finish, players who drop can resume them and spectators can watch them. The server
+ * exits once the games and the spectator send queues are done, so a rolling deploy doesn't reset every
+ * connection at once.
+ */
+void begin_drain() {
+	drain_state.is_draining = true;
+	drain_state.deadline = std::chrono::steady_clock::now() + DRAIN_TIMEOUT;
+	spdlog::info("Draining server: {} games have {} s to finish.", session_handover.running(),
+	             std::chrono::duration_cast<std::chrono::seconds>(DRAIN_TIMEOUT).count());
+
+	if (upgrade_listener != -1) {
+		::close(upgrade_listener);
+		unlink(UPGRADE_SOCKET_PATH);
+		upgrade_listener = -1;
+	}
+	timer_service.cancel(successor_timer);
+	successor.reset();
+	const size_t lobby_count = lobbies_list.close_waiting(ErrorType::SERVER_DRAINING);
+	const size_t queued_count = matchmaker.queued();
+	matchmaker.stop(ErrorType::SERVER_DRAINING);
+	spdlog::info("Turned away {} waiting lobbies and {} queued players.", lobby_count, queued_count);
+	check_drain();
+}
+
+/**
+ * @brief Continues the games a crashed server left in the snapshot file. Their players resume them with their tokens.
+ */
+void recover_games() {
+	const auto started = std::chrono::steady_clock::now();
+	std::vector<HandoverRecord> records = session_snapshots->recover();
+	for (auto& record : records) {
+		recover_game_session(std::move(record), session_services);
+	}
+	if (!records.empty()) {
+		const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+		spdlog::info("Recovering {} games from {}, read in {} us.", records.size(), SNAPSHOT_FILE_PATH, elapsed.count());
+	}
 }
 
 /**
  * @brief The main function of the Checkers TCP server.
+ *
+ * Runs the server event loop: accepts connections, reads handshakes, watches players waiting
+ * in lobbies and drives the timer service. Started with --takeover, the server takes the
+ * listening socket, the lobbies and the games over from the server running in the same
+ * directory, which then exits. Otherwise the games a crashed server left in the snapshot file are
+ * recovered. The first SIGINT or SIGTERM drains the server, see begin_drain().
+ * @param argc The number of arguments.
+ * @param argv The arguments.
  * @return 0 on successful execution.
  */
-int main() {
+int main(int argc, char** argv) {
+	drain_request_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (drain_request_fd == -1) {
+		spdlog::error("Failed to create drain eventfd: {}", strerror(errno));
+		return 1;
+	}
 	signal(SIGINT, signalHandler);
 	signal(SIGTERM, signalHandler);
+	// A player may vanish between two moves, report it as a send error instead of dying.
+	signal(SIGPIPE, SIG_IGN);
+
+	session_services.rtt_histogram = &rtt_histogram;
+	timer_service.arm(RTT_REPORT_INTERVAL, report_rtt);
+
+	// The game log and the snapshot file are opened once the running server acknowledged the hand-over,
+	// its sessions have stopped writing them by then.
+	const bool is_takeover = argc > 1 && strcmp(argv[1], "--takeover") == 0;
+	std::vector<HandoverRecord> taken_over;
+	try {
+		if (is_takeover && !take_over(taken_over)) {
+			spdlog::info("Starting as the only server.");
+		}
+	} catch (const std::exception& e) {
+		spdlog::error("Taking over failed, the running server keeps serving: {}", e.what());
+		return 1;
+	}
+
+	try {
+		game_log = std::make_unique<GameLogWriter>(GAME_LOG_DIRECTORY);
+		session_services.game_log = game_log.get();
+	} catch (const std::exception& e) {
+		spdlog::error("Finished games won't be logged: {}", e.what());
+	}
+
+	try {
+		session_snapshots = std::make_unique<SessionSnapshots>(SNAPSHOT_FILE_PATH);
+		session_services.snapshots = session_snapshots.get();
+	} catch (const std::exception& e) {
+		spdlog::error("Running games won't survive a crash: {}", e.what());
+	}
+
+	for (auto& record : taken_over) {
+		take_over_record(std::move(record));
+	}
+	if (server_socket.getSocketFd() == -1) {
+		// After a takeover the slots belonged to the running server, its games came over with the hand-over.
+		if (session_snapshots) {
+			recover_games();
+		}
+		spdlog::info("Starting Checkers TCP server on port 3000.");
+		server_socket.openServerSocket("3000");
+	}
+	try {
+		upgrade_listener = open_upgrade_listener(UPGRADE_SOCKET_PATH);
+	} catch (const std::exception& e) {
+		spdlog::warn("Hot restart is unavailable: {}", e.what());
+	}
+	bool is_handed_over = false;
 
-	spdlog::info("Starting Checkers TCP server on port 3000.");
-	server_socket.openServerSocket("3000");
+	std::vector<pollfd> pfds;
+	std::vector<std::pair<uint32_t, Socket>> waiting_players;
 
 	while (!is_done) {
-		try {
-			spdlog::info("Waiting for new connections...");
-			Socket player_socket = server_socket.accept();
-
-			spdlog::info("Received new connection from {}", player_socket.getAddressString());
-			HandshakeResult handshake_result = receive_handshake(player_socket);
-
-			if (handshake_result.handshake_type == HandshakeType::CREATE_SESSION) {
-				spdlog::info("Player is creating new lobby.");
-				const uint32_t lobby_id = lobbies_list.add_lobby(player_socket);
-				if (lobby_id != 0) {
-					send_lobby_created(player_socket, lobby_id);
-				} else {
-					spdlog::error("Failed to create new lobby.");
-					send_error(player_socket, ErrorType::SERVER_ERROR);
-					player_socket.close();
-				}
-			} else if (handshake_result.handshake_type == HandshakeType::CONNECT_TO_SESSION) {
-				spdlog::info("Player is connecting to lobby.");
-				if(lobbies_list.add_player_to_lobby(player_socket, handshake_result.lobby_id) == -1) {
-					spdlog::warn("Lobby with provided id doesn't exist.");
-					send_error(player_socket, ErrorType::LOBBY_NOT_EXISTS);
-					player_socket.close();
-				}
+		pfds.clear();
+		pfds.push_back({server_socket.getSocketFd(), POLLIN, 0});
+		pfds.push_back({timer_service.wake_fd(), POLLIN, 0});
+		pfds.push_back({upgrade_listener, POLLIN, 0});
+		pfds.push_back({drain_request_fd, POLLIN, 0});
+		pfds.push_back({successor ? successor->descriptor() : -1, POLLIN, 0});
+		for (const auto& [socket_fd, pending] : pending_connections) {
+			pfds.push_back({socket_fd, POLLIN, 0});
+		}
+		const size_t waiting_begin = pfds.size();
+		waiting_players.clear();
+		lobbies_list.collect_waiting(waiting_players);
+		for (const auto& [lobby_id, player_socket] : waiting_players) {
+			pfds.push_back({player_socket.getSocketFd(), POLLIN, 0});
+		}
+
+		if (poll(pfds.data(), pfds.size(), timer_service.poll_timeout()) == -1) {
+			if (errno == EINTR) continue;
+			spdlog::error("Error occurred when polling data: {}", strerror(errno));
+			break;
+		}
+
+		timer_service.run_expired();
+
+		if (pfds[3].revents & POLLIN) {
+			uint64_t signal_count;
+			if (::read(drain_request_fd, &signal_count, sizeof signal_count) > 0 && !drain_state.is_draining) {
+				begin_drain();
+			}
+		}
+
+		for (size_t i = 5; i < waiting_begin; ++i) {
+			if (pfds[i].revents) handle_handshake(pfds[i].fd);
+		}
+		for (size_t i = waiting_begin; i < pfds.size(); ++i) {
+			if (pfds[i].revents) {
+				handle_waiting_player(waiting_players[i - waiting_begin].first, pfds[i].revents);
+			}
+		}
+
+		if (successor && pfds[4].revents) {
+			is_handed_over = handle_successor();
+			if (is_handed_over) break;
+		}
+		if (upgrade_listener != -1 && pfds[2].revents & POLLIN) {
+			accept_successor();
+		}
+
+		if (server_socket.getSocketFd() != -1 && pfds[0].revents & POLLIN) {
+			try {
+				accept_connection();
+			} catch (const std::exception& e) {
+				spdlog::error("Exception occurred: {}", e.what());
+				is_done = true;
 			}
-		} catch (const std::exception& e) {
-			spdlog::error("Exception occurred: {}", e.what());
-			is_done = true;
 		}
 	}
 
-	cleanup();
+	if (!is_handed_over) {
+		cleanup();
+	}
 	return 0;
 }
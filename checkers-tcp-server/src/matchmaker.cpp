@@ -0,0 +1,196 @@
+/**
+ * @file matchmaker.cpp
+ * @brief Implementation of the rating-bucketed matchmaking queue.
+ */
+
+#include "matchmaker.h"
+
+#include "message_handler.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <sys/socket.h>
+
+/**
+ * @brief Constructs a Matchmaker and starts its pairing thread.
+ * @param start_game Called on the pairing thread for every pair.
+ */
+Matchmaker::Matchmaker(StartGame start_game) : start_game(std::move(start_game)) {
+  pairing_thread = std::thread(&Matchmaker::run, this);
+}
+
+/**
+ * @brief Stops the pairing thread and closes the sockets of queued players.
+ */
+Matchmaker::~Matchmaker() {
+  stopping = true;
+  if (pairing_thread.joinable()) {
+    pairing_thread.join();
+  }
+  for (auto& bucket : buckets) {
+    std::scoped_lock<std::mutex> lock(bucket.mutex);
+    for (auto* entries : {&bucket.incoming, &bucket.waiting}) {
+      for (auto& entry : *entries) {
+        entry.socket.close();
+      }
+    }
+  }
+}
+
+/**
+ * @brief Stops pairing and turns the queued players away. Does nothing once stopped.
+ * Players enqueued after the stop wait until the matchmaker is destroyed.
+ * @param reason The error sent to the queued players.
+ */
+void Matchmaker::stop(ErrorType reason) {
+  if (!pairing_thread.joinable()) return;
+  stopping = true;
+  pairing_thread.join();
+  for (auto& bucket : buckets) {
+    std::vector<Entry> entries;
+    {
+      std::scoped_lock<std::mutex> lock(bucket.mutex);
+      entries.swap(bucket.incoming);
+    }
+    std::move(bucket.waiting.begin(), bucket.waiting.end(), std::back_inserter(entries));
+    bucket.waiting.clear();
+    for (auto& entry : entries) {
+      --queued_count;
+      try {
+        send_error(entry.socket, reason);
+        entry.socket.close();
+      } catch (const std::exception& e) {
+        spdlog::warn("Failed to turn queued player away: {}", e.what());
+      }
+    }
+  }
+}
+
+/**
+ * @brief Queues a player for the next pairing batch.
+ * @param socket The socket of the player.
+ * @param rating The rating of the player.
+ */
+void Matchmaker::enqueue(Socket socket, uint16_t rating) {
+  Bucket& bucket = buckets[bucket_index(rating)];
+  {
+    std::scoped_lock<std::mutex> lock(bucket.mutex);
+    bucket.incoming.push_back({socket, Clock::now()});
+  }
+  ++queued_count;
+}
+
+/**
+ * @brief Pairs a batch every PAIRING_INTERVAL until the matchmaker stops.
+ */
+void Matchmaker::run() {
+  auto next_batch = Clock::now();
+  while (!stopping) {
+    next_batch += PAIRING_INTERVAL;
+    pair_batch(Clock::now());
+    std::this_thread::sleep_until(next_batch);
+  }
+}
+
+/**
+ * @brief Takes the players queued since the last batch and pairs everyone who can be paired.
+ * @param now The current time.
+ */
+void Matchmaker::pair_batch(Clock::time_point now) {
+  std::vector<Entry> incoming;
+  for (auto& bucket : buckets) {
+    {
+      std::scoped_lock<std::mutex> lock(bucket.mutex);
+      incoming.swap(bucket.incoming);
+    }
+    std::move(incoming.begin(), incoming.end(), std::back_inserter(bucket.waiting));
+    incoming.clear();
+
+    // Pair oldest first, at most one player stays waiting in the bucket.
+    std::vector<Entry> waiting;
+    waiting.swap(bucket.waiting);
+    Entry* pending = nullptr;
+    for (auto& entry : waiting) {
+      if (now - entry.enqueued_at >= QUEUE_TIMEOUT) {
+        drop(entry, true);
+      } else if (!is_alive(entry.socket)) {
+        drop(entry, false);
+      } else if (pending == nullptr) {
+        pending = &entry;
+      } else {
+        start(*pending, entry);
+        pending = nullptr;
+      }
+    }
+    if (pending != nullptr) {
+      bucket.waiting.push_back(*pending);
+    }
+  }
+
+  // Players who waited long enough take an opponent from the next rating range.
+  for (size_t index = 0; index + 1 < buckets.size(); ++index) {
+    auto& lower = buckets[index].waiting;
+    auto& upper = buckets[index + 1].waiting;
+    if (lower.empty() || upper.empty()) continue;
+    const auto oldest = std::min(lower.front().enqueued_at, upper.front().enqueued_at);
+    if (now - oldest < CROSS_BUCKET_WAIT) continue;
+    start(lower.front(), upper.front());
+    lower.clear();
+    upper.clear();
+  }
+}
+
+/**
+ * @brief Hands a pair to the game starter.
+ * @param white The player that plays white.
+ * @param black The player that plays black.
+ */
+void Matchmaker::start(Entry& white, Entry& black) {
+  queued_count -= 2;
+  try {
+    start_game(white.socket, black.socket);
+  } catch (const std::exception& e) {
+    spdlog::error("Failed to start matched game: {}", e.what());
+    white.socket.close();
+    black.socket.close();
+  }
+}
+
+/**
+ * @brief Removes a player from the queue and closes the connection.
+ * @param entry The queued player.
+ * @param expired Whether the player waited for QUEUE_TIMEOUT and gets told so.
+ */
+void Matchmaker::drop(Entry& entry, bool expired) {
+  --queued_count;
+  try {
+    if (expired) {
+      send_error(entry.socket, ErrorType::LOBBY_EXPIRED);
+    }
+    entry.socket.close();
+  } catch (const std::exception& e) {
+    spdlog::warn("Failed to close socket: {}", e.what());
+  }
+}
+
+/**
+ * @brief Gets the bucket of a rating.
+ * @param rating The rating of the player.
+ * @return The bucket index.
+ */
+size_t Matchmaker::bucket_index(uint16_t rating) {
+  return std::min<size_t>(rating / BUCKET_WIDTH, BUCKET_COUNT - 1);
+}
+
+/**
+ * @brief Checks that a queued player didn't hang up.
+ * @param socket The socket of the player.
+ * @return True if the connection is still open, false otherwise.
+ */
+bool Matchmaker::is_alive(const Socket& socket) {
+  unsigned char byte;
+  const auto n = recv(socket.getSocketFd(), &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  return n > 0 || (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
@@ -5,145 +5,187 @@
 
 #include "message_handler.h"
 
+#include "frame.h"
 #include "message.h"
+#include "message_format.h"
 #include "pack.h"
 #include "board.h"
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
 
 /**
- * @brief Converts a MessageStorage object to a string representation.
- * @param message The MessageStorage object to convert.
- * @return The string representation of the MessageStorage object.
+ * @brief Receives a message without blocking, player connections are non-blocking.
+ * @param socket The socket to receive the message from.
+ * @param decoder The decoder keeping the bytes of an unfinished frame between calls.
+ * @param message_storage The storage to store the received message.
+ * @param version The protocol version of the frame.
+ * @return True if a message was stored, false if the frame isn't complete yet.
+ * @throws std::runtime_error if the peer closed the connection, the frame is malformed or the payload doesn't fit.
  */
-std::string message_to_string(const MessageStorage& message) {
-	std::string result;
-	switch(message.message_type) {
-		case MessageType::HANDSHAKE: {
-			result += "HANDSHAKE (" + std::to_string(message.len) + " bytes) [";
-			switch(HandshakeType(message.payload[0])) {
-				case HandshakeType::CREATE_SESSION:
-					result += "CREATE_SESSION";
-					break;
-				case HandshakeType::CONNECT_TO_SESSION:
-					result += "CONNECT_TO_SESSION, ";
-					result += "lobby_id: " + std::to_string(unpacku32(&message.payload[1]));
-					break;
-				default:
-					break;
-			}
-			break;
+bool try_receive_message(const Socket &socket, FrameDecoder &decoder, MessageStorage &message_storage, uint8_t version) {
+	uint8_t buf[MAX_FRAME_HEADER + MAX_MESSAGE_LEN];
+	while (true) {
+		FrameHeader header;
+		std::span<const uint8_t> payload;
+		const FrameDecoder::Status status = decoder.next(version, header, payload);
+		if (status == FrameDecoder::MALFORMED) {
+			throw std::runtime_error("Malformed message header.");
 		}
-		case MessageType::LOBBY_CREATED: {
-			result += "LOBBY_CREATED (" + std::to_string(message.len) + " bytes) [";
-			uint32_t lobby_id = unpacku32(message.payload);
-			result += "lobby_id: " + std::to_string(lobby_id);
-			break;
+		if (status == FrameDecoder::FRAME) {
+			message_storage.message_type = header.message_type;
+			message_storage.len = uint8_t(payload.size());
+			std::memcpy(message_storage.payload, payload.data(), payload.size());
+			spdlog::info("Received message: {}", message_storage);
+			return true;
 		}
-		case MessageType::GAME_STARTED: {
-			result += "GAME_STARTED (" + std::to_string(message.len) + " bytes) [";
-			if(GameFlags(message.payload[0]) & GameFlags::IM_WHITE) {
-				result += "IM_WHITE";
-			}
-			break;
+		// The length is checked before the payload is read, a client can't make the server buffer a large frame.
+		if (decode_frame_header(decoder.pending(), version, header) > 0 && header.payload_len > MAX_MESSAGE_LEN) {
+			throw std::runtime_error("Message payload too long: " + std::to_string(header.payload_len) + " bytes.");
 		}
-		case MessageType::MOVE: {
-			result += "MOVE (" + std::to_string(message.len) + " bytes) [";
-			SpotIndex from = SpotIndex(message.payload[0]);
-			SpotIndex to = SpotIndex(message.payload[1]);
-			MoveType move_type = MoveType(message.payload[2]);
-			result += "from: " + std::to_string(from) + ", to: " + std::to_string(to) + ", move_type: ";
-			switch(move_type) {
-				case NORMAL:result += "NORMAL"; break;
-				case CAPTURE:result += "CAPTURE"; break;
-				case PROMOTION:result += "PROMOTION"; break;
-				case CAPTURE_PROMOTION:result += "CAPTURE_PROMOTION"; break;
-			}
-			break;
+		const size_t wanted = std::min(decoder.missing(version), sizeof buf);
+		const ssize_t received = recv(socket.getSocketFd(), buf, wanted, MSG_DONTWAIT);
+		if (received == 0) {
+			throw std::runtime_error("Connection closed by peer.");
 		}
-		case MessageType::DISCONNECT:
-			result += "DISCONNECT (" + std::to_string(message.len) + " bytes) [";
-			break;
-		case MessageType::RESIGN:
-			result += "RESIGN (" + std::to_string(message.len) + " bytes) [";
-			break;
-		case MessageType::ERROR:
-			result += "ERROR (" + std::to_string(message.len) + " bytes) [";
-			switch(ErrorType(message.payload[0])) {
-				case ErrorType::LOBBY_NOT_EXISTS: result += "LOBBY_NOT_EXISTS"; break;
-				case ErrorType::SERVER_ERROR: result += "SERVER_ERROR"; break;
-				case ErrorType::SERVER_DISCONNECTED: result += "SERVER_DISCONNECTED"; break;
-				case ErrorType::OPPONENT_DISCONNECTED: result += "OPPONENT_DISCONNECTED"; break;
-				case ErrorType::INVALID_MOVE: result += "INVALID_MOVE"; break;
+		if (received == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+				return false;
 			}
-			break;
-		default:
-			// should never reach here
-			break;
+			throw std::runtime_error(std::string("Receive failed: ") + strerror(errno));
+		}
+		decoder.append(std::span(buf, size_t(received)));
 	}
-	return result + "]";
 }
 
 /**
- * @brief Overloaded stream insertion operator for MessageStorage objects.
- * @param os The output stream.
- * @param message_storage The MessageStorage object to insert into the stream.
- * @return The output stream.
+ * @brief Sends a message through a socket in the protocol negotiated on it.
+ * @param socket The socket to send the message through.
+ * @param message_storage The MessageStorage object containing the message to send.
  */
-std::ostream& operator<<(std::ostream& os, const MessageStorage& message_storage) {
-	os << message_to_string(message_storage);
-	return os;
+void send_message(Socket &socket, const MessageStorage &message_storage) {
+	unsigned char buf[MAX_FRAME_HEADER + MAX_MESSAGE_LEN];
+	const size_t header_len = encode_frame_header(message_storage.message_type, message_storage.len,
+	                                              socket.getProtocolVersion(), buf);
+	std::memcpy(buf+header_len, message_storage.payload, message_storage.len);
+	// Send message type, length and payload at once
+	socket.sendAll((char*)buf, int(header_len+message_storage.len));
+	spdlog::info("Sent message: {}", message_storage);
 }
 
 /**
- * @brief Receives a message from a socket and stores it in a MessageStorage object.
- * @param socket The socket to receive the message from.
- * @param message_storage The MessageStorage object to store the received message.
+ * @brief Answers the HELLO of a client with the protocol both sides speak and switches the socket to it.
+ * The answer is framed v1 like the HELLO, the socket uses the new protocol after the handshake.
+ * @param socket The socket of the client.
+ * @param hello The HELLO message of the client.
  */
-void receive_message(const Socket &socket, MessageStorage &message_storage) {
-	uint8_t buf[2];
-	// Receive message type and length
-	socket.receiveAll(buf, 2);
-	message_storage.message_type = MessageType(buf[0]);
-	message_storage.len = buf[1];
-	// Receive payload
-	socket.receiveAll(message_storage.payload, message_storage.len);
-	spdlog::info("Received message: {}", message_to_string(message_storage));
-}
+void negotiate_protocol(Socket &socket, const MessageStorage &hello) {
+	const uint8_t requested = hello.len >= 1 ? hello.payload[0] : PROTOCOL_V1;
+	const uint8_t version = std::clamp(requested, PROTOCOL_V1, PROTOCOL_LATEST);
+	const uint32_t offered = hello.len >= HELLO_PAYLOAD_LEN ? unpacku32(&hello.payload[1]) : 0;
+	const uint32_t capabilities = version >= PROTOCOL_V2 ? offered & SERVER_CAPABILITIES : 0;
 
-/**
- * @brief Sends a message through a socket.
- * @param socket The socket to send the message through.
- * @param message_storage The MessageStorage object containing the message to send.
- */
-void send_message(Socket &socket, const MessageStorage &message_storage) {
-	unsigned char buf[2 + MAX_MESSAGE_LEN];
-	buf[0] = message_storage.message_type;
-	buf[1] = message_storage.len;
-	std::memcpy(buf+2, message_storage.payload, message_storage.len);
-	// Send message type and length
-	socket.sendAll((char*)buf, 2+message_storage.len);
-	spdlog::info("Sent message: {}", message_to_string(message_storage));
+	MessageStorage answer{MessageType::HELLO, HELLO_PAYLOAD_LEN};
+	answer.payload[0] = version;
+	packi32(&answer.payload[1], capabilities);
+	send_message(socket, answer);
+	socket.setProtocol(version, capabilities);
 }
 
 /**
- * @brief Receives a handshake message from a socket and returns the handshake result.
- * @param socket The socket to receive the handshake message from.
+ * @brief Parses a handshake message.
+ * @param message_storage The handshake message.
  * @return The handshake result.
  */
-struct HandshakeResult receive_handshake(const Socket &socket) {
-	MessageStorage message_storage{};
-	receive_message(socket, message_storage);
+struct HandshakeResult parse_handshake(const MessageStorage &message_storage) {
 	auto handshake_type = HandshakeType(message_storage.payload[0]);
-	if (handshake_type == HandshakeType::CONNECT_TO_SESSION) {
+	if (handshake_type == HandshakeType::CONNECT_TO_SESSION || handshake_type == HandshakeType::SPECTATE) {
 		uint32_t lobby_id = unpacku32(&message_storage.payload[1]);
 		return HandshakeResult{handshake_type, lobby_id};
 	}
+	if (handshake_type == HandshakeType::PLAY_AGAINST_BOT) {
+		HandshakeResult result{handshake_type};
+		result.bot_level = message_storage.len >= 2 ? message_storage.payload[1] : 0;
+		return result;
+	}
+	if (handshake_type == HandshakeType::FIND_GAME) {
+		HandshakeResult result{handshake_type};
+		result.rating = message_storage.len >= 3 ? unpacku16(&message_storage.payload[1]) : 0;
+		return result;
+	}
+	if (handshake_type == HandshakeType::RESUME_SESSION && message_storage.len >= 9) {
+		HandshakeResult result{handshake_type};
+		result.resume_token = unpacku64(&message_storage.payload[1]);
+		return result;
+	}
+	if (handshake_type == HandshakeType::CREATE_SESSION && message_storage.len >= 5) {
+		TimeControl time_control{unpacku16(&message_storage.payload[1]), unpacku16(&message_storage.payload[3])};
+		return HandshakeResult{handshake_type, 0, time_control};
+	}
 	return HandshakeResult{handshake_type};
 }
 
+/**
+ * @brief Sends moves through a socket, as MOVE_BATCH frames if the client asked for them, otherwise one MOVE each.
+ * @param socket The socket to send the moves through.
+ * @param moves The moves.
+ */
+void send_moves(Socket &socket, std::span<const Move> moves) {
+	if (!(socket.getCapabilities() & CAPABILITY_MOVE_BATCH)) {
+		for (const Move& move : moves) {
+			MessageStorage message{MessageType::MOVE, 3};
+			message.payload[0] = move.from;
+			message.payload[1] = move.to;
+			message.payload[2] = move.type;
+			send_message(socket, message);
+		}
+		return;
+	}
+	constexpr size_t batch_moves = MAX_FRAME_PAYLOAD / 3;
+	std::vector<uint8_t> frame;
+	for (size_t first = 0; first < moves.size(); first += batch_moves) {
+		const auto batch = moves.subspan(first, std::min(batch_moves, moves.size() - first));
+		frame.resize(MAX_FRAME_HEADER);
+		frame.resize(encode_frame_header(MessageType::MOVE_BATCH, batch.size() * 3, socket.getProtocolVersion(),
+		                                 frame.data()));
+		for (const Move& move : batch) {
+			frame.insert(frame.end(), {uint8_t(move.from), uint8_t(move.to), uint8_t(move.type)});
+		}
+		socket.sendAll((char*)frame.data(), int(frame.size()));
+		spdlog::info("Sent message: MOVE_BATCH ({} bytes) [moves: {}]", batch.size() * 3, batch.size());
+	}
+}
+
+/**
+ * @brief Sends a PING through a socket.
+ * @param socket The socket to send the PING through.
+ * @param timestamp The timestamp the peer echoes in its PONG.
+ */
+void send_ping(Socket &socket, uint64_t timestamp) {
+	MessageStorage message{MessageType::PING, 8};
+	packi64(message.payload, timestamp);
+	send_message(socket, message);
+}
+
+/**
+ * @brief Answers a PING with a PONG through a socket.
+ * @param socket The socket to send the PONG through.
+ * @param ping The received PING, its payload is echoed unchanged.
+ */
+void send_pong(Socket &socket, const MessageStorage &ping) {
+	MessageStorage message = ping;
+	message.message_type = MessageType::PONG;
+	send_message(socket, message);
+}
+
 /**
  * @brief Sends a lobby created message through a socket.
  * @param socket The socket to send the lobby created message through.
@@ -159,10 +201,28 @@ void send_lobby_created(Socket &socket, uint32_t lobby_id) {
  * @brief Sends a game started message through a socket.
  * @param socket The socket to send the game started message through.
  * @param game_flags The game flags indicating the game state.
+ * @param resume_token The resume token of the player, 0 if the game can't be resumed.
  */
-void send_game_started(Socket &socket, GameFlags game_flags) {
+void send_game_started(Socket &socket, GameFlags game_flags, uint64_t resume_token) {
 	MessageStorage message{MessageType::GAME_STARTED, 1};
 	message.payload[0] = game_flags;
+	if (resume_token != 0) {
+		message.len = 9;
+		packi64(&message.payload[1], resume_token);
+	}
+	send_message(socket, message);
+}
+
+/**
+ * @brief Sends the remaining clock times of both players through a socket.
+ * @param socket The socket to send the clock message through.
+ * @param white_ms The remaining time of white in milliseconds.
+ * @param black_ms The remaining time of black in milliseconds.
+ */
+void send_clock(Socket &socket, uint32_t white_ms, uint32_t black_ms) {
+	MessageStorage message{MessageType::CLOCK, 8};
+	packi32(message.payload, white_ms);
+	packi32(&message.payload[4], black_ms);
 	send_message(socket, message);
 }
 
@@ -177,6 +237,19 @@ void send_error(Socket &socket, ErrorType error) {
 	send_message(socket, message);
 }
 
+/**
+ * @brief Sends a game over message through a socket.
+ * @param socket The socket to send the game over message through.
+ * @param winner The color of the winner, BOTH for a draw.
+ * @param reason Why the game ended.
+ */
+void send_game_over(Socket &socket, Color winner, GameOverReason reason) {
+	MessageStorage message{MessageType::GAME_OVER, 2};
+	message.payload[0] = winner;
+	message.payload[1] = reason;
+	send_message(socket, message);
+}
+
 void send_no_lobby(Socket socket) {
 	// TODO: Implement send_no_lobby function
 }
@@ -0,0 +1,38 @@
+/**
+ * @file session_memory.cpp
+ * @brief Implementation of the session threads.
+ */
+
+#include "session_memory.h"
+
+#include <cstring>
+#include <pthread.h>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Starts a detached thread with a SESSION_STACK_SIZE stack.
+ * std::thread can't set the stack size, so the thread is created with pthreads.
+ * @param routine The routine the thread runs.
+ * @throws std::runtime_error if the thread could not be started.
+ */
+void start_session_thread(std::function<void()> routine) {
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  pthread_attr_setstacksize(&attributes, SESSION_STACK_SIZE);
+  pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+
+  auto owned_routine = std::make_unique<std::function<void()>>(std::move(routine));
+  pthread_t thread;
+  const int status = pthread_create(&thread, &attributes, [](void* argument) -> void* {
+    std::unique_ptr<std::function<void()>> thread_routine(static_cast<std::function<void()>*>(argument));
+    (*thread_routine)();
+    return nullptr;
+  }, owned_routine.get());
+  pthread_attr_destroy(&attributes);
+
+  if (status != 0) {
+    throw std::runtime_error("Failed to start session thread: " + std::string(strerror(status)));
+  }
+  owned_routine.release();
+}
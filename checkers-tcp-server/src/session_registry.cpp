@@ -0,0 +1,58 @@
+/**
+ * @file session_registry.cpp
+ * @brief Implementation of the registry mapping resume tokens to running game sessions.
+ */
+
+#include "session_registry.h"
+
+#include "game_session.h"
+
+#include <random>
+
+/**
+ * @brief Generates an unguessable, non-zero resume token.
+ * @return The resume token.
+ */
+uint64_t SessionRegistry::generate_token() {
+  static thread_local std::random_device rd;
+  uint64_t token = 0;
+  while (token == 0) {
+    token = (uint64_t(rd()) << 32) | rd();
+  }
+  return token;
+}
+
+/**
+ * @brief Registers a resume token of a session.
+ * @param token The resume token.
+ * @param events The events of the session.
+ */
+void SessionRegistry::add(uint64_t token, const std::shared_ptr<SessionEvents>& events) {
+  std::scoped_lock<std::mutex> lock(mutex);
+  sessions[token] = events;
+}
+
+/**
+ * @brief Unregisters a resume token.
+ * @param token The resume token.
+ */
+void SessionRegistry::remove(uint64_t token) {
+  std::scoped_lock<std::mutex> lock(mutex);
+  sessions.erase(token);
+}
+
+/**
+ * @brief Hands a reconnected socket to the session that issued the token.
+ * @param token The resume token.
+ * @param socket The reconnected socket.
+ * @return True if the session is running and took the socket, false otherwise.
+ */
+bool SessionRegistry::resume(uint64_t token, Socket socket) {
+  std::scoped_lock<std::mutex> lock(mutex);
+  auto session_it = sessions.find(token);
+  if (session_it == sessions.end()) return false;
+  auto events = session_it->second.lock();
+  if (!events) return false;
+  events->post_reconnect(token, socket);
+  return true;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file session_snapshots.cpp
+ * @brief Implementation of the memory-mapped snapshot file.
+ */
+
+#include "session_snapshots.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief Identifies a snapshot file with the slot layout of this build.
+ */
+constexpr uint64_t SNAPSHOT_MAGIC = 0x434b534e41500001u;
+
+/**
+ * @brief Size of the file header, a page so the slots stay page-aligned.
+ */
+constexpr size_t HEADER_BYTES = 4096;
+
+/**
+ * @brief Header of the snapshot file.
+ */
+struct FileHeader {
+  uint64_t magic; /**< SNAPSHOT_MAGIC. */
+  uint32_t slot_count; /**< The number of slots. */
+  uint32_t slot_bytes; /**< The size of a slot. */
+  char boot_id[40]; /**< The boot the slots were written in, their monotonic times are meaningless in another one. */
+};
+
+/**
+ * @brief Reads the ID of the current boot.
+ * @param boot_id The buffer to fill, zeros if the ID is unavailable.
+ */
+void read_boot_id(char (&boot_id)[40]) {
+  memset(boot_id, 0, sizeof boot_id);
+  const int fd = ::open("/proc/sys/kernel/random/boot_id", O_RDONLY | O_CLOEXEC);
+  if (fd != -1) {
+    [[maybe_unused]] const ssize_t n = ::read(fd, boot_id, sizeof boot_id - 1);
+    ::close(fd);
+  }
+}
+
+/**
+ * @brief Size of the whole file.
+ */
+constexpr size_t FILE_BYTES = HEADER_BYTES + SessionSnapshots::SLOT_COUNT * SessionSnapshots::SLOT_BYTES;
+
+}
+
+/**
+ * @brief Opens the snapshot file, creating or resetting it if it doesn't have the expected layout.
+ * The slots are kept for recover().
+ * @param path The path of the file.
+ * @throws std::runtime_error if the file could not be opened or mapped.
+ */
+SessionSnapshots::SessionSnapshots(const char* path) {
+  const int fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    throw std::runtime_error("Failed to open " + std::string(path) + ": " + strerror(errno));
+  }
+  FileHeader header{SNAPSHOT_MAGIC, uint32_t(SLOT_COUNT), uint32_t(SLOT_BYTES), {}};
+  read_boot_id(header.boot_id);
+  struct stat info{};
+  bool is_valid = fstat(fd, &info) == 0 && size_t(info.st_size) == FILE_BYTES;
+  if (is_valid) {
+    FileHeader stored{};
+    is_valid = pread(fd, &stored, sizeof stored, 0) == ssize_t(sizeof stored) && stored.magic == SNAPSHOT_MAGIC &&
+               stored.slot_count == SLOT_COUNT && stored.slot_bytes == SLOT_BYTES;
+    is_same_boot = is_valid && memcmp(stored.boot_id, header.boot_id, sizeof header.boot_id) == 0;
+  }
+  if (!is_valid) {
+    // Truncating to zero first drops the slots of another layout, the file reads back as zeros.
+    if (ftruncate(fd, 0) == -1 || ftruncate(fd, off_t(FILE_BYTES)) == -1) {
+      const int error = errno;
+      ::close(fd);
+      throw std::runtime_error("Failed to initialize " + std::string(path) + ": " + strerror(error));
+    }
+  }
+  void* mapped = mmap(nullptr, FILE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  const int error = errno;
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("Failed to map " + std::string(path) + ": " + strerror(error));
+  }
+  mapping = static_cast<uint8_t*>(mapped);
+  mapping_size = FILE_BYTES;
+  if (!is_same_boot) {
+    memcpy(mapping, &header, sizeof header);
+  }
+
+  free_slots.reserve(SLOT_COUNT);
+  for (size_t slot = SLOT_COUNT; slot-- > 0;) {
+    free_slots.push_back(slot);
+  }
+}
+
+/**
+ * @brief Unmaps the file. The slots stay in the file.
+ */
+SessionSnapshots::~SessionSnapshots() {
+  munmap(mapping, mapping_size);
+}
+
+/**
+ * @brief Gets a copy of a slot.
+ * @param slot The index of the slot.
+ * @param index The copy, 0 or 1.
+ * @return The header of the copy, the snapshot bytes follow it.
+ */
+SessionSnapshots::CopyHeader* SessionSnapshots::copy(size_t slot, size_t index) const {
+  return reinterpret_cast<CopyHeader*>(mapping + HEADER_BYTES + slot * SLOT_BYTES + index * COPY_BYTES);
+}
+
+/**
+ * @brief Computes the FNV-1a checksum of a copy.
+ * @param generation The generation of the copy.
+ * @param bytes The snapshot bytes.
+ * @param length The number of snapshot bytes.
+ * @return The checksum.
+ */
+uint32_t SessionSnapshots::checksum(uint64_t generation, const uint8_t* bytes, uint32_t length) {
+  uint32_t hash = 2166136261u;
+  const auto mix = [&hash](uint8_t byte) { hash = (hash ^ byte) * 16777619u; };
+  for (int shift = 0; shift < 64; shift += 8) {
+    mix(uint8_t(generation >> shift));
+  }
+  for (int shift = 0; shift < 32; shift += 8) {
+    mix(uint8_t(length >> shift));
+  }
+  for (uint32_t i = 0; i < length; ++i) {
+    mix(bytes[i]);
+  }
+  return hash;
+}
+
+/**
+ * @brief Reads the games left by a previous process and clears their slots.
+ * Of the two copies of a slot, the newest one with a matching checksum is taken. Slots written before the machine
+ * rebooted are dropped.
+ * @return The snapshots as HANDOVER_GAME records.
+ */
+std::vector<HandoverRecord> SessionSnapshots::recover() {
+  std::vector<HandoverRecord> records;
+  for (size_t slot = 0; slot < SLOT_COUNT; ++slot) {
+    if (!is_same_boot) {
+      memset(copy(slot, 0), 0, SLOT_BYTES);
+      continue;
+    }
+    const CopyHeader* newest = nullptr;
+    for (size_t index = 0; index < 2; ++index) {
+      const CopyHeader* header = copy(slot, index);
+      if (header->generation == 0 || header->length > MAX_SNAPSHOT_BYTES) continue;
+      const auto* bytes = reinterpret_cast<const uint8_t*>(header + 1);
+      if (header->checksum != checksum(header->generation, bytes, header->length)) continue;
+      if (newest == nullptr || header->generation > newest->generation) {
+        newest = header;
+      }
+    }
+    if (newest != nullptr) {
+      const auto* bytes = reinterpret_cast<const uint8_t*>(newest + 1);
+      records.push_back(HandoverRecord{HANDOVER_GAME, {bytes, bytes + newest->length}, {}});
+    }
+    memset(copy(slot, 0), 0, SLOT_BYTES);
+  }
+  return records;
+}
+
+/**
+ * @brief Takes a free slot.
+ * @return The index of the slot, NO_SLOT if all slots are taken.
+ */
+size_t SessionSnapshots::acquire() {
+  std::scoped_lock<std::mutex> lock(mutex);
+  if (free_slots.empty()) {
+    return NO_SLOT;
+  }
+  const size_t slot = free_slots.back();
+  free_slots.pop_back();
+  return slot;
+}
+
+/**
+ * @brief Writes a snapshot into a slot, over the older of its copies.
+ * The copy being written is never the one recovery would fall back to, so a torn write costs one move at most.
+ * @param slot The index of the slot.
+ * @param record The snapshot.
+ * @return True if the snapshot was written, false if it is larger than a copy.
+ */
+bool SessionSnapshots::write(size_t slot, const HandoverRecord& record) {
+  if (record.bytes.size() > MAX_SNAPSHOT_BYTES) {
+    return false;
+  }
+  CopyHeader* first = copy(slot, 0);
+  CopyHeader* second = copy(slot, 1);
+  const uint64_t generation = std::max(first->generation, second->generation) + 1;
+  CopyHeader* target = first->generation <= second->generation ? first : second;
+  const auto length = uint32_t(record.bytes.size());
+  memcpy(target + 1, record.bytes.data(), length);
+  target->length = length;
+  target->checksum = checksum(generation, record.bytes.data(), length);
+  target->generation = generation;
+  return true;
+}
+
+/**
+ * @brief Clears a slot and returns it to the free slots.
+ * @param slot The index of the slot.
+ */
+void SessionSnapshots::release(size_t slot) {
+  copy(slot, 0)->generation = 0;
+  copy(slot, 1)->generation = 0;
+  std::scoped_lock<std::mutex> lock(mutex);
+  free_slots.push_back(slot);
+}
@@ -0,0 +1,265 @@
+/**
+ * @file session_workers.cpp
+ * @brief Implementation of the worker threads running the game sessions.
+ */
+
+#include "session_workers.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// A ready descriptor is handed to the session as if poll() had reported it.
+static_assert(EPOLLIN == POLLIN && EPOLLERR == POLLERR && EPOLLHUP == POLLHUP);
+
+/**
+ * @brief Constructs a SessionWorker and starts its thread.
+ * @param handover The collector the games enroll in.
+ * @throws std::runtime_error if the epoll instance or the eventfd could not be created.
+ */
+SessionWorker::SessionWorker(SessionHandover& handover) : handover(handover) {
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd == -1 || wake_fd == -1) {
+    throw std::runtime_error("Failed to create session worker: " + std::string(strerror(errno)));
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = wake_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+  worker_thread = std::thread(&SessionWorker::run, this);
+}
+
+/**
+ * @brief Stops the worker thread. Games still running are abandoned like the threads of a process that exits:
+ * they are neither logged nor closed, and the pool frees their slabs.
+ */
+SessionWorker::~SessionWorker() {
+  stopping = true;
+  const uint64_t one = 1;
+  if (::write(wake_fd, &one, sizeof one) == -1) {
+    spdlog::error("Failed to wake session worker: {}", strerror(errno));
+  }
+  worker_thread.join();
+  for (auto& [session, game] : games) {
+    static_cast<void>(game.session.release());
+  }
+  ::close(wake_fd);
+  ::close(epoll_fd);
+}
+
+/**
+ * @brief Queues a game to be created and run by the worker.
+ * @param create Creates the session.
+ * @param is_exit Flag ending the game from outside, it must outlive the game. Null if only the game ends itself.
+ * @param on_finished Called on the worker thread once the game ended or was handed over.
+ */
+void SessionWorker::start(Factory create, std::atomic<bool>* is_exit, std::function<void()> on_finished) {
+  ++games_started;
+  {
+    std::scoped_lock<std::mutex> lock(mutex);
+    queued.push_back({std::move(create), is_exit, std::move(on_finished)});
+  }
+  const uint64_t one = 1;
+  if (::write(wake_fd, &one, sizeof one) == -1 && errno != EAGAIN) {
+    spdlog::error("Failed to wake session worker: {}", strerror(errno));
+  }
+}
+
+/**
+ * @brief Gets the memory the worker spends on a game besides its session: the entry of the game and the
+ * entries of its three watched descriptors, without the overhead of the allocator.
+ * @return The size in bytes.
+ */
+size_t SessionWorker::bookkeeping_bytes() {
+  // Each map node holds its value and the link to the next node, the buckets hold one pointer per node.
+  const size_t game_node = sizeof(void*) + sizeof(std::pair<SessionData* const, Game>) + sizeof(void*);
+  const size_t watch_node = sizeof(void*) + sizeof(std::pair<const int, Watch>) + sizeof(void*);
+  return game_node + 3 * watch_node;
+}
+
+/**
+ * @brief Waits for ready descriptors and serves their games until the worker stops.
+ * All descriptors are collected before any game is served, so a game woken by both players and its events
+ * is served once.
+ */
+void SessionWorker::run() {
+  epoll_event ready[MAX_READY];
+  while (!stopping) {
+    const int count = epoll_wait(epoll_fd, ready, MAX_READY, -1);
+    if (count == -1) {
+      if (errno == EINTR) continue;
+      spdlog::error("Session worker failed to wait for events: {}", strerror(errno));
+      break;
+    }
+
+    bool has_queued = false;
+    for (int i = 0; i < count; ++i) {
+      const int fd = ready[i].data.fd;
+      if (fd == wake_fd) {
+        uint64_t counter;
+        while (::read(wake_fd, &counter, sizeof counter) > 0) {}
+        has_queued = true;
+        continue;
+      }
+      const auto watch_it = watches.find(fd);
+      if (watch_it == watches.end()) continue;
+      Game& game = *watch_it->second.game;
+      game.session->pfds[watch_it->second.slot].revents = short(ready[i].events);
+      if (!game.is_woken) {
+        game.is_woken = true;
+        woken.push_back(&game);
+      }
+    }
+
+    for (Game* game : woken) {
+      serve(*game);
+    }
+    woken.clear();
+    if (has_queued && !stopping) {
+      create_queued();
+    }
+  }
+}
+
+/**
+ * @brief Creates the queued games, enrolls them for a hand-over and watches their descriptors.
+ */
+void SessionWorker::create_queued() {
+  std::vector<QueuedGame> taken;
+  {
+    std::scoped_lock<std::mutex> lock(mutex);
+    taken.swap(queued);
+  }
+  for (auto& queued_game : taken) {
+    SlabPool<SessionData>::Ptr session = queued_game.create(pool);
+    if (!session) {
+      ++games_finished;
+      if (queued_game.on_finished) {
+        queued_game.on_finished();
+      }
+      continue;
+    }
+    SessionData* key = session.get();
+    Game& game = games.try_emplace(key).first->second;
+    game.session = std::move(session);
+    game.is_exit = queued_game.is_exit != nullptr ? queued_game.is_exit : &game.own_exit;
+    game.on_finished = std::move(queued_game.on_finished);
+    game.ticket = handover.enroll(game.session->events);
+    spdlog::info("Game {} costs {} bytes, {} games on this worker hold {} KiB of session slabs.",
+                 game.session->game_id, game.session->memory_footprint() + bookkeeping_bytes(), pool.live(),
+                 pool.reserved_bytes() / 1024);
+    if (*game.is_exit) {
+      finish(game, std::nullopt);
+    } else {
+      watch(game);
+    }
+  }
+}
+
+/**
+ * @brief Serves a woken game and ends it if it is over.
+ * @param game The game, its revents are set.
+ */
+void SessionWorker::serve(Game& game) {
+  game.is_woken = false;
+  std::optional<HandoverRecord> record = game.session->serve(*game.is_exit);
+  for (auto& pfd : game.session->pfds) {
+    pfd.revents = 0;
+  }
+  if (*game.is_exit) {
+    finish(game, std::move(record));
+  } else {
+    watch(game);
+  }
+}
+
+/**
+ * @brief Makes the epoll instance watch the current descriptors of a game.
+ * A player that left or resumed changed its descriptor. A closed descriptor already left the epoll instance,
+ * removing it again fails harmlessly, even if its number was reused since.
+ * @param game The game.
+ */
+void SessionWorker::watch(Game& game) {
+  for (size_t slot = 0; slot < 3; ++slot) {
+    const int fd = game.session->pfds[slot].fd;
+    int& watched = game.watched[slot];
+    if (fd == watched) continue;
+    if (watched != -1) {
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, watched, nullptr);
+      watches.erase(watched);
+    }
+    watched = fd;
+    if (fd == -1) continue;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+      spdlog::error("Failed to watch descriptor {} of game {}: {}", fd, game.session->game_id, strerror(errno));
+      watched = -1;
+      continue;
+    }
+    watches[fd] = {&game, slot};
+  }
+}
+
+/**
+ * @brief Ends a game: stops watching it, closes the sockets of a game that wasn't handed over, frees the
+ * session and leaves the hand-over collector.
+ * @param game The game.
+ * @param record The record of a game handed over, nothing if the game ended.
+ */
+void SessionWorker::finish(Game& game, std::optional<HandoverRecord> record) {
+  // The sockets of a handed over game stay open, they must leave the epoll instance before the game goes.
+  for (int& watched : game.watched) {
+    if (watched == -1) continue;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, watched, nullptr);
+    watches.erase(watched);
+    watched = -1;
+  }
+  if (!record) {
+    cleanup_session(*game.session);
+  }
+  const uint64_t ticket = game.ticket;
+  std::function<void()> on_finished = std::move(game.on_finished);
+  SessionData* key = game.session.get();
+  game.session.reset();
+  games.erase(key);
+  ++games_finished;
+  handover.leave(ticket, std::move(record));
+  if (on_finished) {
+    on_finished();
+  }
+}
+
+/**
+ * @brief Constructs the workers and starts their threads.
+ * @param worker_count The number of workers, at least one is started.
+ * @param handover The collector the games enroll in.
+ */
+SessionWorkers::SessionWorkers(unsigned worker_count, SessionHandover& handover) {
+  for (unsigned i = 0; i < std::max(worker_count, 1u); ++i) {
+    workers.push_back(std::make_unique<SessionWorker>(handover));
+  }
+}
+
+/**
+ * @brief Starts a game on the worker running the fewest games.
+ * @param create Creates the session on the worker thread.
+ * @param is_exit Flag ending the game from outside, it must outlive the game. Null if only the game ends itself.
+ * @param on_finished Called on the worker thread once the game ended or was handed over.
+ */
+void SessionWorkers::start(SessionWorker::Factory create, std::atomic<bool>* is_exit,
+                           std::function<void()> on_finished) {
+  const auto least_busy = std::min_element(workers.begin(), workers.end(), [](const auto& a, const auto& b) {
+    return a->game_count() < b->game_count();
+  });
+  (*least_busy)->start(std::move(create), is_exit, std::move(on_finished));
+}
@@ -3,7 +3,10 @@
 #include <spdlog/spdlog.h>
 
 #include <stdexcept>
+#include <cerrno>
 #include <cstring>
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 
 #include <netdb.h>
@@ -13,7 +16,31 @@
 
 Socket::Socket(int socketFD) : socketFD(socketFD) {}
 
-Socket::Socket(int socketFD, struct sockaddr_storage addr) : socketFD(socketFD), address(addr) {}
+Socket::Socket(int socketFD, struct sockaddr_storage addr) : socketFD(socketFD)
+{
+  setAddress((const struct sockaddr *)&addr);
+}
+
+/**
+ * @brief Socket::setAddress keeps only the family, port and ip of an address.
+ * @param addr IPv4 or IPv6 address.
+ */
+void Socket::setAddress(const struct sockaddr *addr)
+{
+  family = addr->sa_family;
+  if (family == AF_INET)
+  {
+    const auto *ipv4 = (const struct sockaddr_in *)addr;
+    port = ipv4->sin_port;
+    memcpy(ip, &ipv4->sin_addr, sizeof ipv4->sin_addr);
+  }
+  else if (family == AF_INET6)
+  {
+    const auto *ipv6 = (const struct sockaddr_in6 *)addr;
+    port = ipv6->sin6_port;
+    memcpy(ip, &ipv6->sin6_addr, sizeof ipv6->sin6_addr);
+  }
+}
 
 /**
  * @brief Socket::openClientSocket connects client socket to givent address.
@@ -57,7 +84,7 @@ void Socket::openClientSocket(const char *ip, const char *port)
   {
     throw std::runtime_error("Failed to connect to client.");
   }
-  address = *((struct sockaddr_storage *)p->ai_addr);
+  setAddress(p->ai_addr);
 
   freeaddrinfo(servinfo);
 
@@ -122,7 +149,7 @@ void Socket::openServerSocket(const char *port)
     throw std::runtime_error("Failed to bind server socket.");
   }
 
-  address = *((struct sockaddr_storage *)p->ai_addr);
+  setAddress(p->ai_addr);
 
   freeaddrinfo(servinfo);
 
@@ -151,18 +178,7 @@ void Socket::openServerSocket(const char *port)
  */
 std::string Socket::getPortString() const
 {
-  uint16_t port;
-  if (address.ss_family == AF_INET)
-  {
-    port = ((struct sockaddr_in *)&address)->sin_port;
-    port = ntohs(port);
-  }
-  else
-  {
-    port = ((struct sockaddr_in6 *)&address)->sin6_port;
-    port = ntohs(port);
-  }
-  return std::to_string(port);
+  return std::to_string(ntohs(port));
 }
 
 /**
@@ -171,17 +187,8 @@ std::string Socket::getPortString() const
  */
 std::string Socket::getIpString() const
 {
-  char ipstr[INET6_ADDRSTRLEN];
-  if (address.ss_family == AF_INET)
-  { // IPv4
-    struct in_addr ipv4 = ((struct sockaddr_in *)&address)->sin_addr;
-    inet_ntop(address.ss_family, &ipv4, ipstr, sizeof ipstr);
-  }
-  else
-  { // IPv6
-    struct in6_addr ipv6 = ((struct sockaddr_in6 *)&address)->sin6_addr;
-    inet_ntop(address.ss_family, &ipv6, ipstr, sizeof ipstr);
-  }
+  char ipstr[INET6_ADDRSTRLEN] = "";
+  inet_ntop(family, ip, ipstr, sizeof ipstr);
   return {ipstr};
 }
 
@@ -232,6 +239,20 @@ size_t Socket::sendAll(const char *buf, int len)
   while (total < len)
   {
     n = send(socketFD, buf + total, len - total, 0);
+    if (n == -1 && errno == EINTR)
+    {
+      continue;
+    }
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      // The send buffer is full, wait a bounded time for the peer to read.
+      struct pollfd pfd = {socketFD, POLLOUT, 0};
+      if (poll(&pfd, 1, int(SEND_TIMEOUT.count())) == 0)
+      {
+        throw std::runtime_error("Timed out sending data.");
+      }
+      continue;
+    }
     if (n == -1)
     {
       throw std::runtime_error("Failed to send data.");
@@ -266,12 +287,28 @@ size_t Socket::receiveAll(unsigned char *buf, int len) const
     {
       throw std::runtime_error("Failed to receive data.");
     }
+    if (n == 0)
+    {
+      throw std::runtime_error("Connection closed by peer.");
+    }
     total += n;
   }
 
   return total;
 }
 
+/**
+ * @brief Socket::setNonBlocking makes the socket non-blocking, so a stalled peer can't block the caller.
+ */
+void Socket::setNonBlocking()
+{
+  const int flags = fcntl(socketFD, F_GETFL);
+  if (flags == -1 || fcntl(socketFD, F_SETFL, flags | O_NONBLOCK) == -1)
+  {
+    throw std::runtime_error("Could not set O_NONBLOCK: " + std::string(strerror(errno)));
+  }
+}
+
 /**
  * @brief Socket::close close socket, also shutdown berore to unblock all blocking operations.
  */
@@ -285,7 +322,8 @@ void Socket::close()
 
   int status = ::shutdown(socketFD, SHUT_RDWR);
 
-  if (status == -1)
+  // A peer that already reset the connection leaves nothing to shut down, the descriptor must still be closed.
+  if (status == -1 && errno != ENOTCONN)
   {
     throw std::runtime_error("Failed to shutdown socket: " + std::string(strerror(errno)));
   }
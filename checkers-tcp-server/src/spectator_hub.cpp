@@ -0,0 +1,366 @@
+/**
+ * @file spectator_hub.cpp
+ * @brief Implementation of the hub fanning out running games to spectators.
+ */
+
+#include "spectator_hub.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * @brief Serializes a message into a shareable frame.
+ * @param message The message.
+ * @return The frame.
+ */
+SharedFrame SpectatorHub::make_frame(const MessageStorage& message) {
+  // Payloads are shorter than 128 bytes, so the frame is the same in both protocol versions.
+  static_assert(MAX_MESSAGE_LEN < 0x80);
+  auto frame = std::make_shared<BroadcastFrame>();
+  frame->bytes[0] = message.message_type;
+  frame->bytes[1] = message.len;
+  std::memcpy(frame->bytes + 2, message.payload, message.len);
+  frame->size = uint8_t(2 + message.len);
+  return frame;
+}
+
+/**
+ * @brief Constructs a SpectatorHub and starts its thread.
+ */
+SpectatorHub::SpectatorHub() {
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd == -1 || wake_fd == -1) {
+    throw std::runtime_error("Failed to create spectator hub: " + std::string(strerror(errno)));
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = wake_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+  hub_thread = std::thread(&SpectatorHub::run, this);
+}
+
+/**
+ * @brief Stops the hub thread and disconnects all watchers.
+ */
+SpectatorHub::~SpectatorHub() {
+  stopping = true;
+  wake();
+  hub_thread.join();
+  for (auto& [fd, watcher] : watchers) {
+    watcher.socket.close();
+  }
+  ::close(wake_fd);
+  ::close(epoll_fd);
+}
+
+/**
+ * @brief Makes a game watchable.
+ * @param game_id The ID spectators join with.
+ * @param position The POSITION frame of the starting position.
+ * @return True if the game was opened, false if the ID is taken.
+ */
+bool SpectatorHub::open_channel(uint32_t game_id, SharedFrame position) {
+  MessageStorage started{MessageType::GAME_STARTED, 1};
+  started.payload[0] = GameFlags::SPECTATOR;
+  std::scoped_lock<std::mutex> lock(mutex);
+  const auto [channel_it, inserted] = channels.try_emplace(game_id);
+  if (!inserted) return false;
+  channel_it->second.started = make_frame(started);
+  channel_it->second.position = std::move(position);
+  return true;
+}
+
+/**
+ * @brief Queues a frame to all watchers of a game.
+ * @param game_id The ID of the game.
+ * @param frame The frame to send.
+ * @param position The POSITION frame after the message, if it changed the position.
+ */
+void SpectatorHub::publish(uint32_t game_id, SharedFrame frame, SharedFrame position) {
+  {
+    std::scoped_lock<std::mutex> lock(mutex);
+    auto channel_it = channels.find(game_id);
+    if (channel_it == channels.end()) return;
+    Channel& channel = channel_it->second;
+    if (position) {
+      channel.position = std::move(position);
+    }
+    if (frame->bytes[0] == MessageType::CLOCK) {
+      channel.clock = frame;
+    }
+    if (channel.watchers.empty()) return;
+    for (const int fd : channel.watchers) {
+      enqueue(fd, watchers.at(fd), frame);
+    }
+  }
+  wake();
+}
+
+/**
+ * @brief Closes a game, its watchers are disconnected once their queues are flushed,
+ * at the latest after CLOSE_LINGER_TIMEOUT.
+ * @param game_id The ID of the game.
+ */
+void SpectatorHub::close_channel(uint32_t game_id) {
+  const auto linger_deadline = std::chrono::steady_clock::now() + CLOSE_LINGER_TIMEOUT;
+  {
+    std::scoped_lock<std::mutex> lock(mutex);
+    auto channel_it = channels.find(game_id);
+    if (channel_it == channels.end()) return;
+    for (const int fd : channel_it->second.watchers) {
+      Watcher& watcher = watchers.at(fd);
+      watcher.closing = true;
+      watcher.linger_deadline = linger_deadline;
+      lingering.push_back(fd);
+      dirty.push_back(fd);
+    }
+    channels.erase(channel_it);
+  }
+  wake();
+}
+
+/**
+ * @brief Adds a watcher to a game and queues the late-join snapshot.
+ * @param game_id The ID of the game.
+ * @param socket The socket of the spectator.
+ * @return True if the game is running, false otherwise.
+ */
+bool SpectatorHub::watch(uint32_t game_id, Socket socket) {
+  const int fd = socket.getSocketFd();
+  {
+    std::scoped_lock<std::mutex> lock(mutex);
+    auto channel_it = channels.find(game_id);
+    if (channel_it == channels.end()) return false;
+    Channel& channel = channel_it->second;
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+      spdlog::error("Failed to watch spectator socket: {}", strerror(errno));
+      return false;
+    }
+    Watcher& watcher = watchers[fd];
+    watcher.socket = socket;
+    watcher.game_id = game_id;
+    channel.watchers.push_back(fd);
+    ++watcher_total;
+
+    for (const auto& frame : {channel.started, channel.position, channel.clock}) {
+      if (frame) {
+        enqueue(fd, watcher, frame);
+      }
+    }
+  }
+  spdlog::info("Spectator {} is watching game {}.", socket.getAddressString(), game_id);
+  wake();
+  return true;
+}
+
+/**
+ * @brief Drives the watcher sockets until the hub stops.
+ */
+void SpectatorHub::run() {
+  constexpr int MAX_EVENTS = 64;
+  epoll_event events[MAX_EVENTS];
+
+  while (!stopping) {
+    int timeout;
+    {
+      std::scoped_lock<std::mutex> lock(mutex);
+      timeout = wait_timeout();
+    }
+    const int count = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+    if (count == -1) {
+      if (errno == EINTR) continue;
+      spdlog::error("Spectator hub failed to wait for events: {}", strerror(errno));
+      break;
+    }
+
+    std::scoped_lock<std::mutex> lock(mutex);
+    for (int i = 0; i < count; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == wake_fd) {
+        uint64_t counter;
+        while (::read(wake_fd, &counter, sizeof counter) > 0) {}
+        continue;
+      }
+      if (!watchers.contains(fd)) continue;
+      if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
+        remove_watcher(fd);
+        continue;
+      }
+      if (events[i].events & EPOLLIN) {
+        // Spectators have nothing to say, anything they send is dropped.
+        unsigned char buf[64];
+        const auto n = recv(fd, buf, sizeof buf, MSG_DONTWAIT);
+        if (n == 0 || (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+          remove_watcher(fd);
+          continue;
+        }
+      }
+      if (events[i].events & EPOLLOUT) {
+        flush(fd);
+      }
+    }
+
+    for (const int fd : dirty) {
+      flush(fd);
+    }
+    dirty.clear();
+    drop_lingering();
+  }
+}
+
+/**
+ * @brief Appends a frame to the send queue of a watcher.
+ * @param fd The file descriptor of the watcher.
+ * @param watcher The watcher.
+ * @param frame The frame to send.
+ */
+void SpectatorHub::enqueue(int fd, Watcher& watcher, const SharedFrame& frame) {
+  if (watcher.closing) return;
+  if (watcher.queue.size() >= MAX_QUEUED_FRAMES) {
+    // Too slow to keep up. publish() is walking the channel, so the watcher can't be removed here, and
+    // its stalled reader would keep a flush waiting: the socket is shut down and the emptied queue lets
+    // the next flush remove it.
+    watcher.closing = true;
+    watcher.queue.clear();
+    watcher.offset = 0;
+    ::shutdown(fd, SHUT_RDWR);
+    dirty.push_back(fd);
+    return;
+  }
+  watcher.queue.push_back(frame);
+  if (watcher.queue.size() == 1 && !watcher.want_write) {
+    dirty.push_back(fd);
+  }
+}
+
+/**
+ * @brief Writes as much of the send queue of a watcher as the socket takes.
+ * @param fd The file descriptor of the watcher.
+ */
+void SpectatorHub::flush(int fd) {
+  auto watcher_it = watchers.find(fd);
+  if (watcher_it == watchers.end()) return;
+  Watcher& watcher = watcher_it->second;
+
+  while (!watcher.queue.empty()) {
+    const BroadcastFrame& frame = *watcher.queue.front();
+    const auto n = send(fd, frame.bytes + watcher.offset, frame.size - watcher.offset, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        set_want_write(fd, watcher, true);
+        return;
+      }
+      remove_watcher(fd);
+      return;
+    }
+    watcher.offset += size_t(n);
+    if (watcher.offset == frame.size) {
+      watcher.queue.pop_front();
+      watcher.offset = 0;
+    }
+  }
+  if (watcher.closing) {
+    remove_watcher(fd);
+    return;
+  }
+  set_want_write(fd, watcher, false);
+}
+
+/**
+ * @brief Enables or disables polling a watcher socket for writability.
+ * @param fd The file descriptor of the watcher.
+ * @param watcher The watcher.
+ * @param want_write Whether to poll for writability.
+ */
+void SpectatorHub::set_want_write(int fd, Watcher& watcher, bool want_write) {
+  if (watcher.want_write == want_write) return;
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLRDHUP | (want_write ? EPOLLOUT : 0);
+  event.data.fd = fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+  watcher.want_write = want_write;
+}
+
+/**
+ * @brief Disconnects a watcher.
+ * @param fd The file descriptor of the watcher.
+ */
+void SpectatorHub::remove_watcher(int fd) {
+  auto watcher_it = watchers.find(fd);
+  if (watcher_it == watchers.end()) return;
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+  auto channel_it = channels.find(watcher_it->second.game_id);
+  if (channel_it != channels.end()) {
+    auto& fds = channel_it->second.watchers;
+    auto fd_it = std::find(fds.begin(), fds.end(), fd);
+    if (fd_it != fds.end()) {
+      *fd_it = fds.back();
+      fds.pop_back();
+    }
+  }
+  try {
+    watcher_it->second.socket.close();
+  } catch (const std::exception& e) {
+    spdlog::warn("Failed to close spectator socket: {}", e.what());
+  }
+  watchers.erase(watcher_it);
+  --watcher_total;
+}
+
+/**
+ * @brief Disconnects the watchers of closed games whose linger deadline passed with frames left.
+ */
+void SpectatorHub::drop_lingering() {
+  const auto now = std::chrono::steady_clock::now();
+  std::erase_if(lingering, [this, now](int fd) {
+    auto watcher_it = watchers.find(fd);
+    // Gone already, or the descriptor was reused by a new watcher.
+    if (watcher_it == watchers.end() || !watcher_it->second.closing) return true;
+    if (now < watcher_it->second.linger_deadline) return false;
+    spdlog::info("Dropping spectator {} of a closed game with {} frames unsent.",
+                 watcher_it->second.socket.getAddressString(), watcher_it->second.queue.size());
+    remove_watcher(fd);
+    return true;
+  });
+}
+
+/**
+ * @brief Gets how long the hub thread may wait for events before a linger deadline passes.
+ * @return The timeout in milliseconds, -1 if no watcher lingers.
+ */
+int SpectatorHub::wait_timeout() const {
+  if (lingering.empty()) return -1;
+  auto first_deadline = std::chrono::steady_clock::time_point::max();
+  for (const int fd : lingering) {
+    auto watcher_it = watchers.find(fd);
+    if (watcher_it == watchers.end()) return 0;
+    first_deadline = std::min(first_deadline, watcher_it->second.linger_deadline);
+  }
+  const auto left = std::chrono::ceil<std::chrono::milliseconds>(first_deadline - std::chrono::steady_clock::now());
+  return int(std::max<std::chrono::milliseconds::rep>(left.count(), 0));
+}
+
+/**
+ * @brief Wakes up the hub thread.
+ */
+void SpectatorHub::wake() {
+  const uint64_t one = 1;
+  if (::write(wake_fd, &one, sizeof one) == -1 && errno != EAGAIN) {
+    spdlog::error("Failed to wake spectator hub: {}", strerror(errno));
+  }
+}
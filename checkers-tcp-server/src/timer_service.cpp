@@ -0,0 +1,123 @@
+/**
+ * @file timer_service.cpp
+ * @brief Implementation of the thread-safe timer service.
+ */
+
+#include "timer_service.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/**
+ * @brief Constructs a TimerService and its wake-up eventfd.
+ */
+TimerService::TimerService() {
+  event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (event_fd == -1) {
+    throw std::runtime_error("Failed to create timer eventfd: " + std::string(strerror(errno)));
+  }
+}
+
+/**
+ * @brief Closes the wake-up eventfd.
+ */
+TimerService::~TimerService() {
+  ::close(event_fd);
+}
+
+/**
+ * @brief Arms a timer that expires after the given delay.
+ * @param delay The delay from now.
+ * @param callback The callback to run on the event loop thread.
+ * @return The id of the armed timer.
+ */
+TimerService::TimerId TimerService::arm(Clock::duration delay, Callback callback) {
+  return arm_at(Clock::now() + delay, std::move(callback));
+}
+
+/**
+ * @brief Arms a timer that expires at the given time point.
+ * Wakes the event loop if it sleeps past the new deadline.
+ * @param deadline The expiry time point.
+ * @param callback The callback to run on the event loop thread.
+ * @return The id of the armed timer.
+ */
+TimerService::TimerId TimerService::arm_at(Clock::time_point deadline, Callback callback) {
+  bool wake = false;
+  TimerId id;
+  {
+    std::scoped_lock<std::mutex> lock(mutex);
+    id = wheel.arm(deadline, std::move(callback));
+    if (deadline < sleeping_until) {
+      sleeping_until = deadline;
+      wake = true;
+    }
+  }
+  if (wake) {
+    const uint64_t one = 1;
+    if (::write(event_fd, &one, sizeof one) == -1 && errno != EAGAIN) {
+      spdlog::error("Failed to wake up timer service: {}", strerror(errno));
+    }
+  }
+  return id;
+}
+
+/**
+ * @brief Cancels a timer.
+ * @param id The id of the timer.
+ * @return True if the timer was cancelled before expiring, false otherwise.
+ */
+bool TimerService::cancel(TimerId id) {
+  std::scoped_lock<std::mutex> lock(mutex);
+  return wheel.cancel(id);
+}
+
+/**
+ * @brief Gets the poll() timeout until the next timer is due.
+ * @return The timeout in milliseconds, or -1 if no timers are armed.
+ */
+int TimerService::poll_timeout() {
+  std::scoped_lock<std::mutex> lock(mutex);
+  sleeping_until = wheel.next_deadline();
+  if (sleeping_until == Clock::time_point::max()) return -1;
+
+  const auto now = Clock::now();
+  if (sleeping_until <= now) return 0;
+  const auto timeout = std::chrono::ceil<std::chrono::milliseconds>(sleeping_until - now).count();
+  return int(std::min<int64_t>(timeout, INT32_MAX));
+}
+
+/**
+ * @brief Runs the callbacks of all expired timers.
+ * @return The number of callbacks run.
+ */
+size_t TimerService::run_expired() {
+  uint64_t counter;
+  while (::read(event_fd, &counter, sizeof counter) > 0) {}
+
+  {
+    std::scoped_lock<std::mutex> lock(mutex);
+    wheel.advance(Clock::now(), expired);
+  }
+
+  const size_t count = expired.size();
+  for (auto& callback : expired) {
+    callback();
+  }
+  expired.clear();
+  return count;
+}
+
+/**
+ * @brief Gets the number of armed timers.
+ * @return The number of armed timers.
+ */
+size_t TimerService::size() {
+  std::scoped_lock<std::mutex> lock(mutex);
+  return wheel.size();
+}
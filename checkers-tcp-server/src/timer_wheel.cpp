@@ -0,0 +1,192 @@
+/**
+ * @file timer_wheel.cpp
+ * @brief Implementation of the hierarchical timer wheel.
+ */
+
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <bit>
+
+/**
+ * @brief Constructs a TimerWheel.
+ * @param tick The wheel resolution.
+ * @param start The time point of tick zero.
+ */
+TimerWheel::TimerWheel(Clock::duration tick, Clock::time_point start) : tick(tick), origin(start) {
+  heads.fill(NIL);
+}
+
+/**
+ * @brief Arms a timer.
+ * @param deadline The time point at which the timer expires.
+ * @param callback The callback to run on expiry.
+ * @return The id of the armed timer.
+ */
+TimerWheel::TimerId TimerWheel::arm(Clock::time_point deadline, Callback callback) {
+  uint32_t index;
+  if (free_head != NIL) {
+    index = free_head;
+    free_head = nodes[index].next;
+  } else {
+    index = uint32_t(nodes.size());
+    nodes.emplace_back();
+  }
+
+  // Round up so the timer never fires early.
+  uint64_t expiry = current + 1;
+  if (deadline > origin) {
+    const auto ticks = uint64_t((deadline - origin + tick - Clock::duration(1)) / tick);
+    expiry = std::max(expiry, ticks);
+  }
+  expiry = std::min(expiry, current + HORIZON - 1);
+
+  Node& node = nodes[index];
+  node.callback = std::move(callback);
+  node.expiry = expiry;
+  link(index);
+  ++armed_count;
+  return (TimerId(node.generation) << 32) | (index + 1);
+}
+
+/**
+ * @brief Cancels an armed timer.
+ * @param id The id of the timer.
+ * @return True if the timer was cancelled, false otherwise.
+ */
+bool TimerWheel::cancel(TimerId id) {
+  if (id == INVALID_TIMER) return false;
+  const uint32_t index = uint32_t(id & UINT32_MAX) - 1;
+  if (index >= nodes.size()) return false;
+  Node& node = nodes[index];
+  if (node.generation != uint32_t(id >> 32) || node.slot == NIL) return false;
+  unlink(index);
+  release(index);
+  --armed_count;
+  return true;
+}
+
+/**
+ * @brief Advances the wheel up to the given time, collecting expired callbacks.
+ * @param now The current time.
+ * @param expired The vector the expired callbacks are appended to.
+ * @return The number of expired timers.
+ */
+size_t TimerWheel::advance(Clock::time_point now, std::vector<Callback>& expired) {
+  if (now <= origin) return 0;
+  const auto target = uint64_t((now - origin) / tick);
+  size_t count = 0;
+  while (current < target) {
+    if (armed_count == 0) {
+      current = target;
+      break;
+    }
+    step(expired, count);
+  }
+  return count;
+}
+
+/**
+ * @brief Gets the time point at which the wheel next needs to be advanced.
+ * @return The next time point, or Clock::time_point::max() if no timers are armed.
+ */
+TimerWheel::Clock::time_point TimerWheel::next_deadline() const {
+  if (armed_count == 0) return Clock::time_point::max();
+
+  uint64_t next = UINT64_MAX;
+  if (occupied[0]) {
+    const uint64_t first = current + 1;
+    next = first + std::countr_zero(std::rotr(occupied[0], int(first & SLOT_MASK)));
+  }
+  if (occupied[1] | occupied[2] | occupied[3]) {
+    next = std::min(next, (current | SLOT_MASK) + 1);
+  }
+  return origin + tick * int64_t(next);
+}
+
+/**
+ * @brief Inserts a node into the slot matching its expiry.
+ * @param index The node index.
+ */
+void TimerWheel::link(uint32_t index) {
+  Node& node = nodes[index];
+  const uint64_t delta = node.expiry - current;
+  uint32_t level = 0;
+  while (level + 1 < LEVELS && delta >= (uint64_t(1) << ((level + 1) * SLOT_BITS))) ++level;
+  const uint32_t slot = uint32_t(node.expiry >> (level * SLOT_BITS)) & SLOT_MASK;
+
+  node.slot = level * SLOTS + slot;
+  node.prev = NIL;
+  node.next = heads[node.slot];
+  if (node.next != NIL) nodes[node.next].prev = index;
+  heads[node.slot] = index;
+  occupied[level] |= uint64_t(1) << slot;
+}
+
+/**
+ * @brief Removes a node from its slot list.
+ * @param index The node index.
+ */
+void TimerWheel::unlink(uint32_t index) {
+  Node& node = nodes[index];
+  if (node.prev != NIL) nodes[node.prev].next = node.next;
+  else heads[node.slot] = node.next;
+  if (node.next != NIL) nodes[node.next].prev = node.prev;
+  if (heads[node.slot] == NIL) occupied[node.slot / SLOTS] &= ~(uint64_t(1) << (node.slot & SLOT_MASK));
+  node.slot = NIL;
+}
+
+/**
+ * @brief Returns a node to the free list, invalidating its id.
+ * @param index The node index.
+ */
+void TimerWheel::release(uint32_t index) {
+  Node& node = nodes[index];
+  node.callback = nullptr;
+  ++node.generation;
+  node.next = free_head;
+  free_head = index;
+}
+
+/**
+ * @brief Moves all timers of the current slot of a level down the hierarchy.
+ * @param level The level to cascade.
+ */
+void TimerWheel::cascade(uint32_t level) {
+  const uint32_t slot = level * SLOTS + (uint32_t(current >> (level * SLOT_BITS)) & SLOT_MASK);
+  uint32_t index = heads[slot];
+  heads[slot] = NIL;
+  occupied[level] &= ~(uint64_t(1) << (slot & SLOT_MASK));
+  while (index != NIL) {
+    const uint32_t next = nodes[index].next;
+    link(index);
+    index = next;
+  }
+}
+
+/**
+ * @brief Advances the wheel by one tick.
+ * @param expired The vector the expired callbacks are appended to.
+ * @param count The counter of expired timers.
+ */
+void TimerWheel::step(std::vector<Callback>& expired, size_t& count) {
+  ++current;
+  for (uint32_t level = LEVELS - 1; level > 0; --level) {
+    if ((current & ((uint64_t(1) << (level * SLOT_BITS)) - 1)) == 0) cascade(level);
+  }
+
+  const uint32_t slot = uint32_t(current) & SLOT_MASK;
+  uint32_t index = heads[slot];
+  heads[slot] = NIL;
+  occupied[0] &= ~(uint64_t(1) << slot);
+  while (index != NIL) {
+    Node& node = nodes[index];
+    const uint32_t next = node.next;
+    node.slot = NIL;
+    expired.push_back(std::move(node.callback));
+    release(index);
+    --armed_count;
+    ++count;
+    index = next;
+  }
+}
@@ -0,0 +1,111 @@
+/**
+ * @file worker_pool.cpp
+ * @brief Implementation of the bounded work-stealing worker pool.
+ */
+
+#include "worker_pool.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+/**
+ * @brief Constructs a WorkerPool and starts its threads.
+ * @param thread_count The number of worker threads.
+ * @param max_queued The maximum number of tasks waiting to run.
+ */
+WorkerPool::WorkerPool(size_t thread_count, size_t max_queued) : max_queued(max_queued) {
+  thread_count = std::max<size_t>(thread_count, 1);
+  for (size_t i = 0; i < thread_count; ++i) {
+    workers.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back(&WorkerPool::run, this, i);
+  }
+}
+
+/**
+ * @brief Stops and joins the worker threads.
+ */
+WorkerPool::~WorkerPool() {
+  {
+    std::scoped_lock<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+/**
+ * @brief Submits a task.
+ * @param task The task to run.
+ * @return True if the task was queued, false if the pool is full or stopping.
+ */
+bool WorkerPool::submit(Task task) {
+  {
+    // Holding the lock across the push keeps the destructor from stopping the workers in between,
+    // and orders the push before a worker's emptiness check.
+    std::scoped_lock<std::mutex> lock(sleep_mutex);
+    if (stopping) {
+      return false;
+    }
+    if (queued_count.fetch_add(1) >= max_queued) {
+      --queued_count;
+      return false;
+    }
+    Worker& worker = *workers[next_worker.fetch_add(1) % workers.size()];
+    std::scoped_lock<std::mutex> worker_lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+  wake.notify_one();
+  return true;
+}
+
+/**
+ * @brief Takes a task from the own deque, or steals one from another worker.
+ * @param index The index of the calling worker.
+ * @param task The taken task.
+ * @return True if a task was taken, false otherwise.
+ */
+bool WorkerPool::try_take(size_t index, Task& task) {
+  for (size_t offset = 0; offset < workers.size(); ++offset) {
+    Worker& worker = *workers[(index + offset) % workers.size()];
+    std::scoped_lock<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) continue;
+    if (offset == 0) {
+      task = std::move(worker.tasks.front());
+      worker.tasks.pop_front();
+    } else {
+      task = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+    }
+    --queued_count;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Worker thread loop.
+ * @param index The index of the worker.
+ */
+void WorkerPool::run(size_t index) {
+  Task task;
+  while (true) {
+    if (try_take(index, task)) {
+      try {
+        task();
+      } catch (const std::exception& e) {
+        spdlog::error("Worker task failed: {}", e.what());
+      }
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    if (stopping) return;
+    wake.wait(lock, [this] { return stopping || queued_count > 0; });
+    if (stopping) return;
+  }
+}
@@ -0,0 +1,279 @@
+/**
+ * @file game_validator.cpp
+ * @brief Replays every game of a game log through the engine on all cores and reports illegal moves.
+ *
+ * Usage: CheckersGameValidator <log directory> [threads]
+ *
+ * Every segment starts as one task. The worker taking it walks the record headers and splits the
+ * segment into chunks of records, which it queues on its own deque. Workers take from the back of
+ * their own deque and steal from the front of the others, so a single large segment still spreads
+ * over all threads while the split keeps reading the mapping sequentially.
+ */
+
+#include "checkers_engine.h"
+#include "game_log.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Number of records validated as one task.
+ */
+constexpr size_t CHUNK_RECORDS = 512;
+
+/**
+ * @brief An illegal move, or a record that can't be decoded.
+ */
+struct Violation {
+  uint32_t game_id;   /**< The ID of the game. */
+  uint16_t ply;       /**< The number of moves played before the bad one. */
+  Move move;          /**< The bad move. */
+  Bitboard white;     /**< The white pieces before the move. */
+  Bitboard black;     /**< The black pieces before the move. */
+  Bitboard kings;     /**< The kings before the move. */
+  Color turn;         /**< The side to move. */
+  const char* reason; /**< Why the move was rejected. */
+};
+
+/**
+ * @brief A unit of work: a whole segment still to be split, or a chunk of records.
+ */
+struct Task {
+  std::span<const uint8_t> records; /**< The record bytes. */
+  bool is_segment = false;          /**< Whether the records are a whole segment to split first. */
+};
+
+/**
+ * @brief Results of one worker, merged when all workers are done.
+ */
+struct WorkerResult {
+  size_t games = 0;                /**< The number of validated games. */
+  size_t moves = 0;                /**< The number of replayed moves. */
+  std::vector<Violation> violations; /**< The rejected games. */
+};
+
+/**
+ * @brief Work-stealing scheduler over a fixed set of worker deques.
+ */
+class Scheduler {
+public:
+  /**
+   * @brief Constructs the scheduler with one deque per worker.
+   * @param worker_count The number of workers.
+   */
+  explicit Scheduler(size_t worker_count) {
+    for (size_t i = 0; i < worker_count; ++i) {
+      deques.push_back(std::make_unique<Deque>());
+    }
+  }
+
+  /**
+   * @brief Queues a task on the deque of a worker.
+   * @param index The index of the worker.
+   * @param task The task.
+   */
+  void push(size_t index, Task task) {
+    ++outstanding;
+    Deque& deque = *deques[index % deques.size()];
+    std::scoped_lock<std::mutex> lock(deque.mutex);
+    deque.tasks.push_back(task);
+  }
+
+  /**
+   * @brief Takes a task, from the own deque first, then from the others.
+   * @param index The index of the worker.
+   * @param task The taken task.
+   * @return True if a task was taken, false if all work is done.
+   */
+  bool take(size_t index, Task& task) {
+    while (outstanding > 0) {
+      for (size_t offset = 0; offset < deques.size(); ++offset) {
+        Deque& deque = *deques[(index + offset) % deques.size()];
+        std::scoped_lock<std::mutex> lock(deque.mutex);
+        if (deque.tasks.empty()) continue;
+        if (offset == 0) {
+          task = deque.tasks.back();
+          deque.tasks.pop_back();
+        } else {
+          task = deque.tasks.front();
+          deque.tasks.pop_front();
+        }
+        return true;
+      }
+      // Everything left is running, it may still queue chunks.
+      std::this_thread::yield();
+    }
+    return false;
+  }
+
+  /**
+   * @brief Marks a taken task as finished.
+   */
+  void done() { --outstanding; }
+
+private:
+  /**
+   * @brief Per-worker task deque.
+   */
+  struct Deque {
+    std::mutex mutex;      /**< Guards tasks. */
+    std::deque<Task> tasks; /**< The queued tasks. */
+  };
+
+  std::vector<std::unique_ptr<Deque>> deques; /**< The task deques, one per worker. */
+  std::atomic<size_t> outstanding = 0; /**< The number of queued or running tasks. */
+};
+
+/**
+ * @brief Checks a move against the rules the server enforces, plus the promotion flag.
+ * @param engine The engine in the position before the move.
+ * @param move The move.
+ * @return The reason the move is rejected, or nullptr if it is legal.
+ */
+static const char* check_move(const checkers_engine& engine, const Move& move) {
+  if (!engine.is_valid(move)) return "illegal move";
+  const Bitboard from_bit = spot_index_to_bit[move.from];
+  const bool promotes = !(engine.kings_bitboard() & from_bit) && (spot_index_to_bit[move.to] & OPPOSITE_BASE[engine.turn]);
+  if (bool(move.type & MoveType::PROMOTION) != promotes) return "wrong promotion flag";
+  return nullptr;
+}
+
+/**
+ * @brief Replays one game.
+ * @param record The game record.
+ * @param result The results of the worker.
+ */
+static void validate_record(const GameRecordView& record, WorkerResult& result) {
+  checkers_engine engine;
+  engine.reset();
+  uint16_t ply = 0;
+  Move bad_move{};
+  const char* reason = nullptr;
+  for (const Move& move : record) {
+    reason = check_move(engine, move);
+    if (reason) {
+      bad_move = move;
+      break;
+    }
+    engine.make_move(move);
+    ++ply;
+  }
+  if (!reason && ply < record.header().ply_count) {
+    reason = "undecodable move";
+  }
+  if (reason) {
+    result.violations.push_back({record.header().game_id, ply, bad_move, engine.pieces_bitboard(WHITE),
+                                 engine.pieces_bitboard(BLACK), engine.kings_bitboard(), engine.turn, reason});
+  }
+  result.moves += ply;
+  ++result.games;
+}
+
+/**
+ * @brief Splits a segment into chunks of records on the deque of a worker.
+ * @param scheduler The scheduler.
+ * @param index The index of the worker.
+ * @param records The record bytes of the segment.
+ */
+static void split_segment(Scheduler& scheduler, size_t index, std::span<const uint8_t> records) {
+  size_t chunk_begin = 0;
+  size_t offset = 0;
+  size_t count = 0;
+  for (GameLogSegment::Iterator it(records), end; it != end; ++it) {
+    offset += it->size();
+    if (++count == CHUNK_RECORDS) {
+      scheduler.push(index, {records.subspan(chunk_begin, offset - chunk_begin)});
+      chunk_begin = offset;
+      count = 0;
+    }
+  }
+  if (count > 0) {
+    scheduler.push(index, {records.subspan(chunk_begin, offset - chunk_begin)});
+  }
+}
+
+/**
+ * @brief Worker thread loop.
+ * @param scheduler The scheduler.
+ * @param index The index of the worker.
+ * @param result The results of the worker.
+ */
+static void run_worker(Scheduler& scheduler, size_t index, WorkerResult& result) {
+  Task task;
+  while (scheduler.take(index, task)) {
+    if (task.is_segment) {
+      split_segment(scheduler, index, task.records);
+    } else {
+      for (GameLogSegment::Iterator it(task.records), end; it != end; ++it) {
+        validate_record(*it, result);
+      }
+    }
+    scheduler.done();
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fmt::print(stderr, "Usage: {} <log directory> [threads]\n", argv[0]);
+    return 2;
+  }
+  const size_t thread_count = std::max<size_t>(1, argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency());
+
+  const auto start = std::chrono::steady_clock::now();
+  std::unique_ptr<GameLogReader> reader;
+  try {
+    reader = std::make_unique<GameLogReader>(argv[1]);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "Failed to open game log: {}\n", e.what());
+    return 2;
+  }
+
+  Scheduler scheduler(thread_count);
+  size_t total_bytes = 0;
+  for (size_t i = 0; i < reader->segments().size(); ++i) {
+    const auto records = reader->segments()[i].records();
+    total_bytes += records.size();
+    scheduler.push(i, {records, true});
+  }
+
+  std::vector<WorkerResult> results(thread_count);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back(run_worker, std::ref(scheduler), i, std::ref(results[i]));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  WorkerResult total;
+  for (auto& result : results) {
+    total.games += result.games;
+    total.moves += result.moves;
+    total.violations.insert(total.violations.end(), result.violations.begin(), result.violations.end());
+  }
+  std::sort(total.violations.begin(), total.violations.end(),
+            [](const Violation& a, const Violation& b) { return a.game_id < b.game_id; });
+
+  for (const auto& violation : total.violations) {
+    fmt::print("game {} ply {}: {} {}-{} (type {}), {} to move, white {:#010x} black {:#010x} kings {:#010x}\n",
+               violation.game_id, violation.ply, violation.reason, violation.move.from, violation.move.to,
+               int(violation.move.type), violation.turn == WHITE ? "white" : "black", violation.white, violation.black,
+               violation.kings);
+  }
+  fmt::print("{} segments, {} games, {} moves, {:.1f} MiB in {:.3f} s on {} threads\n", reader->segments().size(),
+             total.games, total.moves, total_bytes / 1048576.0, elapsed.count(), thread_count);
+  fmt::print("{:.0f} games/s, {:.1f} MiB/s, {} games rejected\n", total.games / elapsed.count(),
+             total_bytes / 1048576.0 / elapsed.count(), total.violations.size());
+  return total.violations.empty() ? 0 : 1;
+}
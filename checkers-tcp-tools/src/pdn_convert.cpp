@@ -0,0 +1,141 @@
+/**
+ * @file pdn_convert.cpp
+ * @brief Converts between PDN files and server game logs.
+ *
+ * Usage:
+ *   CheckersPdnConvert import <file.pdn> <log directory>
+ *   CheckersPdnConvert export <log directory> <file.pdn>
+ */
+
+#include "game_log.h"
+#include "mapped_file.h"
+#include "pdn.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Buffered output written to the file in large blocks.
+ */
+constexpr size_t OUTPUT_BUFFER_SIZE = 1024 * 1024;
+
+/**
+ * @brief Number of rejected games printed on import.
+ */
+constexpr size_t MAX_REPORTED_ERRORS = 20;
+
+/**
+ * @brief Imports the games of a PDN file into a game log.
+ * @param pdn_path The PDN file.
+ * @param log_directory The log directory.
+ * @return The exit code.
+ */
+static int import_pdn(const char* pdn_path, const char* log_directory) {
+  const auto start = std::chrono::steady_clock::now();
+  const MappedFile file(pdn_path);
+  GameLogWriter writer(log_directory, OUTPUT_BUFFER_SIZE);
+
+  PdnReader reader(file.text());
+  PdnGame game;
+  MoveList moves;
+  std::string error;
+  size_t imported = 0;
+  size_t rejected = 0;
+  size_t plies = 0;
+  while (reader.next(game)) {
+    if (game.error == nullptr && !resolve_pdn_moves(game, moves, error)) {
+      game.error = error.c_str();
+    }
+    RecordHeader header;
+    header.result = game.result;
+    header.game_id = uint32_t(imported + rejected + 1);
+    if (game.error == nullptr && !writer.append(header, moves)) {
+      game.error = "game too long for a record";
+    }
+    if (game.error != nullptr) {
+      if (rejected++ < MAX_REPORTED_ERRORS) {
+        fmt::print(stderr, "{}:{}: {}\n", pdn_path, game.line, game.error);
+      }
+      continue;
+    }
+    ++imported;
+    plies += moves.size();
+  }
+  writer.flush();
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  const double mib = file.text().size() / 1048576.0;
+  fmt::print("imported {} games ({} jumps and moves), rejected {}\n", imported, plies, rejected);
+  fmt::print("{:.1f} MiB in {:.3f} s: {:.0f} games/s, {:.1f} MiB/s\n", mib, elapsed.count(),
+             (imported + rejected) / elapsed.count(), mib / elapsed.count());
+  return 0;
+}
+
+/**
+ * @brief Exports the games of a game log to a PDN file.
+ * @param log_directory The log directory.
+ * @param pdn_path The PDN file.
+ * @return The exit code.
+ */
+static int export_pdn(const char* log_directory, const char* pdn_path) {
+  const auto start = std::chrono::steady_clock::now();
+  const GameLogReader reader(log_directory);
+  std::FILE* out = std::fopen(pdn_path, "w");
+  if (out == nullptr) {
+    fmt::print(stderr, "Failed to open {}\n", pdn_path);
+    return 2;
+  }
+
+  std::string buffer;
+  buffer.reserve(OUTPUT_BUFFER_SIZE + 4096);
+  MoveList moves;
+  size_t exported = 0;
+  for (const auto& segment : reader.segments()) {
+    for (const GameRecordView& record : segment) {
+      moves.assign(record.begin(), record.end());
+      const std::string event = fmt::format("Checkers TCP game {}", record.header().game_id);
+      char date[16] = "????.??.??";
+      if (record.header().started_at_ms != 0) {
+        const std::time_t started = std::time_t(record.header().started_at_ms / 1000);
+        std::tm utc{};
+        gmtime_r(&started, &utc);
+        std::strftime(date, sizeof date, "%Y.%m.%d", &utc);
+      }
+      const PdnTag tags[] = {{"Event", event}, {"Date", date}, {"GameType", "21"}};
+      write_pdn(buffer, tags, moves, record.header().result);
+      ++exported;
+      if (buffer.size() >= OUTPUT_BUFFER_SIZE) {
+        std::fwrite(buffer.data(), 1, buffer.size(), out);
+        buffer.clear();
+      }
+    }
+  }
+  std::fwrite(buffer.data(), 1, buffer.size(), out);
+  if (std::fclose(out) != 0) {
+    fmt::print(stderr, "Failed to write {}\n", pdn_path);
+    return 2;
+  }
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  fmt::print("exported {} games in {:.3f} s: {:.0f} games/s\n", exported, elapsed.count(), exported / elapsed.count());
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 4 || (std::string_view(argv[1]) != "import" && std::string_view(argv[1]) != "export")) {
+    fmt::print(stderr, "Usage: {} import <file.pdn> <log directory>\n       {} export <log directory> <file.pdn>\n",
+               argv[0], argv[0]);
+    return 2;
+  }
+  try {
+    return std::string_view(argv[1]) == "import" ? import_pdn(argv[2], argv[3]) : export_pdn(argv[2], argv[3]);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    return 2;
+  }
+}
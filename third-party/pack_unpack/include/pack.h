@@ -48,7 +48,7 @@ int unpacki16(const unsigned char *buf);
 /*
 ** unpacku16() -- unpack a 16-bit unsigned from a char buffer (like ntohs())
 */ 
-uint16_t unpacku16(unsigned char *buf);
+uint16_t unpacku16(const unsigned char *buf);
 
 /*
 ** unpacki32() -- unpack a 32-bit int from a char buffer (like ntohl())
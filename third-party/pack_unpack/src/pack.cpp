@@ -80,7 +80,7 @@ int unpacki16(const unsigned char *buf) {
   return i;
 }
 
-uint16_t unpacku16(unsigned char *buf) {
+uint16_t unpacku16(const unsigned char *buf) {
   return ((uint16_t)buf[0]<<8) | buf[1];
 }
 